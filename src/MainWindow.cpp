@@ -9,14 +9,15 @@
 #include <QTabWidget>
 #include <QToolBar>
 
+#include "backend/AnalysisHub.h"
 #include "backend/AudioRecorder.h"
-#include "backend/AudioTap.h"
 #include "backend/EqManager.h"
 #include "backend/LogStore.h"
 #include "backend/PatchbayAutoConnectController.h"
 #include "backend/PatchbayProfileHooks.h"
 #include "backend/PipeWireGraph.h"
 #include "backend/PipeWireThread.h"
+#include "backend/ReplayBuffer.h"
 #include "settings/SettingsKeys.h"
 #include "ui/GraphPage.h"
 #include "ui/MixerPage.h"
@@ -29,15 +30,16 @@ MainWindow::MainWindow(LogStore* logs, QWidget* parent)
   m_logs = logs;
   m_pw = new PipeWireThread(this);
   m_graph = new PipeWireGraph(m_pw, this);
-  m_tap = new AudioTap(m_pw, this);
+  m_analysisHub = new AnalysisHub(m_pw, this);
   m_recorder = new AudioRecorder(m_pw, this);
+  m_replay = new ReplayBuffer(m_pw, this);
   m_eq = new EqManager(m_pw, m_graph, this);
   m_autoConnect = new PatchbayAutoConnectController(m_graph, this);
 
   m_tabs = new QTabWidget(this);
   m_mixerPage = new MixerPage(m_pw, m_graph, m_eq, this);
   m_tabs->addTab(m_mixerPage, tr("Mixer"));
-  m_visualizerPage = new VisualizerPage(m_graph, m_tap, this);
+  m_visualizerPage = new VisualizerPage(m_graph, m_analysisHub, this);
   m_tabs->addTab(m_visualizerPage, tr("Visualizer"));
   m_patchbayPage = new PatchbayPage(m_graph, this);
   m_tabs->addTab(m_patchbayPage, tr("Patchbay"));
@@ -62,13 +64,16 @@ MainWindow::MainWindow(LogStore* logs, QWidget* parent)
         m_logs->append(LogStore::Level::Error, QStringLiteral("Headroom/Recorder"), msg);
       }
     });
+    connect(m_replay, &ReplayBuffer::errorOccurred, this, [this](const QString& msg) {
+      if (m_logs) {
+        m_logs->append(LogStore::Level::Warning, QStringLiteral("Headroom/Replay"), msg);
+      }
+    });
   }
 
   connect(m_mixerPage, &MixerPage::visualizerTapRequested, this, [this](const QString& targetObject, bool captureSink) {
     if (m_visualizerPage) {
       m_visualizerPage->setTapTarget(targetObject, captureSink);
-    } else if (m_tap) {
-      m_tap->setTarget(captureSink, targetObject);
     }
     if (m_tabs) {
       m_tabs->setCurrentIndex(1);
@@ -100,6 +105,16 @@ MainWindow::MainWindow(LogStore* logs, QWidget* parent)
 
   setupTray();
 
+  // The replay history follows the PipeWire connection: it cannot outlive the core it captures from.
+  connect(m_pw, &PipeWireThread::connectionChanged, this, [this](bool connected) {
+    QSettings s;
+    const bool enabled = s.value(QStringLiteral("recording/replayEnabled"), false).toBool();
+    setReplayEnabled(connected && enabled);
+  });
+  if (QSettings{}.value(QStringLiteral("recording/replayEnabled"), false).toBool()) {
+    setReplayEnabled(true);
+  }
+
   connect(qApp, &QCoreApplication::aboutToQuit, this, [this]() {
     QSettings s;
     const QString active = s.value(SettingsKeys::patchbayActiveProfileName()).toString().trimmed();
@@ -123,8 +138,6 @@ void MainWindow::setVisualizerTapTarget(const QString& targetObject, bool captur
 {
   if (m_visualizerPage) {
     m_visualizerPage->setTapTarget(targetObject, captureSink);
-  } else if (m_tap) {
-    m_tap->setTarget(captureSink, targetObject);
   }
 }
 
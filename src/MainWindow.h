@@ -11,8 +11,9 @@ class VisualizerPage;
 class PatchbayPage;
 class PipeWireThread;
 class PipeWireGraph;
-class AudioTap;
+class AnalysisHub;
 class AudioRecorder;
+class ReplayBuffer;
 class EqManager;
 class PatchbayAutoConnectController;
 class QAction;
@@ -56,11 +57,14 @@ private:
   void applyTrayVolumePercent(int percent);
   void rebuildTrayProfilesMenu();
   void requestExitFromTray();
+  void setReplayEnabled(bool enabled);
+  void saveReplayFromTray();
 
   PipeWireThread* m_pw = nullptr;
   PipeWireGraph* m_graph = nullptr;
-  AudioTap* m_tap = nullptr;
+  AnalysisHub* m_analysisHub = nullptr;
   AudioRecorder* m_recorder = nullptr;
+  ReplayBuffer* m_replay = nullptr;
   EqManager* m_eq = nullptr;
   PatchbayAutoConnectController* m_autoConnect = nullptr;
   LogStore* m_logs = nullptr;
@@ -74,6 +78,8 @@ private:
   QMenu* m_trayMenu = nullptr;
   QMenu* m_trayProfilesMenu = nullptr;
   QAction* m_trayMuteAction = nullptr;
+  QAction* m_trayReplayAction = nullptr;
+  QAction* m_traySaveReplayAction = nullptr;
   QWidgetAction* m_trayVolumeAction = nullptr;
   QSlider* m_trayVolumeSlider = nullptr;
   QLabel* m_trayVolumeLabel = nullptr;
@@ -2,7 +2,7 @@
 
 #include <QSettings>
 
-#include "backend/AudioTap.h"
+#include "backend/AnalysisHub.h"
 #include "backend/EqManager.h"
 #include "settings/VisualizerSettings.h"
 #include "ui/AppTheme.h"
@@ -37,8 +37,8 @@ void MainWindow::openSettings()
     const VisualizerSettings cfg = VisualizerSettingsStore::load(s);
     if (m_visualizerPage) {
       m_visualizerPage->applySettings(cfg);
-    } else if (m_tap) {
-      m_tap->applySettings(cfg);
+    } else if (m_analysisHub) {
+      m_analysisHub->applySettings(cfg);
     }
   });
   dlg.exec();
@@ -6,6 +6,7 @@
 #include <QAction>
 #include <QApplication>
 #include <QCloseEvent>
+#include <QDir>
 #include <QHBoxLayout>
 #include <QIcon>
 #include <QLabel>
@@ -18,9 +19,12 @@
 #include <QWidget>
 #include <QWidgetAction>
 
+#include "backend/AudioRecorder.h"
 #include "backend/PatchbayProfileHooks.h"
 #include "backend/PatchbayProfiles.h"
 #include "backend/PipeWireGraph.h"
+#include "backend/PipeWireThread.h"
+#include "backend/ReplayBuffer.h"
 #include "settings/SettingsKeys.h"
 #include "ui/MixerPage.h"
 #include "ui/PatchbayPage.h"
@@ -30,6 +34,9 @@ void MainWindow::closeEvent(QCloseEvent* event)
   if (m_tray && !m_trayExitRequested) {
     event->ignore();
     hide();
+    if (m_mixerPage) {
+      m_mixerPage->setInTray(true);
+    }
 
     QSettings s;
     const bool alreadyNotified = s.value(QStringLiteral("tray/closeNotified"), false).toBool();
@@ -96,6 +103,32 @@ void MainWindow::setupTray()
 
   m_trayMenu->addSeparator();
 
+  m_trayReplayAction = m_trayMenu->addAction(tr("Keep Replay History"));
+  m_trayReplayAction->setCheckable(true);
+  connect(m_trayReplayAction, &QAction::triggered, this, [this](bool checked) {
+    QSettings s;
+    s.setValue(QStringLiteral("recording/replayEnabled"), checked);
+    setReplayEnabled(checked);
+  });
+
+  m_traySaveReplayAction = m_trayMenu->addAction(QIcon::fromTheme(QStringLiteral("document-save")), tr("Save Replay"));
+  connect(m_traySaveReplayAction, &QAction::triggered, this, &MainWindow::saveReplayFromTray);
+
+  if (m_replay) {
+    connect(m_replay, &ReplayBuffer::dumpFinished, this, [this](const QString& filePath, bool ok, const QString& error) {
+      if (!m_tray) {
+        return;
+      }
+      if (ok) {
+        m_tray->showMessage(tr("Headroom"), tr("Replay saved to %1").arg(filePath), QSystemTrayIcon::Information);
+      } else {
+        m_tray->showMessage(tr("Headroom"), tr("Saving the replay failed: %1").arg(error), QSystemTrayIcon::Warning);
+      }
+    });
+  }
+
+  m_trayMenu->addSeparator();
+
   m_trayProfilesMenu = m_trayMenu->addMenu(tr("Profiles"));
   connect(m_trayProfilesMenu, &QMenu::aboutToShow, this, &MainWindow::rebuildTrayProfilesMenu);
 
@@ -195,6 +228,64 @@ void MainWindow::refreshTrayUi()
   }
   m_tray->setIcon(icon);
   m_tray->setToolTip(tr("Headroom — Output %1%").arg(std::clamp(percent, 0, 200)));
+
+  const bool replaying = m_replay && m_replay->isRunning();
+  if (m_trayReplayAction) {
+    QSignalBlocker b(m_trayReplayAction);
+    m_trayReplayAction->setChecked(replaying);
+  }
+  if (m_traySaveReplayAction) {
+    const double buffered = replaying ? m_replay->bufferedSeconds() : 0.0;
+    m_traySaveReplayAction->setEnabled(replaying && buffered > 0.0 && !m_replay->isDumping());
+    if (buffered >= 60.0) {
+      m_traySaveReplayAction->setText(tr("Save Replay (last %1 min)").arg(static_cast<int>(buffered / 60.0)));
+    } else if (buffered > 0.0) {
+      m_traySaveReplayAction->setText(tr("Save Replay (last %1 s)").arg(static_cast<int>(buffered)));
+    } else {
+      m_traySaveReplayAction->setText(tr("Save Replay"));
+    }
+  }
+}
+
+void MainWindow::setReplayEnabled(bool enabled)
+{
+  if (!m_replay) {
+    return;
+  }
+  if (!enabled) {
+    m_replay->stop();
+    scheduleTrayRefresh();
+    return;
+  }
+  if (m_replay->isRunning() || !m_pw || !m_pw->isConnected()) {
+    return;
+  }
+
+  QSettings s;
+  s.beginGroup(QStringLiteral("recording"));
+  ReplayBuffer::StartOptions o;
+  o.seconds = s.value(QStringLiteral("replaySeconds"), ReplayBuffer::kDefaultSeconds).toInt();
+  s.endGroup();
+  m_replay->start(o);
+  scheduleTrayRefresh();
+}
+
+void MainWindow::saveReplayFromTray()
+{
+  if (!m_replay || !m_replay->isRunning()) {
+    return;
+  }
+
+  QSettings s;
+  s.beginGroup(QStringLiteral("recording"));
+  const auto format =
+      AudioRecorder::formatFromString(s.value(QStringLiteral("format")).toString()).value_or(AudioRecorder::Format::Wav);
+  s.endGroup();
+
+  const QString path = m_replay->dump(QDir::home().filePath(QStringLiteral("headroom-{target}-{datetime}.{ext}")), format, 0.0);
+  if (path.isEmpty() && m_tray) {
+    m_tray->showMessage(tr("Headroom"), tr("Saving the replay failed: %1").arg(m_replay->lastError()), QSystemTrayIcon::Warning);
+  }
 }
 
 void MainWindow::showTabFromTray(const QString& key)
@@ -203,6 +294,9 @@ void MainWindow::showTabFromTray(const QString& key)
   raise();
   activateWindow();
   selectTabByKey(key);
+  if (m_mixerPage) {
+    m_mixerPage->setInTray(false);
+  }
 }
 
 void MainWindow::toggleTrayMute()
@@ -0,0 +1,154 @@
+#include "AnalysisHub.h"
+
+#include "AudioTap.h"
+
+#include <QTimer>
+
+#include <algorithm>
+
+AnalysisSubscription::AnalysisSubscription(AnalysisHub* hub, bool captureSink, const QString& targetObject, QObject* owner)
+    : QObject(owner)
+    , m_hub(hub)
+    , m_targetObject(targetObject)
+    , m_captureSink(captureSink)
+{
+  m_timer = new QTimer(this);
+  m_timer->setInterval(m_refreshIntervalMs);
+  connect(m_timer, &QTimer::timeout, this, &AnalysisSubscription::updated);
+  attach();
+}
+
+AnalysisSubscription::~AnalysisSubscription()
+{
+  detach();
+}
+
+void AnalysisSubscription::attach()
+{
+  if (!m_hub) {
+    return;
+  }
+  const AnalysisHub::Key key{m_targetObject, m_captureSink};
+  m_tap = m_hub->acquire(key);
+  if (m_tap) {
+    m_stateConnection = connect(m_tap, &AudioTap::streamStateChanged, this, &AnalysisSubscription::streamStateChanged);
+  }
+  if (m_active) {
+    m_hub->setActive(key, true);
+  }
+}
+
+void AnalysisSubscription::detach()
+{
+  disconnect(m_stateConnection);
+  m_tap = nullptr;
+  if (m_hub) {
+    m_hub->release(AnalysisHub::Key{m_targetObject, m_captureSink}, m_active);
+  }
+}
+
+void AnalysisSubscription::setTarget(bool captureSink, const QString& targetObject)
+{
+  if (captureSink == m_captureSink && targetObject == m_targetObject) {
+    return;
+  }
+  detach();
+  m_captureSink = captureSink;
+  m_targetObject = targetObject;
+  attach();
+  emit tapChanged();
+}
+
+void AnalysisSubscription::setActive(bool active)
+{
+  if (active == m_active) {
+    return;
+  }
+  m_active = active;
+  if (m_hub) {
+    m_hub->setActive(AnalysisHub::Key{m_targetObject, m_captureSink}, active);
+  }
+  if (active) {
+    m_timer->start(m_refreshIntervalMs);
+  } else {
+    m_timer->stop();
+  }
+}
+
+void AnalysisSubscription::setRefreshIntervalMs(int intervalMs)
+{
+  m_refreshIntervalMs = std::clamp(intervalMs, 8, 1000);
+  m_timer->setInterval(m_refreshIntervalMs);
+}
+
+AnalysisHub::AnalysisHub(PipeWireThread* pw, QObject* parent)
+    : QObject(parent)
+    , m_pw(pw)
+{
+}
+
+AnalysisHub::~AnalysisHub()
+{
+  // Subscriptions hold QPointers to the hub and their taps, so outliving it is harmless.
+  for (auto& [key, stream] : m_streams) {
+    delete stream.tap;
+  }
+  m_streams.clear();
+}
+
+AnalysisSubscription* AnalysisHub::subscribe(bool captureSink, const QString& targetObject, QObject* owner)
+{
+  return new AnalysisSubscription(this, captureSink, targetObject, owner);
+}
+
+void AnalysisHub::applySettings(const VisualizerSettings& settings)
+{
+  m_settings = settings;
+  for (auto& [key, stream] : m_streams) {
+    stream.tap->applySettings(settings);
+  }
+}
+
+AudioTap* AnalysisHub::acquire(const Key& key)
+{
+  Stream& stream = m_streams[key];
+  if (!stream.tap) {
+    stream.tap = new AudioTap(m_pw, this);
+    stream.tap->setEnabled(false);
+    stream.tap->setTarget(key.second, key.first);
+    if (m_settings.has_value()) {
+      stream.tap->applySettings(*m_settings);
+    }
+  }
+  ++stream.subscribers;
+  return stream.tap;
+}
+
+void AnalysisHub::release(const Key& key, bool wasActive)
+{
+  auto it = m_streams.find(key);
+  if (it == m_streams.end()) {
+    return;
+  }
+  if (wasActive) {
+    setActive(key, false);
+  }
+  if (--it->second.subscribers > 0) {
+    return;
+  }
+  // Deferred so a subscriber reacting to one of the tap's signals never deletes it mid-emit.
+  it->second.tap->setEnabled(false);
+  it->second.tap->deleteLater();
+  m_streams.erase(it);
+}
+
+void AnalysisHub::setActive(const Key& key, bool active)
+{
+  auto it = m_streams.find(key);
+  if (it == m_streams.end()) {
+    return;
+  }
+  Stream& stream = it->second;
+  stream.active = std::max(0, stream.active + (active ? 1 : -1));
+  stream.tap->setEnabled(stream.active > 0);
+}
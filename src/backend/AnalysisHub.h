@@ -0,0 +1,113 @@
+#pragma once
+
+#include "settings/VisualizerSettings.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+#include <map>
+#include <optional>
+#include <utility>
+
+class AnalysisHub;
+class AudioTap;
+class PipeWireThread;
+class QTimer;
+
+// One consumer of a shared analysis stream.
+//
+// A subscription points at the AudioTap the hub keeps for its (target, captureSink) pair and
+// ticks updated() at its own refresh interval while active, so a 60 FPS visualizer and a 10 Hz
+// readout on the same node share one capture stream and one set of FFTs. Subscriptions live on
+// the GUI thread (the tap's published results have a single reader).
+class AnalysisSubscription final : public QObject
+{
+  Q_OBJECT
+
+public:
+  ~AnalysisSubscription() override;
+
+  AnalysisSubscription(const AnalysisSubscription&) = delete;
+  AnalysisSubscription& operator=(const AnalysisSubscription&) = delete;
+
+  // Shared tap for the current target; may be null if the hub is gone.
+  AudioTap* tap() const { return m_tap; }
+
+  QString targetObject() const { return m_targetObject; }
+  bool captureSink() const { return m_captureSink; }
+
+  // Moves this subscriber to another shared stream (creating it on first use).
+  void setTarget(bool captureSink, const QString& targetObject);
+
+  // Capture runs while at least one subscriber of a stream is active.
+  bool isActive() const { return m_active; }
+  void setActive(bool active);
+
+  int refreshIntervalMs() const { return m_refreshIntervalMs; }
+  void setRefreshIntervalMs(int intervalMs);
+
+signals:
+  // Emitted every refreshIntervalMs() while active.
+  void updated();
+  // The subscription now points at a different tap (after setTarget()).
+  void tapChanged();
+  void streamStateChanged(QString state);
+
+private:
+  friend class AnalysisHub;
+  AnalysisSubscription(AnalysisHub* hub, bool captureSink, const QString& targetObject, QObject* owner);
+
+  void attach();
+  void detach();
+
+  QPointer<AnalysisHub> m_hub;
+  QPointer<AudioTap> m_tap;
+  QMetaObject::Connection m_stateConnection;
+  QTimer* m_timer = nullptr;
+  QString m_targetObject;
+  bool m_captureSink = false;
+  bool m_active = false;
+  int m_refreshIntervalMs = 33;
+};
+
+// Owns one AudioTap per (target object, capture-sink flag) and hands out ref-counted
+// subscriptions to it. A tap is created by its first subscriber, enabled only while some
+// subscriber is active, and destroyed with its last subscriber.
+class AnalysisHub final : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit AnalysisHub(PipeWireThread* pw, QObject* parent = nullptr);
+  ~AnalysisHub() override;
+
+  AnalysisHub(const AnalysisHub&) = delete;
+  AnalysisHub& operator=(const AnalysisHub&) = delete;
+
+  // The returned subscription is a child of `owner` and releases its stream when destroyed.
+  AnalysisSubscription* subscribe(bool captureSink, const QString& targetObject, QObject* owner);
+
+  // Analysis settings are shared by every stream (and applied to ones created later).
+  void applySettings(const VisualizerSettings& settings);
+
+  int streamCount() const { return static_cast<int>(m_streams.size()); }
+
+private:
+  friend class AnalysisSubscription;
+
+  using Key = std::pair<QString, bool>;
+  struct Stream final {
+    AudioTap* tap = nullptr;
+    int subscribers = 0;
+    int active = 0;
+  };
+
+  AudioTap* acquire(const Key& key);
+  void release(const Key& key, bool wasActive);
+  void setActive(const Key& key, bool active);
+
+  PipeWireThread* m_pw = nullptr;
+  std::map<Key, Stream> m_streams;
+  std::optional<VisualizerSettings> m_settings;
+};
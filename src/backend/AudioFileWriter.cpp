@@ -0,0 +1,46 @@
+#include "AudioFileWriter.h"
+
+SndfileWriter::SndfileWriter(SNDFILE* file, uint32_t channels)
+    : AudioFileWriter(channels)
+    , m_file(file)
+{
+}
+
+SndfileWriter::~SndfileWriter()
+{
+  (void)close();
+}
+
+bool SndfileWriter::write(const float* interleaved, uint64_t frames)
+{
+  if (!m_file) {
+    m_error = QStringLiteral("File is closed.");
+    return false;
+  }
+  const sf_count_t wrote = sf_writef_float(m_file, interleaved, static_cast<sf_count_t>(frames));
+  if (wrote != static_cast<sf_count_t>(frames)) {
+    m_error = QString::fromLocal8Bit(sf_strerror(m_file));
+    return false;
+  }
+  return true;
+}
+
+bool SndfileWriter::close()
+{
+  if (!m_file) {
+    return true;
+  }
+  sf_write_sync(m_file);
+  const int rc = sf_close(m_file);
+  m_file = nullptr;
+  if (rc != 0) {
+    m_error = QString::fromLocal8Bit(sf_error_number(rc));
+    return false;
+  }
+  return true;
+}
+
+QString SndfileWriter::errorString() const
+{
+  return m_error;
+}
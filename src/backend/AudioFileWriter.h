@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QString>
+
+#include <cstdint>
+
+#include <sndfile.h>
+
+// Destination for recorded audio: interleaved float frames in, a finished file out. The recorders
+// only see this interface, so a format can be written by libsndfile or by a native writer.
+class AudioFileWriter
+{
+public:
+  virtual ~AudioFileWriter() = default;
+
+  AudioFileWriter(const AudioFileWriter&) = delete;
+  AudioFileWriter& operator=(const AudioFileWriter&) = delete;
+
+  // Appends `frames` interleaved frames of `channels()` samples. On failure errorString() says why.
+  virtual bool write(const float* interleaved, uint64_t frames) = 0;
+  // Finalizes the headers and flushes the file to disk. Safe to call more than once; the
+  // destructor closes too, without reporting errors.
+  virtual bool close() = 0;
+  virtual QString errorString() const = 0;
+
+  uint32_t channels() const { return m_channels; }
+
+protected:
+  explicit AudioFileWriter(uint32_t channels)
+      : m_channels(channels)
+  {
+  }
+
+private:
+  uint32_t m_channels = 0;
+};
+
+// Any format libsndfile can encode. Takes ownership of an open SNDFILE.
+class SndfileWriter final : public AudioFileWriter
+{
+public:
+  SndfileWriter(SNDFILE* file, uint32_t channels);
+  ~SndfileWriter() override;
+
+  bool write(const float* interleaved, uint64_t frames) override;
+  bool close() override;
+  QString errorString() const override;
+
+private:
+  SNDFILE* m_file = nullptr;
+  QString m_error;
+};
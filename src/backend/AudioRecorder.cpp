@@ -1,11 +1,15 @@
 #include "AudioRecorder.h"
 
 #include "PipeWireThread.h"
+#include "WavFileWriter.h"
+#include "dsp/SimdKernels.h"
 
 #include <QDateTime>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QMetaObject>
+#include <QStringList>
 
 #include <pipewire/keys.h>
 #include <pipewire/properties.h>
@@ -17,12 +21,148 @@
 #include <spa/utils/result.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 
 namespace {
 
 constexpr float kMinDb = -100.0f;
 
+// Slack between the process callback and the disk: ~21 s of 48 kHz stereo, ~2.7 s of 8 channels
+// at 96 kHz.
+constexpr std::size_t kRingSamples = std::size_t{1} << 21;
+constexpr std::size_t kWriteBlockFrames = 16384;
+constexpr auto kWriterPollInterval = std::chrono::milliseconds(50);
+
+int sndfileChannel(uint32_t position)
+{
+  switch (position) {
+    case SPA_AUDIO_CHANNEL_MONO:
+      return SF_CHANNEL_MAP_MONO;
+    case SPA_AUDIO_CHANNEL_FL:
+      return SF_CHANNEL_MAP_FRONT_LEFT;
+    case SPA_AUDIO_CHANNEL_FR:
+      return SF_CHANNEL_MAP_FRONT_RIGHT;
+    case SPA_AUDIO_CHANNEL_FC:
+      return SF_CHANNEL_MAP_FRONT_CENTER;
+    case SPA_AUDIO_CHANNEL_LFE:
+      return SF_CHANNEL_MAP_LFE;
+    case SPA_AUDIO_CHANNEL_RL:
+      return SF_CHANNEL_MAP_REAR_LEFT;
+    case SPA_AUDIO_CHANNEL_RR:
+      return SF_CHANNEL_MAP_REAR_RIGHT;
+    case SPA_AUDIO_CHANNEL_FLC:
+      return SF_CHANNEL_MAP_FRONT_LEFT_OF_CENTER;
+    case SPA_AUDIO_CHANNEL_FRC:
+      return SF_CHANNEL_MAP_FRONT_RIGHT_OF_CENTER;
+    case SPA_AUDIO_CHANNEL_RC:
+      return SF_CHANNEL_MAP_REAR_CENTER;
+    case SPA_AUDIO_CHANNEL_SL:
+      return SF_CHANNEL_MAP_SIDE_LEFT;
+    case SPA_AUDIO_CHANNEL_SR:
+      return SF_CHANNEL_MAP_SIDE_RIGHT;
+    case SPA_AUDIO_CHANNEL_TC:
+      return SF_CHANNEL_MAP_TOP_CENTER;
+    case SPA_AUDIO_CHANNEL_TFL:
+      return SF_CHANNEL_MAP_TOP_FRONT_LEFT;
+    case SPA_AUDIO_CHANNEL_TFC:
+      return SF_CHANNEL_MAP_TOP_FRONT_CENTER;
+    case SPA_AUDIO_CHANNEL_TFR:
+      return SF_CHANNEL_MAP_TOP_FRONT_RIGHT;
+    case SPA_AUDIO_CHANNEL_TRL:
+      return SF_CHANNEL_MAP_TOP_REAR_LEFT;
+    case SPA_AUDIO_CHANNEL_TRC:
+      return SF_CHANNEL_MAP_TOP_REAR_CENTER;
+    case SPA_AUDIO_CHANNEL_TRR:
+      return SF_CHANNEL_MAP_TOP_REAR_RIGHT;
+    default:
+      return SF_CHANNEL_MAP_INVALID;
+  }
+}
+
+// WAVE_FORMAT_EXTENSIBLE speaker bits. The mask can only describe channels that appear in this
+// order, each at most once; anything else is written unpositioned.
+uint32_t waveSpeakerBit(uint32_t position)
+{
+  switch (position) {
+    case SPA_AUDIO_CHANNEL_MONO:
+    case SPA_AUDIO_CHANNEL_FC:
+      return 0x4;
+    case SPA_AUDIO_CHANNEL_FL:
+      return 0x1;
+    case SPA_AUDIO_CHANNEL_FR:
+      return 0x2;
+    case SPA_AUDIO_CHANNEL_LFE:
+      return 0x8;
+    case SPA_AUDIO_CHANNEL_RL:
+      return 0x10;
+    case SPA_AUDIO_CHANNEL_RR:
+      return 0x20;
+    case SPA_AUDIO_CHANNEL_FLC:
+      return 0x40;
+    case SPA_AUDIO_CHANNEL_FRC:
+      return 0x80;
+    case SPA_AUDIO_CHANNEL_RC:
+      return 0x100;
+    case SPA_AUDIO_CHANNEL_SL:
+      return 0x200;
+    case SPA_AUDIO_CHANNEL_SR:
+      return 0x400;
+    case SPA_AUDIO_CHANNEL_TC:
+      return 0x800;
+    case SPA_AUDIO_CHANNEL_TFL:
+      return 0x1000;
+    case SPA_AUDIO_CHANNEL_TFC:
+      return 0x2000;
+    case SPA_AUDIO_CHANNEL_TFR:
+      return 0x4000;
+    case SPA_AUDIO_CHANNEL_TRL:
+      return 0x8000;
+    case SPA_AUDIO_CHANNEL_TRC:
+      return 0x10000;
+    case SPA_AUDIO_CHANNEL_TRR:
+      return 0x20000;
+    default:
+      return 0;
+  }
+}
+
+dsp::LoudnessChannel loudnessChannel(uint32_t position)
+{
+  switch (position) {
+    case SPA_AUDIO_CHANNEL_LFE:
+    case SPA_AUDIO_CHANNEL_LFE2:
+      return dsp::LoudnessChannel::Lfe;
+    case SPA_AUDIO_CHANNEL_SL:
+    case SPA_AUDIO_CHANNEL_SR:
+    case SPA_AUDIO_CHANNEL_RL:
+    case SPA_AUDIO_CHANNEL_RR:
+      return dsp::LoudnessChannel::Surround;
+    default:
+      return dsp::LoudnessChannel::Front;
+  }
+}
+
+uint32_t waveChannelMask(const uint32_t* positions, uint32_t channels)
+{
+  uint32_t mask = 0;
+  uint32_t previous = 0;
+  for (uint32_t c = 0; c < channels; ++c) {
+    const uint32_t bit = waveSpeakerBit(positions[c]);
+    if (bit == 0 || bit <= previous) {
+      return 0;
+    }
+    mask |= bit;
+    previous = bit;
+  }
+  return mask;
+}
+
+bool isOpusRate(uint32_t rate)
+{
+  return rate == 8000 || rate == 12000 || rate == 16000 || rate == 24000 || rate == 48000;
+}
+
 const char* stateToString(pw_stream_state state)
 {
   switch (state) {
@@ -97,10 +237,19 @@ QString AudioRecorder::formatToString(Format format)
       return QStringLiteral("wav");
     case Format::Flac:
       return QStringLiteral("flac");
+    case Format::Opus:
+      return QStringLiteral("opus");
+    case Format::Vorbis:
+      return QStringLiteral("vorbis");
   }
   return QStringLiteral("wav");
 }
 
+bool AudioRecorder::isCompressedFormat(Format format)
+{
+  return format != Format::Wav;
+}
+
 std::optional<AudioRecorder::Format> AudioRecorder::formatFromString(const QString& s)
 {
   const QString v = s.trimmed().toLower();
@@ -110,12 +259,24 @@ std::optional<AudioRecorder::Format> AudioRecorder::formatFromString(const QStri
   if (v == QStringLiteral("flac")) {
     return Format::Flac;
   }
+  if (v == QStringLiteral("opus")) {
+    return Format::Opus;
+  }
+  if (v == QStringLiteral("vorbis") || v == QStringLiteral("ogg")) {
+    return Format::Vorbis;
+  }
   return std::nullopt;
 }
 
+std::optional<AudioRecorder::Format> AudioRecorder::formatFromFileName(const QString& path)
+{
+  const QString suffix = QFileInfo(path.trimmed()).suffix();
+  return suffix.isEmpty() ? std::nullopt : formatFromString(suffix);
+}
+
 QString AudioRecorder::defaultExtensionForFormat(Format format)
 {
-  return formatToString(format);
+  return format == Format::Vorbis ? QStringLiteral("ogg") : formatToString(format);
 }
 
 QString AudioRecorder::ensureFileExtension(QString path, Format format)
@@ -133,7 +294,8 @@ QString AudioRecorder::ensureFileExtension(QString path, Format format)
   }
 
   const QString suffixLower = suffix.toLower();
-  if ((suffixLower == QStringLiteral("wav") || suffixLower == QStringLiteral("flac")) && suffixLower != wanted) {
+  static const QStringList known{QStringLiteral("wav"), QStringLiteral("flac"), QStringLiteral("opus"), QStringLiteral("ogg")};
+  if (known.contains(suffixLower) && suffixLower != wanted) {
     QString out = path;
     out.chop(suffix.size());
     return out + wanted;
@@ -167,6 +329,34 @@ QString AudioRecorder::expandPathTemplate(const QString& templateOrPath, const Q
   return ensureFileExtension(out, format);
 }
 
+double AudioRecorder::backlogSeconds() const
+{
+  const uint32_t rate = sampleRate();
+  const uint32_t ch = std::max<uint32_t>(1u, channels());
+  return rate > 0 ? static_cast<double>(m_ring.readAvailable() / ch) / static_cast<double>(rate) : 0.0;
+}
+
+double AudioRecorder::encoderSpeed() const
+{
+  const uint64_t ns = m_encodeNs.load(std::memory_order_relaxed);
+  const uint32_t rate = sampleRate();
+  if (ns == 0 || rate == 0) {
+    return 0.0;
+  }
+  const double audioSeconds = static_cast<double>(framesCaptured()) / static_cast<double>(rate);
+  return audioSeconds / (static_cast<double>(ns) * 1e-9);
+}
+
+float AudioRecorder::channelPeakDb(uint32_t channel) const
+{
+  return channel < kMaxChannels ? m_channelPeakDb[channel].load(std::memory_order_relaxed) : kMinDb;
+}
+
+float AudioRecorder::channelRmsDb(uint32_t channel) const
+{
+  return channel < kMaxChannels ? m_channelRmsDb[channel].load(std::memory_order_relaxed) : kMinDb;
+}
+
 QString AudioRecorder::lastError() const
 {
   std::lock_guard<std::mutex> lock(m_errorMutex);
@@ -180,7 +370,12 @@ pw_stream_state AudioRecorder::streamState() const
 
 QString AudioRecorder::streamStateString() const
 {
-  return QString::fromUtf8(stateToString(streamState()));
+  return streamStateToString(streamState());
+}
+
+QString AudioRecorder::streamStateToString(pw_stream_state state)
+{
+  return QString::fromUtf8(stateToString(state));
 }
 
 bool AudioRecorder::start(const StartOptions& options)
@@ -196,15 +391,29 @@ bool AudioRecorder::start(const StartOptions& options)
   m_streamState.store(PW_STREAM_STATE_UNCONNECTED);
   m_dataBytesWritten.store(0);
   m_framesCaptured.store(0);
+  m_droppedFrames.store(0);
+  m_encodeNs.store(0);
+  m_formatMismatch.store(false);
   m_peakDb.store(kMinDb);
   m_rmsDb.store(kMinDb);
+  for (uint32_t c = 0; c < kMaxChannels; ++c) {
+    m_channelPeakDb[c].store(kMinDb);
+    m_channelRmsDb[c].store(kMinDb);
+  }
+  m_momentaryLufs.store(dsp::LoudnessMeter::kMinLufs);
+  m_shortTermLufs.store(dsp::LoudnessMeter::kMinLufs);
+  m_integratedLufs.store(dsp::LoudnessMeter::kMinLufs);
+  m_loudnessRange.store(0.0f);
+  m_truePeakDb.store(kMinDb);
   m_sampleRate.store(48000);
   m_channels.store(2);
+  m_loudness.reset(48000, 2); // no stream yet, so nothing else touches it
   m_quantumFrames.store(0);
   m_lastBufferFrames.store(0);
   m_lastBufferBytes.store(0);
   m_captureSink.store(options.captureSink);
   m_format.store(static_cast<int>(options.format));
+  m_encoder = options.encoder;
 
   {
     std::lock_guard<std::mutex> lock(m_errorMutex);
@@ -227,31 +436,31 @@ bool AudioRecorder::start(const StartOptions& options)
     }
   }
 
-  SF_INFO info{};
-  info.samplerate = static_cast<int>(sampleRate());
-  info.channels = static_cast<int>(channels());
-  info.format = 0;
-
-  switch (options.format) {
-    case Format::Wav:
-      info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
-      break;
-    case Format::Flac:
-      info.format = SF_FORMAT_FLAC | SF_FORMAT_PCM_24;
-      break;
+  // The writer opens the file only after format negotiation, too late to fail start(), so make
+  // sure now that it can be created. An existing file is left as it is until then.
+  if (fi.isDir()) {
+    setErrorAndScheduleStop(tr("Output path is a directory."));
+    return false;
   }
-
-  const QByteArray pathLocal = resolved.toLocal8Bit();
-  m_sndFile = sf_open(pathLocal.constData(), SFM_WRITE, &info);
-  if (!m_sndFile) {
-    setErrorAndScheduleStop(tr("Failed to open output file: %1").arg(QString::fromLocal8Bit(sf_strerror(nullptr))));
+  QFile probe(resolved);
+  const bool existed = probe.exists();
+  if (!probe.open(QIODevice::ReadWrite)) {
+    setErrorAndScheduleStop(tr("Cannot write output file: %1").arg(probe.errorString()));
     return false;
   }
+  probe.close();
+  if (!existed) {
+    probe.remove();
+  }
+
+  // The file is opened by the writer once the stream has negotiated its native rate and channel
+  // layout; until then the first quanta wait in the ring. Neither side runs yet, so it can be sized
+  // here.
+  m_formatReady.store(false);
+  m_ring.reset(kRingSamples);
 
   if (!m_pw || !m_pw->isConnected() || !m_pw->threadLoop()) {
     setErrorAndScheduleStop(tr("Not connected to PipeWire."));
-    sf_close(m_sndFile);
-    m_sndFile = nullptr;
     return false;
   }
 
@@ -262,11 +471,15 @@ bool AudioRecorder::start(const StartOptions& options)
 
   if (!m_stream) {
     setErrorAndScheduleStop(tr("Failed to connect recording stream."));
-    sf_close(m_sndFile);
-    m_sndFile = nullptr;
     return false;
   }
 
+  {
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    m_writerStop = false;
+  }
+  m_writer = std::thread([this]() { writerLoop(); });
+
   emit recordingChanged(true);
   return true;
 }
@@ -294,10 +507,14 @@ void AudioRecorder::stop()
     destroyStreamLocked();
   }
 
-  if (m_sndFile) {
-    sf_write_sync(m_sndFile);
-    sf_close(m_sndFile);
-    m_sndFile = nullptr;
+  // The stream is gone, so the writer can drain everything that is left before the file closes.
+  stopWriter();
+
+  if (m_file) {
+    if (!m_file->close()) {
+      setErrorAndScheduleStop(tr("Failed to finish %1: %2").arg(m_filePath, m_file->errorString()));
+    }
+    m_file.reset();
   }
 
   if (wasRecording) {
@@ -337,12 +554,37 @@ void AudioRecorder::onStreamParamChanged(void* data, uint32_t id, const struct s
     return;
   }
 
-  if (info.rate > 0) {
-    self->m_sampleRate.store(info.rate);
+  // The file is written at whatever the first negotiation settles on; it cannot follow a later
+  // renegotiation, so that ends the recording instead of producing a mislabeled file.
+  const uint32_t rate = info.rate > 0 ? info.rate : self->sampleRate();
+  const uint32_t channelCount = info.channels > 0 ? info.channels : self->channels();
+  if (self->m_formatReady.load(std::memory_order_acquire)) {
+    if (rate != self->sampleRate() || channelCount != self->channels()) {
+      self->m_formatMismatch.store(true);
+      self->setErrorAndScheduleStop(tr("Stream format changed to %1 Hz, %2 ch while recording.").arg(rate).arg(channelCount));
+    }
+    return;
+  }
+
+  self->m_sampleRate.store(rate);
+  self->m_channels.store(channelCount);
+  self->m_positioned = (info.flags & SPA_AUDIO_FLAG_UNPOSITIONED) == 0 && info.channels <= kMaxChannels;
+  for (uint32_t c = 0; c < std::min(info.channels, kMaxChannels); ++c) {
+    self->m_positions[c] = info.position[c];
   }
-  if (info.channels > 0) {
-    self->m_channels.store(info.channels);
+
+  const uint32_t ch = std::max<uint32_t>(1u, self->channels());
+  self->m_levelPeaks.assign(ch, 0.0f);
+  self->m_levelSumSq.assign(ch, 0.0f);
+  self->m_levelClips.assign(ch, 0u);
+  self->m_loudness.reset(self->sampleRate(), ch);
+  if ((info.flags & SPA_AUDIO_FLAG_UNPOSITIONED) == 0) {
+    for (uint32_t c = 0; c < std::min(ch, SPA_AUDIO_MAX_CHANNELS); ++c) {
+      self->m_loudness.setChannelWeight(c, dsp::loudnessChannelWeight(loudnessChannel(info.position[c])));
+    }
   }
+
+  self->m_formatReady.store(true, std::memory_order_release);
 }
 
 void AudioRecorder::onStreamProcess(void* data)
@@ -397,16 +639,10 @@ void AudioRecorder::connectStreamLocked()
   }();
   pw_stream_add_listener(m_stream, &m_streamListener, &streamEvents, this);
 
+  // Only the sample format is fixed; rate and channel layout follow the target, so nothing gets
+  // resampled or remixed on the way in.
   spa_audio_info_raw info{};
   info.format = SPA_AUDIO_FORMAT_F32;
-  info.rate = sampleRate();
-  info.channels = channels();
-  if (info.channels >= 1) {
-    info.position[0] = SPA_AUDIO_CHANNEL_FL;
-  }
-  if (info.channels >= 2) {
-    info.position[1] = SPA_AUDIO_CHANNEL_FR;
-  }
 
   uint8_t buffer[1024];
   spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
@@ -440,7 +676,7 @@ void AudioRecorder::destroyStreamLocked()
 
 void AudioRecorder::processBuffer(pw_buffer* buffer)
 {
-  if (!buffer || !buffer->buffer || !m_sndFile) {
+  if (!buffer || !buffer->buffer || !m_formatReady.load(std::memory_order_acquire) || m_formatMismatch.load(std::memory_order_relaxed)) {
     return;
   }
 
@@ -478,32 +714,208 @@ void AudioRecorder::processBuffer(pw_buffer* buffer)
   (void)m_quantumFrames.compare_exchange_strong(expected, framesU32);
 
   const float* samples = reinterpret_cast<const float*>(base + offset);
-  const sf_count_t frames = static_cast<sf_count_t>(framesU32);
 
-  // Levels (best-effort).
-  const size_t sampleCount = static_cast<size_t>(framesU32) * static_cast<size_t>(ch);
+  // Levels (best-effort): one vectorized pass for all channels.
+  if (m_levelPeaks.size() != ch) {
+    m_levelPeaks.resize(ch);
+    m_levelSumSq.resize(ch);
+    m_levelClips.resize(ch);
+  }
+  std::fill(m_levelPeaks.begin(), m_levelPeaks.end(), 0.0f);
+  std::fill(m_levelSumSq.begin(), m_levelSumSq.end(), 0.0f);
+  std::fill(m_levelClips.begin(), m_levelClips.end(), 0u);
+  dsp::simd::channelLevels(samples, framesU32, ch, 1.0f, m_levelPeaks.data(), m_levelSumSq.data(), m_levelClips.data());
+
   float peak = 0.0f;
   double sumSq = 0.0;
-  for (size_t i = 0; i < sampleCount; ++i) {
-    const float s = samples[i];
-    const float a = std::abs(s);
-    peak = std::max(peak, a);
-    sumSq += static_cast<double>(s) * static_cast<double>(s);
+  for (uint32_t c = 0; c < ch; ++c) {
+    peak = std::max(peak, m_levelPeaks[c]);
+    sumSq += static_cast<double>(m_levelSumSq[c]);
+    if (c < kMaxChannels) {
+      m_channelPeakDb[c].store(amplitudeToDb(m_levelPeaks[c]));
+      m_channelRmsDb[c].store(amplitudeToDb(std::sqrt(m_levelSumSq[c] / static_cast<float>(framesU32))));
+    }
   }
-  const float rms = sampleCount > 0 ? static_cast<float>(std::sqrt(sumSq / static_cast<double>(sampleCount))) : 0.0f;
+  const size_t sampleCount = static_cast<size_t>(framesU32) * static_cast<size_t>(ch);
+  const float rms = static_cast<float>(std::sqrt(sumSq / static_cast<double>(sampleCount)));
   m_peakDb.store(amplitudeToDb(peak));
   m_rmsDb.store(amplitudeToDb(rms));
 
-  const sf_count_t wrote = sf_writef_float(m_sndFile, samples, frames);
-  if (wrote > 0) {
-    m_framesCaptured.fetch_add(static_cast<uint64_t>(wrote));
-    const uint64_t rawBytes = static_cast<uint64_t>(wrote) * static_cast<uint64_t>(ch) * static_cast<uint64_t>(sizeof(float));
-    m_dataBytesWritten.fetch_add(rawBytes);
+  if (m_loudness.channels() != ch) {
+    m_loudness.reset(sampleRate(), ch);
+  }
+  m_loudness.process(samples, framesU32);
+  m_momentaryLufs.store(m_loudness.momentaryLufs());
+  m_shortTermLufs.store(m_loudness.shortTermLufs());
+  m_integratedLufs.store(m_loudness.integratedLufs());
+  m_loudnessRange.store(m_loudness.loudnessRangeLu());
+  float truePeak = 0.0f;
+  for (uint32_t c = 0; c < ch; ++c) {
+    truePeak = std::max(truePeak, m_loudness.maxTruePeak(c));
+  }
+  m_truePeakDb.store(amplitudeToDb(truePeak));
+
+  // Never block here: a whole buffer either fits into the ring or is dropped and counted, so the
+  // file stays frame-aligned.
+  if (m_ring.writeAvailable() < sampleCount) {
+    m_droppedFrames.fetch_add(framesU32, std::memory_order_relaxed);
+    return;
+  }
+  m_ring.write(samples, sampleCount);
+}
+
+std::unique_ptr<AudioFileWriter> AudioRecorder::openOutputFile(const QString& path,
+                                                               Format format,
+                                                               const EncoderOptions& encoder,
+                                                               uint32_t sampleRate,
+                                                               uint32_t channels,
+                                                               const uint32_t* positions,
+                                                               QString* error)
+{
+  channels = std::max<uint32_t>(1u, channels);
+
+  if (format == Format::Wav) {
+    return WavFileWriter::open(path, sampleRate, channels, positions ? waveChannelMask(positions, channels) : 0u, error);
   }
 
-  if (wrote != frames) {
-    setErrorAndScheduleStop(tr("Write failed: %1").arg(QString::fromLocal8Bit(sf_strerror(m_sndFile))));
+  SF_INFO info{};
+  info.samplerate = static_cast<int>(sampleRate);
+  info.channels = static_cast<int>(channels);
+  switch (format) {
+    case Format::Wav:
+    case Format::Flac:
+      info.format = SF_FORMAT_FLAC | SF_FORMAT_PCM_24;
+      break;
+    case Format::Opus:
+      info.format = SF_FORMAT_OGG | SF_FORMAT_OPUS;
+      break;
+    case Format::Vorbis:
+      info.format = SF_FORMAT_OGG | SF_FORMAT_VORBIS;
+      break;
+  }
+
+  if (format == Format::Opus && !isOpusRate(sampleRate)) {
+    if (error) {
+      *error = tr("Opus supports 8, 12, 16, 24 and 48 kHz; the stream runs at %1 Hz. Record to FLAC or Vorbis instead.").arg(sampleRate);
+    }
+    return nullptr;
+  }
+  if (!sf_format_check(&info)) {
+    if (error) {
+      *error = tr("This libsndfile cannot write %1 with %2 channels at %3 Hz.").arg(formatToString(format)).arg(channels).arg(sampleRate);
+    }
+    return nullptr;
+  }
+
+  const QByteArray pathLocal = path.toLocal8Bit();
+  SNDFILE* file = sf_open(pathLocal.constData(), SFM_WRITE, &info);
+  if (!file) {
+    if (error) {
+      *error = tr("Failed to open output file: %1").arg(QString::fromLocal8Bit(sf_strerror(nullptr)));
+    }
+    return nullptr;
+  }
+
+  // Both must be set before the first write, while the encoder is still unconfigured.
+  if (format == Format::Flac) {
+    double level = static_cast<double>(std::clamp(encoder.flacLevel, 0, kMaxFlacLevel)) / kMaxFlacLevel;
+    (void)sf_command(file, SFC_SET_COMPRESSION_LEVEL, &level, sizeof(level));
+  } else {
+    double quality = std::clamp(encoder.quality, 0.0, 1.0);
+    (void)sf_command(file, SFC_SET_VBR_ENCODING_QUALITY, &quality, sizeof(quality));
+  }
+
+  // Formats without a channel mask ignore the map.
+  if (positions) {
+    std::vector<int> map(static_cast<std::size_t>(info.channels));
+    bool mapped = true;
+    for (std::size_t c = 0; c < map.size(); ++c) {
+      map[c] = sndfileChannel(positions[c]);
+      mapped = mapped && map[c] != SF_CHANNEL_MAP_INVALID;
+    }
+    if (mapped) {
+      (void)sf_command(file, SFC_SET_CHANNEL_MAP_INFO, map.data(), static_cast<int>(map.size() * sizeof(int)));
+    }
+  }
+  return std::make_unique<SndfileWriter>(file, channels);
+}
+
+bool AudioRecorder::openFile()
+{
+  const uint32_t ch = std::max<uint32_t>(1u, channels());
+  QString error;
+  m_file = openOutputFile(m_filePath, format(), m_encoder, sampleRate(), ch, m_positioned ? m_positions.data() : nullptr, &error);
+  if (!m_file) {
+    setErrorAndScheduleStop(error);
+    return false;
+  }
+
+  m_fileChannels = ch;
+  m_writeBlock.assign(kWriteBlockFrames * m_fileChannels, 0.0f);
+  return true;
+}
+
+void AudioRecorder::writerLoop()
+{
+  for (;;) {
+    bool stopping = false;
+    {
+      std::unique_lock<std::mutex> lock(m_writerMutex);
+      m_writerCv.wait_for(lock, kWriterPollInterval, [this]() { return m_writerStop; });
+      stopping = m_writerStop;
+    }
+
+    if (!m_file) {
+      if (!m_formatReady.load(std::memory_order_acquire)) {
+        if (stopping) {
+          return;
+        }
+        continue;
+      }
+      if (!openFile()) {
+        return;
+      }
+    }
+
+    const std::size_t ch = m_fileChannels;
+    const std::size_t blockSamples = m_writeBlock.size();
+
+    // Full blocks while recording; the remainder once the stream has gone away.
+    for (;;) {
+      const std::size_t available = m_ring.readAvailable() / ch * ch;
+      if (available == 0 || (available < blockSamples && !stopping)) {
+        break;
+      }
+      const std::size_t n = m_ring.read(m_writeBlock.data(), std::min(available, blockSamples));
+      const uint64_t frames = n / ch;
+      const auto encodeStart = std::chrono::steady_clock::now();
+      if (!m_file->write(m_writeBlock.data(), frames)) {
+        setErrorAndScheduleStop(tr("Write failed: %1").arg(m_file->errorString()));
+        return;
+      }
+      m_encodeNs.fetch_add(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - encodeStart).count()));
+      m_framesCaptured.fetch_add(frames);
+      m_dataBytesWritten.fetch_add(frames * ch * sizeof(float));
+    }
+
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+void AudioRecorder::stopWriter()
+{
+  if (!m_writer.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    m_writerStop = true;
   }
+  m_writerCv.notify_all();
+  m_writer.join();
 }
 
 void AudioRecorder::setErrorAndScheduleStop(QString message)
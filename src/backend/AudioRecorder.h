@@ -1,15 +1,23 @@
 #pragma once
 
+#include "backend/AudioFileWriter.h"
+#include "dsp/Loudness.h"
+#include "dsp/SpscRing.h"
+
 #include <QObject>
 #include <QString>
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <thread>
+#include <vector>
 
 #include <pipewire/stream.h>
-#include <sndfile.h>
 
 class PipeWireThread;
 
@@ -21,6 +29,16 @@ public:
   enum class Format {
     Wav,
     Flac,
+    Opus,   // Ogg Opus
+    Vorbis, // Ogg Vorbis
+  };
+
+  static constexpr int kMaxFlacLevel = 8;
+
+  // Encoder settings for the compressed formats; WAV ignores them.
+  struct EncoderOptions final {
+    int flacLevel = 5;    // 0 (fastest) .. kMaxFlacLevel (smallest)
+    double quality = 0.6; // Opus/Vorbis VBR quality, 0 (smallest) .. 1 (best)
   };
 
   struct StartOptions final {
@@ -28,6 +46,7 @@ public:
     QString targetObject;
     bool captureSink = true;
     Format format = Format::Wav;
+    EncoderOptions encoder;
   };
 
   explicit AudioRecorder(PipeWireThread* pw, QObject* parent = nullptr);
@@ -50,20 +69,52 @@ public:
   uint32_t lastBufferBytes() const { return m_lastBufferBytes.load(std::memory_order_relaxed); }
   uint64_t dataBytesWritten() const { return m_dataBytesWritten.load(std::memory_order_relaxed); }
   uint64_t framesCaptured() const { return m_framesCaptured.load(std::memory_order_relaxed); }
+  // Frames the process callback had to throw away because the disk writer fell behind.
+  uint64_t droppedFrames() const { return m_droppedFrames.load(std::memory_order_relaxed); }
+  // Audio captured but not yet encoded, in seconds.
+  double backlogSeconds() const;
+  // Seconds of audio encoded per second spent encoding (realtime factor); 0 until something is written.
+  double encoderSpeed() const;
 
   float peakDb() const { return m_peakDb.load(std::memory_order_relaxed); }
   float rmsDb() const { return m_rmsDb.load(std::memory_order_relaxed); }
+  // Per-channel levels of the latest buffer, for the first kMaxChannels channels.
+  static constexpr uint32_t kMaxChannels = 64;
+  float channelPeakDb(uint32_t channel) const;
+  float channelRmsDb(uint32_t channel) const;
+  // Loudness of the recording so far (EBU R128), and its maximum true peak in dBTP.
+  float momentaryLufs() const { return m_momentaryLufs.load(std::memory_order_relaxed); }
+  float shortTermLufs() const { return m_shortTermLufs.load(std::memory_order_relaxed); }
+  float integratedLufs() const { return m_integratedLufs.load(std::memory_order_relaxed); }
+  float loudnessRangeLu() const { return m_loudnessRange.load(std::memory_order_relaxed); }
+  float truePeakDb() const { return m_truePeakDb.load(std::memory_order_relaxed); }
 
   QString lastError() const;
   pw_stream_state streamState() const;
   QString streamStateString() const;
 
   static QString formatToString(Format format);
+  // Formats that cost real CPU to encode, as opposed to copying samples out.
+  static bool isCompressedFormat(Format format);
   static std::optional<Format> formatFromString(const QString& s);
+  // The format a file name's extension implies (.wav, .flac, .opus, .ogg), if any.
+  static std::optional<Format> formatFromFileName(const QString& path);
   static QString defaultExtensionForFormat(Format format);
   static QString ensureFileExtension(QString path, Format format);
 
   static QString expandPathTemplate(const QString& templateOrPath, const QString& targetLabel, Format format);
+  static QString streamStateToString(pw_stream_state state);
+
+  // Creates `path` in `format` at the given native rate and channel count. `positions` holds one
+  // SPA channel position per channel, or is null for an unpositioned layout. WAV goes through the
+  // native preallocating writer (RF64 past 4 GiB); other formats through libsndfile.
+  static std::unique_ptr<AudioFileWriter> openOutputFile(const QString& path,
+                                                         Format format,
+                                                         const EncoderOptions& encoder,
+                                                         uint32_t sampleRate,
+                                                         uint32_t channels,
+                                                         const uint32_t* positions,
+                                                         QString* error);
 
   bool start(const StartOptions& options);
   bool startWav(const QString& filePath, const QString& targetObject, bool captureSink);
@@ -82,17 +133,21 @@ private:
   void destroyStreamLocked();
 
   void processBuffer(pw_buffer* buffer);
+  bool openFile();
+  void writerLoop();
+  void stopWriter();
   void setErrorAndScheduleStop(QString message);
 
   PipeWireThread* m_pw = nullptr;
   pw_stream* m_stream = nullptr;
   spa_hook m_streamListener{};
 
-  SNDFILE* m_sndFile = nullptr;
+  std::unique_ptr<AudioFileWriter> m_file; // writer thread while recording
   QString m_filePath;
   QString m_targetObject;
   std::atomic_bool m_captureSink{true};
   std::atomic_int m_format{static_cast<int>(Format::Wav)};
+  EncoderOptions m_encoder;
 
   std::atomic<uint32_t> m_sampleRate{48000};
   std::atomic<uint32_t> m_channels{2};
@@ -101,8 +156,37 @@ private:
   std::atomic<uint32_t> m_lastBufferBytes{0};
   std::atomic<uint64_t> m_dataBytesWritten{0};
   std::atomic<uint64_t> m_framesCaptured{0};
+  std::atomic<uint64_t> m_droppedFrames{0};
+  std::atomic<uint64_t> m_encodeNs{0}; // writer thread time spent inside AudioFileWriter::write()
+
+  // Negotiated format: written on the loop thread before m_formatReady is released, then fixed.
+  std::atomic_bool m_formatReady{false};
+  std::atomic_bool m_formatMismatch{false};
+  std::array<uint32_t, kMaxChannels> m_positions{};
+  bool m_positioned = false;
+
+  // The process callback only copies into m_ring; m_writer opens the file once the format is
+  // known, then encodes and writes in large blocks.
+  dsp::SpscRing<float> m_ring;
+  uint32_t m_fileChannels = 2;
+  std::vector<float> m_writeBlock; // writer thread only
+  std::thread m_writer;
+  std::mutex m_writerMutex;
+  std::condition_variable m_writerCv;
+  bool m_writerStop = false; // guarded by m_writerMutex
   std::atomic<float> m_peakDb{-100.0f};
   std::atomic<float> m_rmsDb{-100.0f};
+  std::array<std::atomic<float>, kMaxChannels> m_channelPeakDb{};
+  std::array<std::atomic<float>, kMaxChannels> m_channelRmsDb{};
+  std::vector<float> m_levelPeaks; // reduction scratch; process thread only
+  std::vector<float> m_levelSumSq;
+  std::vector<uint32_t> m_levelClips;
+  dsp::LoudnessMeter m_loudness; // process thread only while recording
+  std::atomic<float> m_momentaryLufs{dsp::LoudnessMeter::kMinLufs};
+  std::atomic<float> m_shortTermLufs{dsp::LoudnessMeter::kMinLufs};
+  std::atomic<float> m_integratedLufs{dsp::LoudnessMeter::kMinLufs};
+  std::atomic<float> m_loudnessRange{0.0f};
+  std::atomic<float> m_truePeakDb{-100.0f};
   std::atomic_bool m_stopScheduled{false};
   std::atomic_int m_streamState{PW_STREAM_STATE_UNCONNECTED};
 
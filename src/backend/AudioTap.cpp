@@ -2,6 +2,7 @@
 
 #include "PipeWireThread.h"
 #include "dsp/Fft.h"
+#include "dsp/SimdKernels.h"
 #include "settings/VisualizerSettings.h"
 
 #include <QMetaObject>
@@ -14,10 +15,39 @@
 #include <spa/utils/result.h>
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 
 namespace {
+// Realtime -> worker handoff: up to 16 planar channels, ~0.34 s at 192 kHz.
+constexpr std::size_t kMaxTapChannels = 16;
+constexpr std::size_t kInputRingFrames = 1U << 16U;
+constexpr std::size_t kWorkerChunkFrames = 2048;
+constexpr auto kWorkerPollInterval = std::chrono::milliseconds(4);
+
+// Waveform history is preallocated for the highest rate we expect, so a graph clock change
+// (e.g. 44.1 kHz <-> 96 kHz) neither reallocates nor wipes it. Very long histories are capped at
+// a per-source sample budget and only grow (once) when a faster clock needs more room.
+constexpr uint32_t kMaxTapSampleRate = 192000;
+constexpr std::size_t kWaveBudgetSamples = 1U << 24U;
+
+// Only the mixdown is analysed on every hop (it feeds the spectrogram); the other sources,
+// the display bands and the published spectra are refreshed at most this often.
+constexpr uint32_t kPublishRateHz = 120;
+// Spectrum smoothing is specified per 256-sample hop at 48 kHz and rescaled to the actual hop.
+constexpr double kSmoothingReferenceSeconds = 256.0 / 48000.0;
+// Largest transform after zero padding.
+constexpr std::size_t kMaxTransformSize = 1U << 16U;
+
+constexpr std::size_t kPhaseScopePoints = 4096;
+constexpr double kCorrelationWindowSeconds = 0.3;
+
+// Unique across all taps, so a SpectrogramCursor carried over to another tap always resets.
+std::atomic<uint64_t> g_nextSpectrogramGeneration{1};
+
 const char* stateToString(pw_stream_state state)
 {
   switch (state) {
@@ -46,6 +76,50 @@ float clamp01(float v)
   return v;
 }
 
+QString channelPositionName(uint32_t position, int index)
+{
+  switch (position) {
+    case SPA_AUDIO_CHANNEL_MONO:
+      return QStringLiteral("MONO");
+    case SPA_AUDIO_CHANNEL_FL:
+      return QStringLiteral("FL");
+    case SPA_AUDIO_CHANNEL_FR:
+      return QStringLiteral("FR");
+    case SPA_AUDIO_CHANNEL_FC:
+      return QStringLiteral("FC");
+    case SPA_AUDIO_CHANNEL_LFE:
+      return QStringLiteral("LFE");
+    case SPA_AUDIO_CHANNEL_SL:
+      return QStringLiteral("SL");
+    case SPA_AUDIO_CHANNEL_SR:
+      return QStringLiteral("SR");
+    case SPA_AUDIO_CHANNEL_RL:
+      return QStringLiteral("RL");
+    case SPA_AUDIO_CHANNEL_RR:
+      return QStringLiteral("RR");
+    default:
+      break;
+  }
+  return QStringLiteral("CH%1").arg(index + 1);
+}
+
+// Appends n samples to a circular history starting at `write`; keeps only the newest ring.size().
+void appendToRing(std::vector<float>& ring, std::size_t write, const float* src, std::size_t n)
+{
+  const std::size_t size = ring.size();
+  if (size == 0 || n == 0) {
+    return;
+  }
+  if (n > size) {
+    write = (write + (n - size)) % size;
+    src += n - size;
+    n = size;
+  }
+  const std::size_t first = std::min(n, size - write);
+  std::copy(src, src + first, ring.begin() + static_cast<std::ptrdiff_t>(write));
+  std::copy(src + first, src + n, ring.begin());
+}
+
 std::size_t nearestPowerOfTwo(std::size_t n)
 {
   if (n < 2) {
@@ -80,12 +154,25 @@ AudioTap::AudioTap(PipeWireThread* pw, QObject* parent)
     : QObject(parent)
     , m_pw(pw)
 {
+  m_input.reset(kMaxTapChannels, kInputRingFrames);
+  m_planes.assign(kMaxTapChannels, std::vector<float>(kWorkerChunkFrames, 0.0f));
+  for (auto& plane : m_planes) {
+    m_planePtrs.push_back(plane.data());
+  }
+  m_mixBlock.assign(kWorkerChunkFrames, 0.0f);
+  m_midBlock.assign(kWorkerChunkFrames, 0.0f);
+  m_sideBlock.assign(kWorkerChunkFrames, 0.0f);
+  m_scopeMid.assign(kPhaseScopePoints, 0.0f);
+  m_scopeSide.assign(kPhaseScopePoints, 0.0f);
+
   {
     QSettings s;
     const VisualizerSettings cfg = VisualizerSettingsStore::load(s);
     applySettings(cfg);
   }
 
+  m_worker = std::thread([this]() { workerLoop(); });
+
   if (!m_pw || !m_pw->isConnected()) {
     return;
   }
@@ -98,57 +185,97 @@ AudioTap::AudioTap(PipeWireThread* pw, QObject* parent)
 
 AudioTap::~AudioTap()
 {
-  if (!m_pw || !m_pw->threadLoop()) {
-    return;
+  if (m_pw && m_pw->threadLoop()) {
+    pw_thread_loop* loop = m_pw->threadLoop();
+    pw_thread_loop_lock(loop);
+    destroyStreamLocked();
+    pw_thread_loop_unlock(loop);
   }
-  pw_thread_loop* loop = m_pw->threadLoop();
-  pw_thread_loop_lock(loop);
-  destroyStreamLocked();
-  pw_thread_loop_unlock(loop);
-}
 
-uint32_t AudioTap::sampleRate() const
-{
-  std::lock_guard<std::mutex> lock(m_mutex);
-  return m_sampleRate;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_workerStop = true;
+  }
+  m_workerCv.notify_all();
+  if (m_worker.joinable()) {
+    m_worker.join();
+  }
 }
 
 void AudioTap::applySettings(const VisualizerSettings& settings)
 {
-  const std::size_t nextFftSize = sanitizeFftSize(settings.fftSize);
-  const float nextSmoothing = static_cast<float>(std::clamp(settings.spectrumSmoothing, 0.0, 0.999));
-  const double nextWaveSec = std::clamp(settings.waveformHistorySeconds, 0.05, 30.0);
-  const double nextSpecSec = std::clamp(settings.spectrogramHistorySeconds, 0.25, 120.0);
+  // The window table is built here, off both the realtime and the analysis threads; the worker
+  // only swaps it in.
+  const std::size_t fftSize = sanitizeFftSize(settings.fftSize);
+  std::vector<float> window = dsp::makeWindow(static_cast<dsp::WindowType>(std::clamp(settings.windowType, 0, 3)), fftSize);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pendingFftSize = fftSize;
+    m_pendingWindow.swap(window);
+    m_pendingWindowReady = true;
+    m_pendingOverlap = std::clamp(settings.overlapPercent, 50.0, 93.75) / 100.0;
+    m_pendingZeroPad = std::bit_floor(static_cast<std::size_t>(std::clamp(settings.zeroPadding, 1, 8)));
+    m_pendingSmoothing = static_cast<float>(std::clamp(settings.spectrumSmoothing, 0.0, 0.999));
+    m_pendingWaveSeconds = std::clamp(settings.waveformHistorySeconds, 0.05, 300.0);
+    m_pendingSpecSeconds = std::clamp(settings.spectrogramHistorySeconds, 0.25, 120.0);
+    m_pendingMultiChannel = settings.multiChannel;
+    m_pendingMidSide = settings.midSide;
+    m_pendingBandScale = static_cast<dsp::BandScale>(std::clamp(settings.bandScale, 0, 4));
+    m_pendingBandCount = static_cast<std::size_t>(std::clamp(settings.bandCount, 16, 512));
+    m_pendingBandPooling = settings.bandRmsPooling ? dsp::BandPooling::Rms : dsp::BandPooling::Max;
+    m_settingsDirty.store(true, std::memory_order_release);
+  }
+  m_workerCv.notify_all();
+}
 
+void AudioTap::applyPendingSettings()
+{
   std::lock_guard<std::mutex> lock(m_mutex);
 
+  const std::size_t nextFftSize = m_pendingFftSize;
   const bool fftChanged = nextFftSize != m_fftSize;
-  const bool waveChanged = std::abs(nextWaveSec - m_waveHistorySeconds) > 1.0e-9;
-  const bool specChanged = std::abs(nextSpecSec - m_spectrogramHistorySeconds) > 1.0e-9;
-
-  m_spectrumSmoothing = nextSmoothing;
-  m_waveHistorySeconds = nextWaveSec;
-  m_spectrogramHistorySeconds = nextSpecSec;
-
-  if (fftChanged) {
-    m_fftSize = nextFftSize;
-    m_hopSize = std::max<std::size_t>(1U, m_fftSize / 4U);
+  const std::size_t nextZeroPad = std::min(m_pendingZeroPad, std::max<std::size_t>(1U, kMaxTransformSize / nextFftSize));
+  const bool transformChanged = fftChanged || nextZeroPad != m_zeroPad;
+  const std::size_t nextHop = std::max<std::size_t>(1U, static_cast<std::size_t>(std::llround(static_cast<double>(nextFftSize) * (1.0 - m_pendingOverlap))));
+  const bool hopChanged = nextHop != m_hopSize;
+  const bool waveChanged = std::abs(m_pendingWaveSeconds - m_waveHistorySeconds) > 1.0e-9;
+  const bool specChanged = std::abs(m_pendingSpecSeconds - m_spectrogramHistorySeconds) > 1.0e-9;
+  const bool layoutChanged = m_pendingMultiChannel != m_multiChannel || m_pendingMidSide != m_midSide;
+  const bool bandsChanged = m_pendingBandScale != m_bandScale || m_pendingBandCount != m_bandCount || m_pendingBandPooling != m_bandPooling;
+
+  m_spectrumSmoothing = m_pendingSmoothing;
+  m_waveHistorySeconds = m_pendingWaveSeconds;
+  m_spectrogramHistorySeconds = m_pendingSpecSeconds;
+  m_multiChannel = m_pendingMultiChannel;
+  m_midSide = m_pendingMidSide;
+  m_bandScale = m_pendingBandScale;
+  m_bandCount = m_pendingBandCount;
+  m_bandPooling = m_pendingBandPooling;
+
+  m_fftSize = nextFftSize;
+  m_zeroPad = nextZeroPad;
+  m_hopSize = nextHop;
+  if (m_pendingWindowReady) {
+    m_window.swap(m_pendingWindow);
+    m_pendingWindowReady = false;
+  }
+  if (m_window.size() != m_fftSize) {
+    m_window = dsp::Fft::hannWindow(m_fftSize);
   }
+  m_windowScale = dsp::amplitudeScale(m_window);
 
-  if (m_hann.size() != m_fftSize) {
-    m_hann = dsp::Fft::hannWindow(m_fftSize);
+  if (transformChanged || m_fftPlan.size() != m_fftSize * m_zeroPad) {
+    resizeTransformLocked();
   }
-  if (m_fftRing.size() != m_fftSize) {
-    m_fftRing.assign(m_fftSize, 0.0f);
-    m_fftWrite = 0;
-    m_fftTotal = 0;
-    m_sinceFrame = 0;
+  if (transformChanged || bandsChanged || m_bandMapper.bandCount() == 0) {
+    rebuildBandsLocked();
   }
-
-  if (waveChanged || m_waveRing.empty()) {
+  if (transformChanged || layoutChanged || m_sources.empty()) {
+    rebuildSourcesLocked();
+  } else if (waveChanged) {
     resizeWaveRingLocked();
   }
-  if (fftChanged || specChanged || m_specPixels.isEmpty() || m_spectrum.isEmpty()) {
+  if (fftChanged || hopChanged || specChanged || m_specPixels.empty()) {
     resizeSpectrogramLocked();
   }
 }
@@ -251,12 +378,10 @@ void AudioTap::connectStreamLocked()
   }();
   pw_stream_add_listener(m_stream, &m_streamListener, &streamEvents, this);
 
+  // Only pin the sample format: leaving rate/channels unset lets the stream follow the target's
+  // native layout (5.1/7.1 sinks, multitrack interfaces) instead of a forced stereo downmix.
   spa_audio_info_raw info{};
   info.format = SPA_AUDIO_FORMAT_F32;
-  info.rate = m_sampleRate;
-  info.channels = m_channels;
-  info.position[0] = SPA_AUDIO_CHANNEL_FL;
-  info.position[1] = SPA_AUDIO_CHANNEL_FR;
 
   uint8_t buffer[1024];
   spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
@@ -288,18 +413,86 @@ void AudioTap::destroyStreamLocked()
 
 void AudioTap::resizeWaveRingLocked()
 {
-  const double sec = std::clamp(m_waveHistorySeconds, 0.05, 30.0);
-  const std::size_t want = std::max<std::size_t>(
-      1U,
-      static_cast<std::size_t>(std::llround(sec * static_cast<double>(m_sampleRate == 0 ? 48000U : m_sampleRate))));
+  const std::size_t want = waveCapacityLocked();
+  const std::size_t rings = 1U + static_cast<std::size_t>(m_publishedChannels);
+
+  if (m_wavePyramids.size() != rings) {
+    m_wavePyramids.assign(rings, dsp::MinMaxPyramid{});
+  }
+  for (dsp::MinMaxPyramid& pyramid : m_wavePyramids) {
+    pyramid.reset(want);
+  }
+}
+
+std::size_t AudioTap::waveCapacityLocked() const
+{
+  const double sec = std::clamp(m_waveHistorySeconds, 0.05, 300.0);
+  const double current = sec * static_cast<double>(m_sampleRate == 0 ? 48000U : m_sampleRate);
+  const double preallocated = std::min(sec * static_cast<double>(kMaxTapSampleRate), static_cast<double>(kWaveBudgetSamples));
+  return std::max<std::size_t>(1U, static_cast<std::size_t>(std::llround(std::max(current, preallocated))));
+}
+
+void AudioTap::noteRateChangeLocked(uint32_t rate)
+{
+  if (m_rateSegmentCount == m_rateSegments.size()) {
+    std::move(m_rateSegments.begin() + 1, m_rateSegments.end(), m_rateSegments.begin());
+    --m_rateSegmentCount;
+  }
+  m_rateSegments[m_rateSegmentCount++] = RateSegment{m_framesAnalyzed, rate};
+}
+
+void AudioTap::rebuildSourcesLocked()
+{
+  const int channels = m_multiChannel ? static_cast<int>(m_inputChannels) : 0;
+  const bool midSide = m_midSide && m_inputChannels >= 2U;
+  const std::size_t slotCount = 1U + static_cast<std::size_t>(channels) + (midSide ? 2U : 0U);
+
+  SourceState blank;
+  blank.fftRing.assign(m_fftSize, 0.0f);
+  blank.spectrum.assign(m_transformSize / 2U, 0.0f);
+  blank.bands.assign(m_bandMapper.bandCount(), 0.0f);
+  m_sources.assign(slotCount, blank);
+  m_sourceInput.assign(slotCount, nullptr);
+  m_fftWrite = 0;
+  m_fftTotal = 0;
+  m_sinceFrame = 0;
+
+  m_corrLR = 0.0;
+  m_corrLL = 0.0;
+  m_corrRR = 0.0;
+  m_correlation.store(0.0f, std::memory_order_relaxed);
+  m_scopeWrite = 0;
+  m_scopeCount = 0;
+
+  m_publishedChannels = channels;
+  m_publishedMidSide = midSide;
+  resizeWaveRingLocked();
+}
 
-  if (m_waveRing.size() != want) {
-    m_waveRing.assign(want, 0.0f);
-    m_waveWrite = 0;
-    m_waveCount = 0;
+void AudioTap::rebuildBandsLocked()
+{
+  // Sparse bin->band table for the current FFT size and rate; rebuilt only when those or the
+  // band settings change, so the per-hop cost is one pass over a few entries per band.
+  m_bandMapper.reset(m_bandScale, m_bandPooling, m_transformSize, m_sampleRate, m_bandCount);
+  m_bandWork.assign(m_bandMapper.bandCount(), 0.0f);
+  for (SourceState& src : m_sources) {
+    src.bands.assign(m_bandMapper.bandCount(), 0.0f);
   }
 }
 
+void AudioTap::resizeTransformLocked()
+{
+  // Zero padding: the frame is windowed into the first fftSize samples and the tail stays zero.
+  m_transformSize = m_fftSize * m_zeroPad;
+  const std::size_t bins = m_transformSize / 2U;
+  m_fftPlan.reset(m_transformSize);
+  m_fftFrame.assign(m_transformSize, 0.0f);
+  m_fftBuf.assign(bins + 1U, std::complex<float>(0.0f, 0.0f));
+  m_normWork.assign(bins, 0.0f);
+  m_powerWork.assign(bins, 0.0f);
+  m_colourWork.assign(bins, 0U);
+}
+
 void AudioTap::resizeSpectrogramLocked()
 {
   const int bins = std::max<int>(1, static_cast<int>(m_fftSize / 2U));
@@ -310,9 +503,11 @@ void AudioTap::resizeSpectrogramLocked()
   const int wantColumns = static_cast<int>(std::lround(std::clamp(m_spectrogramHistorySeconds, 0.25, 120.0) * rate / hop));
   m_specColumns = std::clamp(wantColumns, 30, 4000);
 
-  m_spectrum.fill(0.0f, m_specBins);
-  m_specPixels.fill(0, m_specColumns * m_specBins);
+  m_columnWork.assign(static_cast<std::size_t>(m_specBins), 0U);
+  m_specPixels.assign(static_cast<std::size_t>(m_specColumns) * static_cast<std::size_t>(m_specBins), 0U);
   m_specWriteCol = 0;
+  m_specVersion = 0;
+  m_specGeneration = g_nextSpectrogramGeneration.fetch_add(1, std::memory_order_relaxed);
 }
 
 void AudioTap::onStreamStateChanged(void* data, enum pw_stream_state /*old*/, enum pw_stream_state state, const char* error)
@@ -340,19 +535,21 @@ void AudioTap::onStreamParamChanged(void* data, uint32_t id, const struct spa_po
     return;
   }
 
-  std::lock_guard<std::mutex> lock(self->m_mutex);
-  const uint32_t prevRate = self->m_sampleRate;
+  // The worker notices the new rate/layout and resizes its history; nothing is reallocated here.
   if (info.rate > 0) {
-    self->m_sampleRate = info.rate;
+    self->m_rtSampleRate.store(info.rate, std::memory_order_relaxed);
   }
   if (info.channels > 0) {
-    self->m_channels = info.channels;
+    self->m_rtChannels.store(info.channels, std::memory_order_relaxed);
   }
 
-  if (self->m_sampleRate != prevRate) {
-    self->resizeWaveRingLocked();
-    self->resizeSpectrogramLocked();
+  QStringList names;
+  const uint32_t positioned = (info.flags & SPA_AUDIO_FLAG_UNPOSITIONED) ? 0U : std::min(info.channels, SPA_AUDIO_MAX_CHANNELS);
+  for (uint32_t ch = 0; ch < info.channels; ++ch) {
+    names.push_back(channelPositionName(ch < positioned ? info.position[ch] : static_cast<uint32_t>(SPA_AUDIO_CHANNEL_UNKNOWN), static_cast<int>(ch)));
   }
+  std::lock_guard<std::mutex> lock(self->m_mutex);
+  self->m_channelNames = names;
 }
 
 void AudioTap::onStreamProcess(void* data)
@@ -385,7 +582,7 @@ void AudioTap::processBuffer(pw_buffer* buffer)
     return;
   }
 
-  const uint32_t channels = m_channels == 0 ? 1U : m_channels;
+  const uint32_t channels = std::max<uint32_t>(1U, m_rtChannels.load(std::memory_order_relaxed));
   const uint8_t* base = static_cast<const uint8_t*>(d.data);
   const uint32_t offset = d.chunk->offset;
   const uint32_t size = d.chunk->size;
@@ -400,115 +597,396 @@ void AudioTap::processBuffer(pw_buffer* buffer)
     return;
   }
 
-  std::vector<float> mono(frames);
+  // Realtime-safe: a single deinterleaving pass into the planar SPSC ring. No locks, no
+  // allocation; if the worker falls behind the excess is dropped and counted.
+  const std::size_t written = m_input.writeInterleaved(samples, channels, frames);
+  if (written < frames) {
+    m_droppedFrames.fetch_add(frames - written, std::memory_order_relaxed);
+  }
+}
+
+void AudioTap::workerLoop()
+{
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_workerCv.wait_for(lock, kWorkerPollInterval, [this]() { return m_workerStop || m_settingsDirty.load(std::memory_order_acquire); });
+      if (m_workerStop) {
+        return;
+      }
+    }
+
+    if (m_settingsDirty.exchange(false, std::memory_order_acq_rel)) {
+      applyPendingSettings();
+    }
+
+    const uint32_t rate = m_rtSampleRate.load(std::memory_order_relaxed);
+    if (rate > 0 && rate != m_sampleRate) {
+      // Clock change: keep all history. Waveform queries map older samples through the recorded
+      // rate segments; the spectrogram keeps its geometry and simply continues at the new rate.
+      // Only the (small) band table is rebuilt, in place.
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_sampleRate = rate;
+      noteRateChangeLocked(rate);
+      rebuildBandsLocked();
+      const std::size_t want = waveCapacityLocked();
+      if (!m_wavePyramids.empty() && m_wavePyramids.front().capacity() < want) {
+        resizeWaveRingLocked();
+      }
+    }
+
+    const uint32_t channels = std::clamp<uint32_t>(m_rtChannels.load(std::memory_order_relaxed), 1U, kMaxTapChannels);
+    if (channels != m_inputChannels) {
+      // Whatever is still queued was written in the old layout, and the waveform history of the
+      // old channels does not belong to the new ones (reset() keeps it when the size matches).
+      m_input.clear();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_inputChannels = channels;
+      rebuildSourcesLocked();
+      for (dsp::MinMaxPyramid& pyramid : m_wavePyramids) {
+        pyramid.clear();
+      }
+    }
+
+    std::size_t n = 0;
+    while ((n = m_input.read(m_planePtrs.data(), m_inputChannels, kWorkerChunkFrames)) > 0) {
+      analyze(n);
+    }
+  }
+}
+
+void AudioTap::analyze(std::size_t frames)
+{
+  const std::size_t channels = m_inputChannels;
+  float* mix = m_mixBlock.data();
+
+  // Mixdown over the planar block (contiguous per channel, so these loops vectorize).
+  std::copy(m_planes[0].begin(), m_planes[0].begin() + static_cast<std::ptrdiff_t>(frames), mix);
+  for (std::size_t ch = 1; ch < channels; ++ch) {
+    const float* plane = m_planes[ch].data();
+    for (std::size_t i = 0; i < frames; ++i) {
+      mix[i] += plane[i];
+    }
+  }
+  const float invChannels = 1.0f / static_cast<float>(channels);
   float peak = 0.0f;
   double sumSq = 0.0;
-  for (std::size_t f = 0; f < frames; ++f) {
-    float v = 0.0f;
-    for (uint32_t ch = 0; ch < channels; ++ch) {
-      v += samples[f * channels + ch];
+  for (std::size_t i = 0; i < frames; ++i) {
+    mix[i] *= invChannels;
+    peak = std::max(peak, std::fabs(mix[i]));
+    sumSq += static_cast<double>(mix[i]) * static_cast<double>(mix[i]);
+  }
+  m_peak.store(peak, std::memory_order_relaxed);
+  m_rms.store(static_cast<float>(std::sqrt(sumSq / static_cast<double>(frames))), std::memory_order_relaxed);
+
+  const std::size_t perChannel = static_cast<std::size_t>(m_publishedChannels);
+  const bool midSide = m_publishedMidSide;
+  if (midSide) {
+    const float* l = m_planes[0].data();
+    const float* r = m_planes[1].data();
+    double lr = 0.0;
+    double ll = 0.0;
+    double rr = 0.0;
+    for (std::size_t i = 0; i < frames; ++i) {
+      m_midBlock[i] = 0.5f * (l[i] + r[i]);
+      m_sideBlock[i] = 0.5f * (l[i] - r[i]);
+      lr += static_cast<double>(l[i]) * static_cast<double>(r[i]);
+      ll += static_cast<double>(l[i]) * static_cast<double>(l[i]);
+      rr += static_cast<double>(r[i]) * static_cast<double>(r[i]);
     }
-    v /= static_cast<float>(channels);
-    mono[f] = v;
-    const float av = std::fabs(v);
-    if (av > peak) {
-      peak = av;
+
+    const double decay = std::exp(-static_cast<double>(frames) / (kCorrelationWindowSeconds * static_cast<double>(m_sampleRate)));
+    m_corrLR = m_corrLR * decay + lr;
+    m_corrLL = m_corrLL * decay + ll;
+    m_corrRR = m_corrRR * decay + rr;
+    const double denom = std::sqrt(m_corrLL * m_corrRR);
+    const double corr = denom > 1.0e-12 ? std::clamp(m_corrLR / denom, -1.0, 1.0) : 0.0;
+    m_correlation.store(static_cast<float>(corr), std::memory_order_relaxed);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_framesAnalyzed += frames;
+    if (!m_wavePyramids.empty()) {
+      m_wavePyramids[0].append(mix, frames);
+      for (std::size_t ch = 0; ch < perChannel && ch + 1U < m_wavePyramids.size(); ++ch) {
+        m_wavePyramids[ch + 1U].append(m_planes[ch].data(), frames);
+      }
+    }
+    if (midSide) {
+      appendToRing(m_scopeMid, m_scopeWrite, m_midBlock.data(), frames);
+      appendToRing(m_scopeSide, m_scopeWrite, m_sideBlock.data(), frames);
+      m_scopeWrite = (m_scopeWrite + frames) % m_scopeMid.size();
+      m_scopeCount = std::min<std::size_t>(m_scopeCount + frames, m_scopeMid.size());
     }
-    sumSq += static_cast<double>(v) * static_cast<double>(v);
   }
-  const float rms = std::sqrt(sumSq / static_cast<double>(frames));
-  m_peak.store(peak, std::memory_order_relaxed);
-  m_rms.store(rms, std::memory_order_relaxed);
 
-  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_sources.empty() || m_fftSize == 0) {
+    return;
+  }
 
-  // Update wave ring.
-  for (float v : mono) {
-    if (m_waveRing.empty()) {
-      break;
+  // Slot inputs: mix, per-channel planes, then mid/side.
+  std::size_t slot = 0;
+  m_sourceInput[slot++] = mix;
+  for (std::size_t ch = 0; ch < perChannel; ++ch) {
+    m_sourceInput[slot++] = m_planes[ch].data();
+  }
+  if (midSide) {
+    m_sourceInput[slot++] = m_midBlock.data();
+    m_sourceInput[slot++] = m_sideBlock.data();
+  }
+
+  // Feed every slot's FFT ring block-wise, stopping at hop boundaries.
+  const std::size_t mask = m_fftSize - 1U;
+  std::size_t pos = 0;
+  while (pos < frames) {
+    const std::size_t take = std::min(frames - pos, m_hopSize - m_sinceFrame);
+    const std::size_t first = std::min(take, m_fftSize - m_fftWrite);
+    for (std::size_t i = 0; i < m_sources.size(); ++i) {
+      const float* src = m_sourceInput[i] + pos;
+      std::vector<float>& ring = m_sources[i].fftRing;
+      std::copy(src, src + first, ring.begin() + static_cast<std::ptrdiff_t>(m_fftWrite));
+      std::copy(src + first, src + take, ring.begin());
+    }
+    m_fftWrite = (m_fftWrite + take) & mask;
+    m_fftTotal += take;
+    m_sinceFrame += take;
+    m_framesSincePublish += take;
+    pos += take;
+
+    if (m_sinceFrame >= m_hopSize) {
+      m_sinceFrame = 0;
+      if (m_fftTotal >= m_fftSize) {
+        // Cheap scheduler: high overlap multiplies hops, but only the spectrogram needs every
+        // one of them, so everything else is coalesced down to kPublishRateHz.
+        const bool publish = m_framesSincePublish >= std::max<std::size_t>(1U, m_sampleRate / kPublishRateHz);
+        if (publish) {
+          m_framesSincePublish = 0;
+        }
+        analyzeFrame(publish);
+      }
     }
-    m_waveRing[m_waveWrite] = v;
-    m_waveWrite = (m_waveWrite + 1U) % m_waveRing.size();
-    m_waveCount = std::min<std::size_t>(m_waveCount + 1U, m_waveRing.size());
+  }
+}
+
+void AudioTap::analyzeFrame(bool publish)
+{
+  const std::size_t n = m_transformSize / 2U;
+  if (n == 0 || m_normWork.size() != n || m_fftFrame.size() != m_transformSize || m_window.size() != m_fftSize) {
+    return;
+  }
 
-    // Update FFT ring.
-    if (m_fftRing.empty()) {
+  // Quantized palette so the colour pass is a table lookup (gather on AVX2).
+  static const std::array<uint32_t, 256> palette = [] {
+    std::array<uint32_t, 256> lut{};
+    for (std::size_t i = 0; i < lut.size(); ++i) {
+      lut[i] = spectrogramColor(static_cast<float>(i) / 255.0f);
+    }
+    return lut;
+  }();
+
+  // Per slot: window -> (zero-padded) real FFT -> vectorized magnitude/dB/normalize -> smoothing.
+  // Only the mixdown (slot 0) feeds the spectrogram column, and only it runs on every hop.
+  constexpr float minDb = -90.0f;
+  constexpr float maxDb = 0.0f;
+  const float s = std::clamp(m_spectrumSmoothing, 0.0f, 0.999f);
+  const double referenceFrames = kSmoothingReferenceSeconds * static_cast<double>(m_sampleRate == 0 ? 48000U : m_sampleRate);
+  const std::size_t mask = m_fftSize - 1U;
+  const std::size_t bandCount = m_bandMapper.bandCount();
+  const float powerScale = m_windowScale * m_windowScale;
+  const float binHz = static_cast<float>(m_sampleRate) / static_cast<float>(m_transformSize);
+
+  SpectrumSet& out = m_spectrumOut.back();
+  if (publish) {
+    out.channels = m_publishedChannels;
+    out.midSide = m_publishedMidSide;
+    out.rows.resize(m_sources.size());
+    out.bandRows.resize(m_sources.size());
+    out.bandCenters = m_bandMapper.centers();
+    out.peakHz.assign(m_sources.size(), 0.0f);
+    out.peakDb.assign(m_sources.size(), minDb);
+  }
+
+  const std::size_t slotCount = publish ? m_sources.size() : std::min<std::size_t>(1U, m_sources.size());
+  for (std::size_t slot = 0; slot < slotCount; ++slot) {
+    SourceState& src = m_sources[slot];
+    for (std::size_t i = 0; i < m_fftSize; ++i) {
+      m_fftFrame[i] = src.fftRing[(m_fftWrite + i) & mask] * m_window[i];
+    }
+    m_fftPlan.forwardReal(m_fftFrame.data(), m_fftBuf.data());
+
+    // Smoothing is per unit of time, so it behaves the same at any overlap or update rate.
+    const double elapsed = static_cast<double>(m_fftTotal - src.lastSmoothed);
+    src.lastSmoothed = m_fftTotal;
+    const float smoothing = s <= 0.0f ? 0.0f : static_cast<float>(std::pow(static_cast<double>(s), elapsed / referenceFrames));
+
+    dsp::simd::normalizedDb(m_fftBuf.data(), n, m_windowScale, minDb, maxDb, m_normWork.data());
+    dsp::simd::smoothAndColorize(m_normWork.data(), n, smoothing, src.spectrum.data(), palette.data(), slot == 0 ? m_colourWork.data() : nullptr);
+    if (!publish) {
       continue;
     }
-    m_fftRing[m_fftWrite] = v;
-    m_fftWrite = (m_fftWrite + 1U) % m_fftSize;
-    ++m_fftTotal;
-    ++m_sinceFrame;
+    out.rows[slot].assign(src.spectrum.begin(), src.spectrum.end());
 
-    if (m_fftTotal >= m_fftSize && m_sinceFrame >= m_hopSize) {
-      m_sinceFrame = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      m_powerWork[i] = std::norm(m_fftBuf[i]) * powerScale;
+    }
 
-      std::vector<float> frame(m_fftSize);
-      for (std::size_t i = 0; i < m_fftSize; ++i) {
-        const std::size_t idx = (m_fftWrite + i) % m_fftSize;
-        frame[i] = m_fftRing[idx] * m_hann[i];
+    // Peak readout: parabolic interpolation on the dB values around the strongest bin.
+    const std::size_t k = static_cast<std::size_t>(std::max_element(m_powerWork.begin() + 1, m_powerWork.end() - 1) - m_powerWork.begin());
+    const float a = 10.0f * std::log10(m_powerWork[k - 1U] + 1.0e-18f);
+    const float b = 10.0f * std::log10(m_powerWork[k] + 1.0e-18f);
+    const float c = 10.0f * std::log10(m_powerWork[k + 1U] + 1.0e-18f);
+    const float denom = a - 2.0f * b + c;
+    const float delta = std::abs(denom) > 1.0e-12f ? std::clamp(0.5f * (a - c) / denom, -0.5f, 0.5f) : 0.0f;
+    out.peakHz[slot] = (static_cast<float>(k) + delta) * binHz;
+    out.peakDb[slot] = b - 0.25f * (a - c) * delta;
+
+    // Display bands: pool bin power through the sparse table, then the same dB/smoothing.
+    if (bandCount > 0 && src.bands.size() == bandCount) {
+      m_bandMapper.apply(m_powerWork.data(), m_bandWork.data());
+      for (std::size_t band = 0; band < bandCount; ++band) {
+        const float db = 10.0f * std::log10(m_bandWork[band] + 1.0e-18f);
+        m_bandWork[band] = std::clamp((db - minDb) / (maxDb - minDb), 0.0f, 1.0f);
       }
+      dsp::simd::smoothAndColorize(m_bandWork.data(), bandCount, smoothing, src.bands.data(), palette.data(), nullptr);
+    }
+    out.bandRows[slot].assign(src.bands.begin(), src.bands.end());
+  }
+  if (publish) {
+    m_spectrumOut.publish();
+  }
 
-      auto spectrum = dsp::Fft::forwardReal(frame);
-      const int bins = static_cast<int>(m_fftSize / 2);
-      if (bins <= 0) {
-        continue;
-      }
+  // Zero-padded bins at multiples of the padding factor are exactly the unpadded bins, so the
+  // spectrogram keeps fftSize/2 rows whatever the padding.
+  const int specBins = static_cast<int>(m_fftSize / 2U);
+  for (std::size_t i = 0; i < m_columnWork.size() && i * m_zeroPad < n; ++i) {
+    m_columnWork[i] = m_colourWork[i * m_zeroPad];
+  }
 
-      if (m_specBins != bins) {
-        m_specBins = bins;
-        m_spectrum.fill(0.0f, m_specBins);
-        m_specPixels.fill(0, m_specColumns * m_specBins);
-        m_specWriteCol = 0;
-      }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_specBins != specBins || m_specPixels.size() != static_cast<std::size_t>(m_specColumns) * static_cast<std::size_t>(m_specBins)) {
+    return;
+  }
+  std::copy(m_columnWork.begin(), m_columnWork.end(), m_specPixels.begin() + static_cast<std::ptrdiff_t>(m_specWriteCol) * m_specBins);
+  m_specWriteCol = (m_specWriteCol + 1) % m_specColumns;
+  ++m_specVersion;
+}
 
-      // Update spectrum + spectrogram column.
-      constexpr float minDb = -90.0f;
-      constexpr float maxDb = 0.0f;
-      for (int i = 0; i < bins; ++i) {
-        const float mag = std::abs(spectrum[static_cast<std::size_t>(i)]) / static_cast<float>(bins);
-        const float db = 20.0f * std::log10(mag + 1.0e-9f);
-        const float norm = clamp01((db - minDb) / (maxDb - minDb));
-
-        // Simple peak-hold-ish smoothing for the spectrum.
-        const float prev = (i < m_spectrum.size()) ? m_spectrum[i] : 0.0f;
-        const float s = std::clamp(m_spectrumSmoothing, 0.0f, 0.999f);
-        const float next = (norm > prev) ? norm : (prev * s + norm * (1.0f - s));
-        if (i < m_spectrum.size()) {
-          m_spectrum[i] = next;
-        }
+int AudioTap::sourceSlot(int source, int channels, bool midSide)
+{
+  if (source == SourceMix) {
+    return 0;
+  }
+  if (source >= 0 && source < channels) {
+    return 1 + source;
+  }
+  if (midSide && source == SourceMid) {
+    return 1 + channels;
+  }
+  if (midSide && source == SourceSide) {
+    return 2 + channels;
+  }
+  return -1;
+}
 
-        const int col = m_specWriteCol;
-        const int row = i;
-        const int index = col * m_specBins + row;
-        if (index >= 0 && index < m_specPixels.size()) {
-          m_specPixels[index] = spectrogramColor(norm);
-        }
-      }
+int AudioTap::channelCount() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_publishedChannels;
+}
 
-      m_specWriteCol = (m_specWriteCol + 1) % m_specColumns;
-    }
+QStringList AudioTap::channelNames() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  QStringList out;
+  for (int ch = 0; ch < m_publishedChannels; ++ch) {
+    out.push_back(ch < static_cast<int>(m_channelNames.size()) ? m_channelNames[ch] : QStringLiteral("CH%1").arg(ch + 1));
   }
+  return out;
 }
 
-QVector<float> AudioTap::spectrum() const
+bool AudioTap::hasMidSide() const
 {
   std::lock_guard<std::mutex> lock(m_mutex);
-  return m_spectrum;
+  return m_publishedMidSide;
+}
+
+QVector<float> AudioTap::spectrum(int source) const
+{
+  m_spectrumOut.update();
+  const SpectrumSet& latest = m_spectrumOut.front();
+  const int slot = sourceSlot(source, latest.channels, latest.midSide);
+  if (slot < 0 || slot >= static_cast<int>(latest.rows.size())) {
+    return {};
+  }
+  const std::vector<float>& row = latest.rows[static_cast<std::size_t>(slot)];
+  return QVector<float>(row.begin(), row.end());
+}
+
+QVector<float> AudioTap::bands(int source) const
+{
+  m_spectrumOut.update();
+  const SpectrumSet& latest = m_spectrumOut.front();
+  const int slot = sourceSlot(source, latest.channels, latest.midSide);
+  if (slot < 0 || slot >= static_cast<int>(latest.bandRows.size())) {
+    return {};
+  }
+  const std::vector<float>& row = latest.bandRows[static_cast<std::size_t>(slot)];
+  return QVector<float>(row.begin(), row.end());
 }
 
-SpectrogramSnapshot AudioTap::spectrogram() const
+bool AudioTap::spectrumPeak(int source, float& frequencyHz, float& levelDb) const
+{
+  m_spectrumOut.update();
+  const SpectrumSet& latest = m_spectrumOut.front();
+  const int slot = sourceSlot(source, latest.channels, latest.midSide);
+  if (slot < 0 || slot >= static_cast<int>(latest.peakHz.size())) {
+    return false;
+  }
+  frequencyHz = latest.peakHz[static_cast<std::size_t>(slot)];
+  levelDb = latest.peakDb[static_cast<std::size_t>(slot)];
+  return true;
+}
+
+QVector<float> AudioTap::bandCenters() const
+{
+  m_spectrumOut.update();
+  const SpectrumSet& latest = m_spectrumOut.front();
+  return QVector<float>(latest.bandCenters.begin(), latest.bandCenters.end());
+}
+
+void AudioTap::spectrogramSince(SpectrogramCursor& cursor, SpectrogramUpdate& out) const
 {
   std::lock_guard<std::mutex> lock(m_mutex);
-  SpectrogramSnapshot snap;
-  snap.columns = m_specColumns;
-  snap.bins = m_specBins;
-  snap.writeColumn = m_specWriteCol;
-  snap.pixels = m_specPixels;
-  return snap;
+  out.columns = m_specColumns;
+  out.bins = m_specBins;
+  out.reset = cursor.generation != m_specGeneration;
+  out.newColumns = 0;
+  if (m_specColumns <= 0 || m_specBins <= 0 || m_specPixels.size() != static_cast<std::size_t>(m_specColumns) * static_cast<std::size_t>(m_specBins)) {
+    cursor = {m_specGeneration, m_specVersion};
+    return;
+  }
+
+  const uint64_t since = out.reset ? 0U : std::min(cursor.version, m_specVersion);
+  const int count = static_cast<int>(std::min<uint64_t>(m_specVersion - since, static_cast<uint64_t>(m_specColumns)));
+  cursor = {m_specGeneration, m_specVersion};
+  if (count <= 0) {
+    return;
+  }
+
+  // The newest column sits just before the write position; walk forward from the oldest wanted one.
+  out.newColumns = count;
+  out.pixels.resize(count * m_specBins);
+  uint32_t* dst = out.pixels.data();
+  int col = (m_specWriteCol - count + m_specColumns) % m_specColumns;
+  for (int i = 0; i < count; ++i) {
+    const uint32_t* src = m_specPixels.data() + static_cast<std::ptrdiff_t>(col) * m_specBins;
+    dst = std::copy(src, src + m_specBins, dst);
+    col = (col + 1) % m_specColumns;
+  }
 }
 
-void AudioTap::waveformMinMax(int columns, int windowSamples, QVector<float>& minsOut, QVector<float>& maxsOut) const
+void AudioTap::waveformMinMax(int columns, int windowSamples, QVector<float>& minsOut, QVector<float>& maxsOut, int source) const
 {
   minsOut.clear();
   maxsOut.clear();
@@ -517,40 +995,89 @@ void AudioTap::waveformMinMax(int columns, int windowSamples, QVector<float>& mi
   }
 
   std::lock_guard<std::mutex> lock(m_mutex);
-  if (m_waveRing.empty() || m_waveCount == 0) {
+  const int slot = sourceSlot(source, m_publishedChannels, false);
+  if (slot < 0 || slot >= static_cast<int>(m_wavePyramids.size())) {
+    return;
+  }
+  const dsp::MinMaxPyramid& pyramid = m_wavePyramids[static_cast<std::size_t>(slot)];
+  if (pyramid.size() == 0) {
     return;
   }
 
-  const std::size_t available = m_waveCount;
-  const std::size_t take = std::min<std::size_t>(static_cast<std::size_t>(windowSamples), available);
-  const std::size_t start = (m_waveWrite + m_waveRing.size() - take) % m_waveRing.size();
-
+  // O(columns): answered from the min/max pyramid rather than by scanning the window.
   minsOut.resize(columns);
   maxsOut.resize(columns);
 
-  for (int x = 0; x < columns; ++x) {
-    float minV = 1.0f;
-    float maxV = -1.0f;
-    const std::size_t segStart = (take * static_cast<std::size_t>(x)) / static_cast<std::size_t>(columns);
-    const std::size_t segEnd = (take * static_cast<std::size_t>(x + 1)) / static_cast<std::size_t>(columns);
-    const std::size_t count = std::max<std::size_t>(1U, segEnd - segStart);
-
-    for (std::size_t i = 0; i < count; ++i) {
-      const std::size_t idx = (start + segStart + i) % m_waveRing.size();
-      const float v = m_waveRing[idx];
-      if (v < minV) {
-        minV = v;
-      }
-      if (v > maxV) {
-        maxV = v;
+  // Absolute pyramid position of a rate segment (the pyramid may have been created later).
+  const uint64_t now = pyramid.total();
+  const uint64_t offset = m_framesAnalyzed - now;
+  auto segmentStart = [&](std::size_t i) { return m_rateSegments[i].start > offset ? m_rateSegments[i].start - offset : 0U; };
+
+  const std::size_t window = static_cast<std::size_t>(windowSamples);
+  if (m_rateSegmentCount == 0 || segmentStart(m_rateSegmentCount - 1U) + std::min(window, pyramid.size()) <= now) {
+    pyramid.minMax(window, columns, minsOut.data(), maxsOut.data());
+    return;
+  }
+
+  // The window reaches back past a clock change: walk the rate segments so each column still
+  // covers the same wall-clock span (older audio is resampled on the fly, not rewritten).
+  const double currentRate = static_cast<double>(m_sampleRate == 0 ? 48000U : m_sampleRate);
+  auto positionAgo = [&](double ago) -> uint64_t {
+    uint64_t end = now;
+    for (std::size_t i = m_rateSegmentCount; i-- > 0;) {
+      const double ratio = static_cast<double>(m_rateSegments[i].rate) / currentRate;
+      const uint64_t start = segmentStart(i);
+      const double spanUnits = static_cast<double>(end - start) / ratio;
+      if (ago <= spanUnits || i == 0 || start == 0) {
+        const uint64_t back = static_cast<uint64_t>(std::llround(ago * ratio));
+        return back >= end ? 0U : end - back;
       }
+      ago -= spanUnits;
+      end = start;
     }
+    return 0;
+  };
 
+  float minV = 0.0f;
+  float maxV = 0.0f;
+  const double w = static_cast<double>(window);
+  for (int x = 0; x < columns; ++x) {
+    const uint64_t begin = positionAgo(w - w * static_cast<double>(x) / static_cast<double>(columns));
+    const uint64_t end = std::max(begin + 1U, positionAgo(w - w * static_cast<double>(x + 1) / static_cast<double>(columns)));
+    if (!pyramid.minMax(begin, end, minV, maxV)) {
+      minV = 0.0f;
+      maxV = 0.0f;
+    }
     minsOut[x] = minV;
     maxsOut[x] = maxV;
   }
 }
 
+void AudioTap::phaseScope(int maxPoints, QVector<float>& midOut, QVector<float>& sideOut) const
+{
+  midOut.clear();
+  sideOut.clear();
+  if (maxPoints <= 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_publishedMidSide || m_scopeCount == 0 || m_scopeMid.empty()) {
+    return;
+  }
+
+  const std::size_t size = m_scopeMid.size();
+  const std::size_t take = std::min<std::size_t>(static_cast<std::size_t>(maxPoints), m_scopeCount);
+  const std::size_t start = (m_scopeWrite + size - take) % size;
+  midOut.resize(static_cast<int>(take));
+  sideOut.resize(static_cast<int>(take));
+  for (std::size_t i = 0; i < take; ++i) {
+    const std::size_t idx = (start + i) % size;
+    midOut[static_cast<int>(i)] = m_scopeMid[idx];
+    sideOut[static_cast<int>(i)] = m_scopeSide[idx];
+  }
+}
+
 uint32_t AudioTap::spectrogramColor(float normalized01)
 {
   const float t = clamp01(normalized01);
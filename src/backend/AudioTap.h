@@ -1,12 +1,24 @@
 #pragma once
 
 #include <QObject>
+#include <QStringList>
 #include <QVector>
 
+#include "dsp/BandMapper.h"
+#include "dsp/Fft.h"
+#include "dsp/MinMaxPyramid.h"
+#include "dsp/SpscRing.h"
+#include "dsp/TripleBuffer.h"
+#include "dsp/Window.h"
+
+#include <array>
 #include <atomic>
+#include <complex>
+#include <condition_variable>
 #include <cstdint>
 #include <mutex>
 #include <optional>
+#include <thread>
 #include <vector>
 
 #include <pipewire/stream.h>
@@ -14,11 +26,20 @@
 class PipeWireThread;
 struct VisualizerSettings;
 
-struct SpectrogramSnapshot final {
-  int columns = 0;
-  int bins = 0;
-  int writeColumn = 0;
-  QVector<uint32_t> pixels; // columns*bins, column-major
+// Consumer-side position in the spectrogram history (see AudioTap::spectrogramSince()).
+struct SpectrogramCursor final {
+  uint64_t generation = 0;
+  uint64_t version = 0;
+};
+
+// Columns added since a cursor was last advanced. Reuse one instance across calls so the pixel
+// buffer is only reallocated when it has to grow.
+struct SpectrogramUpdate final {
+  int columns = 0;       // history length in columns
+  int bins = 0;          // rows per column
+  bool reset = false;    // geometry changed or history was cleared: drop what you have first
+  int newColumns = 0;    // number of columns in pixels, oldest first
+  QVector<uint32_t> pixels; // newColumns*bins, column-major, bin 0 (DC) first
 };
 
 class AudioTap final : public QObject
@@ -44,28 +65,83 @@ public:
   bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
   void setEnabled(bool enabled);
 
-  uint32_t sampleRate() const;
+  uint32_t sampleRate() const { return m_rtSampleRate.load(std::memory_order_relaxed); }
   void applySettings(const VisualizerSettings& settings);
 
   float peak() const { return m_peak.load(std::memory_order_relaxed); }
   float rms() const { return m_rms.load(std::memory_order_relaxed); }
 
-  QVector<float> spectrum() const;
-  SpectrogramSnapshot spectrogram() const;
+  // Analysis sources: a channel index 0..channelCount()-1 (per-channel mode), or one of these.
+  static constexpr int SourceMix = -1;
+  static constexpr int SourceMid = -2;  // (L+R)/2, needs mid/side mode and >= 2 channels
+  static constexpr int SourceSide = -3; // (L-R)/2
+
+  // Number of individually analysed channels (0 unless per-channel mode is enabled).
+  int channelCount() const;
+  QStringList channelNames() const;
+  bool hasMidSide() const;
+
+  // L/R correlation in -1..1 (0 when mid/side mode is off).
+  float correlation() const { return m_correlation.load(std::memory_order_relaxed); }
+
+  // Raw linear-bin spectrum (fftSize/2 bins), 0..1.
+  QVector<float> spectrum(int source = SourceMix) const;
+  // Display bands on the configured scale (log/mel/octave...), 0..1, plus their centres in Hz.
+  QVector<float> bands(int source = SourceMix) const;
+  QVector<float> bandCenters() const;
+  // Strongest spectral peak (parabolic interpolation over the zero-padded spectrum).
+  bool spectrumPeak(int source, float& frequencyHz, float& levelDb) const;
+  // Copies only the spectrogram columns produced since `cursor` and advances it. A cursor from a
+  // different history generation (or a default-constructed one) gets reset=true plus all columns.
+  void spectrogramSince(SpectrogramCursor& cursor, SpectrogramUpdate& out) const;
 
   // Returns per-column min/max pairs for drawing a waveform efficiently.
-  // windowSamples controls how much history to include.
-  void waveformMinMax(int columns, int windowSamples, QVector<float>& minsOut, QVector<float>& maxsOut) const;
+  // windowSamples controls how much history to include. Mid/side sources have no waveform.
+  void waveformMinMax(int columns, int windowSamples, QVector<float>& minsOut, QVector<float>& maxsOut, int source = SourceMix) const;
+
+  // Most recent (mid, side) sample pairs for a phase scope / goniometer, oldest first.
+  void phaseScope(int maxPoints, QVector<float>& midOut, QVector<float>& sideOut) const;
 
 signals:
   void streamStateChanged(QString state);
 
 private:
+  // Worker-side analysis slot: the mixdown, one per analysed channel, then mid and side.
+  struct SourceState final {
+    std::vector<float> fftRing;
+    std::vector<float> spectrum; // smoothed, 0..1
+    std::vector<float> bands;    // smoothed display bands, 0..1
+    std::size_t lastSmoothed = 0; // m_fftTotal at the last smoothing update
+  };
+
+  // Published spectra (one row per source slot) plus the layout needed to index them.
+  struct SpectrumSet final {
+    int channels = 0;
+    bool midSide = false;
+    std::vector<std::vector<float>> rows;
+    std::vector<std::vector<float>> bandRows;
+    std::vector<float> bandCenters;
+    std::vector<float> peakHz; // per slot
+    std::vector<float> peakDb;
+  };
+
   void connectStreamLocked();
   void destroyStreamLocked();
 
   void resizeWaveRingLocked();
   void resizeSpectrogramLocked();
+  void rebuildSourcesLocked();
+  void rebuildBandsLocked();
+  void resizeTransformLocked();
+  std::size_t waveCapacityLocked() const;
+  void noteRateChangeLocked(uint32_t rate);
+
+  void workerLoop();
+  void applyPendingSettings();
+  void analyze(std::size_t frames);
+  void analyzeFrame(bool publish);
+
+  static int sourceSlot(int source, int channels, bool midSide);
 
   static void onStreamStateChanged(void* data, enum pw_stream_state old, enum pw_stream_state state, const char* error);
   static void onStreamParamChanged(void* data, uint32_t id, const struct spa_pod* param);
@@ -83,36 +159,107 @@ private:
   std::atomic_bool m_captureSink{false};
   QString m_targetObject;
 
-  // Format (updated when negotiated)
-  uint32_t m_sampleRate = 48000;
-  uint32_t m_channels = 2;
+  // Realtime side: the process callback only deinterleaves into m_input.
+  dsp::SpscPlanarRing m_input;
+  std::atomic<uint32_t> m_rtSampleRate{48000};
+  std::atomic<uint32_t> m_rtChannels{2};
+  std::atomic<uint64_t> m_droppedFrames{0};
+
+  // Analysis worker (drains m_input, runs the FFTs, publishes results).
+  std::thread m_worker;
+  std::condition_variable m_workerCv;
+  bool m_workerStop = false; // guarded by m_mutex
+
+  // Pending settings, guarded by m_mutex and picked up by the worker.
+  std::atomic_bool m_settingsDirty{false};
+  std::size_t m_pendingFftSize = 1024;
+  float m_pendingSmoothing = 0.92f;
+  double m_pendingWaveSeconds = 0.5;
+  double m_pendingSpecSeconds = 2.0;
+  bool m_pendingMultiChannel = false;
+  bool m_pendingMidSide = false;
+  dsp::BandScale m_pendingBandScale = dsp::BandScale::Log;
+  std::size_t m_pendingBandCount = 96;
+  dsp::BandPooling m_pendingBandPooling = dsp::BandPooling::Max;
+  double m_pendingOverlap = 0.75;
+  std::size_t m_pendingZeroPad = 1;
+  std::vector<float> m_pendingWindow; // built by applySettings(), swapped in by the worker
+  bool m_pendingWindowReady = false;
 
+  // Worker-owned analysis state.
+  uint32_t m_sampleRate = 48000;
+  uint32_t m_inputChannels = 2; // channels present in m_input
   double m_waveHistorySeconds = 0.5;
   double m_spectrogramHistorySeconds = 2.0;
   float m_spectrumSmoothing = 0.92f;
+  bool m_multiChannel = false;
+  bool m_midSide = false;
+  dsp::BandScale m_bandScale = dsp::BandScale::Log;
+  std::size_t m_bandCount = 96;
+  dsp::BandPooling m_bandPooling = dsp::BandPooling::Max;
 
-  // Wave ring
-  std::vector<float> m_waveRing;
-  std::size_t m_waveWrite = 0;
-  std::size_t m_waveCount = 0;
-
-  // FFT/spectrogram
   std::size_t m_fftSize = 1024;
   std::size_t m_hopSize = 256;
-  std::vector<float> m_hann;
-  std::vector<float> m_fftRing;
+  std::size_t m_zeroPad = 1;
+  std::size_t m_transformSize = 1024; // m_fftSize * m_zeroPad
+  std::vector<float> m_window;
+  float m_windowScale = 1.0f; // amplitude normalization for m_window
+  std::size_t m_framesSincePublish = 0;
   std::size_t m_fftWrite = 0;
   std::size_t m_fftTotal = 0;
   std::size_t m_sinceFrame = 0;
+  dsp::FftPlan m_fftPlan;
+  std::vector<float> m_fftFrame;             // windowed input + zero padding, transformSize
+  std::vector<std::complex<float>> m_fftBuf; // transformSize/2 + 1 bins
+  std::vector<float> m_normWork;
+  std::vector<uint32_t> m_colourWork; // transformSize/2 colours, decimated into m_columnWork
+  std::vector<float> m_powerWork; // |X|^2 per bin, input to the band mapper
+  std::vector<float> m_bandWork;
+  dsp::BandMapper m_bandMapper;
+  std::vector<uint32_t> m_columnWork;
+
+  std::vector<SourceState> m_sources;
+  std::vector<const float*> m_sourceInput; // per slot, into the block buffers below
+  std::vector<std::vector<float>> m_planes; // deinterleaved block, one per input channel
+  std::vector<float*> m_planePtrs;
+  std::vector<float> m_mixBlock;
+  std::vector<float> m_midBlock;
+  std::vector<float> m_sideBlock;
+  double m_corrLR = 0.0;
+  double m_corrLL = 0.0;
+  double m_corrRR = 0.0;
+
+  // Published to the GUI thread (single reader).
+  mutable dsp::TripleBuffer<SpectrumSet> m_spectrumOut;
+
+  // Shared between the worker and GUI (never touched by the realtime callback).
+  mutable std::mutex m_mutex;
+  int m_publishedChannels = 0;
+  bool m_publishedMidSide = false;
+  QStringList m_channelNames;
+  std::vector<dsp::MinMaxPyramid> m_wavePyramids; // [0] = mix, then one per analysed channel
+  uint64_t m_framesAnalyzed = 0;
+  // Where the sample rate changed (in analysed frames), newest last; lets waveform queries span
+  // clock changes without rewriting history.
+  struct RateSegment final {
+    uint64_t start = 0;
+    uint32_t rate = 48000;
+  };
+  std::array<RateSegment, 8> m_rateSegments{RateSegment{0, 48000}};
+  std::size_t m_rateSegmentCount = 1;
+  std::vector<float> m_scopeMid;
+  std::vector<float> m_scopeSide;
+  std::size_t m_scopeWrite = 0;
+  std::size_t m_scopeCount = 0;
 
-  QVector<float> m_spectrum; // bins
   int m_specColumns = 360;
   int m_specBins = 512;
   int m_specWriteCol = 0;
-  QVector<uint32_t> m_specPixels; // column-major
-
-  mutable std::mutex m_mutex;
+  uint64_t m_specGeneration = 0; // new (process-unique) value whenever the history is reallocated
+  uint64_t m_specVersion = 0;    // total columns written in this generation
+  std::vector<uint32_t> m_specPixels; // column ring, column-major
 
   std::atomic<float> m_peak{0.0f};
   std::atomic<float> m_rms{0.0f};
+  std::atomic<float> m_correlation{0.0f};
 };
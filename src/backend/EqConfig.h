@@ -30,6 +30,9 @@ struct EqBand final {
 struct EqPreset final {
   bool enabled = false;
   double preampDb = 0.0;
+  // Run the same magnitude response as a linear-phase FIR instead of the biquad cascade. Costs
+  // latency (about 100 ms) and is meant for correction on monitoring chains, not live use.
+  bool linearPhase = false;
   QVector<EqBand> bands;
 };
 
@@ -130,6 +133,7 @@ inline QJsonObject eqPresetToJson(const EqPreset& p)
   QJsonObject o;
   o.insert(QStringLiteral("enabled"), p.enabled);
   o.insert(QStringLiteral("preampDb"), p.preampDb);
+  o.insert(QStringLiteral("linearPhase"), p.linearPhase);
   QJsonArray bands;
   for (const auto& b : p.bands) {
     bands.append(eqBandToJson(b));
@@ -143,6 +147,7 @@ inline EqPreset eqPresetFromJson(const QJsonObject& o)
   EqPreset p;
   p.enabled = o.value(QStringLiteral("enabled")).toBool(false);
   p.preampDb = o.value(QStringLiteral("preampDb")).toDouble(0.0);
+  p.linearPhase = o.value(QStringLiteral("linearPhase")).toBool(false);
   const QJsonArray bands = o.value(QStringLiteral("bands")).toArray();
   p.bands.reserve(bands.size());
   for (const auto& v : bands) {
@@ -0,0 +1,714 @@
+#include "MeterEngine.h"
+
+#include "PipeWireGraph.h"
+#include "PipeWireThread.h"
+#include "dsp/SimdKernels.h"
+
+#include <QMetaObject>
+#include <QSet>
+#include <QTimer>
+
+#include <pipewire/keys.h>
+#include <pipewire/properties.h>
+
+#include <spa/node/io.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <new>
+
+namespace {
+// Unused meters keep their ports and links this long, so a mixer rebuild finds them again.
+constexpr int kIdleGraceMs = 2000;
+constexpr int kReconcileDelayMs = 50;
+// Loudness interleaves the meter's mono ports through a buffer of this many frames.
+constexpr uint32_t kLoudnessChunkFrames = 1024;
+
+int64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool isAudioPort(const PwPortInfo& p)
+{
+  return p.mediaType == QStringLiteral("Audio") || p.formatDsp.contains(QStringLiteral("audio"));
+}
+
+// Output ports to meter for a node: its own audio outputs (monitor ports for sinks), or, for
+// nodes without any (recording streams), the ports linked into it.
+std::vector<PwPortInfo> meterSources(const QList<PwPortInfo>& ports, const QList<PwLinkInfo>& links, uint32_t nodeId)
+{
+  std::vector<PwPortInfo> out;
+  for (const auto& p : ports) {
+    if (p.nodeId == nodeId && p.direction == QStringLiteral("out") && isAudioPort(p)) {
+      out.push_back(p);
+    }
+  }
+  if (out.empty()) {
+    QSet<uint32_t> upstream;
+    for (const auto& l : links) {
+      if (l.inputNodeId == nodeId) {
+        upstream.insert(l.outputPortId);
+      }
+    }
+    for (const auto& p : ports) {
+      if (upstream.contains(p.id) && isAudioPort(p)) {
+        out.push_back(p);
+      }
+    }
+  }
+  std::sort(out.begin(), out.end(), [](const PwPortInfo& a, const PwPortInfo& b) { return a.id < b.id; });
+  if (out.size() > static_cast<std::size_t>(MeterEngine::kMaxPortsPerMeter)) {
+    out.resize(static_cast<std::size_t>(MeterEngine::kMaxPortsPerMeter));
+  }
+  return out;
+}
+
+dsp::LoudnessChannel loudnessChannel(const QString& position)
+{
+  if (position == QStringLiteral("LFE") || position == QStringLiteral("LFE2")) {
+    return dsp::LoudnessChannel::Lfe;
+  }
+  if (position == QStringLiteral("SL") || position == QStringLiteral("SR") || position == QStringLiteral("RL") || position == QStringLiteral("RR")) {
+    return dsp::LoudnessChannel::Surround;
+  }
+  return dsp::LoudnessChannel::Front;
+}
+} // namespace
+
+MeterEngine::MeterEngine(PipeWireThread* pw, PipeWireGraph* graph, QObject* parent)
+    : QObject(parent)
+    , m_pw(pw)
+    , m_graph(graph)
+    , m_meters(static_cast<std::size_t>(kMaxMeters))
+    , m_subscriptions(static_cast<std::size_t>(kMaxSubscriptions))
+{
+  m_reconcileTimer = new QTimer(this);
+  m_reconcileTimer->setSingleShot(true);
+  m_reconcileTimer->setInterval(kReconcileDelayMs);
+  connect(m_reconcileTimer, &QTimer::timeout, this, &MeterEngine::reconcile);
+
+  m_sweepTimer = new QTimer(this);
+  m_sweepTimer->setSingleShot(true);
+  m_sweepTimer->setInterval(kIdleGraceMs + kReconcileDelayMs);
+  connect(m_sweepTimer, &QTimer::timeout, this, &MeterEngine::reconcile);
+
+  if (m_graph) {
+    connect(m_graph, &PipeWireGraph::topologyChanged, this, &MeterEngine::scheduleReconcile);
+  }
+}
+
+MeterEngine::~MeterEngine()
+{
+  if (!m_pw || !m_pw->threadLoop()) {
+    return;
+  }
+  pw_thread_loop* loop = m_pw->threadLoop();
+  pw_thread_loop_lock(loop);
+  while (!m_filters.empty()) {
+    destroyFilterLocked(m_filters.back().get());
+  }
+  pw_thread_loop_unlock(loop);
+}
+
+int MeterEngine::filterCount() const
+{
+  return static_cast<int>(m_filters.size());
+}
+
+int MeterEngine::acquire(uint32_t nodeId)
+{
+  const auto freeIt = std::find_if(m_subscriptions.begin(), m_subscriptions.end(), [](const Subscription& s) { return !s.used; });
+  if (nodeId == 0 || freeIt == m_subscriptions.end()) {
+    return -1;
+  }
+  int meter = m_byNode.value(nodeId, -1);
+  if (meter < 0 && (meter = createMeter(nodeId)) < 0) {
+    return -1;
+  }
+
+  const int id = static_cast<int>(freeIt - m_subscriptions.begin());
+  *freeIt = Subscription{};
+  freeIt->used = true;
+  freeIt->meter = meter;
+  m_meters[static_cast<std::size_t>(meter)].subscriptions.push_back(id);
+  return id;
+}
+
+void MeterEngine::release(int subscription)
+{
+  if (subscription < 0 || subscription >= kMaxSubscriptions) {
+    return;
+  }
+  Subscription& s = m_subscriptions[static_cast<std::size_t>(subscription)];
+  if (!s.used) {
+    return;
+  }
+  const int meter = s.meter;
+  const bool loudness = s.loudness;
+  Meter& m = m_meters[static_cast<std::size_t>(meter)];
+  m.subscriptions.erase(std::remove(m.subscriptions.begin(), m.subscriptions.end(), subscription), m.subscriptions.end());
+  s = Subscription{};
+  if (loudness && m_pw && m_pw->threadLoop()) {
+    pw_thread_loop* loop = m_pw->threadLoop();
+    pw_thread_loop_lock(loop);
+    configureLoudnessLocked(meter);
+    pw_thread_loop_unlock(loop);
+  }
+  if (m.subscriptions.empty()) {
+    m.idleSinceNs = nowNs();
+    m_sweepTimer->start();
+  }
+}
+
+bool MeterEngine::levels(int subscription, MeterLevels& out) const
+{
+  const Subscription* s = this->subscription(subscription);
+  if (!s) {
+    return false;
+  }
+  readPublished(s->meter, out);
+  out.peak = std::max(out.peak, s->peak);
+  for (int c = 0; c < out.channels; ++c) {
+    const auto i = static_cast<std::size_t>(c);
+    out.channelPeak[i] = std::max(out.channelPeak[i], s->channelPeak[i]);
+  }
+  return true;
+}
+
+bool MeterEngine::takeLevels(int subscription, MeterLevels& out)
+{
+  if (!this->subscription(subscription)) {
+    return false;
+  }
+  Subscription& s = m_subscriptions[static_cast<std::size_t>(subscription)];
+  harvestPeaks(s.meter);
+  readPublished(s.meter, out);
+  out.peak = s.peak;
+  s.peak = 0.0f;
+  for (int c = 0; c < out.channels; ++c) {
+    const auto i = static_cast<std::size_t>(c);
+    out.channelPeak[i] = s.channelPeak[i];
+    s.channelPeak[i] = 0.0f;
+  }
+  return true;
+}
+
+bool MeterEngine::clippedRecently(int subscription, int holdMs) const
+{
+  MeterLevels l;
+  if (holdMs <= 0 || !levels(subscription, l) || l.lastClipNs <= 0) {
+    return false;
+  }
+  const int64_t ageNs = nowNs() - l.lastClipNs;
+  return ageNs >= 0 && ageNs < static_cast<int64_t>(holdMs) * 1'000'000LL;
+}
+
+void MeterEngine::setLoudness(int subscription, bool enabled)
+{
+  if (!this->subscription(subscription) || !m_pw || !m_pw->threadLoop()) {
+    return;
+  }
+  Subscription& s = m_subscriptions[static_cast<std::size_t>(subscription)];
+  if (s.loudness == enabled) {
+    return;
+  }
+  s.loudness = enabled;
+  pw_thread_loop* loop = m_pw->threadLoop();
+  pw_thread_loop_lock(loop);
+  configureLoudnessLocked(s.meter);
+  pw_thread_loop_unlock(loop);
+}
+
+void MeterEngine::resetLoudness(int subscription)
+{
+  const Subscription* s = this->subscription(subscription);
+  if (!s || !m_pw || !m_pw->threadLoop()) {
+    return;
+  }
+  pw_thread_loop* loop = m_pw->threadLoop();
+  pw_thread_loop_lock(loop);
+  if (Loudness* l = m_accumulators[static_cast<std::size_t>(s->meter)].loudness.get()) {
+    l->meter.clear();
+  }
+  pw_thread_loop_unlock(loop);
+}
+
+const MeterEngine::Subscription* MeterEngine::subscription(int id) const
+{
+  if (id < 0 || id >= kMaxSubscriptions) {
+    return nullptr;
+  }
+  const Subscription& s = m_subscriptions[static_cast<std::size_t>(id)];
+  return s.used ? &s : nullptr;
+}
+
+void MeterEngine::readPublished(int meter, MeterLevels& out) const
+{
+  const Published& pub = m_published[static_cast<std::size_t>(meter)];
+  out.peak = pub.peak.load(std::memory_order_relaxed);
+  out.ppm = pub.ppm.load(std::memory_order_relaxed);
+  out.rms = pub.rms.load(std::memory_order_relaxed);
+  out.lastClipNs = pub.lastClipNs.load(std::memory_order_relaxed);
+  out.channels = std::clamp(pub.channels.load(std::memory_order_relaxed), 0, MeterLevels::kMaxChannels);
+  for (int c = 0; c < out.channels; ++c) {
+    out.channelPeak[static_cast<std::size_t>(c)] = pub.channelPeak[static_cast<std::size_t>(c)].load(std::memory_order_relaxed);
+    out.channelRms[static_cast<std::size_t>(c)] = pub.channelRms[static_cast<std::size_t>(c)].load(std::memory_order_relaxed);
+  }
+  out.hasLoudness = pub.loudness.load(std::memory_order_relaxed);
+  if (out.hasLoudness) {
+    out.momentaryLufs = pub.momentaryLufs.load(std::memory_order_relaxed);
+    out.shortTermLufs = pub.shortTermLufs.load(std::memory_order_relaxed);
+    out.integratedLufs = pub.integratedLufs.load(std::memory_order_relaxed);
+    out.loudnessRangeLu = pub.loudnessRange.load(std::memory_order_relaxed);
+    out.maxTruePeak = pub.maxTruePeak.load(std::memory_order_relaxed);
+  }
+}
+
+void MeterEngine::harvestPeaks(int meter)
+{
+  // The audio side only ever raises the published peaks, so anything it adds after the swap
+  // waits there for the next harvest. Every subscription of the meter gets what was taken.
+  Published& pub = m_published[static_cast<std::size_t>(meter)];
+  const float peak = pub.peak.exchange(0.0f, std::memory_order_relaxed);
+  std::array<float, kMaxPortsPerMeter> channelPeak{};
+  const int channels = std::clamp(pub.channels.load(std::memory_order_relaxed), 0, kMaxPortsPerMeter);
+  for (int c = 0; c < channels; ++c) {
+    channelPeak[static_cast<std::size_t>(c)] = pub.channelPeak[static_cast<std::size_t>(c)].exchange(0.0f, std::memory_order_relaxed);
+  }
+  for (const int id : m_meters[static_cast<std::size_t>(meter)].subscriptions) {
+    Subscription& s = m_subscriptions[static_cast<std::size_t>(id)];
+    s.peak = std::max(s.peak, peak);
+    for (int c = 0; c < channels; ++c) {
+      const auto i = static_cast<std::size_t>(c);
+      s.channelPeak[i] = std::max(s.channelPeak[i], channelPeak[i]);
+    }
+  }
+}
+
+void MeterEngine::scheduleReconcile()
+{
+  m_reconcileTimer->start();
+}
+
+void MeterEngine::reconcile()
+{
+  if (!m_pw || !m_pw->isConnected() || !m_pw->threadLoop()) {
+    return;
+  }
+
+  // Expire meters nobody has used for the grace period.
+  const int64_t now = nowNs();
+  bool idleLeft = false;
+  for (int i = 0; i < kMaxMeters; ++i) {
+    const Meter& m = m_meters[static_cast<std::size_t>(i)];
+    if (!m.used || !m.subscriptions.empty()) {
+      continue;
+    }
+    if (now - m.idleSinceNs >= static_cast<int64_t>(kIdleGraceMs) * 1'000'000LL) {
+      destroyMeter(i);
+    } else {
+      idleLeft = true;
+    }
+  }
+  if (idleLeft) {
+    m_sweepTimer->start();
+  }
+
+  if (!m_graph || m_byNode.isEmpty()) {
+    return;
+  }
+
+  const QList<PwPortInfo> ports = m_graph->ports();
+  const QList<PwLinkInfo> links = m_graph->links();
+
+  QSet<uint32_t> filterNodes;
+  for (const auto& f : m_filters) {
+    if (const uint32_t id = f->nodeId.load(); id != 0) {
+      filterNodes.insert(id);
+    }
+  }
+  QHash<QString, uint32_t> ownPorts; // "<filter node>/<port name>" -> global port id
+  for (const auto& p : ports) {
+    if (filterNodes.contains(p.nodeId)) {
+      ownPorts.insert(QStringLiteral("%1/%2").arg(p.nodeId).arg(p.name), p.id);
+    }
+  }
+  QMultiHash<uint32_t, PwLinkInfo> linksByInput;
+  for (const auto& l : links) {
+    if (filterNodes.contains(l.inputNodeId)) {
+      linksByInput.insert(l.inputPortId, l);
+    }
+  }
+
+  pw_thread_loop* loop = m_pw->threadLoop();
+  for (int i = 0; i < kMaxMeters; ++i) {
+    Meter& m = m_meters[static_cast<std::size_t>(i)];
+    if (!m.used || !m.filter) {
+      continue;
+    }
+
+    const std::vector<PwPortInfo> sources = meterSources(ports, links, m.nodeId);
+    std::vector<dsp::LoudnessChannel> layout;
+    layout.reserve(sources.size());
+    for (const PwPortInfo& p : sources) {
+      layout.push_back(loudnessChannel(p.audioChannel));
+    }
+    if (sources.size() != m.ports.size()) {
+      // New ports are linked on the topology change that announces them.
+      m.layout = std::move(layout);
+      pw_thread_loop_lock(loop);
+      resizePortsLocked(i, sources.size());
+      pw_thread_loop_unlock(loop);
+      continue;
+    }
+    if (layout != m.layout) {
+      m.layout = std::move(layout);
+      pw_thread_loop_lock(loop);
+      configureLoudnessLocked(i);
+      pw_thread_loop_unlock(loop);
+    }
+
+    const uint32_t filterNode = m.filter->nodeId.load();
+    if (filterNode == 0) {
+      continue;
+    }
+    for (std::size_t k = 0; k < sources.size(); ++k) {
+      const uint32_t inPort = ownPorts.value(QStringLiteral("%1/%2").arg(filterNode).arg(m.ports[k].name), 0U);
+      if (inPort == 0) {
+        continue;
+      }
+      bool linked = false;
+      for (const PwLinkInfo& l : linksByInput.values(inPort)) {
+        if (l.outputPortId == sources[k].id) {
+          linked = true;
+        } else {
+          m_graph->destroyLink(l.id);
+        }
+      }
+      if (!linked) {
+        m_graph->createLink(sources[k].nodeId, sources[k].id, filterNode, inPort);
+      }
+    }
+  }
+}
+
+int MeterEngine::createMeter(uint32_t nodeId)
+{
+  if (!m_pw || !m_pw->isConnected() || !m_pw->threadLoop()) {
+    return -1;
+  }
+
+  const auto freeIt = std::find_if(m_meters.begin(), m_meters.end(), [](const Meter& m) { return !m.used; });
+  if (freeIt == m_meters.end()) {
+    return -1;
+  }
+
+  const int meter = static_cast<int>(freeIt - m_meters.begin());
+  pw_thread_loop* loop = m_pw->threadLoop();
+  pw_thread_loop_lock(loop);
+  Filter* filter = filterForNewMeterLocked();
+  m_accumulators[static_cast<std::size_t>(meter)].ballistics.reset();
+  pw_thread_loop_unlock(loop);
+  if (!filter) {
+    return -1;
+  }
+
+  freeIt->used = true;
+  freeIt->nodeId = nodeId;
+  freeIt->idleSinceNs = 0;
+  freeIt->filter = filter;
+  ++filter->meters;
+
+  Published& pub = m_published[static_cast<std::size_t>(meter)];
+  pub.peak.store(0.0f, std::memory_order_relaxed);
+  pub.ppm.store(0.0f, std::memory_order_relaxed);
+  pub.rms.store(0.0f, std::memory_order_relaxed);
+  pub.lastClipNs.store(0, std::memory_order_relaxed);
+  pub.channels.store(0, std::memory_order_relaxed);
+  pub.loudness.store(false, std::memory_order_relaxed);
+
+  m_byNode.insert(nodeId, meter);
+  scheduleReconcile();
+  return meter;
+}
+
+void MeterEngine::destroyMeter(int meter)
+{
+  Meter& m = m_meters[static_cast<std::size_t>(meter)];
+  if (m_pw && m_pw->threadLoop()) {
+    pw_thread_loop* loop = m_pw->threadLoop();
+    pw_thread_loop_lock(loop);
+    resizePortsLocked(meter, 0);
+    if (m.filter && --m.filter->meters == 0) {
+      destroyFilterLocked(m.filter);
+    }
+    pw_thread_loop_unlock(loop);
+  }
+  m_byNode.remove(m.nodeId);
+  m = Meter{};
+}
+
+MeterEngine::Filter* MeterEngine::filterForNewMeterLocked()
+{
+  for (const auto& f : m_filters) {
+    if (f->meters < kMetersPerFilter) {
+      return f.get();
+    }
+  }
+  if (!m_pw || !m_pw->core()) {
+    return nullptr;
+  }
+
+  auto f = std::make_unique<Filter>();
+  f->self = this;
+  f->serial = m_nextFilterSerial++;
+  const QByteArray nodeName = QByteArray("headroom.meters.") + QByteArray::number(f->serial);
+
+  // Passive, and without a media class, so the session manager never links it and metering
+  // never keeps an otherwise idle device running.
+  pw_properties* props = pw_properties_new(
+      PW_KEY_MEDIA_TYPE, "Audio",
+      PW_KEY_MEDIA_CATEGORY, "Capture",
+      PW_KEY_MEDIA_ROLE, "DSP",
+      PW_KEY_NODE_NAME, nodeName.constData(),
+      PW_KEY_NODE_DESCRIPTION, "Headroom Meters",
+      PW_KEY_NODE_PASSIVE, "true",
+      nullptr);
+
+  f->filter = pw_filter_new(m_pw->core(), "Headroom Meters", props);
+  if (!f->filter) {
+    return nullptr;
+  }
+
+  static const pw_filter_events filterEvents = [] {
+    pw_filter_events e{};
+    e.version = PW_VERSION_FILTER_EVENTS;
+    e.state_changed = &MeterEngine::onFilterStateChanged;
+    e.process = &MeterEngine::onFilterProcess;
+    return e;
+  }();
+  pw_filter_add_listener(f->filter, &f->listener, &filterEvents, f.get());
+
+  if (pw_filter_connect(f->filter, PW_FILTER_FLAG_NONE, nullptr, 0) < 0) {
+    spa_hook_remove(&f->listener);
+    pw_filter_destroy(f->filter);
+    return nullptr;
+  }
+
+  m_filters.push_back(std::move(f));
+  return m_filters.back().get();
+}
+
+void MeterEngine::destroyFilterLocked(Filter* filter)
+{
+  const auto it = std::find_if(m_filters.begin(), m_filters.end(), [filter](const auto& f) { return f.get() == filter; });
+  if (it == m_filters.end()) {
+    return;
+  }
+  spa_hook_remove(&filter->listener);
+  pw_filter_destroy(filter->filter);
+  m_filters.erase(it);
+}
+
+void MeterEngine::resizePortsLocked(int meter, std::size_t count)
+{
+  Meter& m = m_meters[static_cast<std::size_t>(meter)];
+  Filter* f = m.filter;
+  if (!f || !f->filter) {
+    return;
+  }
+
+  while (m.ports.size() > count) {
+    PortData* data = m.ports.back().data;
+    m.ports.pop_back();
+    f->ports.erase(std::remove(f->ports.begin(), f->ports.end(), data), f->ports.end());
+    data->~PortData();
+    pw_filter_remove_port(data);
+  }
+  while (m.ports.size() < count) {
+    const QString name = QStringLiteral("meter%1_%2").arg(meter).arg(m.ports.size() + 1U);
+    pw_properties* props = pw_properties_new(
+        PW_KEY_FORMAT_DSP, "32 bit float mono audio",
+        PW_KEY_PORT_NAME, name.toUtf8().constData(),
+        nullptr);
+    void* mem = pw_filter_add_port(f->filter, PW_DIRECTION_INPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS, sizeof(PortData), props, nullptr, 0);
+    if (!mem) {
+      break;
+    }
+    // PipeWire hands out zeroed storage; the object still has to be constructed in it.
+    auto* data = new (mem) PortData{};
+    data->meter = meter;
+    data->channel = static_cast<int>(m.ports.size());
+    f->ports.push_back(data);
+    m.ports.push_back(Port{data, name});
+  }
+
+  Published& pub = m_published[static_cast<std::size_t>(meter)];
+  pub.channels.store(static_cast<int>(m.ports.size()), std::memory_order_relaxed);
+  if (m.ports.empty()) {
+    pub.peak.store(0.0f, std::memory_order_relaxed);
+    pub.ppm.store(0.0f, std::memory_order_relaxed);
+    pub.rms.store(0.0f, std::memory_order_relaxed);
+  }
+  configureLoudnessLocked(meter);
+}
+
+void MeterEngine::configureLoudnessLocked(int meter)
+{
+  const Meter& m = m_meters[static_cast<std::size_t>(meter)];
+  Accumulator& acc = m_accumulators[static_cast<std::size_t>(meter)];
+  const bool wanted = m.used && std::any_of(m.subscriptions.begin(), m.subscriptions.end(), [this](int id) {
+    return m_subscriptions[static_cast<std::size_t>(id)].loudness;
+  });
+  if (!wanted) {
+    acc.loudness.reset();
+    m_published[static_cast<std::size_t>(meter)].loudness.store(false, std::memory_order_relaxed);
+    return;
+  }
+
+  // A new channel layout is a new programme; a new weighting alone is not.
+  const std::size_t channels = std::max<std::size_t>(1U, m.ports.size());
+  if (!acc.loudness) {
+    acc.loudness = std::make_unique<Loudness>();
+  }
+  Loudness& l = *acc.loudness;
+  if (l.meter.channels() != channels) {
+    l.meter.reset(l.meter.sampleRate(), channels);
+  }
+  l.interleaved.assign(static_cast<std::size_t>(kLoudnessChunkFrames) * channels, 0.0f);
+  l.weights.assign(channels, 1.0f);
+  for (std::size_t c = 0; c < channels; ++c) {
+    if (c < m.layout.size()) {
+      l.weights[c] = dsp::loudnessChannelWeight(m.layout[c]);
+    }
+    l.meter.setChannelWeight(c, l.weights[c]);
+  }
+}
+
+void MeterEngine::measureLoudness(Accumulator& acc, Published& pub, uint32_t samples, uint32_t rate)
+{
+  Loudness& l = *acc.loudness;
+  const std::size_t channels = l.meter.channels();
+  if (rate > 0 && rate != l.meter.sampleRate()) {
+    // Same channel count, so this re-tunes the filters without allocating.
+    l.meter.reset(rate, channels);
+    for (std::size_t c = 0; c < channels; ++c) {
+      l.meter.setChannelWeight(c, l.weights[c]);
+    }
+  }
+
+  for (uint32_t done = 0; done < samples;) {
+    const uint32_t frames = std::min(samples - done, kLoudnessChunkFrames);
+    for (std::size_t c = 0; c < channels; ++c) {
+      const float* in = acc.inputs[c];
+      float* out = l.interleaved.data() + c;
+      for (uint32_t i = 0; i < frames; ++i) {
+        out[i * channels] = in ? in[done + i] : 0.0f;
+      }
+    }
+    l.meter.process(l.interleaved.data(), frames);
+    done += frames;
+  }
+
+  float maxTruePeak = 0.0f;
+  for (std::size_t c = 0; c < channels; ++c) {
+    maxTruePeak = std::max(maxTruePeak, l.meter.maxTruePeak(c));
+  }
+  pub.momentaryLufs.store(l.meter.momentaryLufs(), std::memory_order_relaxed);
+  pub.shortTermLufs.store(l.meter.shortTermLufs(), std::memory_order_relaxed);
+  pub.integratedLufs.store(l.meter.integratedLufs(), std::memory_order_relaxed);
+  pub.loudnessRange.store(l.meter.loudnessRangeLu(), std::memory_order_relaxed);
+  pub.maxTruePeak.store(maxTruePeak, std::memory_order_relaxed);
+  pub.loudness.store(true, std::memory_order_relaxed);
+}
+
+void MeterEngine::onFilterStateChanged(void* data, enum pw_filter_state /*old*/, enum pw_filter_state state, const char* /*error*/)
+{
+  auto* filter = static_cast<Filter*>(data);
+  if (!filter || !filter->self) {
+    return;
+  }
+  if (state == PW_FILTER_STATE_PAUSED || state == PW_FILTER_STATE_STREAMING) {
+    const uint32_t id = pw_filter_get_node_id(filter->filter);
+    if (id != SPA_ID_INVALID && id != filter->nodeId.exchange(id)) {
+      MeterEngine* self = filter->self;
+      QMetaObject::invokeMethod(self, [self]() { self->scheduleReconcile(); }, Qt::QueuedConnection);
+    }
+  }
+}
+
+void MeterEngine::onFilterProcess(void* data, struct spa_io_position* position)
+{
+  auto* filter = static_cast<Filter*>(data);
+  if (!filter || !filter->self || !position) {
+    return;
+  }
+  filter->self->processFilter(*filter, static_cast<uint32_t>(position->clock.duration), position->clock.rate.denom);
+}
+
+void MeterEngine::processFilter(Filter& filter, uint32_t samples, uint32_t rate)
+{
+  if (samples == 0) {
+    return;
+  }
+  const double seconds = static_cast<double>(samples) / static_cast<double>(rate > 0 ? rate : 48000U);
+
+  // Every port of a meter lands in one accumulator; each meter is published once per cycle.
+  for (const PortData* port : filter.ports) {
+    Accumulator& acc = m_accumulators[static_cast<std::size_t>(port->meter)];
+    acc.peak = 0.0f;
+    acc.sumSq = 0.0;
+    acc.samples = 0;
+    acc.clipped = false;
+    acc.inputs.fill(nullptr);
+  }
+  for (PortData* port : filter.ports) {
+    const auto* in = static_cast<const float*>(pw_filter_get_dsp_buffer(port, samples));
+    if (!in) {
+      continue;
+    }
+    Accumulator& acc = m_accumulators[static_cast<std::size_t>(port->meter)];
+    float peak = 0.0f;
+    float sumSq = 0.0f;
+    uint32_t clips = 0;
+    dsp::simd::channelLevels(in, samples, 1, 1.0f, &peak, &sumSq, &clips);
+
+    const float rms = std::sqrt(sumSq / static_cast<float>(samples));
+    port->ballistics.advance(peak, rms, seconds);
+    Published& pub = m_published[static_cast<std::size_t>(port->meter)];
+    if (port->channel < kMaxPortsPerMeter) {
+      dsp::atomicMax(pub.channelPeak[static_cast<std::size_t>(port->channel)], peak);
+      pub.channelRms[static_cast<std::size_t>(port->channel)].store(port->ballistics.vu, std::memory_order_relaxed);
+      acc.inputs[static_cast<std::size_t>(port->channel)] = in;
+    }
+    acc.peak = std::max(acc.peak, peak);
+    acc.sumSq += static_cast<double>(sumSq);
+    acc.samples += samples;
+    acc.clipped = acc.clipped || clips > 0;
+  }
+
+  int64_t clipNs = 0;
+  for (const PortData* port : filter.ports) {
+    Accumulator& acc = m_accumulators[static_cast<std::size_t>(port->meter)];
+    if (acc.samples == 0) {
+      continue;
+    }
+    const float rms = static_cast<float>(std::sqrt(acc.sumSq / static_cast<double>(acc.samples)));
+    acc.ballistics.advance(acc.peak, rms, seconds);
+
+    Published& pub = m_published[static_cast<std::size_t>(port->meter)];
+    dsp::atomicMax(pub.peak, acc.peak);
+    pub.ppm.store(acc.ballistics.ppm, std::memory_order_relaxed);
+    pub.rms.store(acc.ballistics.vu, std::memory_order_relaxed);
+    if (acc.clipped) {
+      clipNs = clipNs != 0 ? clipNs : nowNs();
+      pub.lastClipNs.store(clipNs, std::memory_order_relaxed);
+    }
+    if (acc.loudness) {
+      measureLoudness(acc, pub, samples, rate);
+    }
+    acc.samples = 0;
+  }
+}
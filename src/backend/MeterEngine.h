@@ -0,0 +1,198 @@
+#pragma once
+
+#include "dsp/Loudness.h"
+#include "dsp/MeterBallistics.h"
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <pipewire/filter.h>
+
+class PipeWireGraph;
+class PipeWireThread;
+class QTimer;
+
+struct MeterLevels final {
+  static constexpr int kMaxChannels = 16;
+
+  float peak = 0.0f; // highest sample peak of any channel since this subscriber's previous takeLevels(), linear
+  float ppm = 0.0f;  // peak programme level (IEC 60268-10 type I ballistics), linear
+  float rms = 0.0f;  // VU-integrated power average over channels, linear
+  int64_t lastClipNs = 0;
+  int channels = 0;  // one per metered port
+  std::array<float, kMaxChannels> channelPeak{}; // held like `peak`
+  std::array<float, kMaxChannels> channelRms{};  // VU-integrated
+
+  // BS.1770 / EBU R128, only while some subscription of the meter asked for it.
+  bool hasLoudness = false;
+  float momentaryLufs = dsp::LoudnessMeter::kMinLufs;
+  float shortTermLufs = dsp::LoudnessMeter::kMinLufs;
+  float integratedLufs = dsp::LoudnessMeter::kMinLufs;
+  float loudnessRangeLu = 0.0f;
+  float maxTruePeak = 0.0f; // linear, any channel, since the programme started
+};
+
+// Peak/RMS/clip metering for many nodes through a small pool of capture nodes.
+//
+// Each metered node gets mono DSP input ports on a shared pw_filter ("headroom.meters.N"),
+// linked from the node's output (or sink monitor) ports; a node without outputs, such as a
+// recording stream, is metered from whatever feeds its inputs. One process callback per filter
+// measures every port and publishes into a fixed array of atomics that the UI polls lock-free.
+//
+// Meters are shared per node id by any number of subscriptions and survive their last one for a
+// short grace period, so rebuilding the mixer reuses ports and links instead of tearing them down.
+//
+// Ballistics run on the audio side and sample peaks are held per subscription until that
+// subscription reads them, so every reader sees every over no matter how rarely it polls.
+//
+// Loudness (dsp::LoudnessMeter over all of a meter's channels) is opt-in: it runs for a meter
+// while at least one of its subscriptions has asked for it.
+class MeterEngine final : public QObject
+{
+  Q_OBJECT
+
+public:
+  static constexpr int kMaxMeters = 256;
+  static constexpr int kMetersPerFilter = 64;
+  static constexpr int kMaxPortsPerMeter = MeterLevels::kMaxChannels;
+  static constexpr int kMaxSubscriptions = 4 * kMaxMeters;
+
+  MeterEngine(PipeWireThread* pw, PipeWireGraph* graph, QObject* parent = nullptr);
+  ~MeterEngine() override;
+
+  MeterEngine(const MeterEngine&) = delete;
+  MeterEngine& operator=(const MeterEngine&) = delete;
+
+  // Returns a subscription to the node's meter, or -1.
+  int acquire(uint32_t nodeId);
+  void release(int subscription);
+
+  // Call from the engine's thread. levels() leaves the held peaks alone; takeLevels() resets
+  // only this subscription's, so widgets sharing a meter never take each other's peaks.
+  bool levels(int subscription, MeterLevels& out) const;
+  bool takeLevels(int subscription, MeterLevels& out);
+  bool clippedRecently(int subscription, int holdMs = 1000) const;
+
+  void setLoudness(int subscription, bool enabled);
+  // Starts a new programme (integrated loudness, range, maximum true peak) for the whole meter.
+  void resetLoudness(int subscription);
+
+  int meterCount() const { return static_cast<int>(m_byNode.size()); }
+  int filterCount() const;
+
+private:
+  // pw_filter port user data, constructed in place when the port is added. pw_filter_destroy()
+  // frees the ports of a whole filter without running destructors, so it must not need one.
+  struct PortData final {
+    int meter = -1;
+    int channel = 0;
+    dsp::MeterBallistics ballistics;
+  };
+  static_assert(std::is_trivially_destructible_v<PortData>);
+
+  struct Filter final {
+    MeterEngine* self = nullptr;
+    pw_filter* filter = nullptr;
+    spa_hook listener{};
+    std::atomic<uint32_t> nodeId{0};
+    std::vector<PortData*> ports; // mutated and processed on the PipeWire loop thread only
+    int meters = 0;
+    int serial = 0;
+  };
+
+  struct Port final {
+    PortData* data = nullptr;
+    QString name;
+  };
+
+  struct Meter final {
+    bool used = false;
+    uint32_t nodeId = 0;
+    std::vector<int> subscriptions;
+    std::vector<dsp::LoudnessChannel> layout; // of the metered ports, for loudness weighting
+    int64_t idleSinceNs = 0;
+    Filter* filter = nullptr;
+    std::vector<Port> ports;
+  };
+
+  struct Published final {
+    std::atomic<float> peak{0.0f}; // held until taken
+    std::atomic<float> ppm{0.0f};
+    std::atomic<float> rms{0.0f};
+    std::atomic<int64_t> lastClipNs{0};
+    std::atomic<int> channels{0};
+    std::array<std::atomic<float>, kMaxPortsPerMeter> channelPeak{};
+    std::array<std::atomic<float>, kMaxPortsPerMeter> channelRms{};
+    std::atomic_bool loudness{false};
+    std::atomic<float> momentaryLufs{dsp::LoudnessMeter::kMinLufs};
+    std::atomic<float> shortTermLufs{dsp::LoudnessMeter::kMinLufs};
+    std::atomic<float> integratedLufs{dsp::LoudnessMeter::kMinLufs};
+    std::atomic<float> loudnessRange{0.0f};
+    std::atomic<float> maxTruePeak{0.0f};
+  };
+
+  struct Subscription final {
+    bool used = false;
+    int meter = -1;
+    bool loudness = false;
+    float peak = 0.0f; // published peaks harvested but not yet taken by this subscription
+    std::array<float, kMaxPortsPerMeter> channelPeak{};
+  };
+
+  struct Loudness final {
+    dsp::LoudnessMeter meter;
+    std::vector<float> weights;     // per channel, re-applied when the rate changes
+    std::vector<float> interleaved; // kLoudnessChunkFrames frames of the meter's ports
+  };
+
+  struct Accumulator final {
+    float peak = 0.0f;
+    double sumSq = 0.0;
+    uint32_t samples = 0;
+    bool clipped = false;
+    dsp::MeterBallistics ballistics; // kept across cycles
+    std::array<const float*, kMaxPortsPerMeter> inputs{}; // this cycle's port buffers
+    // Allocated while loudness is wanted. Changed only under the loop lock.
+    std::unique_ptr<Loudness> loudness;
+  };
+
+  static void onFilterStateChanged(void* data, enum pw_filter_state old, enum pw_filter_state state, const char* error);
+  static void onFilterProcess(void* data, struct spa_io_position* position);
+
+  void scheduleReconcile();
+  void reconcile();
+  int createMeter(uint32_t nodeId);
+  void destroyMeter(int meter);
+  const Subscription* subscription(int id) const;
+  void readPublished(int meter, MeterLevels& out) const;
+  void harvestPeaks(int meter);
+  void configureLoudnessLocked(int meter);
+  void measureLoudness(Accumulator& acc, Published& pub, uint32_t samples, uint32_t rate);
+
+  Filter* filterForNewMeterLocked();
+  void destroyFilterLocked(Filter* filter);
+  void resizePortsLocked(int meter, std::size_t count);
+  void processFilter(Filter& filter, uint32_t samples, uint32_t rate);
+
+  PipeWireThread* m_pw = nullptr;
+  PipeWireGraph* m_graph = nullptr;
+  QTimer* m_reconcileTimer = nullptr;
+  QTimer* m_sweepTimer = nullptr;
+
+  std::vector<std::unique_ptr<Filter>> m_filters;
+  std::vector<Meter> m_meters;
+  std::vector<Subscription> m_subscriptions;
+  QHash<uint32_t, int> m_byNode;
+  int m_nextFilterSerial = 1;
+
+  std::array<Published, kMaxMeters> m_published;
+  std::array<Accumulator, kMaxMeters> m_accumulators; // loop thread, or under the loop lock
+};
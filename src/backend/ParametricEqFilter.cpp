@@ -5,9 +5,12 @@
 #include <QRegularExpression>
 
 #include <pipewire/keys.h>
+#include <pipewire/loop.h>
 #include <pipewire/properties.h>
+#include <pipewire/thread-loop.h>
 
 #include <spa/param/audio/raw-utils.h>
+#include <spa/param/latency-utils.h>
 #include <spa/utils/result.h>
 
 #include <algorithm>
@@ -109,6 +112,12 @@ ParametricEqFilter::ParametricEqFilter(PipeWireThread* pw,
     , m_portSpecs(std::move(ports))
 {
   m_preset = defaultEqPreset(6);
+  // Each publish collects what came back before it, so only a couple are ever in flight.
+  m_retiredBanks.reset(16);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    publishBankLocked();
+  }
 
   if (!m_pw || !m_pw->isConnected() || !m_pw->threadLoop()) {
     return;
@@ -122,14 +131,15 @@ ParametricEqFilter::ParametricEqFilter(PipeWireThread* pw,
 
 ParametricEqFilter::~ParametricEqFilter()
 {
-  if (!m_pw || !m_pw->threadLoop()) {
-    return;
+  if (m_pw && m_pw->threadLoop()) {
+    pw_thread_loop* loop = m_pw->threadLoop();
+    pw_thread_loop_lock(loop);
+    destroyLocked();
+    pw_thread_loop_unlock(loop);
   }
 
-  pw_thread_loop* loop = m_pw->threadLoop();
-  pw_thread_loop_lock(loop);
-  destroyLocked();
-  pw_thread_loop_unlock(loop);
+  // The filter is gone, so nothing can be adopting a bank any more.
+  freeBanks();
 }
 
 EqPreset ParametricEqFilter::preset() const
@@ -140,9 +150,12 @@ EqPreset ParametricEqFilter::preset() const
 
 void ParametricEqFilter::setPreset(const EqPreset& preset)
 {
-  std::lock_guard<std::mutex> lock(m_mutex);
-  m_preset = preset;
-  rebuildCoefficientsLocked();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_preset = preset;
+    publishBankLocked();
+  }
+  // A change of latency is reported by the process callback, once the new bank is in effect.
 }
 
 void ParametricEqFilter::connectLocked()
@@ -172,6 +185,7 @@ void ParametricEqFilter::connectLocked()
   if (!m_filter) {
     return;
   }
+  m_latencyEvent = pw_loop_add_event(pw_thread_loop_get_loop(m_pw->threadLoop()), &ParametricEqFilter::onLatencyChanged, this);
 
   static const pw_filter_events filterEvents = [] {
     pw_filter_events e{};
@@ -252,7 +266,11 @@ void ParametricEqFilter::connectLocked()
 
   {
     std::lock_guard<std::mutex> lock(m_mutex);
-    rebuildCoefficientsLocked();
+    m_portChannels.clear();
+    for (const auto& port : m_ports) {
+      m_portChannels.push_back(std::max(1, port.channels));
+    }
+    publishBankLocked();
   }
 
   const int res = pw_filter_connect(m_filter, PW_FILTER_FLAG_NONE, nullptr, 0);
@@ -264,6 +282,23 @@ void ParametricEqFilter::connectLocked()
   m_nodeId.store(pw_filter_get_node_id(m_filter));
 }
 
+void ParametricEqFilter::updateLatencyLocked()
+{
+  const uint32_t frames = m_latencyFrames.load(std::memory_order_relaxed);
+  if (!m_filter || frames == m_reportedLatency) {
+    return;
+  }
+
+  uint8_t buffer[256];
+  spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+  spa_process_latency_info info{};
+  info.rate = frames;
+  const spa_pod* params[] = {spa_process_latency_build(&b, SPA_PARAM_ProcessLatency, &info)};
+  if (pw_filter_update_params(m_filter, nullptr, params, 1) >= 0) {
+    m_reportedLatency = frames;
+  }
+}
+
 void ParametricEqFilter::destroyLocked()
 {
   if (!m_filter) {
@@ -273,9 +308,19 @@ void ParametricEqFilter::destroyLocked()
   spa_hook_remove(&m_filterListener);
   pw_filter_destroy(m_filter);
   m_filter = nullptr;
+  if (m_latencyEvent) {
+    pw_loop_destroy_source(pw_thread_loop_get_loop(m_pw->threadLoop()), m_latencyEvent);
+    m_latencyEvent = nullptr;
+  }
   m_ports.clear();
   m_totalChannels = 0;
+  m_latencyFrames.store(0);
+  m_reportedLatency = 0;
   m_nodeId.store(0);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_portChannels.clear();
+  }
 }
 
 void ParametricEqFilter::onFilterStateChanged(void* data, enum pw_filter_state /*old*/, enum pw_filter_state /*state*/, const char* /*error*/)
@@ -286,7 +331,7 @@ void ParametricEqFilter::onFilterStateChanged(void* data, enum pw_filter_state /
   }
 }
 
-void ParametricEqFilter::onFilterParamChanged(void* data, void* /*port_data*/, uint32_t id, const struct spa_pod* param)
+void ParametricEqFilter::onFilterParamChanged(void* data, void* port_data, uint32_t id, const struct spa_pod* param)
 {
   auto* self = static_cast<ParametricEqFilter*>(data);
   if (!self || !param) {
@@ -306,9 +351,22 @@ void ParametricEqFilter::onFilterParamChanged(void* data, void* /*port_data*/, u
     return;
   }
 
-  std::lock_guard<std::mutex> lock(self->m_mutex);
-  self->m_sampleRate = static_cast<double>(info.rate);
-  self->rebuildCoefficientsLocked();
+  // Every port reports the same format when the filter starts, so only an actual change of rate
+  // designs a new bank. Port widths are fixed by the formats the ports offer; a port negotiating
+  // anything else is ignored rather than relaid.
+  const auto* port = static_cast<const PortUserData*>(port_data);
+  {
+    std::lock_guard<std::mutex> lock(self->m_mutex);
+    if (port && port->portIndex >= 0 && port->portIndex < self->m_portChannels.size()
+        && static_cast<int>(info.channels) != self->m_portChannels[port->portIndex]) {
+      return;
+    }
+    if (static_cast<double>(info.rate) == self->m_sampleRate) {
+      return;
+    }
+    self->m_sampleRate = static_cast<double>(info.rate);
+    self->publishBankLocked();
+  }
 }
 
 void ParametricEqFilter::onFilterProcess(void* data, struct spa_io_position* /*position*/)
@@ -317,6 +375,14 @@ void ParametricEqFilter::onFilterProcess(void* data, struct spa_io_position* /*p
   if (!self) {
     return;
   }
-  std::lock_guard<std::mutex> lock(self->m_mutex);
-  self->processLocked();
+  self->processBlock();
+}
+
+void ParametricEqFilter::onLatencyChanged(void* data, uint64_t /*count*/)
+{
+  auto* self = static_cast<ParametricEqFilter*>(data);
+  if (!self) {
+    return;
+  }
+  self->updateLatencyLocked();
 }
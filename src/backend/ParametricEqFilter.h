@@ -5,13 +5,33 @@
 
 #include <atomic>
 #include <mutex>
+#include <vector>
 
 #include <pipewire/filter.h>
 
 #include "backend/EqConfig.h"
+#include "dsp/PartitionedConvolver.h"
+#include "dsp/SimdKernels.h"
+#include "dsp/SpscRing.h"
 
 class PipeWireThread;
 
+// Realtime EQ node. The process callback never locks: every preset or rate change builds a new,
+// immutable coefficient bank on the control side and hands it over through an atomic mailbox.
+// The process callback adopts it at the start of the next block, carrying filter state over band
+// by band, and passes the bank it replaced back through a ring so the control side frees it.
+//
+// Changes never take effect in a single sample. When only band parameters move, the new bank
+// glides frequency, Q, gain and preamp from where the old one was, recomputing coefficients every
+// kRampSubBlock frames (nothing extra per sample). When the band layout changes or the EQ is
+// bypassed or re-enabled, old and new banks both run for one ramp and their outputs crossfade.
+//
+// In linear-phase mode the bank carries an FIR with the cascade's magnitude response instead,
+// run by partitioned FFT convolution; its delay is reported to PipeWire as process latency once
+// that bank is the only one running. An FIR that starts without input history is silent for that
+// delay, so switching into linear phase keeps the old path audible while the new one fills up and
+// only then crossfades: the output steps back by the delay instead of dropping out. Switching out
+// of linear phase skips forward by the same amount.
 class ParametricEqFilter final : public QObject
 {
   Q_OBJECT
@@ -45,22 +65,91 @@ private:
     double a2 = 0.0;
   };
 
-  struct BiquadState final {
-    double z1 = 0.0;
-    double z2 = 0.0;
+  // Coefficients laid out for dsp::simd::biquadCascade: one array per term, one entry per section.
+  struct Coefficients final {
+    std::vector<double> b0, b1, b2, a1, a2;
+
+    void resize(std::size_t sections)
+    {
+      b0.resize(sections);
+      b1.resize(sections);
+      b2.resize(sections);
+      a1.resize(sections);
+      a2.resize(sections);
+    }
+    void set(std::size_t section, const Biquad& c)
+    {
+      b0[section] = c.b0;
+      b1[section] = c.b1;
+      b2[section] = c.b2;
+      a1[section] = c.a1;
+      a2[section] = c.a2;
+    }
   };
 
+  struct BandParams final {
+    double freqHz = 1000.0;
+    double q = 1.0;
+    double gainDb = 0.0;
+  };
+
+  struct Section final {
+    int band = 0; // index into the preset, for carrying state across banks
+    EqBandType type = EqBandType::Peaking;
+    BandParams params;
+    Biquad c;
+  };
+
+  // Everything the process callback needs for one configuration. Built and freed on the control
+  // side; between those only the process callback touches it, and only the state, `live`,
+  // `from`, `preGainFrom` and `scratch` change (all sized up front, so adopting never allocates).
+  struct Bank final {
+    bool enabled = false;
+    double sampleRate = 48000.0;
+    double preGain = 1.0;
+    int channels = 1;
+    std::vector<Section> sections; // enabled bands only
+    std::vector<double> z1, z2;    // [section * channels + channel]
+    Coefficients live;             // in use; differ from sections[].c while gliding
+    std::vector<BandParams> from;  // glide start per section
+    double preGainFrom = 1.0;
+    std::vector<float> scratch;    // kRampSubBlock frames of output while crossfading out
+    dsp::simd::BiquadCascadeFn kernel = &dsp::simd::biquadCascade; // picked for this shape
+
+    bool linearPhase = false; // run `fir` instead of the cascade
+    uint32_t latencyFrames = 0;
+    dsp::FirPartitions fir;
+    std::vector<dsp::PartitionedConvolver> convolvers; // one per channel pair, never across ports
+  };
+
+  static constexpr double kRampSeconds = 0.02;
+  static constexpr uint32_t kRampSubBlock = 32;
+  // Linear-phase FIR length (rounded up to a power of two; 8192 taps at 48 kHz) and the number
+  // of partitions it is split into, which sets the block size and so the extra latency.
+  static constexpr double kFirSeconds = 0.15;
+  static constexpr std::size_t kFirPartitions = 16;
+
   static void onFilterStateChanged(void* data, enum pw_filter_state old, enum pw_filter_state state, const char* error);
   static void onFilterParamChanged(void* data, void* port_data, uint32_t id, const struct spa_pod* param);
   static void onFilterProcess(void* data, struct spa_io_position* position);
+  static void onLatencyChanged(void* data, uint64_t count);
 
   void connectLocked();
   void destroyLocked();
-  void rebuildCoefficientsLocked();
-
-  void processLocked();
+  void publishBankLocked();
+  uint32_t designFirLocked(Bank& bank);
+  void updateLatencyLocked();
+  void collectRetiredBanks();
+  void freeBanks();
+
+  void processBlock();
+  Bank* acquireBank();
+  void retireBank(Bank* bank);
+  BandParams glideParams(const Bank& bank, std::size_t section, double t) const;
+  void updateGlide(Bank& bank, double t);
 
   static Biquad makeBiquad(EqBandType type, double sampleRate, double freqHz, double q, double gainDb);
+  static double magnitude(const Biquad& c, double w);
   static double clamp(double v, double lo, double hi);
 
   PipeWireThread* m_pw = nullptr;
@@ -80,12 +169,26 @@ private:
   QVector<PortPair> m_ports;
   int m_totalChannels = 0;
 
+  // Control side only: serializes preset and rate changes from the UI and the loop thread.
   mutable std::mutex m_mutex;
   EqPreset m_preset;
   double m_sampleRate = 48000.0;
-
-  QVector<QVector<Biquad>> m_biquads;           // [channel][band]
-  QVector<QVector<BiquadState>> m_biquadState;  // [channel][band]
+  QVector<int> m_portChannels; // widths of the connected ports, which banks are laid out for
+
+  std::atomic<uint32_t> m_latencyFrames{0}; // of the bank running alone; process callback writes
+  uint32_t m_reportedLatency = 0;           // loop thread only
+  spa_source* m_latencyEvent = nullptr;     // process callback -> loop thread, to report it
+
+  std::atomic<Bank*> m_pendingBank{nullptr}; // control -> process callback
+  Bank* m_activeBank = nullptr;              // process callback only
+  // The transition into m_activeBank, process callback only. m_fadeFrom is the bank being
+  // crossfaded out; it keeps running (and stays alive) until the ramp ends.
+  Bank* m_fadeFrom = nullptr;
+  bool m_gliding = false;
+  uint32_t m_rampPos = 0;
+  uint32_t m_rampFrames = 0; // 0 when settled
+  uint32_t m_primeFrames = 0; // leading part of the ramp in which the incoming FIR only fills up
+  dsp::SpscRing<Bank*> m_retiredBanks;       // process callback -> control, for freeing
 
   std::atomic<uint32_t> m_nodeId{0};
 };
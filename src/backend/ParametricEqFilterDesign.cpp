@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <complex>
+#include <vector>
 
 namespace {
 constexpr double kPi = 3.14159265358979323846;
@@ -125,25 +127,123 @@ ParametricEqFilter::Biquad ParametricEqFilter::makeBiquad(EqBandType type, doubl
   return c;
 }
 
-void ParametricEqFilter::rebuildCoefficientsLocked()
+double ParametricEqFilter::magnitude(const Biquad& c, double w)
 {
-  const int channels = std::max(1, m_totalChannels);
-  const int bands = m_preset.bands.size();
-
-  m_biquads.resize(channels);
-  m_biquadState.resize(channels);
-  for (int ch = 0; ch < channels; ++ch) {
-    m_biquads[ch].resize(bands);
-    m_biquadState[ch].resize(bands);
+  const std::complex<double> z1 = std::polar(1.0, -w);
+  const std::complex<double> z2 = z1 * z1;
+  const std::complex<double> den = 1.0 + c.a1 * z1 + c.a2 * z2;
+  if (std::abs(den) == 0.0) {
+    return 0.0;
   }
+  return std::abs((c.b0 + c.b1 * z1 + c.b2 * z2) / den);
+}
+
+uint32_t ParametricEqFilter::designFirLocked(Bank& bank)
+{
+  std::size_t taps = 2U * kFirPartitions;
+  while (static_cast<double>(taps) < kFirSeconds * bank.sampleRate) {
+    taps <<= 1U;
+  }
+  const std::size_t half = taps / 2U;
+
+  // Frequency sampling: the cascade's magnitude on every bin with zero phase, transformed back,
+  // centred and windowed. The result delays everything by exactly `half` samples.
+  std::vector<std::complex<float>> spectrum(taps);
+  constexpr double twoPi = 2.0 * kPi;
+  for (std::size_t k = 0; k <= half; ++k) {
+    double mag = bank.preGain;
+    const double w = twoPi * static_cast<double>(k) / static_cast<double>(taps);
+    for (const Section& section : bank.sections) {
+      mag *= magnitude(section.c, w);
+    }
+    spectrum[k] = std::complex<float>(static_cast<float>(mag), 0.0f);
+    if (k > 0 && k < half) {
+      spectrum[taps - k] = spectrum[k];
+    }
+  }
+  dsp::FftPlan plan(taps);
+  plan.inverse(spectrum.data());
+
+  std::vector<float> fir(taps);
+  for (std::size_t n = 0; n < taps; ++n) {
+    const double window = 0.5 - 0.5 * std::cos(twoPi * static_cast<double>(n) / static_cast<double>(taps));
+    fir[n] = static_cast<float>(spectrum[(n + half) % taps].real() / static_cast<double>(taps) * window);
+  }
+  bank.fir.reset(fir.data(), taps, taps / kFirPartitions);
+
+  for (const int channels : m_portChannels) {
+    const std::size_t pairs = static_cast<std::size_t>(channels + 1) / 2U;
+    for (std::size_t i = 0; i < pairs; ++i) {
+      bank.convolvers.emplace_back();
+      bank.convolvers.back().reset(bank.fir);
+    }
+  }
+
+  // The FIR's own delay plus the block the convolver gathers before it can answer.
+  return static_cast<uint32_t>(half + bank.fir.blockSize());
+}
 
-  for (int i = 0; i < bands; ++i) {
-    const EqBand band = m_preset.bands[i];
-    const Biquad biq = makeBiquad(band.type, m_sampleRate, band.freqHz, band.q, band.gainDb);
-    for (int ch = 0; ch < channels; ++ch) {
-      m_biquads[ch][i] = biq;
-      m_biquadState[ch][i] = BiquadState{};
+void ParametricEqFilter::publishBankLocked()
+{
+  auto* bank = new Bank;
+  bank->enabled = m_preset.enabled;
+  bank->sampleRate = m_sampleRate;
+  bank->preGain = m_preset.enabled ? std::pow(10.0, m_preset.preampDb / 20.0) : 1.0;
+  bank->preGainFrom = bank->preGain;
+  bank->channels = std::max(1, m_totalChannels);
+  for (int i = 0; i < m_preset.bands.size(); ++i) {
+    const EqBand& band = m_preset.bands[i];
+    if (band.enabled) {
+      const BandParams params{band.freqHz, band.q, band.gainDb};
+      bank->sections.push_back(Section{i, band.type, params, makeBiquad(band.type, m_sampleRate, band.freqHz, band.q, band.gainDb)});
     }
   }
+  const std::size_t sections = bank->sections.size();
+  bank->z1.assign(sections * static_cast<std::size_t>(bank->channels), 0.0);
+  bank->z2.assign(sections * static_cast<std::size_t>(bank->channels), 0.0);
+  bank->live.resize(sections);
+  bank->from.reserve(sections);
+  for (std::size_t s = 0; s < sections; ++s) {
+    bank->live.set(s, bank->sections[s].c);
+    bank->from.push_back(bank->sections[s].params);
+  }
+  bank->scratch.assign(static_cast<std::size_t>(kRampSubBlock) * static_cast<std::size_t>(bank->channels), 0.0f);
+
+  // The kernel runs once per port, so a specialized one only helps if every port has the same width.
+  int portChannels = m_portChannels.isEmpty() ? 0 : m_portChannels.front();
+  for (const int channels : m_portChannels) {
+    if (channels != portChannels) {
+      portChannels = 0;
+    }
+  }
+  bank->kernel = dsp::simd::biquadCascadeFor(sections, static_cast<std::size_t>(portChannels));
+
+  bank->linearPhase = m_preset.enabled && m_preset.linearPhase;
+  if (bank->linearPhase) {
+    bank->latencyFrames = designFirLocked(*bank);
+  }
+
+  collectRetiredBanks();
+  // A bank the process callback never picked up was never used, so it can go right away.
+  delete m_pendingBank.exchange(bank, std::memory_order_acq_rel);
 }
 
+void ParametricEqFilter::collectRetiredBanks()
+{
+  Bank* retired = nullptr;
+  while (m_retiredBanks.read(&retired, 1) == 1) {
+    delete retired;
+  }
+}
+
+void ParametricEqFilter::freeBanks()
+{
+  collectRetiredBanks();
+  delete m_pendingBank.exchange(nullptr);
+  delete m_activeBank;
+  delete m_fadeFrom;
+  m_activeBank = nullptr;
+  m_fadeFrom = nullptr;
+  m_rampFrames = 0;
+  m_primeFrames = 0;
+}
@@ -1,29 +1,208 @@
 #include "ParametricEqFilter.h"
 
+#include "backend/PipeWireThread.h"
+
+#include <pipewire/loop.h>
+#include <pipewire/thread-loop.h>
+
 #include <algorithm>
 #include <cmath>
 
 namespace {
-double dbToLin(double db)
+
+// Same bands, same types, same channel layout: the change can glide instead of crossfading.
+template <typename Bank>
+bool sameLayout(const Bank& a, const Bank& b)
+{
+  if (a.enabled != b.enabled || a.sampleRate != b.sampleRate || a.channels != b.channels || a.sections.size() != b.sections.size()) {
+    return false;
+  }
+  // A new FIR cannot glide; it is crossfaded in.
+  if (a.linearPhase || b.linearPhase) {
+    return false;
+  }
+  for (std::size_t s = 0; s < a.sections.size(); ++s) {
+    if (a.sections[s].band != b.sections[s].band || a.sections[s].type != b.sections[s].type) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The cascade for channels [base, ...) of a bank.
+template <typename Bank>
+dsp::simd::BiquadCascade cascadeOf(Bank& bank, int base)
+{
+  dsp::simd::BiquadCascade q;
+  q.b0 = bank.live.b0.data();
+  q.b1 = bank.live.b1.data();
+  q.b2 = bank.live.b2.data();
+  q.a1 = bank.live.a1.data();
+  q.a2 = bank.live.a2.data();
+  q.sections = bank.sections.size();
+  q.z1 = bank.z1.data() + base;
+  q.z2 = bank.z2.data() + base;
+  q.stateStride = static_cast<std::size_t>(bank.channels);
+  return q;
+}
+
+// Whether a bank can filter channels [base, base + channels) of a port whose channel pairs start
+// at convolver `pair`.
+template <typename Bank>
+bool covers(const Bank& bank, int base, int channels, std::size_t pair)
+{
+  if (!bank.enabled || base + channels > bank.channels) {
+    return false;
+  }
+  return !bank.linearPhase || pair + static_cast<std::size_t>(channels + 1) / 2U <= bank.convolvers.size();
+}
+
+template <typename Bank>
+void convolve(Bank& bank, std::size_t pair, const float* in, float* out, uint32_t frames, int channels)
+{
+  for (int c = 0; c < channels; c += 2) {
+    bank.convolvers[pair + static_cast<std::size_t>(c / 2)].process(
+        bank.fir, in + c, out + c, frames, static_cast<std::size_t>(channels), static_cast<std::size_t>(std::min(2, channels - c)));
+  }
+}
+
+double glideLog(double from, double to, double t)
 {
-  return std::pow(10.0, db / 20.0);
+  if (from <= 0.0 || to <= 0.0) {
+    return from + (to - from) * t;
+  }
+  return from * std::pow(to / from, t);
 }
+
 } // namespace
 
-void ParametricEqFilter::processLocked()
+ParametricEqFilter::BandParams ParametricEqFilter::glideParams(const Bank& bank, std::size_t section, double t) const
+{
+  const BandParams& from = bank.from[section];
+  const BandParams& to = bank.sections[section].params;
+  // Frequency and Q move on a log scale so a sweep sounds even; gain is already in dB.
+  return BandParams{glideLog(from.freqHz, to.freqHz, t), glideLog(from.q, to.q, t), from.gainDb + (to.gainDb - from.gainDb) * t};
+}
+
+void ParametricEqFilter::updateGlide(Bank& bank, double t)
+{
+  for (std::size_t s = 0; s < bank.sections.size(); ++s) {
+    const BandParams p = glideParams(bank, s, t);
+    bank.live.set(s, makeBiquad(bank.sections[s].type, bank.sampleRate, p.freqHz, p.q, p.gainDb));
+  }
+}
+
+void ParametricEqFilter::retireBank(Bank* bank)
+{
+  // The ring only fills if the control side stopped collecting; leaking then beats freeing here.
+  (void)m_retiredBanks.write(&bank, 1);
+}
+
+ParametricEqFilter::Bank* ParametricEqFilter::acquireBank()
+{
+  // A crossfade runs to the end before the next bank is looked at, so at most two banks ever run.
+  if (m_fadeFrom) {
+    return m_activeBank;
+  }
+
+  Bank* next = m_pendingBank.exchange(nullptr, std::memory_order_acq_rel);
+  if (!next) {
+    return m_activeBank;
+  }
+
+  Bank* old = m_activeBank;
+  m_activeBank = next;
+  if (!old) {
+    return next;
+  }
+
+  // Where the old bank is right now, in case it was still gliding.
+  const double t = (m_gliding && m_rampFrames > 0) ? std::min(1.0, static_cast<double>(m_rampPos) / m_rampFrames) : 1.0;
+  const double oldPre = old->preGainFrom + (old->preGain - old->preGainFrom) * t;
+  m_rampPos = 0;
+  m_rampFrames = static_cast<uint32_t>(std::max(1.0, std::round(kRampSeconds * next->sampleRate)));
+
+  if (sameLayout(*old, *next)) {
+    std::copy(old->z1.begin(), old->z1.end(), next->z1.begin());
+    std::copy(old->z2.begin(), old->z2.end(), next->z2.begin());
+    for (std::size_t s = 0; s < next->sections.size(); ++s) {
+      next->from[s] = glideParams(*old, s, t);
+    }
+    next->preGainFrom = oldPre;
+    m_gliding = next->enabled;
+    if (!m_gliding) {
+      m_rampFrames = 0;
+    }
+    retireBank(old);
+    return next;
+  }
+
+  bool continued = false;
+  if (old->enabled && next->enabled && old->linearPhase && next->linearPhase) {
+    // Same input history, new filter: the new FIR answers correctly from its first block.
+    if (old->convolvers.size() == next->convolvers.size()) {
+      for (std::size_t i = 0; i < next->convolvers.size(); ++i) {
+        next->convolvers[i].continueFrom(old->convolvers[i]);
+      }
+      continued = true;
+    }
+  } else if (old->enabled && next->enabled && !old->linearPhase && !next->linearPhase) {
+    // Keep the history of every band that survives the change; new bands start from silence.
+    const std::size_t oldSections = old->sections.size();
+    const std::size_t newSections = next->sections.size();
+    const std::size_t channels = static_cast<std::size_t>(std::min(old->channels, next->channels));
+    std::size_t j = 0;
+    for (std::size_t s = 0; s < newSections; ++s) {
+      while (j < oldSections && old->sections[j].band < next->sections[s].band) {
+        ++j;
+      }
+      if (j == oldSections || old->sections[j].band != next->sections[s].band) {
+        continue;
+      }
+      const std::size_t from = j * static_cast<std::size_t>(old->channels);
+      const std::size_t to = s * static_cast<std::size_t>(next->channels);
+      std::copy_n(old->z1.begin() + from, channels, next->z1.begin() + to);
+      std::copy_n(old->z2.begin() + from, channels, next->z2.begin() + to);
+    }
+  }
+
+  // An FIR without history is silent for its whole delay. The old path stays fully audible while
+  // the new one is fed the same input, and the crossfade starts once the FIR has filled.
+  m_primeFrames = next->enabled && next->linearPhase && !continued ? next->latencyFrames : 0U;
+  m_rampFrames += m_primeFrames;
+
+  // The outgoing bank keeps running with whatever it had reached, frozen, while it fades out.
+  old->preGain = oldPre;
+  old->preGainFrom = oldPre;
+  m_fadeFrom = old;
+  m_gliding = false;
+  return next;
+}
+
+void ParametricEqFilter::processBlock()
 {
+  Bank* bank = acquireBank();
   if (!m_filter) {
     return;
   }
 
-  const bool enabled = m_preset.enabled;
-  const double pre = enabled ? dbToLin(m_preset.preampDb) : 1.0;
+  Bank* fade = m_fadeFrom;
+  const uint32_t rampPos = m_rampPos;
+  const uint32_t rampFrames = m_rampFrames;
+  const uint32_t primeFrames = m_primeFrames;
+  const auto rampT = [rampFrames, primeFrames](uint32_t pos) {
+    return pos <= primeFrames ? 0.0 : std::min(1.0, static_cast<double>(pos - primeFrames) / (rampFrames - primeFrames));
+  };
+  uint32_t cycleFrames = 0;
+  std::size_t nextPair = 0;
 
   for (const auto& port : m_ports) {
     void* inPort = port.inPort;
     void* outPort = port.outPort;
     const int channels = std::max(1, port.channels);
     const int base = port.channelBase;
+    const std::size_t pair = nextPair;
+    nextPair += static_cast<std::size_t>(channels + 1) / 2U;
     if (!inPort || !outPort) {
       continue;
     }
@@ -78,36 +257,57 @@ void ParametricEqFilter::processLocked()
       continue;
     }
 
-    if (!enabled) {
+    cycleFrames = std::max(cycleFrames, frames);
+    const bool wet = bank && covers(*bank, base, channels, pair);
+    const bool fadeWet = fade && covers(*fade, base, channels, pair);
+    if (!wet && !fade) {
       const uint32_t samples = frames * static_cast<uint32_t>(channels);
       for (uint32_t i = 0; i < samples; ++i) {
         outF[i] = inF[i];
       }
     } else {
-      const int bands = m_preset.bands.size();
-      for (uint32_t i = 0; i < frames; ++i) {
-        for (int c = 0; c < channels; ++c) {
-          const uint32_t idx = i * static_cast<uint32_t>(channels) + static_cast<uint32_t>(c);
-          const int ch = base + c;
-
-          double x = static_cast<double>(inF[idx]) * pre;
-          double y = x;
-          for (int b = 0; b < bands; ++b) {
-            const EqBand band = m_preset.bands[b];
-            if (!band.enabled) {
-              continue;
-            }
-
-            const Biquad coeffs = m_biquads[ch][b];
-            BiquadState& st = m_biquadState[ch][b];
+      const uint32_t stride = static_cast<uint32_t>(channels);
+      // Transitions go in sub-blocks that end exactly where the ramp does; after that the whole
+      // rest of the buffer is one kernel call.
+      for (uint32_t start = 0; start < frames;) {
+        const uint32_t pos = rampPos + start;
+        const bool ramping = pos < rampFrames;
+        const uint32_t n = ramping ? std::min({kRampSubBlock, frames - start, rampFrames - pos}) : frames - start;
+        const float* x = inF + start * stride;
+        float* y = outF + start * stride;
 
-            const double out = coeffs.b0 * y + st.z1;
-            st.z1 = coeffs.b1 * y - coeffs.a1 * out + st.z2;
-            st.z2 = coeffs.b2 * y - coeffs.a2 * out;
-            y = out;
+        if (fade && ramping && fadeWet) {
+          if (fade->linearPhase) {
+            convolve(*fade, pair, x, fade->scratch.data(), n, channels);
+          } else {
+            fade->kernel(cascadeOf(*fade, base), x, fade->scratch.data(), n, static_cast<std::size_t>(channels), fade->preGain, 0.0);
+          }
+        }
+        if (wet && bank->linearPhase) {
+          convolve(*bank, pair, x, y, n, channels);
+        } else if (wet) {
+          double gain = bank->preGain;
+          double gainStep = 0.0;
+          if (ramping && m_gliding) {
+            updateGlide(*bank, rampT(pos + n));
+            gain = bank->preGainFrom + (bank->preGain - bank->preGainFrom) * rampT(pos);
+            gainStep = (bank->preGain - bank->preGainFrom) / rampFrames;
           }
-          outF[idx] = static_cast<float>(y);
+          bank->kernel(cascadeOf(*bank, base), x, y, n, static_cast<std::size_t>(channels), gain, gainStep);
+        } else if (y != x) {
+          std::copy_n(x, static_cast<std::size_t>(n) * stride, y);
         }
+        if (fade && ramping) {
+          const float* old = fadeWet ? fade->scratch.data() : x;
+          for (uint32_t i = 0; i < n; ++i) {
+            const auto g = static_cast<float>(rampT(pos + i));
+            for (uint32_t c = 0; c < stride; ++c) {
+              const uint32_t idx = i * stride + c;
+              y[idx] = old[idx] + (y[idx] - old[idx]) * g;
+            }
+          }
+        }
+        start += n;
       }
     }
 
@@ -118,5 +318,32 @@ void ParametricEqFilter::processLocked()
     pw_filter_queue_buffer(inPort, inBuf);
     pw_filter_queue_buffer(outPort, outBuf);
   }
-}
 
+  if (rampFrames > 0) {
+    m_rampPos = rampPos + cycleFrames;
+    if (m_rampPos >= rampFrames) {
+      if (bank && m_gliding) {
+        for (std::size_t s = 0; s < bank->sections.size(); ++s) {
+          bank->live.set(s, bank->sections[s].c);
+        }
+        bank->preGainFrom = bank->preGain;
+      }
+      if (fade) {
+        retireBank(fade);
+        m_fadeFrom = nullptr;
+      }
+      m_gliding = false;
+      m_rampFrames = 0;
+      m_primeFrames = 0;
+      m_rampPos = 0;
+    }
+  }
+
+  // The node's latency is the delay of what is heard, which changes only once a transition ends.
+  if (bank && !m_fadeFrom && bank->latencyFrames != m_latencyFrames.load(std::memory_order_relaxed)) {
+    m_latencyFrames.store(bank->latencyFrames, std::memory_order_relaxed);
+    if (m_latencyEvent) {
+      pw_loop_signal_event(pw_thread_loop_get_loop(m_pw->threadLoop()), m_latencyEvent);
+    }
+  }
+}
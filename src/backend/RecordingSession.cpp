@@ -0,0 +1,822 @@
+#include "RecordingSession.h"
+
+#include "PipeWireThread.h"
+#include "dsp/SimdKernels.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QSet>
+#include <QTimer>
+
+#include <pipewire/keys.h>
+#include <pipewire/properties.h>
+
+#include <spa/param/audio/raw-utils.h>
+#include <spa/param/param.h>
+#include <spa/utils/result.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+
+constexpr float kMinDb = -100.0f;
+
+// Per target: ~5 s of 48 kHz stereo between the process callback and the disk. Thirty targets
+// stay around 60 MiB.
+constexpr std::size_t kTrackRingSamples = std::size_t{1} << 19;
+constexpr std::size_t kTrackSegments = 4096;
+constexpr std::size_t kWriteBlockFrames = 16384;
+constexpr auto kWriterPollInterval = std::chrono::milliseconds(50);
+
+// Start and stop are placed this far ahead of "now" so every target's next cycle sees them.
+constexpr int64_t kAlignLeadNs = 100'000'000;
+constexpr int64_t kStopGraceNs = 250'000'000;
+constexpr int kStopPollIntervalMs = 10;
+constexpr int kArmIntervalMs = 20;
+constexpr int64_t kArmTimeoutNs = 2'000'000'000;
+// A target not on the driver's sample clock counts its own frames, and is only moved back to its
+// time stamps once they disagree by more than this (resampler skew, or a suspend).
+constexpr int64_t kResyncNs = 10'000'000;
+// A target that has delivered nothing for this long is idle; its file is filled with silence
+// rather than holding back the writer.
+constexpr int64_t kIdleAfterNs = 2'000'000'000;
+
+// PipeWire stamps cycles with CLOCK_MONOTONIC, which is what steady_clock reads on Linux.
+int64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+float amplitudeToDb(float amp)
+{
+  if (!std::isfinite(amp) || amp <= 0.0f) {
+    return kMinDb;
+  }
+  return std::max(kMinDb, 20.0f * std::log10(amp));
+}
+
+// "take.wav" -> "take-2.wav"
+QString withSuffix(const QString& path, int n)
+{
+  const QFileInfo fi(path);
+  const QString suffix = fi.suffix();
+  const QString stem = suffix.isEmpty() ? path : path.left(path.size() - suffix.size() - 1);
+  return suffix.isEmpty() ? QStringLiteral("%1-%2").arg(stem).arg(n) : QStringLiteral("%1-%2.%3").arg(stem).arg(n).arg(suffix);
+}
+
+} // namespace
+
+RecordingSession::RecordingSession(PipeWireThread* pw, QObject* parent)
+    : QObject(parent)
+    , m_pw(pw)
+{
+  m_armTimer = new QTimer(this);
+  m_armTimer->setInterval(kArmIntervalMs);
+  connect(m_armTimer, &QTimer::timeout, this, &RecordingSession::arm);
+
+  m_stopTimer = new QTimer(this);
+  m_stopTimer->setInterval(kStopPollIntervalMs);
+  connect(m_stopTimer, &QTimer::timeout, this, [this]() { finishStop(false); });
+}
+
+RecordingSession::~RecordingSession()
+{
+  stop();
+  finishStop(true);
+}
+
+QString RecordingSession::lastError() const
+{
+  std::lock_guard<std::mutex> lock(m_errorMutex);
+  return m_lastError;
+}
+
+RecordingSession::TrackStatus RecordingSession::trackStatus(int track) const
+{
+  TrackStatus s;
+  if (track < 0 || track >= trackCount()) {
+    return s;
+  }
+  const Track& t = *m_tracks[static_cast<std::size_t>(track)];
+  s.label = t.target.label;
+  s.targetObject = t.target.targetObject;
+  s.filePath = t.filePath;
+  s.streamState = AudioRecorder::streamStateToString(static_cast<pw_stream_state>(t.streamState.load()));
+  s.sampleRate = t.sampleRate.load(std::memory_order_relaxed);
+  s.channels = t.channels.load(std::memory_order_relaxed);
+  s.framesWritten = t.framesWritten.load(std::memory_order_relaxed);
+  s.droppedFrames = t.droppedFrames.load(std::memory_order_relaxed);
+  if (s.sampleRate > 0) {
+    const int64_t pending = t.deliveredUntil.load(std::memory_order_relaxed) - static_cast<int64_t>(s.framesWritten);
+    s.backlogSeconds = static_cast<double>(std::max<int64_t>(0, pending)) / static_cast<double>(s.sampleRate);
+  }
+  s.peakDb = t.peakDb.load(std::memory_order_relaxed);
+  s.included = t.included.load(std::memory_order_relaxed);
+  return s;
+}
+
+double RecordingSession::encoderSpeed() const
+{
+  const uint64_t ns = m_encodeNs.load(std::memory_order_relaxed);
+  return ns > 0 ? static_cast<double>(m_encodedAudioNs.load(std::memory_order_relaxed)) / static_cast<double>(ns) : 0.0;
+}
+
+bool RecordingSession::start(const StartOptions& options)
+{
+  stop();
+  finishStop(true);
+  m_jobs.clear();
+  m_tracks.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_lastError.clear();
+  }
+  m_stopScheduled.store(false);
+
+  if (options.filePath.trimmed().isEmpty()) {
+    setErrorAndScheduleStop(tr("Invalid output path."));
+    return false;
+  }
+  if (options.targets.empty() || options.targets.size() > static_cast<std::size_t>(kMaxTargets)) {
+    setErrorAndScheduleStop(tr("A recording session needs between 1 and %1 targets.").arg(kMaxTargets));
+    return false;
+  }
+  if (!m_pw || !m_pw->isConnected() || !m_pw->threadLoop()) {
+    setErrorAndScheduleStop(tr("Not connected to PipeWire."));
+    return false;
+  }
+
+  m_layout = options.layout;
+  m_format = options.format;
+  m_encoder = options.encoder;
+  m_startNs.store(0);
+  m_stopNs.store(0);
+  m_encodeNs.store(0);
+  m_encodedAudioNs.store(0);
+
+  for (const Target& target : options.targets) {
+    auto track = std::make_unique<Track>();
+    track->self = this;
+    track->target = target;
+    track->target.targetObject = target.targetObject.trimmed();
+    if (track->target.label.trimmed().isEmpty()) {
+      track->target.label = !track->target.targetObject.isEmpty()
+          ? track->target.targetObject
+          : (target.captureSink ? QStringLiteral("system-mix") : QStringLiteral("default-input"));
+    }
+    track->samples.reset(kTrackRingSamples);
+    track->segments.reset(kTrackSegments);
+    m_tracks.push_back(std::move(track));
+  }
+
+  // One job per file. Separate files always get a {target} so the targets cannot collide, and
+  // identical labels (two tabs of the same browser) are numbered.
+  if (m_layout == Layout::Multichannel) {
+    auto job = std::make_unique<Job>();
+    job->filePath = AudioRecorder::expandPathTemplate(options.filePath, QStringLiteral("session"), m_format);
+    for (auto& track : m_tracks) {
+      track->filePath = job->filePath;
+      job->tracks.push_back(track.get());
+    }
+    m_jobs.push_back(std::move(job));
+  } else {
+    QString pattern = options.filePath.trimmed();
+    if (m_tracks.size() > 1 && !pattern.contains(QStringLiteral("{target}"))) {
+      const QFileInfo fi(pattern);
+      const QString suffix = fi.suffix();
+      pattern = suffix.isEmpty() ? pattern + QStringLiteral("-{target}")
+                                 : pattern.left(pattern.size() - suffix.size() - 1) + QStringLiteral("-{target}.") + suffix;
+    }
+    QSet<QString> used;
+    for (auto& track : m_tracks) {
+      const QString base = AudioRecorder::expandPathTemplate(pattern, track->target.label, m_format);
+      QString path = base;
+      for (int n = 2; used.contains(path); ++n) {
+        path = withSuffix(base, n);
+      }
+      used.insert(path);
+      track->filePath = path;
+
+      auto job = std::make_unique<Job>();
+      job->filePath = path;
+      job->tracks.push_back(track.get());
+      m_jobs.push_back(std::move(job));
+    }
+  }
+
+  for (const auto& job : m_jobs) {
+    const QFileInfo fi(job->filePath);
+    if (!fi.absolutePath().isEmpty() && !QDir().mkpath(fi.absolutePath())) {
+      setErrorAndScheduleStop(tr("Failed to create output directory."));
+      m_jobs.clear();
+      m_tracks.clear();
+      return false;
+    }
+  }
+
+  pw_thread_loop* loop = m_pw->threadLoop();
+  pw_thread_loop_lock(loop);
+  bool connected = true;
+  for (auto& track : m_tracks) {
+    connected = connectTrackLocked(*track) && connected;
+  }
+  if (!connected) {
+    destroyTracksLocked();
+  }
+  pw_thread_loop_unlock(loop);
+
+  if (!connected) {
+    m_jobs.clear();
+    m_tracks.clear();
+    return false;
+  }
+
+  // Writers sleep between polls and never touch the streams, so a few serve any number of files.
+  // Encoding is CPU work, though, so compressed formats may use every core.
+  const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+  const unsigned pool = AudioRecorder::isCompressedFormat(m_format) ? hw : std::clamp<unsigned>(hw / 2, 1u, kMaxWriterThreads);
+  const std::size_t writers = std::min<std::size_t>(m_jobs.size(), pool);
+  {
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    m_writerStop = false;
+  }
+  m_writersRunning.store(static_cast<int>(writers));
+  for (std::size_t w = 0; w < writers; ++w) {
+    m_writers.emplace_back([this, w, writers]() { writerLoop(w, writers); });
+  }
+
+  m_armDeadlineNs = nowNs() + kArmTimeoutNs;
+  m_armTimer->start();
+
+  m_recording = true;
+  emit recordingChanged(true);
+  return true;
+}
+
+void RecordingSession::stop()
+{
+  if (!m_recording) {
+    return;
+  }
+  m_recording = false;
+  m_stopping = true;
+  m_armTimer->stop();
+
+  // Put the end a little ahead and let every running target reach it, so all files stop on the
+  // same sample instead of wherever each stream happened to be when it was torn down.
+  m_stopDeadlineNs = nowNs();
+  if (m_startNs.load() != 0 && m_stopNs.load() == 0) {
+    const int64_t stopNs = nowNs() + kAlignLeadNs;
+    m_stopNs.store(stopNs, std::memory_order_release);
+    m_stopDeadlineNs = stopNs + kStopGraceNs;
+  }
+  m_stopTimer->start();
+}
+
+bool RecordingSession::stopReached() const
+{
+  const int64_t stopNs = m_stopNs.load(std::memory_order_acquire);
+  if (stopNs == 0) {
+    return true;
+  }
+  for (const auto& track : m_tracks) {
+    if (!track->formatReady.load(std::memory_order_acquire) || track->streamState.load() != PW_STREAM_STATE_STREAMING) {
+      continue;
+    }
+    if (track->deliveredUntil.load(std::memory_order_acquire) < timelineFrame(stopNs, track->sampleRate.load())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs from the stop timer until the session is finished; with `wait`, blocks until it is.
+void RecordingSession::finishStop(bool wait)
+{
+  if (!m_stopping) {
+    return;
+  }
+  while (!stopReached() && nowNs() < m_stopDeadlineNs) {
+    if (!wait) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(kStopPollIntervalMs));
+  }
+
+  if (m_pw && m_pw->threadLoop()) {
+    pw_thread_loop* loop = m_pw->threadLoop();
+    pw_thread_loop_lock(loop);
+    destroyTracksLocked();
+    pw_thread_loop_unlock(loop);
+  } else {
+    destroyTracksLocked();
+  }
+
+  // The streams are gone; the writers drain what is left, pad every file to the stop sample and
+  // close it. They are joined once they have all returned, so the GUI never waits on encoding.
+  {
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    m_writerStop = true;
+  }
+  m_writerCv.notify_all();
+  if (!wait && m_writersRunning.load(std::memory_order_acquire) > 0) {
+    return;
+  }
+  stopWriters();
+
+  m_stopTimer->stop();
+  m_stopping = false;
+  emit recordingChanged(false);
+}
+
+void RecordingSession::arm()
+{
+  if (m_startNs.load() != 0) {
+    m_armTimer->stop();
+    return;
+  }
+
+  int ready = 0;
+  for (const auto& track : m_tracks) {
+    ready += track->formatReady.load(std::memory_order_acquire) ? 1 : 0;
+  }
+  const bool timedOut = nowNs() >= m_armDeadlineNs;
+  if (ready < trackCount() && !timedOut) {
+    return;
+  }
+  m_armTimer->stop();
+
+  // A multichannel file has a fixed layout, so targets that have not negotiated by now are left
+  // out of it; separate files simply start late and are padded at the front.
+  if (m_layout == Layout::Multichannel) {
+    uint32_t rate = 0;
+    for (const auto& track : m_tracks) {
+      const bool included = track->formatReady.load(std::memory_order_acquire);
+      track->included.store(included);
+      if (!included) {
+        continue;
+      }
+      const uint32_t r = track->sampleRate.load();
+      if (rate != 0 && r != rate) {
+        setErrorAndScheduleStop(tr("A multichannel recording needs every target at the same sample rate (%1 Hz and %2 Hz).").arg(rate).arg(r));
+        return;
+      }
+      rate = r;
+    }
+    if (rate == 0) {
+      setErrorAndScheduleStop(tr("No recording target became ready."));
+      return;
+    }
+  }
+
+  m_startNs.store(nowNs() + kAlignLeadNs, std::memory_order_release);
+}
+
+void RecordingSession::onStreamStateChanged(void* data, enum pw_stream_state /*old*/, enum pw_stream_state state, const char* error)
+{
+  auto* track = static_cast<Track*>(data);
+  if (!track) {
+    return;
+  }
+  track->streamState.store(state);
+
+  // One target going away (an app closing) must not end everyone else's recording.
+  if (state == PW_STREAM_STATE_ERROR && track->self->m_tracks.size() == 1) {
+    const QString msg = AudioRecorder::streamStateToString(state) + (error ? QStringLiteral(": %1").arg(QString::fromUtf8(error)) : QString{});
+    track->self->setErrorAndScheduleStop(msg);
+  }
+}
+
+void RecordingSession::onStreamParamChanged(void* data, uint32_t id, const struct spa_pod* param)
+{
+  auto* track = static_cast<Track*>(data);
+  if (!track || !param || id != SPA_PARAM_Format) {
+    return;
+  }
+
+  spa_audio_info_raw info{};
+  if (spa_format_audio_raw_parse(param, &info) < 0 || info.rate == 0 || info.channels == 0) {
+    return;
+  }
+
+  if (track->formatReady.load(std::memory_order_acquire)) {
+    if (info.rate != track->sampleRate.load() || info.channels != track->channels.load()) {
+      track->self->setErrorAndScheduleStop(
+          tr("%1 changed format to %2 Hz, %3 ch while recording.").arg(track->target.label).arg(info.rate).arg(info.channels));
+    }
+    return;
+  }
+
+  track->sampleRate.store(info.rate);
+  track->channels.store(info.channels);
+  track->positioned = (info.flags & SPA_AUDIO_FLAG_UNPOSITIONED) == 0 && info.channels <= AudioRecorder::kMaxChannels;
+  for (uint32_t c = 0; c < std::min(info.channels, AudioRecorder::kMaxChannels); ++c) {
+    track->positions[c] = info.position[c];
+  }
+  track->levelPeaks.assign(info.channels, 0.0f);
+  track->levelSumSq.assign(info.channels, 0.0f);
+  track->levelClips.assign(info.channels, 0u);
+
+  track->formatReady.store(true, std::memory_order_release);
+}
+
+void RecordingSession::onStreamProcess(void* data)
+{
+  auto* track = static_cast<Track*>(data);
+  if (!track || !track->stream) {
+    return;
+  }
+  track->self->processTrack(*track);
+}
+
+bool RecordingSession::connectTrackLocked(Track& track)
+{
+  if (track.stream || !m_pw || !m_pw->core()) {
+    return track.stream != nullptr;
+  }
+
+  pw_properties* props = pw_properties_new(
+      PW_KEY_MEDIA_TYPE, "Audio",
+      PW_KEY_MEDIA_CATEGORY, "Capture",
+      PW_KEY_MEDIA_ROLE, "Production",
+      PW_KEY_NODE_NAME, "headroom.session",
+      PW_KEY_STREAM_MONITOR, "true",
+      nullptr);
+  if (track.target.captureSink) {
+    pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true");
+  }
+  if (!track.target.targetObject.isEmpty()) {
+    pw_properties_set(props, PW_KEY_TARGET_OBJECT, track.target.targetObject.toUtf8().constData());
+  }
+
+  track.stream = pw_stream_new(m_pw->core(), "Headroom Session Recorder", props);
+  if (!track.stream) {
+    setErrorAndScheduleStop(tr("Failed to create a recording stream for %1.").arg(track.target.label));
+    return false;
+  }
+
+  static const pw_stream_events streamEvents = [] {
+    pw_stream_events e{};
+    e.version = PW_VERSION_STREAM_EVENTS;
+    e.state_changed = &RecordingSession::onStreamStateChanged;
+    e.param_changed = &RecordingSession::onStreamParamChanged;
+    e.process = &RecordingSession::onStreamProcess;
+    return e;
+  }();
+  pw_stream_add_listener(track.stream, &track.listener, &streamEvents, &track);
+
+  // Native rate and layout, as for single recordings.
+  spa_audio_info_raw info{};
+  info.format = SPA_AUDIO_FORMAT_F32;
+
+  uint8_t buffer[1024];
+  spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+  const spa_pod* params[] = {spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &info)};
+
+  const int res = pw_stream_connect(
+      track.stream,
+      PW_DIRECTION_INPUT,
+      PW_ID_ANY,
+      static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS),
+      params,
+      1);
+  if (res < 0) {
+    setErrorAndScheduleStop(QStringLiteral("pw_stream_connect failed: %1").arg(QString::fromUtf8(spa_strerror(res))));
+    spa_hook_remove(&track.listener);
+    pw_stream_destroy(track.stream);
+    track.stream = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void RecordingSession::destroyTracksLocked()
+{
+  for (auto& track : m_tracks) {
+    if (!track->stream) {
+      continue;
+    }
+    spa_hook_remove(&track->listener);
+    pw_stream_destroy(track->stream);
+    track->stream = nullptr;
+    track->streamState.store(PW_STREAM_STATE_UNCONNECTED);
+  }
+}
+
+int64_t RecordingSession::timelineFrame(int64_t ns, uint32_t rate) const
+{
+  const int64_t startNs = m_startNs.load(std::memory_order_acquire);
+  return std::llround(static_cast<double>(ns - startNs) * static_cast<double>(rate) / 1.0e9);
+}
+
+void RecordingSession::processTrack(Track& t)
+{
+  pw_buffer* buffer = pw_stream_dequeue_buffer(t.stream);
+  if (!buffer) {
+    return;
+  }
+
+  const int64_t startNs = m_startNs.load(std::memory_order_acquire);
+  spa_buffer* b = buffer->buffer;
+  const uint32_t ch = t.channels.load(std::memory_order_relaxed);
+  const uint32_t rate = t.sampleRate.load(std::memory_order_relaxed);
+  if (!t.formatReady.load(std::memory_order_acquire) || !b || b->n_datas < 1 || !b->datas[0].data || !b->datas[0].chunk
+      || b->datas[0].chunk->offset + b->datas[0].chunk->size > b->datas[0].maxsize) {
+    pw_stream_queue_buffer(t.stream, buffer);
+    return;
+  }
+
+  const spa_data& d = b->datas[0];
+  const float* src = reinterpret_cast<const float*>(static_cast<const uint8_t*>(d.data) + d.chunk->offset);
+  const uint32_t frames = d.chunk->size / (ch * sizeof(float));
+
+  if (frames > 0) {
+    std::fill(t.levelPeaks.begin(), t.levelPeaks.end(), 0.0f);
+    std::fill(t.levelSumSq.begin(), t.levelSumSq.end(), 0.0f);
+    std::fill(t.levelClips.begin(), t.levelClips.end(), 0u);
+    dsp::simd::channelLevels(src, frames, ch, 1.0f, t.levelPeaks.data(), t.levelSumSq.data(), t.levelClips.data());
+    t.peakDb.store(amplitudeToDb(*std::max_element(t.levelPeaks.begin(), t.levelPeaks.end())), std::memory_order_relaxed);
+  }
+
+  if (startNs == 0 || frames == 0 || !t.included.load(std::memory_order_relaxed)) {
+    pw_stream_queue_buffer(t.stream, buffer);
+    return;
+  }
+
+  // Place this cycle on the session timeline. The first cycle is mapped from its time stamp; after
+  // that the driver's sample clock is exact, so targets on the same driver stay sample-aligned with
+  // no jitter. A target resampled from a driver at another rate continues from what it delivered,
+  // since its time stamps jitter by more than a sample.
+  pw_time time{};
+  if (pw_stream_get_time_n(t.stream, &time, sizeof(time)) < 0 || time.now <= 0) {
+    time.now = nowNs();
+    time.rate.num = 0;
+  }
+  if (!t.aligned) {
+    t.aligned = true;
+    t.clockFrames = time.rate.num == 1 && time.rate.denom == rate;
+    t.ticksBase = time.ticks;
+    t.frameBase = timelineFrame(time.now, rate);
+    t.streamFrame = t.frameBase;
+  }
+  int64_t frame = 0;
+  if (t.clockFrames) {
+    frame = t.frameBase + static_cast<int64_t>(time.ticks - t.ticksBase);
+  } else {
+    const int64_t stamped = timelineFrame(time.now, rate);
+    if (std::llabs(stamped - t.streamFrame) > static_cast<int64_t>(rate) * kResyncNs / 1'000'000'000) {
+      t.streamFrame = stamped;
+    }
+    frame = t.streamFrame;
+    t.streamFrame = frame + frames;
+  }
+
+  // Trim what lies before the start, overlaps a previous cycle, or runs past the stop.
+  const int64_t begin = std::max(frame, t.nextFrame);
+  int64_t end = frame + frames;
+  const int64_t stopNs = m_stopNs.load(std::memory_order_acquire);
+  if (stopNs != 0) {
+    end = std::min(end, timelineFrame(stopNs, rate));
+  }
+
+  if (end > begin) {
+    const Segment segment{begin, static_cast<uint32_t>(end - begin)};
+    const std::size_t count = static_cast<std::size_t>(segment.frames) * ch;
+    // All or nothing, never blocking; whatever is dropped becomes silence in the file, so the
+    // timeline (and every other target) is unaffected.
+    if (t.samples.writeAvailable() >= count && t.segments.writeAvailable() >= 1) {
+      t.samples.write(src + static_cast<std::size_t>(begin - frame) * ch, count);
+      t.segments.write(&segment, 1);
+    } else {
+      t.droppedFrames.fetch_add(segment.frames, std::memory_order_relaxed);
+    }
+    t.nextFrame = end;
+    t.deliveredUntil.store(end, std::memory_order_release);
+  }
+
+  pw_stream_queue_buffer(t.stream, buffer);
+}
+
+bool RecordingSession::openJob(Job& job)
+{
+  std::vector<Track*> tracks;
+  for (Track* t : job.tracks) {
+    if (t->included.load() && t->formatReady.load(std::memory_order_acquire)) {
+      tracks.push_back(t);
+    }
+  }
+  if (tracks.empty()) {
+    return false;
+  }
+
+  job.tracks = tracks;
+  job.channelOffsets.clear();
+  job.fileChannels = 0;
+  for (Track* t : job.tracks) {
+    job.channelOffsets.push_back(job.fileChannels);
+    job.fileChannels += t->channels.load();
+    t->scratch.assign(kWriteBlockFrames * t->channels.load(), 0.0f);
+  }
+  job.sampleRate = job.tracks.front()->sampleRate.load();
+
+  // A combined file has no meaningful speaker layout (it may hold several front-lefts), so only a
+  // single target's positions are written.
+  const Track* single = job.tracks.size() == 1 ? job.tracks.front() : nullptr;
+  const uint32_t* positions = single && single->positioned ? single->positions.data() : nullptr;
+
+  QString error;
+  job.file = AudioRecorder::openOutputFile(job.filePath, m_format, m_encoder, job.sampleRate, job.fileChannels, positions, &error);
+  if (!job.file) {
+    job.failed = true;
+    setErrorAndScheduleStop(error);
+    return false;
+  }
+  job.block.assign(kWriteBlockFrames * job.fileChannels, 0.0f);
+  return true;
+}
+
+void RecordingSession::fillTrack(Job& job, Track& t, uint32_t channelOffset, int64_t from, uint32_t frames)
+{
+  const std::size_t ch = t.channels.load();
+  const std::size_t stride = job.fileChannels;
+  const int64_t end = from + frames;
+  const auto silence = [&](int64_t a, int64_t b) {
+    for (int64_t f = a; f < b; ++f) {
+      std::fill_n(job.block.begin() + static_cast<std::ptrdiff_t>(static_cast<std::size_t>(f - from) * stride + channelOffset), ch, 0.0f);
+    }
+  };
+  const auto discard = [&](std::size_t n) {
+    while (n > 0) {
+      const std::size_t take = std::min(n, t.scratch.size() / ch);
+      t.samples.read(t.scratch.data(), take * ch);
+      n -= take;
+    }
+  };
+
+  int64_t pos = from;
+  while (pos < end) {
+    if (!t.hasPending) {
+      if (t.segments.read(&t.pending, 1) == 0) {
+        break;
+      }
+      t.hasPending = true;
+      t.pendingUsed = 0;
+    }
+
+    const int64_t segPos = t.pending.frame + t.pendingUsed;
+    const int64_t segEnd = t.pending.frame + t.pending.frames;
+    if (segPos > pos) {
+      // A gap on the timeline: the target was idle or its data was dropped.
+      const int64_t gapEnd = std::min(segPos, end);
+      silence(pos, gapEnd);
+      pos = gapEnd;
+      continue;
+    }
+    if (segPos < pos) {
+      // Arrived after the writer had already given up on it.
+      const int64_t stale = std::min(pos, segEnd) - segPos;
+      discard(static_cast<std::size_t>(stale));
+      t.pendingUsed += static_cast<uint32_t>(stale);
+    } else {
+      const std::size_t n = static_cast<std::size_t>(std::min(segEnd, end) - pos);
+      t.samples.read(t.scratch.data(), n * ch);
+      for (std::size_t f = 0; f < n; ++f) {
+        std::copy_n(t.scratch.begin() + static_cast<std::ptrdiff_t>(f * ch), ch,
+                    job.block.begin() + static_cast<std::ptrdiff_t>((static_cast<std::size_t>(pos - from) + f) * stride + channelOffset));
+      }
+      pos += static_cast<int64_t>(n);
+      t.pendingUsed += static_cast<uint32_t>(n);
+    }
+    if (t.pendingUsed >= t.pending.frames) {
+      t.hasPending = false;
+    }
+  }
+  silence(pos, end);
+}
+
+bool RecordingSession::serviceJob(Job& job, bool stopping)
+{
+  if (job.failed) {
+    return false;
+  }
+  if (!job.file) {
+    if (m_startNs.load(std::memory_order_acquire) == 0 || !openJob(job)) {
+      return !job.failed;
+    }
+  }
+
+  const uint32_t rate = job.sampleRate;
+  const int64_t stopNs = m_stopNs.load(std::memory_order_acquire);
+  const int64_t limit = stopNs != 0 ? timelineFrame(stopNs, rate) : std::numeric_limits<int64_t>::max();
+
+  for (;;) {
+    // While running, write up to where every target has delivered, or up to where the laggards
+    // count as idle. When stopping, everything up to the stop sample.
+    int64_t readyEnd = 0;
+    if (stopping) {
+      readyEnd = limit;
+      if (readyEnd == std::numeric_limits<int64_t>::max()) {
+        readyEnd = 0;
+        for (const Track* t : job.tracks) {
+          readyEnd = std::max(readyEnd, t->deliveredUntil.load(std::memory_order_acquire));
+        }
+      }
+    } else {
+      int64_t delivered = std::numeric_limits<int64_t>::max();
+      for (const Track* t : job.tracks) {
+        delivered = std::min(delivered, t->deliveredUntil.load(std::memory_order_acquire));
+      }
+      readyEnd = std::min(limit, std::max(delivered, timelineFrame(nowNs() - kIdleAfterNs, rate)));
+    }
+
+    const int64_t available = readyEnd - job.fileFrames;
+    if (available <= 0 || (available < static_cast<int64_t>(kWriteBlockFrames) && !stopping)) {
+      break;
+    }
+    const uint32_t n = static_cast<uint32_t>(std::min<int64_t>(available, kWriteBlockFrames));
+    for (std::size_t i = 0; i < job.tracks.size(); ++i) {
+      fillTrack(job, *job.tracks[i], job.channelOffsets[i], job.fileFrames, n);
+    }
+
+    const int64_t encodeStart = nowNs();
+    if (!job.file->write(job.block.data(), n)) {
+      job.failed = true;
+      setErrorAndScheduleStop(tr("Write to %1 failed: %2").arg(job.filePath, job.file->errorString()));
+      break;
+    }
+    m_encodeNs.fetch_add(static_cast<uint64_t>(nowNs() - encodeStart), std::memory_order_relaxed);
+    m_encodedAudioNs.fetch_add(uint64_t{n} * 1000000000u / rate, std::memory_order_relaxed);
+    job.fileFrames += n;
+    for (Track* t : job.tracks) {
+      t->framesWritten.store(static_cast<uint64_t>(job.fileFrames), std::memory_order_relaxed);
+    }
+  }
+
+  if (stopping || job.failed) {
+    if (!job.file->close() && !job.failed) {
+      job.failed = true;
+      setErrorAndScheduleStop(tr("Failed to finish %1: %2").arg(job.filePath, job.file->errorString()));
+    }
+    job.file.reset();
+  }
+  return !job.failed;
+}
+
+void RecordingSession::writerLoop(std::size_t worker, std::size_t workers)
+{
+  for (;;) {
+    bool stopping = false;
+    {
+      std::unique_lock<std::mutex> lock(m_writerMutex);
+      m_writerCv.wait_for(lock, kWriterPollInterval, [this]() { return m_writerStop; });
+      stopping = m_writerStop;
+    }
+
+    for (std::size_t j = worker; j < m_jobs.size(); j += workers) {
+      (void)serviceJob(*m_jobs[j], stopping);
+    }
+
+    if (stopping) {
+      m_writersRunning.fetch_sub(1, std::memory_order_release);
+      return;
+    }
+  }
+}
+
+void RecordingSession::stopWriters()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    m_writerStop = true;
+  }
+  m_writerCv.notify_all();
+  for (std::thread& writer : m_writers) {
+    if (writer.joinable()) {
+      writer.join();
+    }
+  }
+  m_writers.clear();
+}
+
+void RecordingSession::setErrorAndScheduleStop(QString message)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_lastError = message;
+  }
+
+  emit errorOccurred(message);
+
+  bool expected = false;
+  if (!m_stopScheduled.compare_exchange_strong(expected, true)) {
+    return;
+  }
+
+  QMetaObject::invokeMethod(this, [this]() { stop(); }, Qt::QueuedConnection);
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "backend/AudioRecorder.h"
+#include "dsp/SpscRing.h"
+
+#include <QObject>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pipewire/stream.h>
+
+class PipeWireThread;
+class QTimer;
+
+// Records many capture targets at once ("record everything": the system mix, every app stream,
+// every mic) into one file per target or into a single multichannel file.
+//
+// Each target gets its own capture stream and rings, but files are written by a small shared
+// pool of writer threads, so thirty targets cost thirty process callbacks and a handful of
+// threads rather than thirty writers. WAV writers are I/O bound and stay few; compressed formats
+// get one writer per core (up to one per file), since encoding is where their time goes.
+//
+// All targets share one timeline: the session start and stop are instants on the graph clock
+// (CLOCK_MONOTONIC, which PipeWire stamps every cycle with), and each process callback places its
+// buffer on that timeline from its own cycle time and clock position. The writers fill anything
+// a target did not deliver (not yet linked, suspended, or dropped because a disk fell behind)
+// with silence, so every file starts and ends on the same sample.
+class RecordingSession final : public QObject
+{
+  Q_OBJECT
+
+public:
+  static constexpr int kMaxTargets = 64;
+  static constexpr int kMaxWriterThreads = 4; // for WAV; compressed formats use one per core
+
+  enum class Layout {
+    SeparateFiles, // filePath is a template; {target} expands per target
+    Multichannel,  // every target's channels side by side, in target order, in one file
+  };
+
+  struct Target final {
+    QString targetObject; // empty: default sink monitor / default source
+    bool captureSink = true;
+    QString label;        // for {target} and status; defaults to the target object
+  };
+
+  struct StartOptions final {
+    QString filePath;
+    AudioRecorder::Format format = AudioRecorder::Format::Wav;
+    AudioRecorder::EncoderOptions encoder;
+    Layout layout = Layout::SeparateFiles;
+    std::vector<Target> targets;
+  };
+
+  struct TrackStatus final {
+    QString label;
+    QString targetObject;
+    QString filePath;
+    QString streamState;
+    uint32_t sampleRate = 0;
+    uint32_t channels = 0;
+    uint64_t framesWritten = 0;
+    uint64_t droppedFrames = 0;
+    double backlogSeconds = 0.0; // delivered but not yet encoded
+    float peakDb = -100.0f;
+    bool included = true; // false when a multichannel recording started without this target
+  };
+
+  explicit RecordingSession(PipeWireThread* pw, QObject* parent = nullptr);
+  ~RecordingSession() override;
+
+  RecordingSession(const RecordingSession&) = delete;
+  RecordingSession& operator=(const RecordingSession&) = delete;
+
+  // Waits for a previous session that is still stopping.
+  bool start(const StartOptions& options);
+  // Ends every file on the same sample. Returns at once; recordingChanged(false) follows when every
+  // file is finished. Track status stays readable until the next start().
+  void stop();
+
+  bool isRecording() const { return m_recording; }
+  bool isStopping() const { return m_stopping; }
+  Layout layout() const { return m_layout; }
+  AudioRecorder::Format format() const { return m_format; }
+  int trackCount() const { return static_cast<int>(m_tracks.size()); }
+  TrackStatus trackStatus(int track) const;
+  int writerThreads() const { return static_cast<int>(m_writers.size()); }
+  // Seconds of audio encoded per second of writer time, over all files; 0 until something is written.
+  double encoderSpeed() const;
+  // The shared timeline origin in steady-clock nanoseconds, or 0 until every target has a format.
+  int64_t startTimeNs() const { return m_startNs.load(std::memory_order_relaxed); }
+  QString lastError() const;
+
+signals:
+  void recordingChanged(bool recording);
+  void errorOccurred(QString message);
+
+private:
+  // Where a run of samples in a track's ring sits on the session timeline.
+  struct Segment final {
+    int64_t frame = 0;
+    uint32_t frames = 0;
+  };
+
+  struct Track final {
+    RecordingSession* self = nullptr;
+    Target target;
+    pw_stream* stream = nullptr;
+    spa_hook listener{};
+    std::atomic_int streamState{PW_STREAM_STATE_UNCONNECTED};
+
+    // Negotiated format: written on the loop thread before formatReady is released, then fixed.
+    std::atomic<uint32_t> sampleRate{0};
+    std::atomic<uint32_t> channels{0};
+    std::array<uint32_t, AudioRecorder::kMaxChannels> positions{};
+    bool positioned = false;
+    std::atomic_bool formatReady{false};
+
+    dsp::SpscRing<float> samples;
+    dsp::SpscRing<Segment> segments;
+
+    // Process thread only.
+    bool aligned = false;
+    uint64_t ticksBase = 0;
+    int64_t frameBase = 0;
+    bool clockFrames = false; // the driver runs at the track rate, so clock ticks are frames
+    int64_t streamFrame = 0;  // where the next buffer starts when counting frames ourselves
+    int64_t nextFrame = 0;
+    std::vector<float> levelPeaks;
+    std::vector<float> levelSumSq;
+    std::vector<uint32_t> levelClips;
+
+    std::atomic<int64_t> deliveredUntil{0}; // timeline end of the newest segment
+    std::atomic<uint64_t> droppedFrames{0};
+    std::atomic<float> peakDb{-100.0f};
+
+    // Writer side.
+    Segment pending;
+    uint32_t pendingUsed = 0;
+    bool hasPending = false;
+    std::vector<float> scratch;
+    std::atomic<uint64_t> framesWritten{0};
+    std::atomic_bool included{true};
+    QString filePath;
+  };
+
+  // One output file and the tracks that feed it.
+  struct Job final {
+    std::vector<Track*> tracks;
+    std::vector<uint32_t> channelOffsets;
+    QString filePath;
+    std::unique_ptr<AudioFileWriter> file;
+    uint32_t sampleRate = 0;
+    uint32_t fileChannels = 0;
+    int64_t fileFrames = 0;
+    std::vector<float> block;
+    bool failed = false;
+  };
+
+  static void onStreamStateChanged(void* data, enum pw_stream_state old, enum pw_stream_state state, const char* error);
+  static void onStreamParamChanged(void* data, uint32_t id, const struct spa_pod* param);
+  static void onStreamProcess(void* data);
+
+  bool connectTrackLocked(Track& track);
+  void destroyTracksLocked();
+  void processTrack(Track& track);
+  void arm();
+
+  bool openJob(Job& job);
+  bool serviceJob(Job& job, bool stopping);
+  void fillTrack(Job& job, Track& track, uint32_t channelOffset, int64_t from, uint32_t frames);
+  int64_t timelineFrame(int64_t ns, uint32_t rate) const;
+  void writerLoop(std::size_t worker, std::size_t workers);
+  bool stopReached() const;
+  void finishStop(bool wait);
+  void stopWriters();
+  void setErrorAndScheduleStop(QString message);
+
+  PipeWireThread* m_pw = nullptr;
+  QTimer* m_armTimer = nullptr;
+  int64_t m_armDeadlineNs = 0;
+  QTimer* m_stopTimer = nullptr;
+  int64_t m_stopDeadlineNs = 0;
+  bool m_stopping = false;
+
+  Layout m_layout = Layout::SeparateFiles;
+  AudioRecorder::Format m_format = AudioRecorder::Format::Wav;
+  AudioRecorder::EncoderOptions m_encoder;
+  bool m_recording = false;
+  std::vector<std::unique_ptr<Track>> m_tracks;
+  std::vector<std::unique_ptr<Job>> m_jobs; // job i belongs to writer i % m_writers.size()
+
+  std::atomic<int64_t> m_startNs{0};
+  std::atomic<int64_t> m_stopNs{0}; // 0 while recording
+  std::atomic<uint64_t> m_encodeNs{0};      // writer time spent inside AudioFileWriter::write()
+  std::atomic<uint64_t> m_encodedAudioNs{0}; // audio those writes covered
+
+  std::vector<std::thread> m_writers;
+  std::mutex m_writerMutex;
+  std::condition_variable m_writerCv;
+  bool m_writerStop = false; // guarded by m_writerMutex
+  std::atomic<int> m_writersRunning{0};
+
+  std::atomic_bool m_stopScheduled{false};
+  mutable std::mutex m_errorMutex;
+  QString m_lastError;
+};
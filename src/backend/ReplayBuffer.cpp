@@ -0,0 +1,576 @@
+#include "ReplayBuffer.h"
+
+#include "PipeWireThread.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QMetaObject>
+
+#include <pipewire/keys.h>
+#include <pipewire/properties.h>
+
+#include <spa/param/audio/raw-utils.h>
+#include <spa/param/param.h>
+#include <spa/utils/result.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <new>
+
+namespace {
+
+// ~2.7 s of 48 kHz stereo between the process callback and the packer.
+constexpr std::size_t kRingSamples = std::size_t{1} << 18;
+constexpr std::size_t kPackBlockFrames = 4096;
+constexpr std::size_t kDumpBlockFrames = 16384;
+constexpr auto kPackerPollInterval = std::chrono::milliseconds(50);
+
+std::size_t bytesPerSample(ReplayBuffer::SampleFormat format)
+{
+  return format == ReplayBuffer::SampleFormat::Pcm16 ? 2U : 3U;
+}
+
+float fullScale(ReplayBuffer::SampleFormat format)
+{
+  return format == ReplayBuffer::SampleFormat::Pcm16 ? 32767.0f : 8388607.0f;
+}
+
+// Little-endian packed PCM, clipped to full scale. NaNs become silence; lrint() of one is undefined.
+void packPcm(const float* in, std::size_t samples, ReplayBuffer::SampleFormat format, uint8_t* out)
+{
+  const float scale = fullScale(format);
+  const std::size_t stride = bytesPerSample(format);
+  for (std::size_t i = 0; i < samples; ++i) {
+    const float x = std::isnan(in[i]) ? 0.0f : std::clamp(in[i] * scale, -scale - 1.0f, scale);
+    const int32_t v = static_cast<int32_t>(std::lrint(x));
+    uint8_t* o = out + i * stride;
+    o[0] = static_cast<uint8_t>(v & 0xff);
+    o[1] = static_cast<uint8_t>((v >> 8) & 0xff);
+    if (stride == 3U) {
+      o[2] = static_cast<uint8_t>((v >> 16) & 0xff);
+    }
+  }
+}
+
+void unpackPcm(const uint8_t* in, std::size_t samples, ReplayBuffer::SampleFormat format, float* out)
+{
+  const float scale = 1.0f / fullScale(format);
+  if (format == ReplayBuffer::SampleFormat::Pcm16) {
+    for (std::size_t i = 0; i < samples; ++i) {
+      const int16_t v = static_cast<int16_t>(in[2 * i] | (in[2 * i + 1] << 8));
+      out[i] = static_cast<float>(v) * scale;
+    }
+    return;
+  }
+  for (std::size_t i = 0; i < samples; ++i) {
+    const uint8_t* s = in + 3 * i;
+    const int32_t v = static_cast<int32_t>(static_cast<uint32_t>(s[0]) << 8 | static_cast<uint32_t>(s[1]) << 16 | static_cast<uint32_t>(s[2]) << 24) >> 8;
+    out[i] = static_cast<float>(v) * scale;
+  }
+}
+
+} // namespace
+
+ReplayBuffer::ReplayBuffer(PipeWireThread* pw, QObject* parent)
+    : QObject(parent)
+    , m_pw(pw)
+{
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+  stop();
+}
+
+QString ReplayBuffer::sampleFormatToString(SampleFormat format)
+{
+  return format == SampleFormat::Pcm16 ? QStringLiteral("s16") : QStringLiteral("s24");
+}
+
+QString ReplayBuffer::lastError() const
+{
+  std::lock_guard<std::mutex> lock(m_errorMutex);
+  return m_lastError;
+}
+
+QString ReplayBuffer::streamStateString() const
+{
+  return AudioRecorder::streamStateToString(static_cast<pw_stream_state>(m_streamState.load()));
+}
+
+double ReplayBuffer::bufferedSeconds() const
+{
+  const uint32_t rate = sampleRate();
+  if (rate == 0) {
+    return 0.0;
+  }
+  std::lock_guard<std::mutex> lock(m_historyMutex);
+  return static_cast<double>(std::min(m_historyFrames, m_historyCapacity)) / static_cast<double>(rate);
+}
+
+bool ReplayBuffer::start(const StartOptions& options)
+{
+  stop();
+
+  {
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_lastError.clear();
+  }
+
+  m_options = options;
+  m_options.targetObject = options.targetObject.trimmed();
+  m_options.seconds = std::clamp(options.seconds, 1, kMaxSeconds);
+  m_capacitySeconds.store(m_options.seconds);
+
+  m_sampleRate.store(0);
+  m_channels.store(0);
+  m_formatReady.store(false);
+  m_formatChanged.store(false);
+  m_droppedFrames.store(0);
+  m_streamState.store(PW_STREAM_STATE_UNCONNECTED);
+  m_ring.reset(kRingSamples);
+  {
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    m_history.clear();
+    m_history.shrink_to_fit();
+    m_historyFrames = 0;
+    m_historyCapacity = 0;
+    m_historyChannels = 0;
+  }
+  m_memoryBytes.store(0);
+
+  if (!m_pw || !m_pw->isConnected() || !m_pw->threadLoop()) {
+    setError(tr("Not connected to PipeWire."));
+    return false;
+  }
+
+  pw_thread_loop* loop = m_pw->threadLoop();
+  pw_thread_loop_lock(loop);
+  connectStreamLocked();
+  pw_thread_loop_unlock(loop);
+
+  if (!m_stream) {
+    setError(tr("Failed to connect replay stream."));
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_packerMutex);
+    m_packerStop = false;
+  }
+  m_packer = std::thread([this]() { packerLoop(); });
+
+  emit runningChanged(true);
+  return true;
+}
+
+void ReplayBuffer::stop()
+{
+  const bool wasRunning = (m_stream != nullptr);
+
+  if (m_pw && m_pw->threadLoop()) {
+    pw_thread_loop* loop = m_pw->threadLoop();
+    pw_thread_loop_lock(loop);
+    destroyStreamLocked();
+    pw_thread_loop_unlock(loop);
+  } else {
+    destroyStreamLocked();
+  }
+
+  // A dump in progress still reads the history, so it finishes before the history goes away.
+  joinDumper();
+
+  if (m_packer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_packerMutex);
+      m_packerStop = true;
+    }
+    m_packerCv.notify_all();
+    m_packer.join();
+  }
+
+  if (wasRunning) {
+    emit runningChanged(false);
+  }
+}
+
+QString ReplayBuffer::dump(const QString& filePathTemplate, AudioRecorder::Format format, double seconds)
+{
+  if (!m_formatReady.load(std::memory_order_acquire) || sampleRate() == 0) {
+    setError(tr("Nothing has been captured yet."));
+    return {};
+  }
+  if (m_dumping.load()) {
+    setError(tr("A replay is already being saved."));
+    return {};
+  }
+
+  const QString path = AudioRecorder::expandPathTemplate(filePathTemplate, QStringLiteral("replay"), format);
+  if (path.isEmpty()) {
+    setError(tr("Invalid output path."));
+    return {};
+  }
+  const QFileInfo fi(path);
+  if (!fi.absolutePath().isEmpty() && !QDir().mkpath(fi.absolutePath())) {
+    setError(tr("Failed to create output directory."));
+    return {};
+  }
+
+  // The tail is fixed now; audio captured while the file is being written is not part of it.
+  uint64_t begin = 0;
+  uint64_t end = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    end = m_historyFrames;
+    const uint64_t held = std::min(m_historyFrames, m_historyCapacity);
+    const uint64_t wanted = seconds > 0.0 ? static_cast<uint64_t>(std::llround(seconds * static_cast<double>(sampleRate()))) : held;
+    begin = end - std::min(held, wanted);
+  }
+  if (end == begin) {
+    setError(tr("Nothing has been captured yet."));
+    return {};
+  }
+
+  joinDumper();
+  m_dumping.store(true);
+  m_dumper = std::thread([this, path, format, begin, end]() { dumpLoop(path, format, begin, end); });
+  return path;
+}
+
+void ReplayBuffer::onStreamStateChanged(void* data, enum pw_stream_state /*old*/, enum pw_stream_state state, const char* error)
+{
+  auto* self = static_cast<ReplayBuffer*>(data);
+  if (!self) {
+    return;
+  }
+  self->m_streamState.store(state);
+  if (state == PW_STREAM_STATE_ERROR) {
+    self->setError(AudioRecorder::streamStateToString(state) + (error ? QStringLiteral(": %1").arg(QString::fromUtf8(error)) : QString{}));
+  }
+}
+
+void ReplayBuffer::onStreamParamChanged(void* data, uint32_t id, const struct spa_pod* param)
+{
+  auto* self = static_cast<ReplayBuffer*>(data);
+  if (!self || !param || id != SPA_PARAM_Format) {
+    return;
+  }
+
+  spa_audio_info_raw info{};
+  if (spa_format_audio_raw_parse(param, &info) < 0 || info.rate == 0 || info.channels == 0) {
+    return;
+  }
+
+  // The history holds one format only, and the stream asks for it after the first negotiation, so
+  // the adapter converts whatever the target switches to. Anything else that still arrives is not
+  // captured (the history stays as it is and can be saved) until the pinned format is back.
+  if (self->m_formatReady.load(std::memory_order_acquire)) {
+    if (info.rate == self->sampleRate() && info.channels == self->channels()) {
+      self->m_formatChanged.store(false);
+      return;
+    }
+    if (!self->m_formatChanged.exchange(true)) {
+      self->setError(tr("Target format changed to %1 Hz, %2 ch; replay capture paused until it is converted back to %3 Hz, %4 ch.")
+                         .arg(info.rate)
+                         .arg(info.channels)
+                         .arg(self->sampleRate())
+                         .arg(self->channels()));
+    }
+    self->pinFormatLocked();
+    return;
+  }
+
+  self->m_sampleRate.store(info.rate);
+  self->m_channels.store(info.channels);
+  self->m_positioned = (info.flags & SPA_AUDIO_FLAG_UNPOSITIONED) == 0 && info.channels <= AudioRecorder::kMaxChannels;
+  for (uint32_t c = 0; c < std::min(info.channels, AudioRecorder::kMaxChannels); ++c) {
+    self->m_positions[c] = info.position[c];
+  }
+  self->m_formatReady.store(true, std::memory_order_release);
+  self->pinFormatLocked();
+}
+
+void ReplayBuffer::onStreamProcess(void* data)
+{
+  auto* self = static_cast<ReplayBuffer*>(data);
+  if (!self || !self->m_stream) {
+    return;
+  }
+
+  pw_buffer* buffer = pw_stream_dequeue_buffer(self->m_stream);
+  if (!buffer) {
+    return;
+  }
+  self->processBuffer(buffer);
+  pw_stream_queue_buffer(self->m_stream, buffer);
+}
+
+void ReplayBuffer::connectStreamLocked()
+{
+  if (m_stream || !m_pw || !m_pw->core()) {
+    return;
+  }
+
+  pw_properties* props = pw_properties_new(
+      PW_KEY_MEDIA_TYPE, "Audio",
+      PW_KEY_MEDIA_CATEGORY, "Capture",
+      PW_KEY_MEDIA_ROLE, "Production",
+      PW_KEY_NODE_NAME, "headroom.replay",
+      PW_KEY_STREAM_MONITOR, "true",
+      nullptr);
+  if (m_options.captureSink) {
+    pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true");
+  }
+  if (!m_options.targetObject.isEmpty()) {
+    pw_properties_set(props, PW_KEY_TARGET_OBJECT, m_options.targetObject.toUtf8().constData());
+  }
+
+  m_stream = pw_stream_new(m_pw->core(), "Headroom Replay Buffer", props);
+  if (!m_stream) {
+    return;
+  }
+
+  static const pw_stream_events streamEvents = [] {
+    pw_stream_events e{};
+    e.version = PW_VERSION_STREAM_EVENTS;
+    e.state_changed = &ReplayBuffer::onStreamStateChanged;
+    e.param_changed = &ReplayBuffer::onStreamParamChanged;
+    e.process = &ReplayBuffer::onStreamProcess;
+    return e;
+  }();
+  pw_stream_add_listener(m_stream, &m_streamListener, &streamEvents, this);
+
+  spa_audio_info_raw info{};
+  info.format = SPA_AUDIO_FORMAT_F32;
+
+  uint8_t buffer[1024];
+  spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+  const spa_pod* params[] = {spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &info)};
+
+  const int res = pw_stream_connect(
+      m_stream,
+      PW_DIRECTION_INPUT,
+      PW_ID_ANY,
+      static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS),
+      params,
+      1);
+  if (res < 0) {
+    setError(QStringLiteral("pw_stream_connect failed: %1").arg(QString::fromUtf8(spa_strerror(res))));
+    spa_hook_remove(&m_streamListener);
+    pw_stream_destroy(m_stream);
+    m_stream = nullptr;
+  }
+}
+
+// Replaces the native-format offer with the captured rate and layout.
+void ReplayBuffer::pinFormatLocked()
+{
+  if (!m_stream) {
+    return;
+  }
+  spa_audio_info_raw info{};
+  info.format = SPA_AUDIO_FORMAT_F32;
+  info.rate = sampleRate();
+  info.channels = channels();
+  if (m_positioned) {
+    std::copy_n(m_positions.begin(), info.channels, info.position);
+  } else {
+    info.flags |= SPA_AUDIO_FLAG_UNPOSITIONED;
+  }
+
+  uint8_t buffer[1024];
+  spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+  const spa_pod* params[] = {spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &info)};
+  pw_stream_update_params(m_stream, params, 1);
+}
+
+void ReplayBuffer::destroyStreamLocked()
+{
+  if (!m_stream) {
+    return;
+  }
+  spa_hook_remove(&m_streamListener);
+  pw_stream_destroy(m_stream);
+  m_stream = nullptr;
+  m_streamState.store(PW_STREAM_STATE_UNCONNECTED);
+}
+
+void ReplayBuffer::processBuffer(pw_buffer* buffer)
+{
+  if (!buffer || !buffer->buffer || !m_formatReady.load(std::memory_order_acquire) || m_formatChanged.load(std::memory_order_relaxed)) {
+    return;
+  }
+  spa_buffer* b = buffer->buffer;
+  if (b->n_datas < 1 || !b->datas[0].data || !b->datas[0].chunk) {
+    return;
+  }
+  const spa_data& d = b->datas[0];
+  if (d.chunk->offset + d.chunk->size > d.maxsize) {
+    return;
+  }
+
+  const uint32_t ch = channels();
+  const uint32_t frames = d.chunk->size / (ch * sizeof(float));
+  const std::size_t count = static_cast<std::size_t>(frames) * ch;
+  if (count == 0) {
+    return;
+  }
+  if (m_ring.writeAvailable() < count) {
+    m_droppedFrames.fetch_add(frames, std::memory_order_relaxed);
+    return;
+  }
+  m_ring.write(reinterpret_cast<const float*>(static_cast<const uint8_t*>(d.data) + d.chunk->offset), count);
+}
+
+void ReplayBuffer::packerLoop()
+{
+  for (;;) {
+    bool stopping = false;
+    {
+      std::unique_lock<std::mutex> lock(m_packerMutex);
+      m_packerCv.wait_for(lock, kPackerPollInterval, [this]() { return m_packerStop; });
+      stopping = m_packerStop;
+    }
+    if (stopping) {
+      return;
+    }
+    if (!m_formatReady.load(std::memory_order_acquire)) {
+      continue;
+    }
+
+    if (m_historyChannels == 0 && !allocateHistory()) {
+      // Capture stops rather than running on with nowhere to put it.
+      QMetaObject::invokeMethod(this, [this]() { stop(); }, Qt::QueuedConnection);
+      return;
+    }
+    packAvailable();
+  }
+}
+
+bool ReplayBuffer::allocateHistory()
+{
+  // Sized once per format, off the audio thread.
+  const uint32_t rate = sampleRate();
+  const uint32_t ch = channels();
+  const uint64_t frameBytes = static_cast<uint64_t>(ch) * bytesPerSample(m_options.sampleFormat);
+  const uint64_t capacity = std::max<uint64_t>(std::min(static_cast<uint64_t>(m_options.seconds) * rate, kMaxHistoryBytes / frameBytes), 1U);
+  const int seconds = static_cast<int>(capacity / rate);
+  if (seconds < m_options.seconds) {
+    m_capacitySeconds.store(seconds);
+    setError(tr("Replay history limited to %1 s at %2 Hz, %3 ch to stay within %4 MiB.")
+                 .arg(seconds)
+                 .arg(rate)
+                 .arg(ch)
+                 .arg(kMaxHistoryBytes >> 20));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    try {
+      m_history.assign(static_cast<std::size_t>(capacity * frameBytes), 0U);
+      m_packBlock.assign(kPackBlockFrames * ch, 0.0f);
+      m_historyCapacity = capacity;
+      m_historyChannels = ch;
+      m_historyFrames = 0;
+      m_memoryBytes.store(m_history.size() + m_ring.capacity() * sizeof(float));
+      return true;
+    } catch (const std::bad_alloc&) {
+      m_history.clear();
+      m_history.shrink_to_fit();
+    }
+  }
+  setError(tr("Not enough memory for %1 s of replay history (%2 MiB).").arg(seconds).arg((capacity * frameBytes) >> 20));
+  return false;
+}
+
+void ReplayBuffer::packAvailable()
+{
+  const std::size_t ch = m_historyChannels;
+  const std::size_t stride = ch * bytesPerSample(m_options.sampleFormat);
+  for (;;) {
+    const std::size_t available = m_ring.readAvailable() / ch;
+    if (available == 0) {
+      break;
+    }
+    const std::size_t frames = std::min(available, kPackBlockFrames);
+    m_ring.read(m_packBlock.data(), frames * ch);
+
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    std::size_t done = 0;
+    while (done < frames) {
+      const std::size_t slot = static_cast<std::size_t>((m_historyFrames + done) % m_historyCapacity);
+      const std::size_t run = std::min(frames - done, static_cast<std::size_t>(m_historyCapacity) - slot);
+      packPcm(m_packBlock.data() + done * ch, run * ch, m_options.sampleFormat, m_history.data() + slot * stride);
+      done += run;
+    }
+    m_historyFrames += frames;
+  }
+}
+
+void ReplayBuffer::dumpLoop(QString path, AudioRecorder::Format format, uint64_t begin, uint64_t end)
+{
+  const uint32_t ch = m_historyChannels;
+  const std::size_t stride = ch * bytesPerSample(m_options.sampleFormat);
+
+  QString error;
+  std::unique_ptr<AudioFileWriter> file = AudioRecorder::openOutputFile(path, format, AudioRecorder::EncoderOptions{}, sampleRate(), ch, m_positioned ? m_positions.data() : nullptr, &error);
+  bool ok = file != nullptr;
+
+  std::vector<uint8_t> packed(kDumpBlockFrames * stride);
+  std::vector<float> block(kDumpBlockFrames * ch);
+  uint64_t pos = begin;
+  while (ok && pos < end) {
+    std::size_t frames = 0;
+    {
+      std::lock_guard<std::mutex> lock(m_historyMutex);
+      // Only a dump slower than real time over a nearly full history can lose its oldest frames.
+      const uint64_t oldest = m_historyFrames > m_historyCapacity ? m_historyFrames - m_historyCapacity : 0;
+      pos = std::max(pos, oldest);
+      frames = static_cast<std::size_t>(std::min<uint64_t>(end - std::min(pos, end), kDumpBlockFrames));
+      std::size_t done = 0;
+      while (done < frames) {
+        const std::size_t slot = static_cast<std::size_t>((pos + done) % m_historyCapacity);
+        const std::size_t run = std::min(frames - done, static_cast<std::size_t>(m_historyCapacity) - slot);
+        std::copy_n(m_history.data() + slot * stride, run * stride, packed.data() + done * stride);
+        done += run;
+      }
+    }
+    if (frames == 0) {
+      break;
+    }
+
+    unpackPcm(packed.data(), frames * ch, m_options.sampleFormat, block.data());
+    if (!file->write(block.data(), frames)) {
+      error = tr("Write failed: %1").arg(file->errorString());
+      ok = false;
+    }
+    pos += frames;
+  }
+
+  if (file && !file->close() && ok) {
+    error = tr("Write failed: %1").arg(file->errorString());
+    ok = false;
+  }
+  m_dumping.store(false);
+  if (!ok) {
+    setError(error);
+  }
+  emit dumpFinished(path, ok, error);
+}
+
+void ReplayBuffer::joinDumper()
+{
+  if (m_dumper.joinable()) {
+    m_dumper.join();
+  }
+}
+
+void ReplayBuffer::setError(QString message)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_lastError = message;
+  }
+  emit errorOccurred(message);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "backend/AudioRecorder.h"
+#include "dsp/SpscRing.h"
+
+#include <QObject>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pipewire/stream.h>
+
+class PipeWireThread;
+
+// Always-on retroactive recording: keeps the last few minutes of one target in memory so they can
+// be saved after the fact ("record the last N minutes").
+//
+// The process callback only copies into a small float ring. A packer thread moves that into the
+// history as packed 16- or 24-bit PCM, so an hour of 48 kHz stereo fits in ~1 GiB at 24 bits and
+// the default five minutes in ~86 MiB. The history never exceeds kMaxHistoryBytes; wide or
+// high-rate targets get fewer seconds, and capacitySeconds() says how many. dump() encodes the
+// requested tail on its own thread while capture carries on.
+//
+// The first negotiated rate and layout are pinned for the life of the buffer, so a target that
+// renegotiates is converted by the graph and the history stays one continuous format.
+class ReplayBuffer final : public QObject
+{
+  Q_OBJECT
+
+public:
+  static constexpr int kDefaultSeconds = 300;
+  static constexpr int kMaxSeconds = 3600;
+  static constexpr uint64_t kMaxHistoryBytes = uint64_t{2} << 30;
+
+  enum class SampleFormat {
+    Pcm16,
+    Pcm24,
+  };
+
+  struct StartOptions final {
+    QString targetObject;
+    bool captureSink = true;
+    int seconds = kDefaultSeconds;
+    SampleFormat sampleFormat = SampleFormat::Pcm24;
+  };
+
+  explicit ReplayBuffer(PipeWireThread* pw, QObject* parent = nullptr);
+  ~ReplayBuffer() override;
+
+  ReplayBuffer(const ReplayBuffer&) = delete;
+  ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+  bool start(const StartOptions& options);
+  void stop();
+  bool isRunning() const { return m_stream != nullptr; }
+
+  QString targetObject() const { return m_options.targetObject; }
+  bool captureSink() const { return m_options.captureSink; }
+  SampleFormat sampleFormat() const { return m_options.sampleFormat; }
+  // The requested length until the format is known, then what actually fits.
+  int capacitySeconds() const { return m_capacitySeconds.load(std::memory_order_relaxed); }
+
+  uint32_t sampleRate() const { return m_sampleRate.load(std::memory_order_relaxed); }
+  uint32_t channels() const { return m_channels.load(std::memory_order_relaxed); }
+  double bufferedSeconds() const;
+  uint64_t memoryBytes() const { return m_memoryBytes.load(std::memory_order_relaxed); }
+  uint64_t droppedFrames() const { return m_droppedFrames.load(std::memory_order_relaxed); }
+  QString lastError() const;
+  QString streamStateString() const;
+
+  // Saves the newest `seconds` of history (everything held if <= 0 or more than is held) to
+  // `filePathTemplate`, expanded like any recording path with {target} = "replay". Returns the
+  // resolved path, or an empty string if nothing could be started; dumpFinished() follows.
+  QString dump(const QString& filePathTemplate, AudioRecorder::Format format, double seconds);
+  bool isDumping() const { return m_dumping.load(); }
+
+  static QString sampleFormatToString(SampleFormat format);
+
+signals:
+  void runningChanged(bool running);
+  void dumpFinished(QString filePath, bool ok, QString error);
+  void errorOccurred(QString message);
+
+private:
+  static void onStreamStateChanged(void* data, enum pw_stream_state old, enum pw_stream_state state, const char* error);
+  static void onStreamParamChanged(void* data, uint32_t id, const struct spa_pod* param);
+  static void onStreamProcess(void* data);
+
+  void connectStreamLocked();
+  void pinFormatLocked();
+  void destroyStreamLocked();
+  void processBuffer(pw_buffer* buffer);
+
+  void packerLoop();
+  bool allocateHistory();
+  void packAvailable();
+  void dumpLoop(QString path, AudioRecorder::Format format, uint64_t begin, uint64_t end);
+  void joinDumper();
+  void setError(QString message);
+
+  PipeWireThread* m_pw = nullptr;
+  pw_stream* m_stream = nullptr;
+  spa_hook m_streamListener{};
+  StartOptions m_options;
+
+  std::atomic<uint32_t> m_sampleRate{0};
+  std::atomic<uint32_t> m_channels{0};
+  std::array<uint32_t, AudioRecorder::kMaxChannels> m_positions{};
+  bool m_positioned = false;
+  std::atomic_bool m_formatReady{false};
+  std::atomic_bool m_formatChanged{false}; // a format other than the pinned one; capture pauses
+  std::atomic<uint64_t> m_droppedFrames{0};
+  std::atomic_int m_streamState{PW_STREAM_STATE_UNCONNECTED};
+
+  dsp::SpscRing<float> m_ring; // process callback -> packer
+  std::vector<float> m_packBlock; // packer thread only
+
+  // Packed history, indexed by absolute frame number modulo its capacity. The packer appends under
+  // m_historyMutex; a dump copies out one block at a time so it never holds the packer up for long.
+  mutable std::mutex m_historyMutex;
+  std::vector<uint8_t> m_history;
+  uint64_t m_historyFrames = 0;    // total frames ever packed
+  uint64_t m_historyCapacity = 0;  // in frames
+  uint32_t m_historyChannels = 0;
+  std::atomic<uint64_t> m_memoryBytes{0};
+  std::atomic_int m_capacitySeconds{0};
+
+  std::thread m_packer;
+  std::mutex m_packerMutex;
+  std::condition_variable m_packerCv;
+  bool m_packerStop = false; // guarded by m_packerMutex
+
+  std::thread m_dumper;
+  std::atomic_bool m_dumping{false};
+
+  mutable std::mutex m_errorMutex;
+  QString m_lastError;
+};
@@ -0,0 +1,423 @@
+#include "WavFileWriter.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Samples are copied into the file as they are in memory.
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "WavFileWriter assumes a little-endian host");
+
+namespace {
+
+// RIFF/RF64 header, WAVE, ds64 (JUNK until the upgrade), fmt (WAVE_FORMAT_EXTENSIBLE), fact, data.
+constexpr std::size_t kRiffOffset = 0;
+constexpr std::size_t kDs64Offset = 12;
+constexpr std::size_t kDs64BodyBytes = 28;
+constexpr std::size_t kFmtOffset = kDs64Offset + 8 + kDs64BodyBytes;
+constexpr std::size_t kFmtBodyBytes = 40;
+constexpr std::size_t kFactOffset = kFmtOffset + 8 + kFmtBodyBytes;
+constexpr std::size_t kDataOffset = kFactOffset + 12;
+constexpr std::size_t kHeaderBytes = kDataOffset + 8;
+
+constexpr uint32_t kSizeInDs64 = 0xFFFFFFFFu;
+constexpr uint16_t kWaveFormatExtensible = 0xFFFE;
+
+// KSDATAFORMAT_SUBTYPE_IEEE_FLOAT
+constexpr std::array<unsigned char, 16> kFloatSubFormat{
+    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+void putTag(unsigned char* p, const char* tag)
+{
+  std::memcpy(p, tag, 4);
+}
+
+QString errnoString(const QString& what, int err)
+{
+  return QStringLiteral("%1: %2").arg(what, QString::fromLocal8Bit(std::strerror(err)));
+}
+
+uint64_t pageSize()
+{
+  const long size = sysconf(_SC_PAGESIZE);
+  return size > 0 ? static_cast<uint64_t>(size) : 4096u;
+}
+
+bool readAt(int fd, void* out, std::size_t bytes, uint64_t offset)
+{
+  return pread(fd, out, bytes, static_cast<off_t>(offset)) == static_cast<ssize_t>(bytes);
+}
+
+bool writeAt(int fd, const void* in, std::size_t bytes, uint64_t offset)
+{
+  return pwrite(fd, in, bytes, static_cast<off_t>(offset)) == static_cast<ssize_t>(bytes);
+}
+
+bool zeroFill(int fd, uint64_t from, uint64_t to)
+{
+  static const std::array<unsigned char, std::size_t{1} << 20> zeros{};
+  while (from < to) {
+    const std::size_t n = static_cast<std::size_t>(std::min<uint64_t>(zeros.size(), to - from));
+    if (!writeAt(fd, zeros.data(), n, from)) {
+      return false;
+    }
+    from += n;
+  }
+  return true;
+}
+
+// End of the last non-zero byte in [from, to), or `from` if there is none.
+uint64_t endOfNonZero(int fd, uint64_t from, uint64_t to)
+{
+  std::vector<unsigned char> buf(std::size_t{1} << 20);
+  while (to > from) {
+    const std::size_t n = static_cast<std::size_t>(std::min<uint64_t>(buf.size(), to - from));
+    if (!readAt(fd, buf.data(), n, to - n)) {
+      return to; // unreadable: keep it rather than guess
+    }
+    for (std::size_t i = n; i > 0; --i) {
+      if (buf[i - 1] != 0) {
+        return to - n + i;
+      }
+    }
+    to -= n;
+  }
+  return from;
+}
+
+} // namespace
+
+std::unique_ptr<WavFileWriter> WavFileWriter::open(const QString& path, uint32_t sampleRate, uint32_t channels, uint32_t channelMask, QString* error)
+{
+  channels = std::clamp<uint32_t>(channels, 1u, 0xFFFFu);
+
+  const QByteArray pathLocal = path.toLocal8Bit();
+  const int fd = ::open(pathLocal.constData(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd < 0) {
+    if (error) {
+      *error = errnoString(QStringLiteral("Failed to open output file"), errno);
+    }
+    return nullptr;
+  }
+
+  std::unique_ptr<WavFileWriter> writer(new WavFileWriter(fd, sampleRate, channels, channelMask));
+  if (!writer->writeHeader()) {
+    if (error) {
+      *error = writer->errorString();
+    }
+    return nullptr;
+  }
+  return writer;
+}
+
+WavFileWriter::WavFileWriter(int fd, uint32_t sampleRate, uint32_t channels, uint32_t channelMask)
+    : AudioFileWriter(channels)
+    , m_fd(fd)
+    , m_sampleRate(sampleRate)
+    , m_channelMask(channelMask)
+    , m_allocated(0)
+    , m_retiredUntil(pageSize()) // the header page is rewritten constantly; keep it cached
+{
+}
+
+WavFileWriter::~WavFileWriter()
+{
+  (void)close();
+}
+
+bool WavFileWriter::fail(const QString& what)
+{
+  m_error = errnoString(what, errno);
+  return false;
+}
+
+bool WavFileWriter::writeHeader()
+{
+  const uint64_t riffBytes = kHeaderBytes - 8 + m_dataBytes;
+  const uint64_t frames = m_dataBytes / (uint64_t{channels()} * sizeof(float));
+  m_rf64 = m_rf64 || riffBytes > 0xFFFFFFFFu;
+
+  std::array<unsigned char, kHeaderBytes> h{};
+  unsigned char* p = h.data();
+
+  putTag(p + kRiffOffset, m_rf64 ? "RF64" : "RIFF");
+  qToLittleEndian<quint32>(m_rf64 ? kSizeInDs64 : static_cast<uint32_t>(riffBytes), p + kRiffOffset + 4);
+  putTag(p + kRiffOffset + 8, "WAVE");
+
+  // Plain WAV keeps the space as a JUNK chunk that every reader skips.
+  putTag(p + kDs64Offset, m_rf64 ? "ds64" : "JUNK");
+  qToLittleEndian<quint32>(kDs64BodyBytes, p + kDs64Offset + 4);
+  if (m_rf64) {
+    qToLittleEndian<quint64>(riffBytes, p + kDs64Offset + 8);
+    qToLittleEndian<quint64>(m_dataBytes, p + kDs64Offset + 16);
+    qToLittleEndian<quint64>(frames, p + kDs64Offset + 24);
+  }
+
+  const uint32_t blockAlign = channels() * sizeof(float);
+  putTag(p + kFmtOffset, "fmt ");
+  qToLittleEndian<quint32>(kFmtBodyBytes, p + kFmtOffset + 4);
+  qToLittleEndian<quint16>(kWaveFormatExtensible, p + kFmtOffset + 8);
+  qToLittleEndian<quint16>(static_cast<uint16_t>(channels()), p + kFmtOffset + 10);
+  qToLittleEndian<quint32>(m_sampleRate, p + kFmtOffset + 12);
+  qToLittleEndian<quint32>(m_sampleRate * blockAlign, p + kFmtOffset + 16);
+  qToLittleEndian<quint16>(static_cast<uint16_t>(blockAlign), p + kFmtOffset + 20);
+  qToLittleEndian<quint16>(32, p + kFmtOffset + 22);
+  qToLittleEndian<quint16>(22, p + kFmtOffset + 24);
+  qToLittleEndian<quint16>(32, p + kFmtOffset + 26);
+  qToLittleEndian<quint32>(m_channelMask, p + kFmtOffset + 28);
+  std::copy(kFloatSubFormat.begin(), kFloatSubFormat.end(), p + kFmtOffset + 32);
+
+  putTag(p + kFactOffset, "fact");
+  qToLittleEndian<quint32>(4, p + kFactOffset + 4);
+  qToLittleEndian<quint32>(m_rf64 ? kSizeInDs64 : static_cast<uint32_t>(frames), p + kFactOffset + 8);
+
+  putTag(p + kDataOffset, "data");
+  qToLittleEndian<quint32>(m_rf64 ? kSizeInDs64 : static_cast<uint32_t>(m_dataBytes), p + kDataOffset + 4);
+
+  if (!writeAt(m_fd, h.data(), h.size(), 0)) {
+    return fail(QStringLiteral("Failed to write WAV header"));
+  }
+  return true;
+}
+
+bool WavFileWriter::reserve(uint64_t end)
+{
+  if (end <= m_allocated) {
+    return true;
+  }
+  const uint64_t size = (end + kExtentBytes - 1) / kExtentBytes * kExtentBytes;
+  if (fallocate(m_fd, 0, static_cast<off_t>(m_allocated), static_cast<off_t>(size - m_allocated)) != 0) {
+    // Without fallocate the extent is written out as zeros instead. A sparse tail would do for the
+    // mapping, but a full disk would then surface as SIGBUS on a page fault, not as an error here.
+    if ((errno != EOPNOTSUPP && errno != ENOSYS) || !zeroFill(m_fd, m_allocated, size)) {
+      return fail(QStringLiteral("Failed to allocate space for the recording"));
+    }
+  }
+  m_allocated = size;
+  return true;
+}
+
+void WavFileWriter::unmapWindow()
+{
+  if (!m_window) {
+    return;
+  }
+  munmap(m_window, m_windowSize);
+  m_window = nullptr;
+
+  // Start writing this window back now, and drop the one before it, which had a whole window's
+  // worth of time to reach the disk.
+  (void)sync_file_range(m_fd, static_cast<off_t>(m_windowOffset), static_cast<off_t>(m_windowSize), SYNC_FILE_RANGE_WRITE);
+  if (m_windowOffset > m_retiredUntil) {
+    const off_t from = static_cast<off_t>(m_retiredUntil);
+    const off_t len = static_cast<off_t>(m_windowOffset - m_retiredUntil);
+    (void)sync_file_range(m_fd, from, len, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    (void)posix_fadvise(m_fd, from, len, POSIX_FADV_DONTNEED);
+    m_retiredUntil = m_windowOffset;
+  }
+}
+
+bool WavFileWriter::mapWindow(uint64_t offset)
+{
+  unmapWindow();
+  offset = offset / pageSize() * pageSize();
+  if (!reserve(offset + kWindowBytes)) {
+    return false;
+  }
+  void* p = mmap(nullptr, kWindowBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, static_cast<off_t>(offset));
+  if (p == MAP_FAILED) {
+    return fail(QStringLiteral("Failed to map the recording"));
+  }
+  (void)madvise(p, kWindowBytes, MADV_SEQUENTIAL);
+  m_window = static_cast<unsigned char*>(p);
+  m_windowOffset = offset;
+  m_windowSize = kWindowBytes;
+  return true;
+}
+
+bool WavFileWriter::write(const float* interleaved, uint64_t frames)
+{
+  if (m_fd < 0) {
+    m_error = QStringLiteral("File is closed.");
+    return false;
+  }
+
+  const auto* src = reinterpret_cast<const unsigned char*>(interleaved);
+  uint64_t remaining = frames * channels() * sizeof(float);
+  while (remaining > 0) {
+    const uint64_t pos = kHeaderBytes + m_dataBytes;
+    if (!m_window || pos >= m_windowOffset + m_windowSize) {
+      if (!mapWindow(pos)) {
+        return false;
+      }
+    }
+    const uint64_t n = std::min<uint64_t>(remaining, m_windowOffset + m_windowSize - pos);
+    std::memcpy(m_window + (pos - m_windowOffset), src, n);
+    src += n;
+    remaining -= n;
+    m_dataBytes += n;
+  }
+
+  // Keep the header describing everything written so far; this is what repair() relies on.
+  return writeHeader();
+}
+
+bool WavFileWriter::close()
+{
+  if (m_fd < 0) {
+    return m_error.isEmpty();
+  }
+
+  if (m_window) {
+    munmap(m_window, m_windowSize);
+    m_window = nullptr;
+  }
+
+  bool ok = m_error.isEmpty();
+  if (ftruncate(m_fd, static_cast<off_t>(kHeaderBytes + m_dataBytes)) != 0) {
+    ok = fail(QStringLiteral("Failed to trim the recording"));
+  }
+  ok = writeHeader() && ok;
+  if (fdatasync(m_fd) != 0) {
+    ok = fail(QStringLiteral("Failed to flush the recording"));
+  }
+  ::close(m_fd);
+  m_fd = -1;
+  return ok;
+}
+
+QString WavFileWriter::errorString() const
+{
+  return m_error;
+}
+
+bool WavFileWriter::repair(const QString& path, uint64_t* frames, QString* error)
+{
+  const auto failWith = [error](const QString& message) {
+    if (error) {
+      *error = message;
+    }
+    return false;
+  };
+
+  const QByteArray pathLocal = path.toLocal8Bit();
+  const int fd = ::open(pathLocal.constData(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return failWith(errnoString(QStringLiteral("Failed to open %1").arg(path), errno));
+  }
+  struct FdCloser {
+    int fd;
+    ~FdCloser() { ::close(fd); }
+  } closer{fd};
+
+  struct stat st{};
+  if (fstat(fd, &st) != 0) {
+    return failWith(errnoString(QStringLiteral("Failed to stat %1").arg(path), errno));
+  }
+  const uint64_t fileBytes = static_cast<uint64_t>(st.st_size);
+
+  unsigned char riff[12];
+  if (!readAt(fd, riff, sizeof(riff), 0) || std::memcmp(riff + 8, "WAVE", 4) != 0
+      || (std::memcmp(riff, "RIFF", 4) != 0 && std::memcmp(riff, "RF64", 4) != 0)) {
+    return failWith(QStringLiteral("%1 is not a WAV file.").arg(path));
+  }
+  const bool rf64 = std::memcmp(riff, "RF64", 4) == 0;
+
+  uint64_t ds64At = 0;
+  uint64_t junkAt = 0;
+  uint64_t ds64DataBytes = 0;
+  uint64_t factAt = 0;
+  uint32_t blockAlign = 0;
+  uint64_t dataAt = 0;
+  uint64_t declared = 0;
+  for (uint64_t off = 12; off + 8 <= fileBytes;) {
+    unsigned char chunk[8];
+    if (!readAt(fd, chunk, sizeof(chunk), off)) {
+      break;
+    }
+    const uint32_t size = qFromLittleEndian<quint32>(chunk + 4);
+    if (std::memcmp(chunk, "ds64", 4) == 0 && size >= 24) {
+      unsigned char body[24];
+      if (readAt(fd, body, sizeof(body), off + 8)) {
+        ds64At = off;
+        ds64DataBytes = qFromLittleEndian<quint64>(body + 8);
+      }
+    } else if (std::memcmp(chunk, "JUNK", 4) == 0 && size >= kDs64BodyBytes && junkAt == 0) {
+      junkAt = off;
+    } else if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+      unsigned char body[16];
+      if (readAt(fd, body, sizeof(body), off + 8)) {
+        blockAlign = qFromLittleEndian<quint16>(body + 12);
+      }
+    } else if (std::memcmp(chunk, "fact", 4) == 0 && size >= 4) {
+      factAt = off;
+    } else if (std::memcmp(chunk, "data", 4) == 0) {
+      dataAt = off + 8;
+      declared = (rf64 && size == kSizeInDs64) ? ds64DataBytes : size;
+      break;
+    }
+    off += 8 + uint64_t{size} + (size & 1u);
+  }
+  if (dataAt == 0 || blockAlign == 0) {
+    return failWith(QStringLiteral("%1 has no fmt or data chunk.").arg(path));
+  }
+
+  // A header that was never updated (0, or the "unknown" marker some writers use) claims nothing,
+  // so the data runs to the last non-zero frame; the zeros after it are most likely preallocated
+  // tail, and trailing digital silence is no loss. Otherwise the header is the source of truth.
+  const uint64_t held = fileBytes - std::min(fileBytes, dataAt);
+  uint64_t dataBytes = std::min(declared, held);
+  if (declared == 0 || (!rf64 && declared == kSizeInDs64)) {
+    const uint64_t used = endOfNonZero(fd, dataAt, dataAt + held) - dataAt;
+    dataBytes = std::min((used + blockAlign - 1) / blockAlign * blockAlign, held);
+  }
+  dataBytes = dataBytes / blockAlign * blockAlign;
+  const uint64_t sampleFrames = dataBytes / blockAlign;
+
+  if (ftruncate(fd, static_cast<off_t>(dataAt + dataBytes)) != 0) {
+    return failWith(errnoString(QStringLiteral("Failed to truncate %1").arg(path), errno));
+  }
+
+  const uint64_t riffBytes = dataAt + dataBytes - 8;
+  const bool big = rf64 || riffBytes > 0xFFFFFFFFu;
+  unsigned char word[4];
+  qToLittleEndian<quint32>(big ? kSizeInDs64 : static_cast<uint32_t>(riffBytes), word);
+  bool ok = writeAt(fd, word, 4, 4);
+  qToLittleEndian<quint32>(big ? kSizeInDs64 : static_cast<uint32_t>(dataBytes), word);
+  ok = ok && writeAt(fd, word, 4, dataAt - 4);
+  if (factAt != 0) {
+    qToLittleEndian<quint32>(big ? kSizeInDs64 : static_cast<uint32_t>(sampleFrames), word);
+    ok = ok && writeAt(fd, word, 4, factAt + 8);
+  }
+  if (big) {
+    if (ds64At == 0) {
+      // A plain WAV that outgrew 4 GiB can still become RF64 if it reserved a JUNK chunk for it.
+      if (junkAt == 0) {
+        return failWith(QStringLiteral("%1 is larger than 4 GiB but has no room for an RF64 header.").arg(path));
+      }
+      ds64At = junkAt;
+      ok = ok && writeAt(fd, "ds64", 4, ds64At);
+    }
+    unsigned char body[24];
+    qToLittleEndian<quint64>(riffBytes, body);
+    qToLittleEndian<quint64>(dataBytes, body + 8);
+    qToLittleEndian<quint64>(sampleFrames, body + 16);
+    ok = ok && writeAt(fd, "RF64", 4, 0) && writeAt(fd, body, sizeof(body), ds64At + 8);
+  }
+  if (!ok || fdatasync(fd) != 0) {
+    return failWith(errnoString(QStringLiteral("Failed to update %1").arg(path), errno));
+  }
+
+  if (frames) {
+    *frames = sampleFrames;
+  }
+  return true;
+}
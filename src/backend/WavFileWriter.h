@@ -0,0 +1,68 @@
+#pragma once
+
+#include "backend/AudioFileWriter.h"
+
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Native 32-bit float WAV writer for long captures.
+//
+// The file grows in large preallocated extents (fallocate, or zero-filled where that is not
+// supported), so a 12-hour multitrack recording is a few dozen contiguous allocations instead of
+// hundreds of thousands of small appends, and samples are copied into a sliding mmap window
+// rather than pushed through write(). Windows that have been left behind are written back and
+// dropped from the page cache, so the recording does not evict everything else from memory.
+//
+// The header reserves room for an RF64 ds64 chunk and is upgraded in place once the file passes
+// 4 GiB. It is rewritten after every write(), so a file left behind by a crash describes all data
+// that reached it; repair() then trims the preallocated tail.
+class WavFileWriter final : public AudioFileWriter
+{
+public:
+  static constexpr uint64_t kExtentBytes = uint64_t{64} << 20;
+  static constexpr std::size_t kWindowBytes = std::size_t{16} << 20;
+
+  // `channelMask` is a WAVE_FORMAT_EXTENSIBLE speaker mask, or 0 for an unpositioned layout.
+  static std::unique_ptr<WavFileWriter> open(const QString& path, uint32_t sampleRate, uint32_t channels, uint32_t channelMask, QString* error);
+
+  // Makes a WAV/RF64 file left behind by a crash consistent: the data chunk is clamped to what the
+  // file holds (or, if the header never recorded a size, to its last non-zero frame) and the file
+  // is truncated right after it. `frames` receives the playable length.
+  static bool repair(const QString& path, uint64_t* frames, QString* error);
+
+  ~WavFileWriter() override;
+
+  bool write(const float* interleaved, uint64_t frames) override;
+  bool close() override;
+  QString errorString() const override;
+
+  bool isRf64() const { return m_rf64; }
+  uint64_t dataBytes() const { return m_dataBytes; }
+
+private:
+  WavFileWriter(int fd, uint32_t sampleRate, uint32_t channels, uint32_t channelMask);
+
+  bool writeHeader();
+  bool mapWindow(uint64_t offset);
+  void unmapWindow();
+  bool reserve(uint64_t end);
+  bool fail(const QString& what);
+
+  int m_fd = -1;
+  uint32_t m_sampleRate = 0;
+  uint32_t m_channelMask = 0;
+  bool m_rf64 = false;
+
+  uint64_t m_dataBytes = 0;
+  uint64_t m_allocated = 0; // file size, including the preallocated tail
+
+  unsigned char* m_window = nullptr;
+  uint64_t m_windowOffset = 0;
+  std::size_t m_windowSize = 0;
+  uint64_t m_retiredUntil = 0; // everything before this has been written back and dropped
+
+  QString m_error;
+};
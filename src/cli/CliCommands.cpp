@@ -8,6 +8,7 @@
 namespace headroomctl {
 bool tryHandleEngineCommand(const QString& cmd, QStringList args, bool jsonOutput, QTextStream& out, QTextStream& err, int* exitCodeOut);
 bool tryHandleRecordStatusStop(const QString& cmd, QStringList args, bool jsonOutput, QTextStream& out, QTextStream& err, int* exitCodeOut);
+bool tryHandleRecordReplayFiles(const QString& cmd, QStringList args, bool jsonOutput, QTextStream& out, QTextStream& err, int* exitCodeOut);
 bool tryHandleGraphCommands(const QString& cmd, QStringList args, PipeWireGraph& graph, bool jsonOutput, QTextStream& out, QTextStream& err, int* exitCodeOut);
 bool tryHandlePatchbayCommand(const QString& cmd, QStringList args, PipeWireGraph& graph, bool jsonOutput, QTextStream& out, QTextStream& err, int* exitCodeOut);
 bool tryHandleSessionCommand(const QString& cmd, QStringList args, PipeWireGraph& graph, bool jsonOutput, QTextStream& out, QTextStream& err, int* exitCodeOut);
@@ -21,6 +22,15 @@ bool tryHandleRecordPipeWire(QCoreApplication& app,
                              QTextStream& out,
                              QTextStream& err,
                              int* exitCodeOut);
+bool tryHandleRecordReplayPipeWire(QCoreApplication& app,
+                                   const QString& cmd,
+                                   QStringList args,
+                                   PipeWireThread& pw,
+                                   PipeWireGraph& graph,
+                                   bool jsonOutput,
+                                   QTextStream& out,
+                                   QTextStream& err,
+                                   int* exitCodeOut);
 
 int runCommand(QCoreApplication& app, QStringList args, QTextStream& out, QTextStream& err)
 {
@@ -58,6 +68,9 @@ int runCommand(QCoreApplication& app, QStringList args, QTextStream& out, QTextS
     if (tryHandleRecordStatusStop(cmd, args, jsonOutput, out, err, &exitCode)) {
       break;
     }
+    if (tryHandleRecordReplayFiles(cmd, args, jsonOutput, out, err, &exitCode)) {
+      break;
+    }
     if (tryHandleEngineCommand(cmd, args, jsonOutput, out, err, &exitCode)) {
       break;
     }
@@ -88,6 +101,9 @@ int runCommand(QCoreApplication& app, QStringList args, QTextStream& out, QTextS
     if (tryHandleEqCommand(cmd, args, graph, jsonOutput, out, err, &exitCode)) {
       break;
     }
+    if (tryHandleRecordReplayPipeWire(app, cmd, args, pw, graph, jsonOutput, out, err, &exitCode)) {
+      break;
+    }
     if (tryHandleRecordPipeWire(app, cmd, args, pw, graph, jsonOutput, out, err, &exitCode)) {
       break;
     }
@@ -125,7 +125,8 @@ bool tryHandleEqCommand(const QString& cmd, QStringList args, PipeWireGraph& gra
             o.insert(QStringLiteral("preset"), eqPresetToJson(preset));
             out << QString::fromUtf8(QJsonDocument(o).toJson(QJsonDocument::Compact)) << "\n";
           } else {
-            out << nodeName << "\t" << (preset.enabled ? "on" : "off") << "\tpreampDb=" << preset.preampDb << "\tbands=" << preset.bands.size() << "\n";
+            out << nodeName << "\t" << (preset.enabled ? "on" : "off") << "\tpreampDb=" << preset.preampDb << "\tbands=" << preset.bands.size()
+                << "\tphase=" << (preset.linearPhase ? "linear" : "minimum") << "\n";
           }
           exitCode = 0;
           break;
@@ -4,6 +4,7 @@
 #include <QElapsedTimer>
 #include <QEventLoop>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -33,6 +34,8 @@
 #include <unistd.h>
 
 #include "backend/AudioRecorder.h"
+#include "backend/RecordingSession.h"
+#include "backend/WavFileWriter.h"
 #include "backend/AlsaSeqBridge.h"
 #include "backend/EngineControl.h"
 #include "backend/PatchbayProfiles.h"
@@ -102,19 +105,61 @@ bool tryHandleRecordStatusStop(const QString& cmd, QStringList args, bool jsonOu
       const double dur = obj->value(QStringLiteral("durationSeconds")).toDouble(0.0);
       const double peak = obj->value(QStringLiteral("peakDb")).toDouble(std::numeric_limits<double>::quiet_NaN());
       const double rms = obj->value(QStringLiteral("rmsDb")).toDouble(std::numeric_limits<double>::quiet_NaN());
+      const double lufs = obj->value(QStringLiteral("integratedLufs")).toDouble(std::numeric_limits<double>::quiet_NaN());
+      const double lra = obj->value(QStringLiteral("loudnessRangeLu")).toDouble(std::numeric_limits<double>::quiet_NaN());
+      const double tp = obj->value(QStringLiteral("truePeakDb")).toDouble(std::numeric_limits<double>::quiet_NaN());
+      const double speed = obj->value(QStringLiteral("encoderSpeed")).toDouble(0.0);
       out << (running ? "recording" : "stopped") << "\tpid=" << pid << "\tfile="
           << obj->value(QStringLiteral("filePath")).toString() << "\tfmt=" << fmt
           << "\tdur=" << QString::number(dur, 'f', 1) << "s"
           << "\tpeak=" << (std::isfinite(peak) ? QString::number(peak, 'f', 1) + "dB" : QStringLiteral("-"))
           << "\trms=" << (std::isfinite(rms) ? QString::number(rms, 'f', 1) + "dB" : QStringLiteral("-"))
+          << "\tlufs=" << (std::isfinite(lufs) && lufs > -70.0 ? QString::number(lufs, 'f', 1) + "LUFS" : QStringLiteral("-"))
+          << "\tlra=" << (std::isfinite(lra) ? QString::number(lra, 'f', 1) + "LU" : QStringLiteral("-"))
+          << "\ttp=" << (std::isfinite(tp) ? QString::number(tp, 'f', 1) + "dBTP" : QStringLiteral("-"))
           << "\tbytes=" << obj->value(QStringLiteral("bytesWritten")).toVariant().toLongLong()
-          << "\tstate=" << obj->value(QStringLiteral("streamState")).toString() << "\n";
+          << "\tdropped=" << obj->value(QStringLiteral("droppedFrames")).toVariant().toLongLong()
+          << "\tbacklog=" << QString::number(obj->value(QStringLiteral("encoderBacklogSeconds")).toDouble(0.0), 'f', 1) << "s"
+          << "\trtf=" << (speed > 0.0 ? QString::number(speed, 'f', 1) + "x" : QStringLiteral("-"))
+          << "\tstate=" << obj->value(QStringLiteral("streamState")).toString();
+      if (obj->contains(QStringLiteral("tracks"))) {
+        out << "\ttracks=" << obj->value(QStringLiteral("tracks")).toArray().size();
+      }
+      out << "\n";
     }
 
     *exitCodeOut = 0;
     return true;
   }
 
+  if (sub == QStringLiteral("repair")) {
+    if (args.size() < 4) {
+      printUsage(err);
+      *exitCodeOut = 2;
+      return true;
+    }
+    const QString path = QFileInfo(args.at(3)).absoluteFilePath();
+    uint64_t frames = 0;
+    QString repairErr;
+    if (!WavFileWriter::repair(path, &frames, &repairErr)) {
+      err << "headroomctl: " << repairErr << "\n";
+      *exitCodeOut = 1;
+      return true;
+    }
+
+    if (jsonOutput) {
+      QJsonObject o;
+      o.insert(QStringLiteral("ok"), true);
+      o.insert(QStringLiteral("filePath"), path);
+      o.insert(QStringLiteral("frames"), static_cast<qint64>(frames));
+      out << QString::fromUtf8(QJsonDocument(o).toJson(QJsonDocument::Compact)) << "\n";
+    } else {
+      out << "repaired\tfile=" << path << "\tframes=" << frames << "\n";
+    }
+    *exitCodeOut = 0;
+    return true;
+  }
+
   if (sub == QStringLiteral("stop")) {
     QString readErr;
     const auto obj = readJsonObjectFile(statusPath, &readErr);
@@ -158,6 +203,157 @@ bool tryHandleRecordStatusStop(const QString& cmd, QStringList args, bool jsonOu
   return false;
 }
 
+namespace {
+
+// Foreground loop for a multi-target recording; mirrors the single-target loop in
+// tryHandleRecordPipeWire, with one status entry per target.
+int runRecordSession(QCoreApplication& app,
+                     PipeWireThread& pw,
+                     const RecordingSession::StartOptions& options,
+                     int durationSec,
+                     bool announce,
+                     bool jsonOutput,
+                     QTextStream& out,
+                     QTextStream& err)
+{
+  RecordingSession session(&pw);
+  if (!session.start(options)) {
+    const QString e = session.lastError();
+    err << "headroomctl: record start failed" << (e.isEmpty() ? "" : ": ") << e << "\n";
+    return 1;
+  }
+
+  const QString statusPath = recordingStatusPath();
+  const qint64 pid = QCoreApplication::applicationPid();
+
+  QJsonObject state;
+  state.insert(QStringLiteral("pid"), pid);
+  state.insert(QStringLiteral("running"), true);
+  state.insert(QStringLiteral("startedAt"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+  state.insert(QStringLiteral("filePathTemplate"), options.filePath);
+  state.insert(QStringLiteral("format"), AudioRecorder::formatToString(options.format));
+  state.insert(QStringLiteral("session"), true);
+  state.insert(QStringLiteral("layout"),
+               options.layout == RecordingSession::Layout::Multichannel ? QStringLiteral("multichannel") : QStringLiteral("separate"));
+  state.insert(QStringLiteral("writerThreads"), session.writerThreads());
+  if (durationSec > 0) {
+    state.insert(QStringLiteral("durationLimitSeconds"), durationSec);
+  }
+
+  auto writeStatus = [&]() {
+    QJsonArray tracks;
+    uint64_t frames = 0;
+    uint64_t dropped = 0;
+    qint64 bytes = 0;
+    uint32_t rate = 0;
+    float peak = -100.0f;
+    double backlog = 0.0;
+    bool streaming = false;
+    for (int i = 0; i < session.trackCount(); ++i) {
+      const RecordingSession::TrackStatus t = session.trackStatus(i);
+      QJsonObject o;
+      o.insert(QStringLiteral("label"), t.label);
+      o.insert(QStringLiteral("targetObject"), t.targetObject);
+      o.insert(QStringLiteral("filePath"), t.filePath);
+      o.insert(QStringLiteral("streamState"), t.streamState);
+      o.insert(QStringLiteral("sampleRate"), static_cast<int>(t.sampleRate));
+      o.insert(QStringLiteral("channels"), static_cast<int>(t.channels));
+      o.insert(QStringLiteral("framesWritten"), static_cast<qint64>(t.framesWritten));
+      o.insert(QStringLiteral("droppedFrames"), static_cast<qint64>(t.droppedFrames));
+      o.insert(QStringLiteral("encoderBacklogSeconds"), t.backlogSeconds);
+      o.insert(QStringLiteral("peakDb"), t.peakDb);
+      o.insert(QStringLiteral("included"), t.included);
+      tracks.append(o);
+
+      if (t.framesWritten >= frames) {
+        frames = t.framesWritten;
+        rate = t.sampleRate;
+      }
+      dropped += t.droppedFrames;
+      bytes += static_cast<qint64>(t.framesWritten * t.channels * sizeof(float));
+      peak = std::max(peak, t.peakDb);
+      backlog = std::max(backlog, t.backlogSeconds);
+      streaming = streaming || t.streamState == QStringLiteral("streaming");
+    }
+    if (session.trackCount() > 0) {
+      state.insert(QStringLiteral("tracks"), tracks);
+      state.insert(QStringLiteral("filePath"), session.trackStatus(0).filePath);
+      state.insert(QStringLiteral("sampleRate"), static_cast<int>(rate));
+      state.insert(QStringLiteral("framesCaptured"), static_cast<qint64>(frames));
+      state.insert(QStringLiteral("droppedFrames"), static_cast<qint64>(dropped));
+      state.insert(QStringLiteral("encoderBacklogSeconds"), backlog);
+      state.insert(QStringLiteral("encoderSpeed"), session.encoderSpeed());
+      state.insert(QStringLiteral("bytesWritten"), bytes);
+      state.insert(QStringLiteral("durationSeconds"), rate > 0 ? static_cast<double>(frames) / static_cast<double>(rate) : 0.0);
+      state.insert(QStringLiteral("peakDb"), peak);
+      state.insert(QStringLiteral("streamState"), streaming ? QStringLiteral("streaming") : QStringLiteral("connecting"));
+      state.insert(QStringLiteral("startTimeNs"), static_cast<qint64>(session.startTimeNs()));
+    }
+    const QString le = session.lastError();
+    if (!le.isEmpty()) {
+      state.insert(QStringLiteral("lastError"), le);
+    }
+
+    QString writeErr;
+    (void)writeJsonFileAtomic(statusPath, state, &writeErr);
+  };
+
+  // Stop requests end the session; the app quits once its files are finished.
+  QObject::connect(&app, &QCoreApplication::aboutToQuit, &session, [&]() {
+    session.stop();
+    state.insert(QStringLiteral("running"), false);
+    state.insert(QStringLiteral("stoppedAt"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    writeStatus();
+  });
+  QObject::connect(&session, &RecordingSession::recordingChanged, &app, [&](bool recording) {
+    if (!recording) {
+      app.quit();
+    }
+  });
+
+  QTimer statusTimer;
+  statusTimer.setInterval(500);
+  QObject::connect(&statusTimer, &QTimer::timeout, &app, [&]() { writeStatus(); });
+  statusTimer.start();
+
+  QTimer stopTimer;
+  stopTimer.setInterval(100);
+  QObject::connect(&stopTimer, &QTimer::timeout, &app, [&]() {
+    if (g_recordStopRequested.load()) {
+      session.stop();
+    }
+  });
+  stopTimer.start();
+
+  QTimer durationTimer;
+  if (durationSec > 0) {
+    durationTimer.setSingleShot(true);
+    durationTimer.setInterval(durationSec * 1000);
+    QObject::connect(&durationTimer, &QTimer::timeout, &app, [&]() { session.stop(); });
+    durationTimer.start();
+  }
+
+  writeStatus();
+
+  if (announce) {
+    if (jsonOutput) {
+      QJsonObject o;
+      o.insert(QStringLiteral("ok"), true);
+      o.insert(QStringLiteral("pid"), pid);
+      o.insert(QStringLiteral("targets"), session.trackCount());
+      o.insert(QStringLiteral("statusPath"), statusPath);
+      out << QString::fromUtf8(QJsonDocument(o).toJson(QJsonDocument::Compact)) << "\n";
+    } else {
+      out << "recording\tpid=" << pid << "\ttargets=" << session.trackCount() << "\t(ctrl-c to stop; or headroomctl record stop)\n";
+    }
+    out.flush();
+  }
+
+  return app.exec();
+}
+
+} // namespace
+
 bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringList args, PipeWireThread& pw, PipeWireGraph& graph, bool jsonOutput, QTextStream& out, QTextStream& err, int* exitCodeOut)
 {
   bool handled = false;
@@ -240,11 +436,14 @@ bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringL
 
         const QString filePath = args.at(3).trimmed();
 
-        QString targetArg;
+        QStringList targetArgs;
         std::optional<AudioRecorder::Format> formatOpt;
         int durationSec = 0;
         bool captureSink = true;
         bool background = false;
+        bool recordAll = false;
+        bool multichannel = false;
+        AudioRecorder::EncoderOptions encoder;
 
         for (int i = 4; i < args.size(); ++i) {
           const QString a = args.at(i).trimmed();
@@ -254,10 +453,18 @@ bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringL
               exitCode = 2;
               break;
             }
-            targetArg = args.at(i + 1);
+            targetArgs << args.at(i + 1);
             ++i;
             continue;
           }
+          if (a == QStringLiteral("--all")) {
+            recordAll = true;
+            continue;
+          }
+          if (a == QStringLiteral("--multichannel")) {
+            multichannel = true;
+            continue;
+          }
           if (a == QStringLiteral("--format")) {
             if (i + 1 >= args.size()) {
               err << "headroomctl: --format requires a value\n";
@@ -266,7 +473,7 @@ bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringL
             }
             const auto f = AudioRecorder::formatFromString(args.at(i + 1));
             if (!f) {
-              err << "headroomctl: invalid --format (expected wav|flac)\n";
+              err << "headroomctl: invalid --format (expected wav|flac|opus|vorbis)\n";
               exitCode = 2;
               break;
             }
@@ -274,6 +481,30 @@ bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringL
             ++i;
             continue;
           }
+          if (a == QStringLiteral("--flac-level")) {
+            bool ok = false;
+            const int v = (i + 1 < args.size()) ? args.at(i + 1).trimmed().toInt(&ok) : -1;
+            if (!ok || v < 0 || v > AudioRecorder::kMaxFlacLevel) {
+              err << "headroomctl: invalid --flac-level (expected 0-" << AudioRecorder::kMaxFlacLevel << ")\n";
+              exitCode = 2;
+              break;
+            }
+            encoder.flacLevel = v;
+            ++i;
+            continue;
+          }
+          if (a == QStringLiteral("--quality")) {
+            bool ok = false;
+            const double v = (i + 1 < args.size()) ? args.at(i + 1).trimmed().toDouble(&ok) : -1.0;
+            if (!ok || v < 0.0 || v > 10.0) {
+              err << "headroomctl: invalid --quality (expected 0-10)\n";
+              exitCode = 2;
+              break;
+            }
+            encoder.quality = v / 10.0;
+            ++i;
+            continue;
+          }
           if (a == QStringLiteral("--duration") || a == QStringLiteral("--seconds")) {
             if (i + 1 >= args.size()) {
               err << "headroomctl: --duration requires a value\n";
@@ -311,23 +542,26 @@ bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringL
           break;
         }
 
-        auto inferFormatFromPath = [&](const QString& p) -> AudioRecorder::Format {
-          const QString lower = p.trimmed().toLower();
-          if (lower.endsWith(QStringLiteral(".flac"))) {
-            return AudioRecorder::Format::Flac;
-          }
-          return AudioRecorder::Format::Wav;
-        };
-        const AudioRecorder::Format format = formatOpt.value_or(inferFormatFromPath(filePath));
+        const AudioRecorder::Format format = formatOpt.value_or(AudioRecorder::formatFromFileName(filePath).value_or(AudioRecorder::Format::Wav));
 
         if (sub == QStringLiteral("start")) {
           if (background) {
             QStringList daemonArgs;
             daemonArgs << QStringLiteral("record") << QStringLiteral("run") << filePath;
-            if (!targetArg.trimmed().isEmpty()) {
-              daemonArgs << QStringLiteral("--target") << targetArg;
+            for (const QString& t : targetArgs) {
+              if (!t.trimmed().isEmpty()) {
+                daemonArgs << QStringLiteral("--target") << t;
+              }
+            }
+            if (recordAll) {
+              daemonArgs << QStringLiteral("--all");
+            }
+            if (multichannel) {
+              daemonArgs << QStringLiteral("--multichannel");
             }
             daemonArgs << QStringLiteral("--format") << AudioRecorder::formatToString(format);
+            daemonArgs << QStringLiteral("--flac-level") << QString::number(encoder.flacLevel);
+            daemonArgs << QStringLiteral("--quality") << QString::number(encoder.quality * 10.0);
             daemonArgs << QStringLiteral("--duration") << QString::number(durationSec);
             daemonArgs << (captureSink ? QStringLiteral("--sink") : QStringLiteral("--source"));
 
@@ -360,17 +594,26 @@ bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringL
           break;
         }
 
-        bool okId = false;
-        const uint32_t nodeId = targetArg.trimmed().toUInt(&okId);
-        QString targetObject = targetArg.trimmed();
-        if (okId) {
-          const auto n = graph.nodeById(nodeId);
-          if (!n) {
-            err << "headroomctl: unknown node id " << nodeId << "\n";
-            exitCode = 2;
-            break;
+        // A node id resolves to its name, so the recording follows the node if it is re-created.
+        auto resolveTarget = [&](const QString& arg, QString* targetObjectOut) -> bool {
+          bool okId = false;
+          const uint32_t nodeId = arg.trimmed().toUInt(&okId);
+          *targetObjectOut = arg.trimmed();
+          if (okId) {
+            const auto n = graph.nodeById(nodeId);
+            if (!n) {
+              err << "headroomctl: unknown node id " << nodeId << "\n";
+              return false;
+            }
+            *targetObjectOut = n->name;
           }
-          targetObject = n->name;
+          return true;
+        };
+
+        QString targetObject;
+        if (!resolveTarget(targetArgs.value(0), &targetObject)) {
+          exitCode = 2;
+          break;
         }
 
         const QString statusPath = recordingStatusPath();
@@ -388,6 +631,60 @@ bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringL
         std::signal(SIGINT, onRecordSignal);
         std::signal(SIGTERM, onRecordSignal);
 
+        if (recordAll || multichannel || targetArgs.size() > 1) {
+          std::vector<RecordingSession::Target> targets;
+          if (recordAll) {
+            targets.push_back({QString{}, true, QStringLiteral("system-mix")});
+            // Streams of one app usually share a node.name, so each is targeted by its serial;
+            // device names are unique and let a re-created device be found again.
+            for (const auto& n : graph.audioPlaybackStreams()) {
+              const QString appLabel = !n.appName.isEmpty() ? n.appName : n.appProcessBinary;
+              const QString target = !n.objectSerial.isEmpty() ? n.objectSerial : n.name;
+              targets.push_back({target, false, appLabel.isEmpty() ? nodeLabel(n) : appLabel});
+            }
+            for (const auto& n : graph.audioSources()) {
+              targets.push_back({n.name, false, nodeLabel(n)});
+            }
+          }
+          bool resolved = true;
+          for (const QString& arg : targetArgs) {
+            RecordingSession::Target t;
+            t.captureSink = captureSink;
+            if (!resolveTarget(arg, &t.targetObject)) {
+              resolved = false;
+              break;
+            }
+            for (const auto& n : graph.nodes()) {
+              if (n.name == t.targetObject) {
+                t.label = nodeLabel(n);
+                break;
+              }
+            }
+            targets.push_back(t);
+          }
+          if (!resolved) {
+            exitCode = 2;
+            break;
+          }
+          if (targets.empty()) {
+            targets.push_back({QString{}, captureSink, QString{}});
+          }
+          if (targets.size() > static_cast<std::size_t>(RecordingSession::kMaxTargets)) {
+            err << "headroomctl: too many record targets (max " << RecordingSession::kMaxTargets << ")\n";
+            exitCode = 2;
+            break;
+          }
+
+          RecordingSession::StartOptions sessionOpts;
+          sessionOpts.filePath = filePath;
+          sessionOpts.format = format;
+          sessionOpts.encoder = encoder;
+          sessionOpts.layout = multichannel ? RecordingSession::Layout::Multichannel : RecordingSession::Layout::SeparateFiles;
+          sessionOpts.targets = std::move(targets);
+          exitCode = runRecordSession(app, pw, sessionOpts, durationSec, sub == QStringLiteral("start"), jsonOutput, out, err);
+          break;
+        }
+
         QString targetLabel;
         if (targetObject.isEmpty()) {
           targetLabel = captureSink ? QStringLiteral("system-mix") : QStringLiteral("default-input");
@@ -409,6 +706,7 @@ bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringL
         recOpts.targetObject = targetObject;
         recOpts.captureSink = captureSink;
         recOpts.format = format;
+        recOpts.encoder = encoder;
         if (!recorder.start(recOpts)) {
           const QString e = recorder.lastError();
           err << "headroomctl: record start failed" << (e.isEmpty() ? "" : ": ") << e << "\n";
@@ -480,9 +778,25 @@ bool tryHandleRecordPipeWire(QCoreApplication& app, const QString& cmd, QStringL
           state.insert(QStringLiteral("lastBufferBytes"), static_cast<int>(recorder.lastBufferBytes()));
           state.insert(QStringLiteral("bytesWritten"), static_cast<qint64>(recorder.dataBytesWritten()));
           state.insert(QStringLiteral("framesCaptured"), static_cast<qint64>(frames));
+          state.insert(QStringLiteral("droppedFrames"), static_cast<qint64>(recorder.droppedFrames()));
+          state.insert(QStringLiteral("encoderBacklogSeconds"), recorder.backlogSeconds());
+          state.insert(QStringLiteral("encoderSpeed"), recorder.encoderSpeed());
           state.insert(QStringLiteral("durationSeconds"), dur);
           state.insert(QStringLiteral("peakDb"), recorder.peakDb());
           state.insert(QStringLiteral("rmsDb"), recorder.rmsDb());
+          QJsonArray channelPeaks;
+          QJsonArray channelRms;
+          for (uint32_t c = 0; c < std::min(recorder.channels(), AudioRecorder::kMaxChannels); ++c) {
+            channelPeaks.append(recorder.channelPeakDb(c));
+            channelRms.append(recorder.channelRmsDb(c));
+          }
+          state.insert(QStringLiteral("channelPeakDb"), channelPeaks);
+          state.insert(QStringLiteral("channelRmsDb"), channelRms);
+          state.insert(QStringLiteral("momentaryLufs"), recorder.momentaryLufs());
+          state.insert(QStringLiteral("shortTermLufs"), recorder.shortTermLufs());
+          state.insert(QStringLiteral("integratedLufs"), recorder.integratedLufs());
+          state.insert(QStringLiteral("loudnessRangeLu"), recorder.loudnessRangeLu());
+          state.insert(QStringLiteral("truePeakDb"), recorder.truePeakDb());
           state.insert(QStringLiteral("streamState"), recorder.streamStateString());
           const QString le = recorder.lastError();
           if (!le.isEmpty()) {
@@ -0,0 +1,536 @@
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <optional>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include "backend/AudioRecorder.h"
+#include "backend/PipeWireGraph.h"
+#include "backend/PipeWireThread.h"
+#include "backend/ReplayBuffer.h"
+
+#include "cli/CliInternal.h"
+
+namespace {
+
+std::atomic_bool g_replayStopRequested{false};
+std::atomic_bool g_replayDumpRequested{false};
+
+extern "C" void onReplayStopSignal(int)
+{
+  g_replayStopRequested.store(true);
+}
+
+extern "C" void onReplayDumpSignal(int)
+{
+  g_replayDumpRequested.store(true);
+}
+
+// How long `record dump` waits for the history process to pick a request up, and then for the
+// file to be written before it reports the dump as still in progress.
+constexpr int kDumpAnswerWaitMs = 5000;
+constexpr int kDumpWaitMs = 60000;
+
+QString defaultReplayPath()
+{
+  return QDir::home().filePath(QStringLiteral("headroom-{target}-{datetime}.{ext}"));
+}
+
+QString dumpRequestPath(const QString& id)
+{
+  return QDir(headroomctl::replayRequestDirPath()).filePath(id + QStringLiteral(".request.json"));
+}
+
+QString dumpStatePath(const QString& id)
+{
+  return QDir(headroomctl::replayRequestDirPath()).filePath(id + QStringLiteral(".json"));
+}
+
+} // namespace
+
+namespace headroomctl {
+
+// `record dump`, `record history status` and `record history stop` only talk to the running
+// history process through its status file and signals, so they need no PipeWire connection.
+bool tryHandleRecordReplayFiles(const QString& cmd, QStringList args, bool jsonOutput, QTextStream& out, QTextStream& err, int* exitCodeOut)
+{
+  if (cmd != QStringLiteral("record") || args.size() < 3) {
+    return false;
+  }
+  const QString sub = args.at(2).trimmed().toLower();
+  const QString action = args.size() >= 4 ? args.at(3).trimmed().toLower() : QString{};
+  const bool isDump = sub == QStringLiteral("dump");
+  const bool isStatus = sub == QStringLiteral("history") && action == QStringLiteral("status");
+  const bool isStop = sub == QStringLiteral("history") && action == QStringLiteral("stop");
+  if (!isDump && !isStatus && !isStop) {
+    return false;
+  }
+
+  const QString statusPath = replayStatusPath();
+  const auto status = readJsonObjectFile(statusPath, nullptr);
+  const qint64 pid = status ? status->value(QStringLiteral("pid")).toVariant().toLongLong() : 0;
+  const bool running = status && pidAlive(pid) && status->value(QStringLiteral("running")).toBool(true);
+
+  if (isStatus) {
+    if (jsonOutput) {
+      QJsonObject o = status.value_or(QJsonObject{});
+      o.insert(QStringLiteral("running"), running);
+      o.insert(QStringLiteral("statusPath"), statusPath);
+      out << QString::fromUtf8(QJsonDocument(o).toJson(QJsonDocument::Compact)) << "\n";
+    } else if (!running) {
+      out << "not-running\n";
+    } else {
+      const double mib = status->value(QStringLiteral("memoryBytes")).toDouble(0.0) / (1024.0 * 1024.0);
+      out << "running\tpid=" << pid
+          << "\tbuffered=" << QString::number(status->value(QStringLiteral("bufferedSeconds")).toDouble(0.0), 'f', 1) << "s/"
+          << status->value(QStringLiteral("capacitySeconds")).toInt() << "s"
+          << "\trate=" << status->value(QStringLiteral("sampleRate")).toInt()
+          << "\tch=" << status->value(QStringLiteral("channels")).toInt()
+          << "\tfmt=" << status->value(QStringLiteral("sampleFormat")).toString()
+          << "\tmem=" << QString::number(mib, 'f', 1) << "MiB"
+          << "\tdropped=" << status->value(QStringLiteral("droppedFrames")).toVariant().toLongLong()
+          << "\tstate=" << status->value(QStringLiteral("streamState")).toString() << "\n";
+    }
+    *exitCodeOut = 0;
+    return true;
+  }
+
+  if (isStop) {
+    if (running && !stopPid(pid, 2000, err)) {
+      *exitCodeOut = 1;
+      return true;
+    }
+    if (!pidAlive(pid)) {
+      QFile::remove(statusPath);
+    }
+    if (jsonOutput) {
+      QJsonObject o;
+      o.insert(QStringLiteral("ok"), true);
+      o.insert(QStringLiteral("alreadyStopped"), !running);
+      out << QString::fromUtf8(QJsonDocument(o).toJson(QJsonDocument::Compact)) << "\n";
+    } else {
+      out << (running ? "stopped" : "not-running") << "\n";
+    }
+    *exitCodeOut = 0;
+    return true;
+  }
+
+  // record dump [<seconds>] [<file|template>] [--format wav|flac|opus|vorbis]
+  double seconds = 0.0;
+  QString filePath;
+  std::optional<AudioRecorder::Format> formatOpt;
+  for (int i = 3; i < args.size(); ++i) {
+    const QString a = args.at(i).trimmed();
+    if (a == QStringLiteral("--format")) {
+      if (i + 1 >= args.size()) {
+        err << "headroomctl: --format requires a value\n";
+        *exitCodeOut = 2;
+        return true;
+      }
+      formatOpt = AudioRecorder::formatFromString(args.at(++i));
+      if (!formatOpt) {
+        err << "headroomctl: invalid --format (expected wav|flac|opus|vorbis)\n";
+        *exitCodeOut = 2;
+        return true;
+      }
+      continue;
+    }
+    bool ok = false;
+    const double v = a.toDouble(&ok);
+    if (ok && filePath.isEmpty() && seconds == 0.0) {
+      if (v < 0.0) {
+        err << "headroomctl: invalid dump length (expected seconds >= 0)\n";
+        *exitCodeOut = 2;
+        return true;
+      }
+      seconds = v;
+      continue;
+    }
+    if (!filePath.isEmpty()) {
+      err << "headroomctl: unexpected argument: " << a << "\n";
+      *exitCodeOut = 2;
+      return true;
+    }
+    filePath = a;
+  }
+
+  if (!running) {
+    err << "headroomctl: no replay history is being kept (start one with: headroomctl record history --background)\n";
+    *exitCodeOut = 1;
+    return true;
+  }
+
+  if (filePath.isEmpty()) {
+    filePath = defaultReplayPath();
+  } else if (!filePath.startsWith(QLatin1Char('~')) && QFileInfo(filePath).isRelative()) {
+    // The history process has its own working directory.
+    filePath = QDir::current().absoluteFilePath(filePath);
+  }
+  const AudioRecorder::Format format = formatOpt.value_or(AudioRecorder::formatFromFileName(filePath).value_or(AudioRecorder::Format::Wav));
+
+  const QString requestId = QStringLiteral("%1-%2").arg(QCoreApplication::applicationPid()).arg(QDateTime::currentMSecsSinceEpoch());
+  QJsonObject request;
+  request.insert(QStringLiteral("id"), requestId);
+  request.insert(QStringLiteral("seconds"), seconds);
+  request.insert(QStringLiteral("filePath"), filePath);
+  request.insert(QStringLiteral("format"), AudioRecorder::formatToString(format));
+  QString writeErr;
+  if (!writeJsonFileAtomic(dumpRequestPath(requestId), request, &writeErr)) {
+    err << "headroomctl: failed to write dump request: " << writeErr << "\n";
+    *exitCodeOut = 1;
+    return true;
+  }
+  ::kill(static_cast<pid_t>(pid), SIGUSR1);
+
+  // Every request has its own files, so concurrent dumps never read each other's answers. A dump
+  // that outlasts the wait is reported as in progress; its state file keeps being updated.
+  const QString statePath = dumpStatePath(requestId);
+  std::optional<QJsonObject> dump;
+  QElapsedTimer t;
+  t.start();
+  for (;;) {
+    QThread::msleep(50);
+    dump = readJsonObjectFile(statePath, nullptr);
+    if (dump && dump->value(QStringLiteral("finished")).toBool()) {
+      break;
+    }
+    if (!pidAlive(pid)) {
+      err << "headroomctl: replay history process exited before the dump finished\n";
+      QFile::remove(dumpRequestPath(requestId));
+      *exitCodeOut = 1;
+      return true;
+    }
+    if (!dump && t.elapsed() >= kDumpAnswerWaitMs) {
+      err << "headroomctl: replay history process did not answer the dump request\n";
+      QFile::remove(dumpRequestPath(requestId));
+      *exitCodeOut = 1;
+      return true;
+    }
+    if (dump && t.elapsed() >= kDumpWaitMs) {
+      break;
+    }
+  }
+
+  const bool finished = dump->value(QStringLiteral("finished")).toBool();
+  const bool ok = !finished || dump->value(QStringLiteral("ok")).toBool();
+  if (finished) {
+    QFile::remove(statePath);
+  } else {
+    dump->insert(QStringLiteral("statePath"), statePath);
+  }
+  if (jsonOutput) {
+    out << QString::fromUtf8(QJsonDocument(*dump).toJson(QJsonDocument::Compact)) << "\n";
+  } else if (!finished) {
+    out << dump->value(QStringLiteral("state")).toString() << "\t" << dump->value(QStringLiteral("filePath")).toString(filePath)
+        << "\t(still in progress; see " << statePath << ")\n";
+  } else if (ok) {
+    out << "saved\t" << QString::number(dump->value(QStringLiteral("durationSeconds")).toDouble(), 'f', 1) << "s\t"
+        << dump->value(QStringLiteral("filePath")).toString() << "\n";
+  } else {
+    err << "headroomctl: dump failed: " << dump->value(QStringLiteral("error")).toString() << "\n";
+  }
+  *exitCodeOut = ok ? 0 : 1;
+  return true;
+}
+
+bool tryHandleRecordReplayPipeWire(QCoreApplication& app,
+                                   const QString& cmd,
+                                   QStringList args,
+                                   PipeWireThread& pw,
+                                   PipeWireGraph& graph,
+                                   bool jsonOutput,
+                                   QTextStream& out,
+                                   QTextStream& err,
+                                   int* exitCodeOut)
+{
+  if (cmd != QStringLiteral("record") || args.size() < 3 || args.at(2).trimmed().toLower() != QStringLiteral("history")) {
+    return false;
+  }
+
+  int first = 3;
+  bool daemon = false;
+  if (args.size() > 3) {
+    const QString action = args.at(3).trimmed().toLower();
+    if (action == QStringLiteral("start") || action == QStringLiteral("run")) {
+      daemon = action == QStringLiteral("run");
+      first = 4;
+    }
+  }
+
+  ReplayBuffer::StartOptions options;
+  bool background = false;
+  QString targetArg;
+  for (int i = first; i < args.size(); ++i) {
+    const QString a = args.at(i).trimmed();
+    const bool takesValue = a == QStringLiteral("--minutes") || a == QStringLiteral("--seconds") || a == QStringLiteral("--bits")
+        || a == QStringLiteral("--target");
+    if (takesValue && i + 1 >= args.size()) {
+      err << "headroomctl: " << a << " requires a value\n";
+      *exitCodeOut = 2;
+      return true;
+    }
+    if (a == QStringLiteral("--minutes") || a == QStringLiteral("--seconds")) {
+      bool ok = false;
+      const double v = args.at(++i).trimmed().toDouble(&ok);
+      const int secs = static_cast<int>(a == QStringLiteral("--minutes") ? v * 60.0 : v);
+      if (!ok || secs < 1 || secs > ReplayBuffer::kMaxSeconds) {
+        err << "headroomctl: invalid history length (1 s to " << ReplayBuffer::kMaxSeconds / 60 << " min)\n";
+        *exitCodeOut = 2;
+        return true;
+      }
+      options.seconds = secs;
+    } else if (a == QStringLiteral("--bits")) {
+      const QString v = args.at(++i).trimmed();
+      if (v != QStringLiteral("16") && v != QStringLiteral("24")) {
+        err << "headroomctl: invalid --bits (expected 16|24)\n";
+        *exitCodeOut = 2;
+        return true;
+      }
+      options.sampleFormat = v == QStringLiteral("16") ? ReplayBuffer::SampleFormat::Pcm16 : ReplayBuffer::SampleFormat::Pcm24;
+    } else if (a == QStringLiteral("--target")) {
+      targetArg = args.at(++i).trimmed();
+    } else if (a == QStringLiteral("--sink")) {
+      options.captureSink = true;
+    } else if (a == QStringLiteral("--source")) {
+      options.captureSink = false;
+    } else if (a == QStringLiteral("--background") || a == QStringLiteral("--daemon")) {
+      background = true;
+    } else {
+      err << "headroomctl: unknown record history option: " << a << "\n";
+      *exitCodeOut = 2;
+      return true;
+    }
+  }
+
+  const QString statusPath = replayStatusPath();
+  if (const auto existing = readJsonObjectFile(statusPath, nullptr)) {
+    const qint64 pid = existing->value(QStringLiteral("pid")).toVariant().toLongLong();
+    if (pidAlive(pid) && existing->value(QStringLiteral("running")).toBool(true)) {
+      err << "headroomctl: replay history already running (pid " << pid << ")\n";
+      *exitCodeOut = 1;
+      return true;
+    }
+  }
+
+  if (background && !daemon) {
+    QStringList daemonArgs;
+    daemonArgs << QStringLiteral("record") << QStringLiteral("history") << QStringLiteral("run");
+    daemonArgs << QStringLiteral("--seconds") << QString::number(options.seconds);
+    daemonArgs << QStringLiteral("--bits") << (options.sampleFormat == ReplayBuffer::SampleFormat::Pcm16 ? QStringLiteral("16") : QStringLiteral("24"));
+    if (!targetArg.isEmpty()) {
+      daemonArgs << QStringLiteral("--target") << targetArg;
+    }
+    daemonArgs << (options.captureSink ? QStringLiteral("--sink") : QStringLiteral("--source"));
+
+    qint64 pid = 0;
+    if (!QProcess::startDetached(QCoreApplication::applicationFilePath(), daemonArgs, QString{}, &pid)) {
+      err << "headroomctl: failed to start detached replay history\n";
+      *exitCodeOut = 1;
+      return true;
+    }
+    if (jsonOutput) {
+      QJsonObject o;
+      o.insert(QStringLiteral("ok"), true);
+      o.insert(QStringLiteral("pid"), pid);
+      o.insert(QStringLiteral("statusPath"), statusPath);
+      out << QString::fromUtf8(QJsonDocument(o).toJson(QJsonDocument::Compact)) << "\n";
+    } else {
+      out << "started\tpid=" << pid << "\n";
+    }
+    *exitCodeOut = 0;
+    return true;
+  }
+
+  if (!targetArg.isEmpty()) {
+    bool okId = false;
+    const uint32_t nodeId = targetArg.toUInt(&okId);
+    options.targetObject = targetArg;
+    if (okId) {
+      const auto n = graph.nodeById(nodeId);
+      if (!n) {
+        err << "headroomctl: unknown node id " << nodeId << "\n";
+        *exitCodeOut = 2;
+        return true;
+      }
+      options.targetObject = n->name;
+    }
+  }
+
+  g_replayStopRequested.store(false);
+  g_replayDumpRequested.store(false);
+  std::signal(SIGINT, onReplayStopSignal);
+  std::signal(SIGTERM, onReplayStopSignal);
+  std::signal(SIGUSR1, onReplayDumpSignal);
+
+  ReplayBuffer buffer(&pw);
+  if (!buffer.start(options)) {
+    const QString e = buffer.lastError();
+    err << "headroomctl: record history failed" << (e.isEmpty() ? "" : ": ") << e << "\n";
+    *exitCodeOut = 1;
+    return true;
+  }
+
+  const qint64 pid = QCoreApplication::applicationPid();
+  QJsonObject state;
+  state.insert(QStringLiteral("pid"), pid);
+  state.insert(QStringLiteral("running"), true);
+  state.insert(QStringLiteral("startedAt"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+  state.insert(QStringLiteral("targetObject"), options.targetObject);
+  state.insert(QStringLiteral("captureSink"), options.captureSink);
+  state.insert(QStringLiteral("sampleFormat"), ReplayBuffer::sampleFormatToString(options.sampleFormat));
+
+  auto writeStatus = [&]() {
+    // Lowered once the format is known if the history would not fit in memory.
+    state.insert(QStringLiteral("capacitySeconds"), buffer.capacitySeconds());
+    state.insert(QStringLiteral("sampleRate"), static_cast<int>(buffer.sampleRate()));
+    state.insert(QStringLiteral("channels"), static_cast<int>(buffer.channels()));
+    state.insert(QStringLiteral("bufferedSeconds"), buffer.bufferedSeconds());
+    state.insert(QStringLiteral("memoryBytes"), static_cast<qint64>(buffer.memoryBytes()));
+    state.insert(QStringLiteral("droppedFrames"), static_cast<qint64>(buffer.droppedFrames()));
+    state.insert(QStringLiteral("streamState"), buffer.streamStateString());
+    const QString le = buffer.lastError();
+    if (!le.isEmpty()) {
+      state.insert(QStringLiteral("lastError"), le);
+    }
+    QString writeErr;
+    (void)writeJsonFileAtomic(statusPath, state, &writeErr);
+  };
+
+  // Dump requests are served oldest first, one at a time; each is answered in its own state file,
+  // which is also mirrored as "lastDump" in the status. Files left by an earlier process are stale.
+  const QDir requestDir(replayRequestDirPath());
+  for (const QString& stale : requestDir.entryList({QStringLiteral("*.json")}, QDir::Files)) {
+    QFile::remove(requestDir.filePath(stale));
+  }
+  const QString requestSuffix = QStringLiteral(".request.json");
+  QString dumpId; // the request being written; empty while idle
+  QJsonObject dump;
+
+  auto writeDumpState = [&](const QString& id, const QJsonObject& o) {
+    QString writeErr;
+    (void)writeJsonFileAtomic(dumpStatePath(id), o, &writeErr);
+    state.insert(QStringLiteral("lastDump"), o);
+  };
+
+  auto serveDumpRequests = [&]() {
+    const QFileInfoList requests = requestDir.entryInfoList({QStringLiteral("*") + requestSuffix}, QDir::Files, QDir::Time | QDir::Reversed);
+    for (const QFileInfo& fi : requests) {
+      const QString id = fi.fileName().chopped(requestSuffix.size());
+      if (!dumpId.isEmpty()) {
+        if (!QFile::exists(dumpStatePath(id))) {
+          QJsonObject queued;
+          queued.insert(QStringLiteral("id"), id);
+          queued.insert(QStringLiteral("state"), QStringLiteral("queued"));
+          queued.insert(QStringLiteral("finished"), false);
+          QString writeErr;
+          (void)writeJsonFileAtomic(dumpStatePath(id), queued, &writeErr);
+        }
+        continue;
+      }
+
+      const auto request = readJsonObjectFile(fi.filePath(), nullptr);
+      QFile::remove(fi.filePath());
+      if (!request) {
+        continue;
+      }
+      const double seconds = request->value(QStringLiteral("seconds")).toDouble(0.0);
+      const auto format = AudioRecorder::formatFromString(request->value(QStringLiteral("format")).toString()).value_or(AudioRecorder::Format::Wav);
+
+      QJsonObject o;
+      o.insert(QStringLiteral("id"), id);
+      o.insert(QStringLiteral("requestedAt"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+      const double held = buffer.bufferedSeconds();
+      o.insert(QStringLiteral("durationSeconds"), seconds > 0.0 ? std::min(seconds, held) : held);
+
+      const QString path = buffer.dump(request->value(QStringLiteral("filePath")).toString(), format, seconds);
+      if (path.isEmpty()) {
+        o.insert(QStringLiteral("state"), QStringLiteral("finished"));
+        o.insert(QStringLiteral("finished"), true);
+        o.insert(QStringLiteral("ok"), false);
+        o.insert(QStringLiteral("error"), buffer.lastError());
+      } else {
+        o.insert(QStringLiteral("filePath"), path);
+        o.insert(QStringLiteral("state"), QStringLiteral("saving"));
+        o.insert(QStringLiteral("finished"), false);
+        dumpId = id;
+        dump = o;
+      }
+      writeDumpState(id, o);
+    }
+    writeStatus();
+  };
+
+  QObject::connect(&buffer, &ReplayBuffer::dumpFinished, &app, [&](const QString& path, bool ok, const QString& error) {
+    dump.insert(QStringLiteral("filePath"), path);
+    dump.insert(QStringLiteral("state"), QStringLiteral("finished"));
+    dump.insert(QStringLiteral("finished"), true);
+    dump.insert(QStringLiteral("ok"), ok);
+    if (!ok) {
+      dump.insert(QStringLiteral("error"), error);
+    }
+    writeDumpState(dumpId, dump);
+    dumpId.clear();
+    serveDumpRequests();
+  });
+
+  QObject::connect(&app, &QCoreApplication::aboutToQuit, &buffer, [&]() {
+    buffer.stop();
+    state.insert(QStringLiteral("running"), false);
+    state.insert(QStringLiteral("stoppedAt"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    writeStatus();
+  });
+
+  QTimer statusTimer;
+  statusTimer.setInterval(1000);
+  QObject::connect(&statusTimer, &QTimer::timeout, &app, [&]() { writeStatus(); });
+  statusTimer.start();
+
+  QTimer signalTimer;
+  signalTimer.setInterval(50);
+  QObject::connect(&signalTimer, &QTimer::timeout, &app, [&]() {
+    if (g_replayStopRequested.load()) {
+      app.quit();
+      return;
+    }
+    if (g_replayDumpRequested.exchange(false)) {
+      serveDumpRequests();
+    }
+  });
+  signalTimer.start();
+
+  writeStatus();
+
+  if (!daemon) {
+    if (jsonOutput) {
+      QJsonObject o;
+      o.insert(QStringLiteral("ok"), true);
+      o.insert(QStringLiteral("pid"), pid);
+      o.insert(QStringLiteral("statusPath"), statusPath);
+      out << QString::fromUtf8(QJsonDocument(o).toJson(QJsonDocument::Compact)) << "\n";
+    } else {
+      out << "keeping history\tpid=" << pid << "\tseconds=" << options.seconds << "\t(ctrl-c to stop; save with headroomctl record dump)\n";
+    }
+    out.flush();
+  }
+
+  *exitCodeOut = app.exec();
+  return true;
+}
+
+} // namespace headroomctl
@@ -25,6 +25,8 @@ QString nodeLabel(const PwNodeInfo& n);
 
 QString runtimeDirPath();
 QString recordingStatusPath();
+QString replayStatusPath();
+QString replayRequestDirPath();
 
 bool writeJsonFileAtomic(const QString& path, const QJsonObject& obj, QString* errorOut);
 std::optional<QJsonObject> readJsonObjectFile(const QString& path, QString* errorOut);
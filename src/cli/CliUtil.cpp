@@ -77,9 +77,13 @@ void printUsage(QTextStream& out)
          "  headroomctl eq preset <node-id|node-name> <preset-name>\n"
          "  headroomctl eq presets\n"
          "  headroomctl record targets\n"
-         "  headroomctl record start <file|template> [--format wav|flac] [--duration <sec>] [--target <node-id|node-name>] [--sink|--source] [--background]\n"
+         "  headroomctl record start <file|template> [--format wav|flac|opus|vorbis] [--flac-level 0-8] [--quality 0-10] [--duration <sec>] [--target <node-id|node-name>]... [--all] [--multichannel] [--sink|--source] [--background]\n"
          "  headroomctl record stop\n"
          "  headroomctl record status\n"
+         "  headroomctl record repair <file.wav>\n"
+         "  headroomctl record history [--minutes <n>|--seconds <n>] [--bits 16|24] [--target <node-id|node-name>] [--sink|--source] [--background]\n"
+         "  headroomctl record history status|stop\n"
+         "  headroomctl record dump [<seconds>] [<file|template>] [--format wav|flac|opus|vorbis]\n"
          "  headroomctl engine status\n"
          "  headroomctl engine start <pipewire|wireplumber|pipewire-pulse|unit|all>\n"
          "  headroomctl engine stop <pipewire|wireplumber|pipewire-pulse|unit|all>\n"
@@ -165,6 +169,23 @@ QString recordingStatusPath()
   return d.filePath(QStringLiteral("headroom/recording.json"));
 }
 
+QString replayStatusPath()
+{
+  const QString base = runtimeDirPath();
+  QDir d(base);
+  d.mkpath(QStringLiteral("headroom"));
+  return d.filePath(QStringLiteral("headroom/replay.json"));
+}
+
+// `record dump` requests queue here as <id>.request.json; the history process answers each in <id>.json.
+QString replayRequestDirPath()
+{
+  const QString base = runtimeDirPath();
+  QDir d(base);
+  d.mkpath(QStringLiteral("headroom/replay-requests"));
+  return d.filePath(QStringLiteral("headroom/replay-requests"));
+}
+
 bool writeJsonFileAtomic(const QString& path, const QJsonObject& obj, QString* errorOut)
 {
   QSaveFile f(path);
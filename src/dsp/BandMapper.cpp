@@ -0,0 +1,173 @@
+#include "BandMapper.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dsp {
+
+namespace {
+
+float hzToMel(float hz)
+{
+  return 2595.0f * std::log10(1.0f + hz / 700.0f);
+}
+
+float melToHz(float mel)
+{
+  return 700.0f * (std::pow(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+// Bins whose [k-1/2, k+1/2] span overlaps [loHz, hiHz], weighted by the overlapping fraction.
+void rectangularWeights(float loHz, float hiHz, float binHz, std::size_t bins, std::vector<BandMapper::Entry>& out)
+{
+  const long first = std::max(0L, static_cast<long>(std::floor(loHz / binHz + 0.5f)));
+  const long last = std::min(static_cast<long>(bins) - 1L, static_cast<long>(std::ceil(hiHz / binHz - 0.5f)));
+  for (long k = first; k <= last; ++k) {
+    const float kLo = (static_cast<float>(k) - 0.5f) * binHz;
+    const float kHi = (static_cast<float>(k) + 0.5f) * binHz;
+    const float overlap = std::min(hiHz, kHi) - std::max(loHz, kLo);
+    if (overlap > 0.0f) {
+      out.push_back({static_cast<uint32_t>(k), overlap / binHz});
+    }
+  }
+}
+
+// Mel-style triangle rising from loHz to centerHz and falling to hiHz.
+void triangularWeights(float loHz, float centerHz, float hiHz, float binHz, std::size_t bins, std::vector<BandMapper::Entry>& out)
+{
+  const long first = std::max(0L, static_cast<long>(std::ceil(loHz / binHz)));
+  const long last = std::min(static_cast<long>(bins) - 1L, static_cast<long>(std::floor(hiHz / binHz)));
+  for (long k = first; k <= last; ++k) {
+    const float f = static_cast<float>(k) * binHz;
+    const float w = f <= centerHz ? (f - loHz) / std::max(1.0e-6f, centerHz - loHz) : (hiHz - f) / std::max(1.0e-6f, hiHz - centerHz);
+    if (w > 0.0f) {
+      out.push_back({static_cast<uint32_t>(k), w});
+    }
+  }
+}
+
+} // namespace
+
+void BandMapper::reset(BandScale scale, BandPooling pooling, std::size_t fftSize, uint32_t sampleRate, std::size_t bandCount, float minHz, float maxHz)
+{
+  m_scale = scale;
+  m_pooling = pooling;
+  m_bandStart.assign(1, 0U);
+  m_bins.clear();
+  m_weights.clear();
+  m_centers.clear();
+
+  const std::size_t bins = fftSize / 2U;
+  if (bins < 2 || sampleRate == 0) {
+    return;
+  }
+
+  const float binHz = static_cast<float>(sampleRate) / static_cast<float>(fftSize);
+  const float nyquist = static_cast<float>(sampleRate) * 0.5f;
+  const float hi = std::clamp(maxHz, binHz * 2.0f, nyquist);
+  const float lo = std::clamp(minHz, 1.0f, hi * 0.5f);
+  const std::size_t count = std::clamp<std::size_t>(bandCount, 1U, bins);
+
+  std::vector<Entry> entries;
+  auto emitRect = [&](float bandLo, float bandHi, float center) {
+    entries.clear();
+    rectangularWeights(bandLo, bandHi, binHz, bins, entries);
+    if (entries.empty()) {
+      entries.push_back({static_cast<uint32_t>(std::min<float>(std::lround(center / binHz), static_cast<float>(bins - 1))), 1.0f});
+    }
+    addBand(center, entries);
+  };
+
+  switch (scale) {
+    case BandScale::Linear:
+      for (std::size_t i = 0; i < count; ++i) {
+        const float a = lo + (hi - lo) * static_cast<float>(i) / static_cast<float>(count);
+        const float b = lo + (hi - lo) * static_cast<float>(i + 1) / static_cast<float>(count);
+        emitRect(a, b, 0.5f * (a + b));
+      }
+      break;
+    case BandScale::Log: {
+      const float ratio = hi / lo;
+      for (std::size_t i = 0; i < count; ++i) {
+        const float a = lo * std::pow(ratio, static_cast<float>(i) / static_cast<float>(count));
+        const float b = lo * std::pow(ratio, static_cast<float>(i + 1) / static_cast<float>(count));
+        emitRect(a, b, std::sqrt(a * b));
+      }
+      break;
+    }
+    case BandScale::ThirdOctave:
+    case BandScale::SixthOctave: {
+      // Base-2 fractional octaves centred on 1 kHz (IEC 61260 style).
+      const float fraction = scale == BandScale::ThirdOctave ? 3.0f : 6.0f;
+      // Every band that overlaps [lo, hi] is kept, so 20 Hz..20 kHz includes both nominal end bands.
+      const float halfBand = std::pow(2.0f, 0.5f / fraction);
+      const int kFirst = static_cast<int>(std::ceil(fraction * std::log2(lo / halfBand / 1000.0f)));
+      const int kLast = static_cast<int>(std::floor(fraction * std::log2(std::min(hi * halfBand, nyquist) / 1000.0f)));
+      for (int k = kFirst; k <= kLast; ++k) {
+        const float center = 1000.0f * std::pow(2.0f, static_cast<float>(k) / fraction);
+        emitRect(center / halfBand, std::min(center * halfBand, nyquist), center);
+      }
+      break;
+    }
+    case BandScale::Mel: {
+      const float melLo = hzToMel(lo);
+      const float melHi = hzToMel(hi);
+      auto edge = [&](std::size_t i) { return melToHz(melLo + (melHi - melLo) * static_cast<float>(i) / static_cast<float>(count + 1)); };
+      for (std::size_t i = 0; i < count; ++i) {
+        const float a = edge(i);
+        const float c = edge(i + 1);
+        const float b = edge(i + 2);
+        entries.clear();
+        triangularWeights(a, c, b, binHz, bins, entries);
+        if (entries.empty()) {
+          entries.push_back({static_cast<uint32_t>(std::min<float>(std::lround(c / binHz), static_cast<float>(bins - 1))), 1.0f});
+        }
+        addBand(c, entries);
+      }
+      break;
+    }
+  }
+}
+
+void BandMapper::addBand(float centerHz, const std::vector<Entry>& entries)
+{
+  float sum = 0.0f;
+  float peak = 0.0f;
+  for (const Entry& e : entries) {
+    sum += e.weight;
+    peak = std::max(peak, e.weight);
+  }
+  const float norm = m_pooling == BandPooling::Rms ? 1.0f / std::max(sum, 1.0e-12f) : 1.0f / std::max(peak, 1.0e-12f);
+  for (const Entry& e : entries) {
+    m_bins.push_back(e.bin);
+    m_weights.push_back(e.weight * norm);
+  }
+  m_bandStart.push_back(static_cast<uint32_t>(m_bins.size()));
+  m_centers.push_back(centerHz);
+}
+
+void BandMapper::apply(const float* power, float* bandsOut) const
+{
+  const std::size_t bands = m_centers.size();
+  const uint32_t* bin = m_bins.data();
+  const float* weight = m_weights.data();
+  if (m_pooling == BandPooling::Max) {
+    for (std::size_t b = 0; b < bands; ++b) {
+      float acc = 0.0f;
+      for (uint32_t i = m_bandStart[b]; i < m_bandStart[b + 1]; ++i) {
+        acc = std::max(acc, weight[i] * power[bin[i]]);
+      }
+      bandsOut[b] = acc;
+    }
+  } else {
+    for (std::size_t b = 0; b < bands; ++b) {
+      float acc = 0.0f;
+      for (uint32_t i = m_bandStart[b]; i < m_bandStart[b + 1]; ++i) {
+        acc += weight[i] * power[bin[i]];
+      }
+      bandsOut[b] = acc;
+    }
+  }
+}
+
+} // namespace dsp
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dsp {
+
+enum class BandScale {
+  Linear,
+  Log,
+  Mel,
+  ThirdOctave,
+  SixthOctave,
+};
+
+enum class BandPooling {
+  Max, // loudest bin in the band (peak-style display)
+  Rms, // weighted mean power (energy-style display)
+};
+
+// Aggregates linear FFT power bins into a small number of display bands.
+//
+// reset() builds a sparse weight table (a few bins per band, contiguous per band) once for a
+// given FFT size/sample rate/scale; apply() is then a single pass over that table per frame and
+// never allocates. Linear/log/octave bands use rectangular weights with fractional edge bins,
+// mel bands use the usual overlapping triangles. Bands narrower than one bin fall back to the
+// bin(s) they overlap, so low bands never come out empty.
+class BandMapper final
+{
+public:
+  BandMapper() = default;
+
+  // bandCount is only used by Linear/Log/Mel; octave scales derive it from [minHz, maxHz].
+  void reset(BandScale scale, BandPooling pooling, std::size_t fftSize, uint32_t sampleRate, std::size_t bandCount, float minHz = 20.0f, float maxHz = 20000.0f);
+
+  std::size_t bandCount() const { return m_centers.size(); }
+  BandScale scale() const { return m_scale; }
+  BandPooling pooling() const { return m_pooling; }
+
+  // Band centre frequencies in Hz.
+  const std::vector<float>& centers() const { return m_centers; }
+
+  // power: fftSize/2 bins of |X|^2; bandsOut: bandCount() pooled powers.
+  void apply(const float* power, float* bandsOut) const;
+
+  // One (bin, weight) pair of the sparse table.
+  struct Entry final {
+    uint32_t bin = 0;
+    float weight = 0.0f;
+  };
+
+private:
+  void addBand(float centerHz, const std::vector<Entry>& entries);
+
+  BandScale m_scale = BandScale::Log;
+  BandPooling m_pooling = BandPooling::Max;
+  std::vector<uint32_t> m_bandStart; // bandCount()+1 offsets into m_bins/m_weights
+  std::vector<uint32_t> m_bins;
+  std::vector<float> m_weights; // Rms: sums to 1 per band; Max: peaks at 1 per band
+  std::vector<float> m_centers;
+};
+
+} // namespace dsp
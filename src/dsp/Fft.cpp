@@ -1,5 +1,7 @@
 #include "Fft.h"
 
+#include "SimdKernels.h"
+
 #include <cmath>
 
 namespace dsp {
@@ -23,61 +25,173 @@ std::vector<float> Fft::hannWindow(std::size_t n)
   return w;
 }
 
-static std::size_t reverseBits(std::size_t x, int bits)
+static std::vector<uint32_t> bitReversalTable(std::size_t n)
 {
-  std::size_t y = 0;
-  for (int i = 0; i < bits; ++i) {
-    y = (y << 1U) | (x & 1U);
-    x >>= 1U;
+  int bits = 0;
+  for (std::size_t tmp = n; tmp > 1; tmp >>= 1U) {
+    ++bits;
+  }
+
+  std::vector<uint32_t> table(n, 0U);
+  for (std::size_t i = 0; i < n; ++i) {
+    std::size_t x = i;
+    std::size_t y = 0;
+    for (int b = 0; b < bits; ++b) {
+      y = (y << 1U) | (x & 1U);
+      x >>= 1U;
+    }
+    table[i] = static_cast<uint32_t>(y);
   }
-  return y;
+  return table;
 }
 
-void Fft::forward(std::vector<std::complex<float>>& data)
+void FftPlan::reset(std::size_t n)
 {
-  const std::size_t n = data.size();
-  if (!isPowerOfTwo(n) || n < 2) {
+  if (n == m_size) {
+    return;
+  }
+  if (!Fft::isPowerOfTwo(n) || n < 4) {
+    m_size = 0;
+    m_bitrev.clear();
+    m_bitrevHalf.clear();
+    m_twiddles.clear();
+    m_stageTwiddles.clear();
     return;
   }
 
-  int bits = 0;
-  for (std::size_t tmp = n; tmp > 1; tmp >>= 1U) {
-    ++bits;
+  m_size = n;
+  m_bitrev = bitReversalTable(n);
+  m_bitrevHalf = bitReversalTable(n / 2U);
+
+  constexpr double twoPi = 6.283185307179586476925286766559;
+  m_twiddles.resize(n / 2U);
+  for (std::size_t k = 0; k < n / 2U; ++k) {
+    const double ang = -twoPi * static_cast<double>(k) / static_cast<double>(n);
+    m_twiddles[k] = std::complex<float>(static_cast<float>(std::cos(ang)), static_cast<float>(std::sin(ang)));
+  }
+
+  // Stage len needs exp(-2*pi*i*j/len) == m_twiddles[j * (n / len)] for j < len/2; store each stage
+  // contiguously so the SIMD butterflies can stream them.
+  m_stageTwiddles.resize(n - 2U);
+  for (std::size_t len = 4; len <= n; len <<= 1U) {
+    const std::size_t half = len / 2U;
+    const std::size_t step = n / len;
+    for (std::size_t j = 0; j < half; ++j) {
+      m_stageTwiddles[half - 2U + j] = m_twiddles[j * step];
+    }
   }
+}
 
+void FftPlan::transform(std::complex<float>* data, std::size_t n, const std::vector<uint32_t>& bitrev) const
+{
   for (std::size_t i = 0; i < n; ++i) {
-    const std::size_t j = reverseBits(i, bits);
+    const std::size_t j = bitrev[i];
     if (j > i) {
       std::swap(data[i], data[j]);
     }
   }
 
-  constexpr float pi = 3.14159265358979323846f;
-  for (std::size_t len = 2; len <= n; len <<= 1U) {
-    const float ang = -2.0f * pi / static_cast<float>(len);
-    const std::complex<float> wlen(std::cos(ang), std::sin(ang));
-
-    for (std::size_t i = 0; i < n; i += len) {
-      std::complex<float> w(1.0f, 0.0f);
-      for (std::size_t j = 0; j < len / 2; ++j) {
-        const std::complex<float> u = data[i + j];
-        const std::complex<float> v = data[i + j + len / 2] * w;
-        data[i + j] = u + v;
-        data[i + j + len / 2] = u - v;
-        w *= wlen;
-      }
-    }
+  // First stage has unit twiddles.
+  for (std::size_t i = 0; i < n; i += 2U) {
+    const std::complex<float> u = data[i];
+    const std::complex<float> v = data[i + 1U];
+    data[i] = u + v;
+    data[i + 1U] = u - v;
+  }
+
+  for (std::size_t len = 4; len <= n; len <<= 1U) {
+    simd::radix2Stage(data, n, len / 2U, m_stageTwiddles.data() + (len / 2U - 2U));
   }
 }
 
+void FftPlan::forward(std::complex<float>* data) const
+{
+  if (!isValid() || !data) {
+    return;
+  }
+  transform(data, m_size, m_bitrev);
+}
+
+void FftPlan::inverse(std::complex<float>* data) const
+{
+  if (!isValid() || !data) {
+    return;
+  }
+  // ifft(x) == conj(fft(conj(x))), which reuses the forward twiddles and SIMD stages.
+  for (std::size_t i = 0; i < m_size; ++i) {
+    data[i] = std::conj(data[i]);
+  }
+  transform(data, m_size, m_bitrev);
+  for (std::size_t i = 0; i < m_size; ++i) {
+    data[i] = std::conj(data[i]);
+  }
+}
+
+void FftPlan::forwardReal(const float* in, std::complex<float>* out) const
+{
+  if (!isValid() || !in || !out) {
+    return;
+  }
+
+  // Pack even/odd samples as re/im of a half-size complex sequence.
+  const std::size_t m = m_size / 2U;
+  for (std::size_t k = 0; k < m; ++k) {
+    out[k] = std::complex<float>(in[2U * k], in[2U * k + 1U]);
+  }
+  transform(out, m, m_bitrevHalf);
+
+  // Split: X[k] = E[k] + W^k O[k], with E/O the spectra of the even/odd samples.
+  const std::complex<float> z0 = out[0];
+  out[0] = std::complex<float>(z0.real() + z0.imag(), 0.0f);
+  out[m] = std::complex<float>(z0.real() - z0.imag(), 0.0f);
+
+  const std::complex<float> minusHalfI(0.0f, -0.5f);
+  for (std::size_t k = 1; k <= m / 2U; ++k) {
+    const std::complex<float> zk = out[k];
+    const std::complex<float> zmk = std::conj(out[m - k]);
+    const std::complex<float> e = 0.5f * (zk + zmk);
+    const std::complex<float> o = minusHalfI * (zk - zmk);
+    out[k] = e + m_twiddles[k] * o;
+    out[m - k] = std::conj(e) + m_twiddles[m - k] * std::conj(o);
+  }
+}
+
+void Fft::forward(std::vector<std::complex<float>>& data)
+{
+  const std::size_t n = data.size();
+  if (!isPowerOfTwo(n) || n < 2) {
+    return;
+  }
+  if (n == 2) {
+    const std::complex<float> u = data[0];
+    data[0] = u + data[1];
+    data[1] = u - data[1];
+    return;
+  }
+
+  const FftPlan plan(n);
+  plan.forward(data.data());
+}
+
 std::vector<std::complex<float>> Fft::forwardReal(const std::vector<float>& input)
 {
-  std::vector<std::complex<float>> data;
-  data.reserve(input.size());
-  for (float v : input) {
-    data.emplace_back(v, 0.0f);
+  const std::size_t n = input.size();
+  if (!isPowerOfTwo(n) || n < 4) {
+    std::vector<std::complex<float>> data;
+    data.reserve(n);
+    for (float v : input) {
+      data.emplace_back(v, 0.0f);
+    }
+    forward(data);
+    return data;
+  }
+
+  const FftPlan plan(n);
+  std::vector<std::complex<float>> data(n);
+  plan.forwardReal(input.data(), data.data());
+  for (std::size_t k = 1; k < n / 2U; ++k) {
+    data[n - k] = std::conj(data[k]);
   }
-  forward(data);
   return data;
 }
 
@@ -2,17 +2,55 @@
 
 #include <complex>
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 
 namespace dsp {
 
+// Precomputed radix-2 FFT for one power-of-two size.
+//
+// All tables (bit-reversal permutations and twiddles) are built once in reset(); the transforms
+// run in place on caller-owned buffers and never allocate, so a plan can be reused from an
+// analysis loop indefinitely. Butterfly stages go through dsp::simd (SSE2/AVX2 when available).
+class FftPlan final
+{
+public:
+  FftPlan() = default;
+  explicit FftPlan(std::size_t n) { reset(n); }
+
+  // Rebuilds the tables for an n-point transform (n must be a power of two >= 4).
+  void reset(std::size_t n);
+
+  std::size_t size() const { return m_size; }
+  bool isValid() const { return m_size >= 4; }
+
+  // In-place forward complex FFT of size() points (no scaling).
+  void forward(std::complex<float>* data) const;
+
+  // In-place inverse complex FFT of size() points, also unscaled: inverse(forward(x)) == size() * x.
+  void inverse(std::complex<float>* data) const;
+
+  // Forward FFT of size() real samples, computed as a size()/2-point complex FFT plus a split
+  // pass. Writes size()/2 + 1 bins (DC..Nyquist) into out; in and out must not overlap.
+  void forwardReal(const float* in, std::complex<float>* out) const;
+
+private:
+  void transform(std::complex<float>* data, std::size_t n, const std::vector<uint32_t>& bitrev) const;
+
+  std::size_t m_size = 0;
+  std::vector<uint32_t> m_bitrev;     // size()-point permutation
+  std::vector<uint32_t> m_bitrevHalf; // size()/2-point permutation (real path)
+  std::vector<std::complex<float>> m_twiddles; // exp(-2*pi*i*k/size()), k < size()/2
+  std::vector<std::complex<float>> m_stageTwiddles; // per-stage contiguous copies, stage len at len/2 - 2
+};
+
 class Fft final
 {
 public:
   static bool isPowerOfTwo(std::size_t n);
   static std::vector<float> hannWindow(std::size_t n);
 
-  // In-place forward FFT (no scaling).
+  // In-place forward FFT (no scaling). Builds a temporary plan; prefer FftPlan in loops.
   static void forward(std::vector<std::complex<float>>& data);
 
   // Convenience for real input; returns complex spectrum of size N.
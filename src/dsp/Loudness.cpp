@@ -0,0 +1,322 @@
+#include "Loudness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace dsp {
+
+namespace {
+
+constexpr double kPi = 3.141592653589793238463;
+constexpr double kAbsoluteGateLufs = -70.0;
+constexpr double kIntegratedRelativeGateLu = -10.0;
+constexpr double kRangeRelativeGateLu = -20.0;
+
+double energyToLufs(double energy)
+{
+  return energy > 0.0 ? -0.691 + 10.0 * std::log10(energy) : -std::numeric_limits<double>::infinity();
+}
+
+float reportLufs(double lufs)
+{
+  return std::isfinite(lufs) ? std::max(LoudnessMeter::kMinLufs, static_cast<float>(lufs)) : LoudnessMeter::kMinLufs;
+}
+
+} // namespace
+
+void LoudnessMeter::Histogram::clear()
+{
+  counts.fill(0U);
+  energy.fill(0.0);
+  total = 0;
+  totalEnergy = 0.0;
+}
+
+void LoudnessMeter::Histogram::add(double blockEnergy)
+{
+  const double lufs = energyToLufs(blockEnergy);
+  if (!(lufs >= kAbsoluteGateLufs)) {
+    return;
+  }
+  const std::size_t bin = binFor(lufs);
+  ++counts[bin];
+  energy[bin] += blockEnergy;
+  ++total;
+  totalEnergy += blockEnergy;
+}
+
+std::size_t LoudnessMeter::binFor(double lufs)
+{
+  const double index = std::floor((lufs - kAbsoluteGateLufs) * 10.0);
+  return static_cast<std::size_t>(std::clamp(index, 0.0, static_cast<double>(kHistogramBins - 1U)));
+}
+
+double LoudnessMeter::binLufs(std::size_t bin)
+{
+  return kAbsoluteGateLufs + (static_cast<double>(bin) + 0.5) / 10.0;
+}
+
+LoudnessMeter::LoudnessMeter()
+{
+  // 4x interpolation filter: Hann-windowed sinc cut at the original Nyquist, each phase
+  // normalized to unity DC gain.
+  constexpr std::size_t n = kOversampling * kTapsPerPhase;
+  const double center = static_cast<double>(n - 1U) / 2.0;
+  for (std::size_t i = 0; i < n; ++i) {
+    const double x = (static_cast<double>(i) - center) / static_cast<double>(kOversampling);
+    const double sinc = std::abs(x) < 1.0e-12 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+    const double window = 0.5 - 0.5 * std::cos(2.0 * kPi * static_cast<double>(i + 1U) / static_cast<double>(n + 1U));
+    m_taps[i] = static_cast<float>(sinc * window);
+  }
+  for (std::size_t p = 0; p < kOversampling; ++p) {
+    float sum = 0.0f;
+    for (std::size_t k = 0; k < kTapsPerPhase; ++k) {
+      sum += m_taps[k * kOversampling + p];
+    }
+    for (std::size_t k = 0; k < kTapsPerPhase; ++k) {
+      m_taps[k * kOversampling + p] /= sum;
+    }
+  }
+  reset(48000, 2);
+}
+
+void LoudnessMeter::reset(uint32_t sampleRate, std::size_t channels)
+{
+  m_sampleRate = std::max<uint32_t>(1U, sampleRate);
+  const double fs = static_cast<double>(m_sampleRate);
+
+  // K-weighting, BS.1770-4 Annex 1, with the 48 kHz reference design re-derived for fs.
+  {
+    const double f0 = 1681.974450955533;
+    const double gainDb = 3.999843853973347;
+    const double q = 0.7071752369554196;
+    const double k = std::tan(kPi * f0 / fs);
+    const double vh = std::pow(10.0, gainDb / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    const double a0 = 1.0 + k / q + k * k;
+    m_pre.b0 = (vh + vb * k / q + k * k) / a0;
+    m_pre.b1 = 2.0 * (k * k - vh) / a0;
+    m_pre.b2 = (vh - vb * k / q + k * k) / a0;
+    m_pre.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_pre.a2 = (1.0 - k / q + k * k) / a0;
+  }
+  {
+    const double f0 = 38.13547087602444;
+    const double q = 0.5003270373238773;
+    const double k = std::tan(kPi * f0 / fs);
+    const double a0 = 1.0 + k / q + k * k;
+    m_rlb.b0 = 1.0;
+    m_rlb.b1 = -2.0;
+    m_rlb.b2 = 1.0;
+    m_rlb.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_rlb.a2 = (1.0 - k / q + k * k) / a0;
+  }
+
+  m_channels.assign(std::max<std::size_t>(1U, channels), Channel{});
+  m_subBlockFrames = std::max<std::size_t>(1U, static_cast<std::size_t>(std::lround(fs / 10.0)));
+  clear();
+}
+
+float loudnessChannelWeight(LoudnessChannel channel)
+{
+  switch (channel) {
+    case LoudnessChannel::Lfe:
+      return 0.0f;
+    case LoudnessChannel::Surround:
+      return 1.41f;
+    case LoudnessChannel::Front:
+      break;
+  }
+  return 1.0f;
+}
+
+void LoudnessMeter::setChannelWeight(std::size_t channel, float weight)
+{
+  if (channel < m_channels.size()) {
+    m_channels[channel].weight = std::max(0.0f, weight);
+  }
+}
+
+void LoudnessMeter::clear()
+{
+  for (Channel& c : m_channels) {
+    std::fill(std::begin(c.z), std::end(c.z), 0.0);
+    c.history.fill(0.0f);
+    c.truePeak = 0.0f;
+    c.maxTruePeak = 0.0f;
+  }
+  m_subBlockFill = 0;
+  m_subBlockSum = 0.0;
+  m_subBlocks.fill(0.0);
+  m_subBlockWrite = 0;
+  m_subBlockCount = 0;
+  m_gating.clear();
+  m_shortTerm.clear();
+}
+
+void LoudnessMeter::process(const float* interleaved, std::size_t frames)
+{
+  const std::size_t channelCount = m_channels.size();
+  for (Channel& c : m_channels) {
+    c.truePeak = 0.0f;
+  }
+
+  std::size_t pos = 0;
+  while (pos < frames) {
+    // Never cross a 100 ms boundary inside the channel loops.
+    const std::size_t take = std::min(frames - pos, m_subBlockFrames - m_subBlockFill);
+    for (std::size_t ch = 0; ch < channelCount; ++ch) {
+      Channel& c = m_channels[ch];
+      double z0 = c.z[0];
+      double z1 = c.z[1];
+      double z2 = c.z[2];
+      double z3 = c.z[3];
+      double sum = 0.0;
+      float peak = c.truePeak;
+      const float* in = interleaved + pos * channelCount + ch;
+      for (std::size_t f = 0; f < take; ++f) {
+        const float xf = in[f * channelCount];
+        const double x = static_cast<double>(xf);
+
+        // K-weighting: shelving pre-filter, then the RLB high-pass (transposed direct form II).
+        const double y1 = m_pre.b0 * x + z0;
+        z0 = m_pre.b1 * x - m_pre.a1 * y1 + z1;
+        z1 = m_pre.b2 * x - m_pre.a2 * y1;
+        const double y2 = m_rlb.b0 * y1 + z2;
+        z2 = m_rlb.b1 * y1 - m_rlb.a1 * y2 + z3;
+        z3 = m_rlb.b2 * y1 - m_rlb.a2 * y2;
+        sum += y2 * y2;
+
+        // True peak: the four interpolated points between this sample and the previous one.
+        std::copy_backward(c.history.begin(), c.history.end() - 1, c.history.end());
+        c.history[0] = xf;
+        peak = std::max(peak, std::abs(xf));
+        for (std::size_t p = 0; p < kOversampling; ++p) {
+          float acc = 0.0f;
+          for (std::size_t k = 0; k < kTapsPerPhase; ++k) {
+            acc += m_taps[k * kOversampling + p] * c.history[k];
+          }
+          peak = std::max(peak, std::abs(acc));
+        }
+      }
+      c.z[0] = z0;
+      c.z[1] = z1;
+      c.z[2] = z2;
+      c.z[3] = z3;
+      c.truePeak = peak;
+      m_subBlockSum += static_cast<double>(c.weight) * sum;
+    }
+
+    pos += take;
+    m_subBlockFill += take;
+    if (m_subBlockFill == m_subBlockFrames) {
+      finishSubBlock();
+    }
+  }
+
+  for (Channel& c : m_channels) {
+    c.maxTruePeak = std::max(c.maxTruePeak, c.truePeak);
+  }
+}
+
+void LoudnessMeter::finishSubBlock()
+{
+  m_subBlocks[m_subBlockWrite] = m_subBlockSum / static_cast<double>(m_subBlockFrames);
+  m_subBlockWrite = (m_subBlockWrite + 1U) % kShortTermBlocks;
+  ++m_subBlockCount;
+  m_subBlockSum = 0.0;
+  m_subBlockFill = 0;
+
+  // Gating blocks overlap by 75% (400 ms every 100 ms); short-term blocks feed the range at 10 Hz.
+  if (m_subBlockCount >= kMomentaryBlocks) {
+    m_gating.add(meanEnergy(kMomentaryBlocks));
+  }
+  if (m_subBlockCount >= kShortTermBlocks) {
+    m_shortTerm.add(meanEnergy(kShortTermBlocks));
+  }
+}
+
+double LoudnessMeter::meanEnergy(std::size_t blocks) const
+{
+  const std::size_t n = static_cast<std::size_t>(std::min<uint64_t>(blocks, m_subBlockCount));
+  if (n == 0) {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for (std::size_t i = 1; i <= n; ++i) {
+    sum += m_subBlocks[(m_subBlockWrite + kShortTermBlocks - i) % kShortTermBlocks];
+  }
+  return sum / static_cast<double>(n);
+}
+
+float LoudnessMeter::momentaryLufs() const
+{
+  return m_subBlockCount < kMomentaryBlocks ? kMinLufs : reportLufs(energyToLufs(meanEnergy(kMomentaryBlocks)));
+}
+
+float LoudnessMeter::shortTermLufs() const
+{
+  // Until 3 s have passed this is the loudness of everything so far.
+  return m_subBlockCount < kMomentaryBlocks ? kMinLufs : reportLufs(energyToLufs(meanEnergy(kShortTermBlocks)));
+}
+
+float LoudnessMeter::integratedLufs() const
+{
+  if (m_gating.total == 0) {
+    return kMinLufs;
+  }
+  const double gate = energyToLufs(m_gating.totalEnergy / static_cast<double>(m_gating.total)) + kIntegratedRelativeGateLu;
+  uint64_t count = 0;
+  double energy = 0.0;
+  for (std::size_t bin = binFor(gate); bin < kHistogramBins; ++bin) {
+    if (binLufs(bin) < gate) {
+      continue;
+    }
+    count += m_gating.counts[bin];
+    energy += m_gating.energy[bin];
+  }
+  return count == 0 ? kMinLufs : reportLufs(energyToLufs(energy / static_cast<double>(count)));
+}
+
+float LoudnessMeter::loudnessRangeLu() const
+{
+  if (m_shortTerm.total == 0) {
+    return 0.0f;
+  }
+  const double gate = energyToLufs(m_shortTerm.totalEnergy / static_cast<double>(m_shortTerm.total)) + kRangeRelativeGateLu;
+  const std::size_t first = binFor(gate) + (binLufs(binFor(gate)) < gate ? 1U : 0U);
+  uint64_t count = 0;
+  for (std::size_t bin = first; bin < kHistogramBins; ++bin) {
+    count += m_shortTerm.counts[bin];
+  }
+  if (count == 0) {
+    return 0.0f;
+  }
+
+  // EBU Tech 3342: the spread between the 10th and 95th percentiles of the gated short-term values.
+  const auto percentileBin = [&](double fraction) {
+    const uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(count - 1U));
+    uint64_t seen = 0;
+    for (std::size_t bin = first; bin < kHistogramBins; ++bin) {
+      seen += m_shortTerm.counts[bin];
+      if (seen > rank) {
+        return bin;
+      }
+    }
+    return kHistogramBins - 1U;
+  };
+  return static_cast<float>(binLufs(percentileBin(0.95)) - binLufs(percentileBin(0.10)));
+}
+
+float LoudnessMeter::truePeak(std::size_t channel) const
+{
+  return channel < m_channels.size() ? m_channels[channel].truePeak : 0.0f;
+}
+
+float LoudnessMeter::maxTruePeak(std::size_t channel) const
+{
+  return channel < m_channels.size() ? m_channels[channel].maxTruePeak : 0.0f;
+}
+
+} // namespace dsp
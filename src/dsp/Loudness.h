@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dsp {
+
+// ITU-R BS.1770-4 / EBU R128 loudness and true-peak measurement.
+//
+// Fed with interleaved float frames, it K-weights every channel and accumulates 100 ms
+// sub-blocks; momentary (400 ms) and short-term (3 s) loudness are sums over the last 4 and
+// 30 of them. Integrated loudness and loudness range (EBU Tech 3342) are gated over histograms
+// of 0.1 LU bins, so memory stays fixed however long the programme runs. True peak uses
+// 4x polyphase oversampling per channel.
+//
+// All buffers are sized by reset(); process() never allocates.
+class LoudnessMeter final
+{
+public:
+  static constexpr float kMinLufs = -120.0f; // reported while there is nothing to measure
+  static constexpr std::size_t kOversampling = 4;
+  static constexpr std::size_t kTapsPerPhase = 12;
+
+  LoudnessMeter();
+
+  // Also clears the programme history.
+  void reset(uint32_t sampleRate, std::size_t channels);
+  // Channel gains from BS.1770: 1.0 for front/centre, 1.41 for surround, 0 for LFE.
+  void setChannelWeight(std::size_t channel, float weight);
+  // Starts a new programme (integrated, range and maximum true peak) without re-tuning filters.
+  void clear();
+
+  void process(const float* interleaved, std::size_t frames);
+
+  uint32_t sampleRate() const { return m_sampleRate; }
+  std::size_t channels() const { return m_channels.size(); }
+
+  float momentaryLufs() const;
+  float shortTermLufs() const;
+  float integratedLufs() const;
+  float loudnessRangeLu() const;
+
+  // Linear true peak of the last process() call, and the maximum since clear().
+  float truePeak(std::size_t channel) const;
+  float maxTruePeak(std::size_t channel) const;
+
+private:
+  struct Biquad final {
+    double b0 = 1.0;
+    double b1 = 0.0;
+    double b2 = 0.0;
+    double a1 = 0.0;
+    double a2 = 0.0;
+  };
+
+  struct Channel final {
+    double z[4] = {0.0, 0.0, 0.0, 0.0}; // pre-filter and RLB filter states
+    std::array<float, kTapsPerPhase> history{}; // newest first
+    float weight = 1.0f;
+    float truePeak = 0.0f;
+    float maxTruePeak = 0.0f;
+  };
+
+  // 0.1 LU bins from -70 LUFS (the absolute gate) to +5 LUFS.
+  static constexpr std::size_t kHistogramBins = 750;
+  static constexpr std::size_t kShortTermBlocks = 30;
+  static constexpr std::size_t kMomentaryBlocks = 4;
+
+  struct Histogram final {
+    std::array<uint32_t, kHistogramBins> counts{};
+    std::array<double, kHistogramBins> energy{};
+    uint64_t total = 0;
+    double totalEnergy = 0.0;
+
+    void clear();
+    void add(double blockEnergy);
+  };
+
+  static std::size_t binFor(double lufs);
+  static double binLufs(std::size_t bin);
+
+  void finishSubBlock();
+  double meanEnergy(std::size_t blocks) const;
+
+  uint32_t m_sampleRate = 48000;
+  Biquad m_pre;
+  Biquad m_rlb;
+  std::array<float, kOversampling * kTapsPerPhase> m_taps{};
+  std::vector<Channel> m_channels;
+
+  std::size_t m_subBlockFrames = 4800;
+  std::size_t m_subBlockFill = 0;
+  double m_subBlockSum = 0.0;
+  std::array<double, kShortTermBlocks> m_subBlocks{}; // mean weighted energy per 100 ms
+  std::size_t m_subBlockWrite = 0;
+  uint64_t m_subBlockCount = 0;
+
+  Histogram m_gating;    // 400 ms blocks, for integrated loudness
+  Histogram m_shortTerm; // 3 s blocks, for loudness range
+};
+
+// What BS.1770 weighting cares about in a channel's position. Callers map their own channel
+// positions onto these.
+enum class LoudnessChannel {
+  Front, // front and centre channels, and anything unknown
+  Surround,
+  Lfe,
+};
+
+// BS.1770 weight for a channel: surrounds count +1.5 dB, the LFE is ignored, everything else is
+// 1.0. Feed it to setChannelWeight().
+float loudnessChannelWeight(LoudnessChannel channel);
+
+} // namespace dsp
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+
+namespace dsp {
+
+// IEC 60268-style meter ballistics, advanced once per audio block so the displayed level does
+// not depend on how often the UI polls.
+//
+// ppm follows IEC 60268-10 type I: a 5 ms attack and a 20 dB fall in 1.5 s. vu follows the
+// IEC 60268-17 volume indicator: a symmetric first-order response reaching 99% of a step in
+// 300 ms.
+struct MeterBallistics final {
+  static constexpr double kPpmAttackSeconds = 0.005;
+  static constexpr double kPpmFallDbPerSecond = 20.0 / 1.5;
+  static constexpr double kVuTimeConstantSeconds = 0.300 / 4.605; // -ln(0.01)
+
+  float ppm = 0.0f; // linear amplitude
+  float vu = 0.0f;  // linear RMS
+
+  void reset()
+  {
+    ppm = 0.0f;
+    vu = 0.0f;
+  }
+
+  // blockPeak/blockRms are the sample peak and RMS of `seconds` of audio.
+  void advance(float blockPeak, float blockRms, double seconds)
+  {
+    if (!(seconds > 0.0)) {
+      return;
+    }
+    const float fall = static_cast<float>(std::pow(10.0, -kPpmFallDbPerSecond * seconds / 20.0));
+    const float attack = static_cast<float>(1.0 - std::exp(-seconds / kPpmAttackSeconds));
+    const float fallen = ppm * fall;
+    ppm = blockPeak > fallen ? fallen + (blockPeak - fallen) * attack : fallen;
+
+    const float vuCoeff = static_cast<float>(1.0 - std::exp(-seconds / kVuTimeConstantSeconds));
+    vu += (blockRms - vu) * vuCoeff;
+  }
+};
+
+// Raises `held` to `value` if it is larger; pairs with exchange(0) for reset-on-read peaks.
+inline void atomicMax(std::atomic<float>& held, float value)
+{
+  float current = held.load(std::memory_order_relaxed);
+  while (value > current && !held.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+} // namespace dsp
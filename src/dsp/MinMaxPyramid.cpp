@@ -0,0 +1,173 @@
+#include "MinMaxPyramid.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace dsp {
+
+namespace {
+constexpr float kEmptyMin = std::numeric_limits<float>::max();
+constexpr float kEmptyMax = -std::numeric_limits<float>::max();
+} // namespace
+
+void MinMaxPyramid::reset(std::size_t samples)
+{
+  constexpr std::size_t coarsest = kBlockSizes[kLevels - 1];
+  const std::size_t capacity = std::max<std::size_t>(1U, (samples + coarsest - 1U) / coarsest) * coarsest;
+  if (capacity == m_raw.size()) {
+    return;
+  }
+
+  m_raw.assign(capacity, 0.0f);
+  for (std::size_t l = 0; l < kLevels; ++l) {
+    m_levels[l].mins.assign(capacity / kBlockSizes[l], 0.0f);
+    m_levels[l].maxs.assign(capacity / kBlockSizes[l], 0.0f);
+  }
+  clear();
+}
+
+void MinMaxPyramid::clear()
+{
+  m_total = 0;
+  for (Level& level : m_levels) {
+    level.partialMin = kEmptyMin;
+    level.partialMax = kEmptyMax;
+  }
+}
+
+std::size_t MinMaxPyramid::size() const
+{
+  return static_cast<std::size_t>(std::min<uint64_t>(m_total, m_raw.size()));
+}
+
+void MinMaxPyramid::append(const float* src, std::size_t n)
+{
+  if (m_raw.empty()) {
+    return;
+  }
+
+  constexpr std::size_t base = kBlockSizes[0];
+  while (n > 0) {
+    // Never cross a finest-block boundary; the capacity is a multiple of it, so the raw copy
+    // never wraps inside a chunk either.
+    const std::size_t inBlock = static_cast<std::size_t>(m_total % base);
+    const std::size_t take = std::min(n, base - inBlock);
+    const std::size_t at = static_cast<std::size_t>(m_total % m_raw.size());
+
+    float minV = m_levels[0].partialMin;
+    float maxV = m_levels[0].partialMax;
+    for (std::size_t i = 0; i < take; ++i) {
+      const float v = src[i];
+      m_raw[at + i] = v;
+      minV = std::min(minV, v);
+      maxV = std::max(maxV, v);
+    }
+    m_levels[0].partialMin = minV;
+    m_levels[0].partialMax = maxV;
+
+    m_total += take;
+    src += take;
+    n -= take;
+
+    // Commit finished blocks upwards.
+    for (std::size_t l = 0; l < kLevels && m_total % kBlockSizes[l] == 0; ++l) {
+      Level& level = m_levels[l];
+      const std::size_t index = static_cast<std::size_t>((m_total / kBlockSizes[l] - 1U) % level.mins.size());
+      level.mins[index] = level.partialMin;
+      level.maxs[index] = level.partialMax;
+      if (l + 1U < kLevels) {
+        Level& up = m_levels[l + 1U];
+        up.partialMin = std::min(up.partialMin, level.partialMin);
+        up.partialMax = std::max(up.partialMax, level.partialMax);
+      }
+      level.partialMin = kEmptyMin;
+      level.partialMax = kEmptyMax;
+    }
+  }
+}
+
+void MinMaxPyramid::scanRaw(uint64_t begin, uint64_t end, float& minV, float& maxV) const
+{
+  const std::size_t cap = m_raw.size();
+  std::size_t at = static_cast<std::size_t>(begin % cap);
+  std::size_t remaining = static_cast<std::size_t>(end - begin);
+  while (remaining > 0) {
+    const std::size_t run = std::min(remaining, cap - at);
+    const float* p = m_raw.data() + at;
+    for (std::size_t i = 0; i < run; ++i) {
+      minV = std::min(minV, p[i]);
+      maxV = std::max(maxV, p[i]);
+    }
+    remaining -= run;
+    at = 0;
+  }
+}
+
+void MinMaxPyramid::rangeMinMax(uint64_t begin, uint64_t end, std::size_t maxLevel, float& minV, float& maxV) const
+{
+  // Coarsest level (up to maxLevel) with at least one whole block inside [begin, end).
+  for (std::size_t l = maxLevel; l-- > 0;) {
+    const uint64_t block = kBlockSizes[l];
+    const uint64_t first = (begin + block - 1U) / block;
+    const uint64_t last = end / block;
+    if (first >= last) {
+      continue;
+    }
+
+    // Whole blocks end at or before `end` <= m_total, so they are all committed, and they lie
+    // within the retained history, so none has been overwritten yet.
+    const Level& level = m_levels[l];
+    const std::size_t count = level.mins.size();
+    for (uint64_t k = first; k < last; ++k) {
+      const std::size_t index = static_cast<std::size_t>(k % count);
+      minV = std::min(minV, level.mins[index]);
+      maxV = std::max(maxV, level.maxs[index]);
+    }
+    if (begin < first * block) {
+      rangeMinMax(begin, first * block, l, minV, maxV);
+    }
+    if (last * block < end) {
+      rangeMinMax(last * block, end, l, minV, maxV);
+    }
+    return;
+  }
+  scanRaw(begin, end, minV, maxV);
+}
+
+bool MinMaxPyramid::minMax(uint64_t begin, uint64_t end, float& minV, float& maxV) const
+{
+  const uint64_t oldest = m_total - size();
+  begin = std::max(begin, oldest);
+  end = std::min(end, m_total);
+  if (begin >= end) {
+    return false;
+  }
+  float lo = kEmptyMin;
+  float hi = kEmptyMax;
+  rangeMinMax(begin, end, kLevels, lo, hi);
+  minV = lo;
+  maxV = hi;
+  return true;
+}
+
+void MinMaxPyramid::minMax(std::size_t window, int columns, float* minsOut, float* maxsOut) const
+{
+  const std::size_t take = std::min(window, size());
+  if (columns <= 0 || take == 0) {
+    return;
+  }
+
+  const uint64_t start = m_total - take;
+  const uint64_t cols = static_cast<uint64_t>(columns);
+  for (int x = 0; x < columns; ++x) {
+    const uint64_t segStart = (take * static_cast<uint64_t>(x)) / cols;
+    const uint64_t segEnd = std::max<uint64_t>(segStart + 1U, (take * static_cast<uint64_t>(x + 1)) / cols);
+    float minV = kEmptyMin;
+    float maxV = kEmptyMax;
+    rangeMinMax(start + segStart, start + std::min<uint64_t>(segEnd, take), kLevels, minV, maxV);
+    minsOut[x] = minV;
+    maxsOut[x] = maxV;
+  }
+}
+
+} // namespace dsp
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dsp {
+
+// Sample history with a mip-mapped min/max summary for waveform drawing.
+//
+// Besides the raw ring, min/max pairs are kept for 64-, 512- and 4096-sample blocks, updated
+// incrementally as samples are appended. A range query uses the coarsest level whose blocks fit
+// and only touches finer levels (and raw samples) at the two range edges, so drawing N columns
+// costs O(N) no matter how long the history is.
+class MinMaxPyramid final
+{
+public:
+  static constexpr std::size_t kLevels = 3;
+  static constexpr std::array<std::size_t, kLevels> kBlockSizes{64, 512, 4096};
+
+  MinMaxPyramid() = default;
+
+  // Keeps at least `samples` samples of history (rounded up to whole coarsest blocks).
+  // Clears the history if the capacity changes; a no-op (no allocation) otherwise.
+  void reset(std::size_t samples);
+  void clear();
+
+  std::size_t capacity() const { return m_raw.size(); }
+  std::size_t size() const;
+  // Samples ever appended since the last clear; absolute positions run from total()-size().
+  uint64_t total() const { return m_total; }
+
+  void append(const float* src, std::size_t n);
+
+  // Min/max over absolute positions [begin, end), clamped to the retained history. Returns false
+  // (leaving minV/maxV untouched) if nothing of the range is retained.
+  bool minMax(uint64_t begin, uint64_t end, float& minV, float& maxV) const;
+
+  // Splits the newest `window` samples (clamped to size()) into `columns` equal segments and
+  // writes each segment's min/max. Columns narrower than one sample repeat the nearest sample.
+  void minMax(std::size_t window, int columns, float* minsOut, float* maxsOut) const;
+
+private:
+  struct Level final {
+    std::vector<float> mins;
+    std::vector<float> maxs;
+    float partialMin = 0.0f;
+    float partialMax = 0.0f;
+  };
+
+  void rangeMinMax(uint64_t begin, uint64_t end, std::size_t maxLevel, float& minV, float& maxV) const;
+  void scanRaw(uint64_t begin, uint64_t end, float& minV, float& maxV) const;
+
+  std::vector<float> m_raw;
+  std::array<Level, kLevels> m_levels{};
+  uint64_t m_total = 0; // samples ever appended; absolute positions index every level
+};
+
+} // namespace dsp
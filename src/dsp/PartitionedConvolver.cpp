@@ -0,0 +1,117 @@
+#include "PartitionedConvolver.h"
+
+#include <algorithm>
+
+namespace dsp {
+
+void FirPartitions::reset(const float* taps, std::size_t count, std::size_t blockSize)
+{
+  m_blockSize = 0;
+  m_partitions = 0;
+  m_spectra.clear();
+  if (!taps || count == 0 || blockSize < 2 || !Fft::isPowerOfTwo(blockSize)) {
+    return;
+  }
+
+  const std::size_t n = 2U * blockSize;
+  m_plan.reset(n);
+  m_blockSize = blockSize;
+  m_partitions = (count + blockSize - 1U) / blockSize;
+  m_spectra.assign(m_partitions * n, std::complex<float>{});
+
+  // Folding 1/n in here leaves the unscaled inverse transform with nothing to do per block.
+  const float scale = 1.0f / static_cast<float>(n);
+  for (std::size_t p = 0; p < m_partitions; ++p) {
+    std::complex<float>* bins = m_spectra.data() + p * n;
+    const std::size_t first = p * blockSize;
+    const std::size_t len = std::min(blockSize, count - first);
+    for (std::size_t i = 0; i < len; ++i) {
+      bins[i] = std::complex<float>(taps[first + i] * scale, 0.0f);
+    }
+    m_plan.forward(bins);
+  }
+}
+
+void PartitionedConvolver::reset(const FirPartitions& fir)
+{
+  m_blockSize = fir.blockSize();
+  m_partitions = fir.partitions();
+  m_pos = 0;
+  m_newest = 0;
+
+  const std::size_t n = 2U * m_blockSize;
+  m_input.assign(n, std::complex<float>{});
+  m_output.assign(m_blockSize, std::complex<float>{});
+  m_work.assign(n, std::complex<float>{});
+  m_delayLine.assign(m_partitions * n, std::complex<float>{});
+}
+
+void PartitionedConvolver::continueFrom(const PartitionedConvolver& other)
+{
+  if (other.m_blockSize != m_blockSize || other.m_partitions != m_partitions) {
+    return;
+  }
+  std::copy(other.m_input.begin(), other.m_input.end(), m_input.begin());
+  std::copy(other.m_output.begin(), other.m_output.end(), m_output.begin());
+  std::copy(other.m_delayLine.begin(), other.m_delayLine.end(), m_delayLine.begin());
+  m_pos = other.m_pos;
+  m_newest = other.m_newest;
+}
+
+void PartitionedConvolver::process(const FirPartitions& fir, const float* in, float* out, std::size_t frames, std::size_t stride, std::size_t channels)
+{
+  if (m_blockSize == 0 || fir.blockSize() != m_blockSize || fir.partitions() != m_partitions) {
+    if (in != out) {
+      for (std::size_t f = 0; f < frames; ++f) {
+        std::copy_n(in + f * stride, channels, out + f * stride);
+      }
+    }
+    return;
+  }
+
+  const bool stereo = channels > 1;
+  for (std::size_t f = 0; f < frames; ++f) {
+    const float* x = in + f * stride;
+    float* y = out + f * stride;
+    m_input[m_blockSize + m_pos] = std::complex<float>(x[0], stereo ? x[1] : 0.0f);
+    const std::complex<float> o = m_output[m_pos];
+    y[0] = o.real();
+    if (stereo) {
+      y[1] = o.imag();
+    }
+    if (++m_pos == m_blockSize) {
+      runBlock(fir);
+      m_pos = 0;
+    }
+  }
+}
+
+void PartitionedConvolver::runBlock(const FirPartitions& fir)
+{
+  const std::size_t n = 2U * m_blockSize;
+
+  // The delay line runs backwards, so slot (m_newest + p) % partitions holds the spectrum of the
+  // block p blocks ago, the one partition p of the filter applies to.
+  m_newest = (m_newest + m_partitions - 1U) % m_partitions;
+  std::complex<float>* newest = m_delayLine.data() + m_newest * n;
+  std::copy(m_input.begin(), m_input.end(), newest);
+  fir.plan().forward(newest);
+
+  std::fill(m_work.begin(), m_work.end(), std::complex<float>{});
+  auto* acc = reinterpret_cast<float*>(m_work.data());
+  for (std::size_t p = 0; p < m_partitions; ++p) {
+    const auto* x = reinterpret_cast<const float*>(m_delayLine.data() + ((m_newest + p) % m_partitions) * n);
+    const auto* h = reinterpret_cast<const float*>(fir.partition(p));
+    for (std::size_t k = 0; k < 2U * n; k += 2U) {
+      acc[k] += x[k] * h[k] - x[k + 1U] * h[k + 1U];
+      acc[k + 1U] += x[k] * h[k + 1U] + x[k + 1U] * h[k];
+    }
+  }
+  fir.plan().inverse(m_work.data());
+
+  // Overlap-save: the first half wrapped around, the second half is this block's output.
+  std::copy(m_work.begin() + static_cast<std::ptrdiff_t>(m_blockSize), m_work.end(), m_output.begin());
+  std::copy(m_input.begin() + static_cast<std::ptrdiff_t>(m_blockSize), m_input.end(), m_input.begin());
+}
+
+} // namespace dsp
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Fft.h"
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace dsp {
+
+// A real FIR split into uniform partitions of blockSize() taps, each zero-padded and transformed
+// to 2 * blockSize() bins. Built once off the audio thread and shared, read-only, by every
+// PartitionedConvolver that runs it.
+class FirPartitions final
+{
+public:
+  // blockSize must be a power of two >= 2; the last partition is zero-padded.
+  void reset(const float* taps, std::size_t count, std::size_t blockSize);
+
+  bool isValid() const { return m_partitions > 0; }
+  std::size_t blockSize() const { return m_blockSize; }
+  std::size_t partitions() const { return m_partitions; }
+  const FftPlan& plan() const { return m_plan; }
+  // 2 * blockSize() bins of partition p, already divided by the inverse transform's size.
+  const std::complex<float>* partition(std::size_t p) const { return m_spectra.data() + p * 2U * m_blockSize; }
+
+private:
+  FftPlan m_plan;
+  std::size_t m_blockSize = 0;
+  std::size_t m_partitions = 0;
+  std::vector<std::complex<float>> m_spectra;
+};
+
+// Uniformly partitioned overlap-save convolution with a frequency-domain delay line, for one or
+// two channels. Because the filter is real, two channels share every transform as its real and
+// imaginary parts.
+//
+// Input is gathered into blocks of blockSize() frames, so the output lags by exactly that much.
+// Each block costs one forward and one inverse FFT of 2 * blockSize() points plus one complex
+// multiply-add per bin and partition. reset() allocates everything; process() never does.
+class PartitionedConvolver final
+{
+public:
+  void reset(const FirPartitions& fir);
+
+  // Takes over another convolver's input history and pending output, so a new filter picks up
+  // mid-stream instead of starting from silence. Both must have been reset for the same geometry.
+  void continueFrom(const PartitionedConvolver& other);
+
+  // Convolves `channels` (1 or 2) adjacent channels of interleaved frames `stride` samples apart.
+  // `in` and `out` may be the same buffer.
+  void process(const FirPartitions& fir, const float* in, float* out, std::size_t frames, std::size_t stride, std::size_t channels);
+
+private:
+  void runBlock(const FirPartitions& fir);
+
+  std::size_t m_blockSize = 0;
+  std::size_t m_partitions = 0;
+  std::size_t m_pos = 0;    // frames gathered into the current block
+  std::size_t m_newest = 0; // delay-line slot of the newest input spectrum
+
+  std::vector<std::complex<float>> m_input;  // previous block, then the one being gathered
+  std::vector<std::complex<float>> m_output; // finished block, played out while the next gathers
+  std::vector<std::complex<float>> m_work;
+  std::vector<std::complex<float>> m_delayLine; // partitions() input spectra, 2 * blockSize() bins each
+};
+
+} // namespace dsp
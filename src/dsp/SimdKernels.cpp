@@ -0,0 +1,927 @@
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define HEADROOM_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define HEADROOM_SIMD_X86 0
+#endif
+
+namespace dsp::simd {
+
+namespace {
+constexpr float kDbPerLog2Power = 3.01029995663981195f; // 10*log10(2)
+constexpr float kPowerFloor = 1.0e-18f;                 // == (1e-9 magnitude)^2
+
+using Radix2StageFn = void (*)(std::complex<float>*, std::size_t, std::size_t, const std::complex<float>*);
+using NormalizedDbFn = void (*)(const std::complex<float>*, std::size_t, float, float, float, float*);
+using SmoothColorizeFn = void (*)(const float*, std::size_t, float, float*, const uint32_t*, uint32_t*);
+using ChannelLevelsFn = void (*)(const float*, std::size_t, std::size_t, float, float*, float*, uint32_t*);
+
+struct Kernels final {
+  Level level = Level::Scalar;
+  Radix2StageFn radix2Stage = nullptr;
+  NormalizedDbFn normalizedDb = nullptr;
+  SmoothColorizeFn smoothAndColorize = nullptr;
+  ChannelLevelsFn channelLevels = nullptr;
+  BiquadCascadeFn biquadCascade = nullptr;
+};
+
+// ---- Scalar reference -------------------------------------------------------------------------
+
+inline void butterflyScalar(std::complex<float>& a, std::complex<float>& b, const std::complex<float>& w)
+{
+  const std::complex<float> u = a;
+  const std::complex<float> v = b * w;
+  a = u + v;
+  b = u - v;
+}
+
+void radix2StageScalar(std::complex<float>* data, std::size_t n, std::size_t half, const std::complex<float>* twiddles)
+{
+  for (std::size_t i = 0; i < n; i += 2U * half) {
+    std::complex<float>* a = data + i;
+    std::complex<float>* b = a + half;
+    for (std::size_t j = 0; j < half; ++j) {
+      butterflyScalar(a[j], b[j], twiddles[j]);
+    }
+  }
+}
+
+inline float normalizedDbScalar(const std::complex<float>& bin, float scale2, float minDb, float invRange)
+{
+  const float power = (bin.real() * bin.real() + bin.imag() * bin.imag()) * scale2 + kPowerFloor;
+  const float db = 10.0f * std::log10(power);
+  return std::clamp((db - minDb) * invRange, 0.0f, 1.0f);
+}
+
+void normalizedDbScalarLoop(const std::complex<float>* bins, std::size_t count, float scale, float minDb, float maxDb, float* normOut)
+{
+  const float scale2 = scale * scale;
+  const float invRange = 1.0f / (maxDb - minDb);
+  for (std::size_t i = 0; i < count; ++i) {
+    normOut[i] = normalizedDbScalar(bins[i], scale2, minDb, invRange);
+  }
+}
+
+inline void smoothColorizeScalarOne(float norm, float smoothing, float& state, const uint32_t* lut256, uint32_t* colourOut)
+{
+  const float prev = state;
+  state = (norm > prev) ? norm : (prev * smoothing + norm * (1.0f - smoothing));
+  if (colourOut) {
+    const int idx = static_cast<int>(std::clamp(norm, 0.0f, 1.0f) * 255.0f + 0.5f);
+    *colourOut = lut256[idx];
+  }
+}
+
+void smoothAndColorizeScalar(const float* norm, std::size_t count, float smoothing, float* state, const uint32_t* lut256, uint32_t* colourOut)
+{
+  for (std::size_t i = 0; i < count; ++i) {
+    smoothColorizeScalarOne(norm[i], smoothing, state[i], lut256, colourOut ? colourOut + i : nullptr);
+  }
+}
+
+// `count` channels starting at `in`, one frame every `stride` floats.
+void levelsStridedScalar(const float* in,
+                         std::size_t frames,
+                         std::size_t stride,
+                         std::size_t count,
+                         float clipLevel,
+                         float* peak,
+                         float* sumSq,
+                         uint32_t* clips)
+{
+  for (std::size_t f = 0; f < frames; ++f) {
+    const float* frame = in + f * stride;
+    for (std::size_t c = 0; c < count; ++c) {
+      const float x = frame[c];
+      const float a = std::fabs(x);
+      peak[c] = std::max(peak[c], a);
+      sumSq[c] += x * x;
+      clips[c] += a >= clipLevel ? 1U : 0U;
+    }
+  }
+}
+
+void channelLevelsScalar(const float* in, std::size_t frames, std::size_t channels, float clipLevel, float* peak, float* sumSq, uint32_t* clips)
+{
+  levelsStridedScalar(in, frames, channels, channels, clipLevel, peak, sumSq, clips);
+}
+
+// Folds per-lane accumulators of a flat pass back onto channels: lane j of a period that starts
+// on a frame boundary always holds channel j % channels.
+void foldLanes(const float* lanePeak,
+               const float* laneSum,
+               const uint32_t* laneClips,
+               std::size_t lanes,
+               std::size_t channels,
+               float* peak,
+               float* sumSq,
+               uint32_t* clips)
+{
+  for (std::size_t j = 0; j < lanes; ++j) {
+    const std::size_t c = j % channels;
+    peak[c] = std::max(peak[c], lanePeak[j]);
+    sumSq[c] += laneSum[j];
+    clips[c] += laneClips[j];
+  }
+}
+
+// Channels [first, first + lanes) of the cascade, lanes <= 8, one frame at a time so every section
+// sees all lanes back to back.
+void cascadeLanesScalar(const BiquadCascade& q,
+                        const float* in,
+                        float* out,
+                        std::size_t frames,
+                        std::size_t channels,
+                        std::size_t first,
+                        std::size_t lanes,
+                        double gain,
+                        double gainStep)
+{
+  double y[8];
+  for (std::size_t f = 0; f < frames; ++f) {
+    const float* x = in + f * channels + first;
+    for (std::size_t l = 0; l < lanes; ++l) {
+      y[l] = static_cast<double>(x[l]) * gain;
+    }
+    for (std::size_t s = 0; s < q.sections; ++s) {
+      double* z1 = q.z1 + s * q.stateStride + first;
+      double* z2 = q.z2 + s * q.stateStride + first;
+      const double b0 = q.b0[s];
+      const double b1 = q.b1[s];
+      const double b2 = q.b2[s];
+      const double a1 = q.a1[s];
+      const double a2 = q.a2[s];
+      for (std::size_t l = 0; l < lanes; ++l) {
+        const double v = b0 * y[l] + z1[l];
+        z1[l] = b1 * y[l] - a1 * v + z2[l];
+        z2[l] = b2 * y[l] - a2 * v;
+        y[l] = v;
+      }
+    }
+    float* o = out + f * channels + first;
+    for (std::size_t l = 0; l < lanes; ++l) {
+      o[l] = static_cast<float>(y[l]);
+    }
+    gain += gainStep;
+  }
+}
+
+void biquadCascadeScalar(const BiquadCascade& q, const float* in, float* out, std::size_t frames, std::size_t channels, double gain, double gainStep)
+{
+  for (std::size_t c = 0; c < channels; c += 8U) {
+    cascadeLanesScalar(q, in, out, frames, channels, c, std::min<std::size_t>(8U, channels - c), gain, gainStep);
+  }
+}
+
+// Fixed-shape cascade: S sections of C channels. With both known the compiler unrolls everything
+// and keeps coefficients and state in registers for the whole call.
+template <std::size_t S, std::size_t C>
+inline __attribute__((always_inline)) void cascadeFixed(const BiquadCascade& q,
+                                                        const float* in,
+                                                        float* out,
+                                                        std::size_t frames,
+                                                        double gain,
+                                                        double gainStep)
+{
+  double b0[S], b1[S], b2[S], a1[S], a2[S];
+  double z1[S][C], z2[S][C];
+  for (std::size_t s = 0; s < S; ++s) {
+    b0[s] = q.b0[s];
+    b1[s] = q.b1[s];
+    b2[s] = q.b2[s];
+    a1[s] = q.a1[s];
+    a2[s] = q.a2[s];
+    std::copy_n(q.z1 + s * q.stateStride, C, z1[s]);
+    std::copy_n(q.z2 + s * q.stateStride, C, z2[s]);
+  }
+
+  for (std::size_t f = 0; f < frames; ++f) {
+    double y[C];
+    for (std::size_t c = 0; c < C; ++c) {
+      y[c] = static_cast<double>(in[f * C + c]) * gain;
+    }
+    for (std::size_t s = 0; s < S; ++s) {
+      for (std::size_t c = 0; c < C; ++c) {
+        const double v = b0[s] * y[c] + z1[s][c];
+        z1[s][c] = b1[s] * y[c] - a1[s] * v + z2[s][c];
+        z2[s][c] = b2[s] * y[c] - a2[s] * v;
+        y[c] = v;
+      }
+    }
+    for (std::size_t c = 0; c < C; ++c) {
+      out[f * C + c] = static_cast<float>(y[c]);
+    }
+    gain += gainStep;
+  }
+
+  for (std::size_t s = 0; s < S; ++s) {
+    std::copy_n(z1[s], C, q.z1 + s * q.stateStride);
+    std::copy_n(z2[s], C, q.z2 + s * q.stateStride);
+  }
+}
+
+template <std::size_t S, std::size_t C>
+void biquadCascadeFixed(const BiquadCascade& q, const float* in, float* out, std::size_t frames, std::size_t channels, double gain, double gainStep)
+{
+  if (q.sections != S || channels != C) {
+    biquadCascade(q, in, out, frames, channels, gain, gainStep);
+    return;
+  }
+  cascadeFixed<S, C>(q, in, out, frames, gain, gainStep);
+}
+
+#if HEADROOM_SIMD_X86
+
+// ---- SSE2 -------------------------------------------------------------------------------------
+
+// (re, im) pairs: [br*wr - bi*wi, bi*wr + br*wi].
+inline __m128 complexMulSse2(__m128 b, __m128 w)
+{
+  const __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+  const __m128 wi = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+  const __m128 bSwap = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+  const __m128 sign = _mm_castsi128_ps(_mm_set_epi32(0, static_cast<int>(0x80000000U), 0, static_cast<int>(0x80000000U)));
+  return _mm_add_ps(_mm_mul_ps(b, wr), _mm_xor_ps(_mm_mul_ps(bSwap, wi), sign));
+}
+
+void radix2StageSse2(std::complex<float>* data, std::size_t n, std::size_t half, const std::complex<float>* twiddles)
+{
+  if (half < 2) {
+    radix2StageScalar(data, n, half, twiddles);
+    return;
+  }
+
+  for (std::size_t i = 0; i < n; i += 2U * half) {
+    float* a = reinterpret_cast<float*>(data + i);
+    float* b = reinterpret_cast<float*>(data + i + half);
+    const float* w = reinterpret_cast<const float*>(twiddles);
+    for (std::size_t j = 0; j < half; j += 2U) {
+      const __m128 u = _mm_loadu_ps(a + 2U * j);
+      const __m128 v = complexMulSse2(_mm_loadu_ps(b + 2U * j), _mm_loadu_ps(w + 2U * j));
+      _mm_storeu_ps(a + 2U * j, _mm_add_ps(u, v));
+      _mm_storeu_ps(b + 2U * j, _mm_sub_ps(u, v));
+    }
+  }
+}
+
+// log2(x) for positive normal x: exponent + 2/ln2 * atanh((m-1)/(m+1)), m in [1, 2).
+inline __m128 log2Sse2(__m128 x)
+{
+  const __m128i xi = _mm_castps_si128(x);
+  const __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(xi, 23), _mm_set1_epi32(127)));
+  const __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(xi, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+  const __m128 t2 = _mm_mul_ps(t, t);
+  __m128 p = _mm_set1_ps(0.41219858f); // 2/(7 ln2)
+  p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(0.57707801f)); // 2/(5 ln2)
+  p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(0.96179669f)); // 2/(3 ln2)
+  p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(2.88539008f)); // 2/ln2
+  return _mm_add_ps(e, _mm_mul_ps(p, t));
+}
+
+void normalizedDbSse2(const std::complex<float>* bins, std::size_t count, float scale, float minDb, float maxDb, float* normOut)
+{
+  const float invRange = 1.0f / (maxDb - minDb);
+  const __m128 scale2 = _mm_set1_ps(scale * scale);
+  const __m128 floor = _mm_set1_ps(kPowerFloor);
+  const __m128 dbPerLog2 = _mm_set1_ps(kDbPerLog2Power * invRange);
+  const __m128 offset = _mm_set1_ps(-minDb * invRange);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  const float* src = reinterpret_cast<const float*>(bins);
+  std::size_t i = 0;
+  for (; i + 4U <= count; i += 4U) {
+    const __m128 a = _mm_loadu_ps(src + 2U * i);
+    const __m128 b = _mm_loadu_ps(src + 2U * i + 4U);
+    const __m128 a2 = _mm_mul_ps(a, a);
+    const __m128 b2 = _mm_mul_ps(b, b);
+    const __m128 re2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 im2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1));
+    const __m128 power = _mm_add_ps(_mm_mul_ps(_mm_add_ps(re2, im2), scale2), floor);
+    const __m128 norm = _mm_add_ps(_mm_mul_ps(log2Sse2(power), dbPerLog2), offset);
+    _mm_storeu_ps(normOut + i, _mm_min_ps(_mm_max_ps(norm, zero), one));
+  }
+  normalizedDbScalarLoop(bins + i, count - i, scale, minDb, maxDb, normOut + i);
+}
+
+void smoothAndColorizeSse2(const float* norm, std::size_t count, float smoothing, float* state, const uint32_t* lut256, uint32_t* colourOut)
+{
+  const __m128 s = _mm_set1_ps(smoothing);
+  const __m128 oneMinusS = _mm_set1_ps(1.0f - smoothing);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 lutScale = _mm_set1_ps(255.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+
+  std::size_t i = 0;
+  alignas(16) int32_t idx[4];
+  for (; i + 4U <= count; i += 4U) {
+    const __m128 n = _mm_loadu_ps(norm + i);
+    const __m128 prev = _mm_loadu_ps(state + i);
+    const __m128 mix = _mm_add_ps(_mm_mul_ps(prev, s), _mm_mul_ps(n, oneMinusS));
+    const __m128 rising = _mm_cmpgt_ps(n, prev);
+    _mm_storeu_ps(state + i, _mm_or_ps(_mm_and_ps(rising, n), _mm_andnot_ps(rising, mix)));
+
+    if (colourOut) {
+      const __m128 clamped = _mm_min_ps(_mm_max_ps(n, zero), one);
+      _mm_store_si128(reinterpret_cast<__m128i*>(idx), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, lutScale), half)));
+      colourOut[i] = lut256[idx[0]];
+      colourOut[i + 1U] = lut256[idx[1]];
+      colourOut[i + 2U] = lut256[idx[2]];
+      colourOut[i + 3U] = lut256[idx[3]];
+    }
+  }
+  smoothAndColorizeScalar(norm + i, count - i, smoothing, state + i, lut256, colourOut ? colourOut + i : nullptr);
+}
+
+// Interleaved frames read as one flat stream, V vectors per period of lcm(channels, 4) floats,
+// so every lane keeps the same channel and the accumulators stay in registers.
+template <std::size_t V>
+void channelLevelsFlatSse2(const float* in, std::size_t frames, std::size_t channels, float clipLevel, float* peak, float* sumSq, uint32_t* clips)
+{
+  constexpr std::size_t kPeriod = 4U * V;
+  const std::size_t total = frames * channels;
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  const __m128 clip = _mm_set1_ps(clipLevel);
+
+  __m128 accPeak[V];
+  __m128 accSum[V];
+  __m128i accClips[V];
+  for (std::size_t v = 0; v < V; ++v) {
+    accPeak[v] = _mm_setzero_ps();
+    accSum[v] = _mm_setzero_ps();
+    accClips[v] = _mm_setzero_si128();
+  }
+
+  std::size_t i = 0;
+  for (; i + kPeriod <= total; i += kPeriod) {
+    for (std::size_t v = 0; v < V; ++v) {
+      const __m128 x = _mm_loadu_ps(in + i + 4U * v);
+      const __m128 a = _mm_and_ps(x, absMask);
+      accPeak[v] = _mm_max_ps(accPeak[v], a);
+      accSum[v] = _mm_add_ps(accSum[v], _mm_mul_ps(x, x));
+      accClips[v] = _mm_sub_epi32(accClips[v], _mm_castps_si128(_mm_cmpge_ps(a, clip))); // mask is -1
+    }
+  }
+
+  alignas(16) float lanePeak[kPeriod];
+  alignas(16) float laneSum[kPeriod];
+  alignas(16) uint32_t laneClips[kPeriod];
+  for (std::size_t v = 0; v < V; ++v) {
+    _mm_store_ps(lanePeak + 4U * v, accPeak[v]);
+    _mm_store_ps(laneSum + 4U * v, accSum[v]);
+    _mm_store_si128(reinterpret_cast<__m128i*>(laneClips + 4U * v), accClips[v]);
+  }
+  foldLanes(lanePeak, laneSum, laneClips, kPeriod, channels, peak, sumSq, clips);
+
+  // Periods are whole frames, so the tail is too.
+  channelLevelsScalar(in + i, (total - i) / channels, channels, clipLevel, peak, sumSq, clips);
+}
+
+// Four adjacent channels, one frame every `stride` floats.
+void channelQuadSse2(const float* in, std::size_t frames, std::size_t stride, float clipLevel, float* peak, float* sumSq, uint32_t* clips)
+{
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  const __m128 clip = _mm_set1_ps(clipLevel);
+  __m128 accPeak = _mm_loadu_ps(peak);
+  __m128 accSum = _mm_setzero_ps();
+  __m128i accClips = _mm_setzero_si128();
+  for (std::size_t f = 0; f < frames; ++f) {
+    const __m128 x = _mm_loadu_ps(in + f * stride);
+    const __m128 a = _mm_and_ps(x, absMask);
+    accPeak = _mm_max_ps(accPeak, a);
+    accSum = _mm_add_ps(accSum, _mm_mul_ps(x, x));
+    accClips = _mm_sub_epi32(accClips, _mm_castps_si128(_mm_cmpge_ps(a, clip)));
+  }
+  _mm_storeu_ps(peak, accPeak);
+  _mm_storeu_ps(sumSq, _mm_add_ps(_mm_loadu_ps(sumSq), accSum));
+  auto* c = reinterpret_cast<__m128i*>(clips);
+  _mm_storeu_si128(c, _mm_add_epi32(_mm_loadu_si128(c), accClips));
+}
+
+// Wide layouts whose period would not fit in registers: vectors across channels, frames inner.
+void channelLevelsStridedSse2(const float* in, std::size_t frames, std::size_t channels, float clipLevel, float* peak, float* sumSq, uint32_t* clips)
+{
+  std::size_t c = 0;
+  for (; c + 4U <= channels; c += 4U) {
+    channelQuadSse2(in + c, frames, channels, clipLevel, peak + c, sumSq + c, clips + c);
+  }
+  levelsStridedScalar(in + c, frames, channels, channels - c, clipLevel, peak + c, sumSq + c, clips + c);
+}
+
+void channelLevelsSse2(const float* in, std::size_t frames, std::size_t channels, float clipLevel, float* peak, float* sumSq, uint32_t* clips)
+{
+  switch (channels / std::gcd(channels, std::size_t{4})) {
+    case 1:
+      return channelLevelsFlatSse2<1>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 2:
+      return channelLevelsFlatSse2<2>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 3:
+      return channelLevelsFlatSse2<3>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 4:
+      return channelLevelsFlatSse2<4>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 5:
+      return channelLevelsFlatSse2<5>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 6:
+      return channelLevelsFlatSse2<6>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 7:
+      return channelLevelsFlatSse2<7>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 8:
+      return channelLevelsFlatSse2<8>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    default:
+      return channelLevelsStridedSse2(in, frames, channels, clipLevel, peak, sumSq, clips);
+  }
+}
+
+// Two channels per register; state is loaded and stored per section, which stays in L1.
+void cascadePairSse2(const BiquadCascade& q, const float* in, float* out, std::size_t frames, std::size_t channels, std::size_t first, double gain, double gainStep)
+{
+  for (std::size_t f = 0; f < frames; ++f) {
+    // Through the may_alias vector types: reading two floats as a double would break strict aliasing.
+    const __m128 x = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + f * channels + first)));
+    __m128d y = _mm_mul_pd(_mm_cvtps_pd(x), _mm_set1_pd(gain));
+    for (std::size_t s = 0; s < q.sections; ++s) {
+      double* z1 = q.z1 + s * q.stateStride + first;
+      double* z2 = q.z2 + s * q.stateStride + first;
+      const __m128d v = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(q.b0[s]), y), _mm_loadu_pd(z1));
+      _mm_storeu_pd(z1, _mm_add_pd(_mm_sub_pd(_mm_mul_pd(_mm_set1_pd(q.b1[s]), y), _mm_mul_pd(_mm_set1_pd(q.a1[s]), v)), _mm_loadu_pd(z2)));
+      _mm_storeu_pd(z2, _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(q.b2[s]), y), _mm_mul_pd(_mm_set1_pd(q.a2[s]), v)));
+      y = v;
+    }
+    _mm_storel_pi(reinterpret_cast<__m64*>(out + f * channels + first), _mm_cvtpd_ps(y));
+    gain += gainStep;
+  }
+}
+
+void biquadCascadeSse2(const BiquadCascade& q, const float* in, float* out, std::size_t frames, std::size_t channels, double gain, double gainStep)
+{
+  std::size_t c = 0;
+  for (; c + 2U <= channels; c += 2U) {
+    cascadePairSse2(q, in, out, frames, channels, c, gain, gainStep);
+  }
+  if (c < channels) {
+    cascadeLanesScalar(q, in, out, frames, channels, c, channels - c, gain, gainStep);
+  }
+}
+
+// ---- AVX2 + FMA -------------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma"))) inline __m256 complexMulAvx2(__m256 b, __m256 w)
+{
+  const __m256 wr = _mm256_moveldup_ps(w);
+  const __m256 wi = _mm256_movehdup_ps(w);
+  const __m256 bSwap = _mm256_permute_ps(b, _MM_SHUFFLE(2, 3, 0, 1));
+  return _mm256_fmaddsub_ps(b, wr, _mm256_mul_ps(bSwap, wi));
+}
+
+__attribute__((target("avx2,fma"))) void radix2StageAvx2(std::complex<float>* data,
+                                                          std::size_t n,
+                                                          std::size_t half,
+                                                          const std::complex<float>* twiddles)
+{
+  if (half < 4) {
+    radix2StageSse2(data, n, half, twiddles);
+    return;
+  }
+
+  for (std::size_t i = 0; i < n; i += 2U * half) {
+    float* a = reinterpret_cast<float*>(data + i);
+    float* b = reinterpret_cast<float*>(data + i + half);
+    const float* w = reinterpret_cast<const float*>(twiddles);
+    for (std::size_t j = 0; j < half; j += 4U) {
+      const __m256 u = _mm256_loadu_ps(a + 2U * j);
+      const __m256 v = complexMulAvx2(_mm256_loadu_ps(b + 2U * j), _mm256_loadu_ps(w + 2U * j));
+      _mm256_storeu_ps(a + 2U * j, _mm256_add_ps(u, v));
+      _mm256_storeu_ps(b + 2U * j, _mm256_sub_ps(u, v));
+    }
+  }
+}
+
+__attribute__((target("avx2,fma"))) inline __m256 log2Avx2(__m256 x)
+{
+  const __m256i xi = _mm256_castps_si256(x);
+  const __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(xi, 23), _mm256_set1_epi32(127)));
+  const __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(xi, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+  const __m256 t2 = _mm256_mul_ps(t, t);
+  __m256 p = _mm256_set1_ps(0.41219858f);
+  p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(0.57707801f));
+  p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(0.96179669f));
+  p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(2.88539008f));
+  return _mm256_fmadd_ps(p, t, e);
+}
+
+__attribute__((target("avx2,fma"))) void normalizedDbAvx2(const std::complex<float>* bins,
+                                                           std::size_t count,
+                                                           float scale,
+                                                           float minDb,
+                                                           float maxDb,
+                                                           float* normOut)
+{
+  const float invRange = 1.0f / (maxDb - minDb);
+  const __m256 scale2 = _mm256_set1_ps(scale * scale);
+  const __m256 floor = _mm256_set1_ps(kPowerFloor);
+  const __m256 dbPerLog2 = _mm256_set1_ps(kDbPerLog2Power * invRange);
+  const __m256 offset = _mm256_set1_ps(-minDb * invRange);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+
+  const float* src = reinterpret_cast<const float*>(bins);
+  std::size_t i = 0;
+  for (; i + 8U <= count; i += 8U) {
+    const __m256 a = _mm256_loadu_ps(src + 2U * i);
+    const __m256 b = _mm256_loadu_ps(src + 2U * i + 8U);
+    const __m256 a2 = _mm256_mul_ps(a, a);
+    const __m256 b2 = _mm256_mul_ps(b, b);
+    // Per 128-bit lane: [c0 c1 c4 c5 | c2 c3 c6 c7] -> reorder 64-bit pairs back to c0..c7.
+    const __m256 lanes = _mm256_add_ps(_mm256_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0)), _mm256_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1)));
+    const __m256 sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(lanes), _MM_SHUFFLE(3, 1, 2, 0)));
+    const __m256 power = _mm256_fmadd_ps(sum, scale2, floor);
+    const __m256 norm = _mm256_fmadd_ps(log2Avx2(power), dbPerLog2, offset);
+    _mm256_storeu_ps(normOut + i, _mm256_min_ps(_mm256_max_ps(norm, zero), one));
+  }
+  normalizedDbSse2(bins + i, count - i, scale, minDb, maxDb, normOut + i);
+}
+
+__attribute__((target("avx2,fma"))) void smoothAndColorizeAvx2(const float* norm,
+                                                                std::size_t count,
+                                                                float smoothing,
+                                                                float* state,
+                                                                const uint32_t* lut256,
+                                                                uint32_t* colourOut)
+{
+  const __m256 s = _mm256_set1_ps(smoothing);
+  const __m256 oneMinusS = _mm256_set1_ps(1.0f - smoothing);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 lutScale = _mm256_set1_ps(255.0f);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const int* lut = reinterpret_cast<const int*>(lut256);
+
+  std::size_t i = 0;
+  for (; i + 8U <= count; i += 8U) {
+    const __m256 n = _mm256_loadu_ps(norm + i);
+    const __m256 prev = _mm256_loadu_ps(state + i);
+    const __m256 mix = _mm256_fmadd_ps(prev, s, _mm256_mul_ps(n, oneMinusS));
+    _mm256_storeu_ps(state + i, _mm256_blendv_ps(mix, n, _mm256_cmp_ps(n, prev, _CMP_GT_OQ)));
+
+    if (colourOut) {
+      const __m256 clamped = _mm256_min_ps(_mm256_max_ps(n, zero), one);
+      const __m256i idx = _mm256_cvttps_epi32(_mm256_fmadd_ps(clamped, lutScale, half));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(colourOut + i), _mm256_i32gather_epi32(lut, idx, 4));
+    }
+  }
+  smoothAndColorizeSse2(norm + i, count - i, smoothing, state + i, lut256, colourOut ? colourOut + i : nullptr);
+}
+
+template <std::size_t V>
+__attribute__((target("avx2,fma"))) void channelLevelsFlatAvx2(const float* in,
+                                                                std::size_t frames,
+                                                                std::size_t channels,
+                                                                float clipLevel,
+                                                                float* peak,
+                                                                float* sumSq,
+                                                                uint32_t* clips)
+{
+  constexpr std::size_t kPeriod = 8U * V;
+  const std::size_t total = frames * channels;
+  const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+  const __m256 clip = _mm256_set1_ps(clipLevel);
+
+  __m256 accPeak[V];
+  __m256 accSum[V];
+  __m256i accClips[V];
+  for (std::size_t v = 0; v < V; ++v) {
+    accPeak[v] = _mm256_setzero_ps();
+    accSum[v] = _mm256_setzero_ps();
+    accClips[v] = _mm256_setzero_si256();
+  }
+
+  std::size_t i = 0;
+  for (; i + kPeriod <= total; i += kPeriod) {
+    for (std::size_t v = 0; v < V; ++v) {
+      const __m256 x = _mm256_loadu_ps(in + i + 8U * v);
+      const __m256 a = _mm256_and_ps(x, absMask);
+      accPeak[v] = _mm256_max_ps(accPeak[v], a);
+      accSum[v] = _mm256_fmadd_ps(x, x, accSum[v]);
+      accClips[v] = _mm256_sub_epi32(accClips[v], _mm256_castps_si256(_mm256_cmp_ps(a, clip, _CMP_GE_OQ)));
+    }
+  }
+
+  alignas(32) float lanePeak[kPeriod];
+  alignas(32) float laneSum[kPeriod];
+  alignas(32) uint32_t laneClips[kPeriod];
+  for (std::size_t v = 0; v < V; ++v) {
+    _mm256_store_ps(lanePeak + 8U * v, accPeak[v]);
+    _mm256_store_ps(laneSum + 8U * v, accSum[v]);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(laneClips + 8U * v), accClips[v]);
+  }
+  foldLanes(lanePeak, laneSum, laneClips, kPeriod, channels, peak, sumSq, clips);
+
+  channelLevelsSse2(in + i, (total - i) / channels, channels, clipLevel, peak, sumSq, clips);
+}
+
+__attribute__((target("avx2,fma"))) void channelOctetAvx2(const float* in,
+                                                           std::size_t frames,
+                                                           std::size_t stride,
+                                                           float clipLevel,
+                                                           float* peak,
+                                                           float* sumSq,
+                                                           uint32_t* clips)
+{
+  const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+  const __m256 clip = _mm256_set1_ps(clipLevel);
+  __m256 accPeak = _mm256_loadu_ps(peak);
+  __m256 accSum = _mm256_setzero_ps();
+  __m256i accClips = _mm256_setzero_si256();
+  for (std::size_t f = 0; f < frames; ++f) {
+    const __m256 x = _mm256_loadu_ps(in + f * stride);
+    const __m256 a = _mm256_and_ps(x, absMask);
+    accPeak = _mm256_max_ps(accPeak, a);
+    accSum = _mm256_fmadd_ps(x, x, accSum);
+    accClips = _mm256_sub_epi32(accClips, _mm256_castps_si256(_mm256_cmp_ps(a, clip, _CMP_GE_OQ)));
+  }
+  _mm256_storeu_ps(peak, accPeak);
+  _mm256_storeu_ps(sumSq, _mm256_add_ps(_mm256_loadu_ps(sumSq), accSum));
+  auto* c = reinterpret_cast<__m256i*>(clips);
+  _mm256_storeu_si256(c, _mm256_add_epi32(_mm256_loadu_si256(c), accClips));
+}
+
+__attribute__((target("avx2,fma"))) void channelLevelsStridedAvx2(const float* in,
+                                                                   std::size_t frames,
+                                                                   std::size_t channels,
+                                                                   float clipLevel,
+                                                                   float* peak,
+                                                                   float* sumSq,
+                                                                   uint32_t* clips)
+{
+  std::size_t c = 0;
+  for (; c + 8U <= channels; c += 8U) {
+    channelOctetAvx2(in + c, frames, channels, clipLevel, peak + c, sumSq + c, clips + c);
+  }
+  if (c + 4U <= channels) {
+    channelQuadSse2(in + c, frames, channels, clipLevel, peak + c, sumSq + c, clips + c);
+    c += 4U;
+  }
+  levelsStridedScalar(in + c, frames, channels, channels - c, clipLevel, peak + c, sumSq + c, clips + c);
+}
+
+void channelLevelsAvx2(const float* in, std::size_t frames, std::size_t channels, float clipLevel, float* peak, float* sumSq, uint32_t* clips)
+{
+  switch (channels / std::gcd(channels, std::size_t{8})) {
+    case 1:
+      return channelLevelsFlatAvx2<1>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 2:
+      return channelLevelsFlatAvx2<2>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 3:
+      return channelLevelsFlatAvx2<3>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 4:
+      return channelLevelsFlatAvx2<4>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 5:
+      return channelLevelsFlatAvx2<5>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 6:
+      return channelLevelsFlatAvx2<6>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 7:
+      return channelLevelsFlatAvx2<7>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    case 8:
+      return channelLevelsFlatAvx2<8>(in, frames, channels, clipLevel, peak, sumSq, clips);
+    default:
+      return channelLevelsStridedAvx2(in, frames, channels, clipLevel, peak, sumSq, clips);
+  }
+}
+
+// Four channels per register, V registers (4 or 8 channels) in flight so independent lanes hide
+// the latency of the recursion.
+template <std::size_t V>
+__attribute__((target("avx2,fma"))) void cascadeQuadsAvx2(const BiquadCascade& q,
+                                                           const float* in,
+                                                           float* out,
+                                                           std::size_t frames,
+                                                           std::size_t channels,
+                                                           std::size_t first,
+                                                           double gain,
+                                                           double gainStep)
+{
+  for (std::size_t f = 0; f < frames; ++f) {
+    const float* x = in + f * channels + first;
+    const __m256d g = _mm256_set1_pd(gain);
+    __m256d y[V];
+    for (std::size_t v = 0; v < V; ++v) {
+      y[v] = _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + 4U * v)), g);
+    }
+    for (std::size_t s = 0; s < q.sections; ++s) {
+      double* z1 = q.z1 + s * q.stateStride + first;
+      double* z2 = q.z2 + s * q.stateStride + first;
+      const __m256d b0 = _mm256_set1_pd(q.b0[s]);
+      const __m256d b1 = _mm256_set1_pd(q.b1[s]);
+      const __m256d b2 = _mm256_set1_pd(q.b2[s]);
+      const __m256d a1 = _mm256_set1_pd(q.a1[s]);
+      const __m256d a2 = _mm256_set1_pd(q.a2[s]);
+      for (std::size_t v = 0; v < V; ++v) {
+        const __m256d o = _mm256_fmadd_pd(b0, y[v], _mm256_loadu_pd(z1 + 4U * v));
+        _mm256_storeu_pd(z1 + 4U * v, _mm256_fnmadd_pd(a1, o, _mm256_fmadd_pd(b1, y[v], _mm256_loadu_pd(z2 + 4U * v))));
+        _mm256_storeu_pd(z2 + 4U * v, _mm256_fnmadd_pd(a2, o, _mm256_mul_pd(b2, y[v])));
+        y[v] = o;
+      }
+    }
+    float* o = out + f * channels + first;
+    for (std::size_t v = 0; v < V; ++v) {
+      _mm_storeu_ps(o + 4U * v, _mm256_cvtpd_ps(y[v]));
+    }
+    gain += gainStep;
+  }
+}
+
+void biquadCascadeAvx2(const BiquadCascade& q, const float* in, float* out, std::size_t frames, std::size_t channels, double gain, double gainStep)
+{
+  std::size_t c = 0;
+  for (; c + 8U <= channels; c += 8U) {
+    cascadeQuadsAvx2<2>(q, in, out, frames, channels, c, gain, gainStep);
+  }
+  if (c + 4U <= channels) {
+    cascadeQuadsAvx2<1>(q, in, out, frames, channels, c, gain, gainStep);
+    c += 4U;
+  }
+  for (; c + 2U <= channels; c += 2U) {
+    cascadePairSse2(q, in, out, frames, channels, c, gain, gainStep);
+  }
+  if (c < channels) {
+    cascadeLanesScalar(q, in, out, frames, channels, c, channels - c, gain, gainStep);
+  }
+}
+
+template <std::size_t S, std::size_t C>
+__attribute__((target("avx2,fma"))) void biquadCascadeFixedAvx2(const BiquadCascade& q,
+                                                                 const float* in,
+                                                                 float* out,
+                                                                 std::size_t frames,
+                                                                 std::size_t channels,
+                                                                 double gain,
+                                                                 double gainStep)
+{
+  if (q.sections != S || channels != C) {
+    biquadCascade(q, in, out, frames, channels, gain, gainStep);
+    return;
+  }
+  cascadeFixed<S, C>(q, in, out, frames, gain, gainStep);
+}
+
+#endif // HEADROOM_SIMD_X86
+
+Kernels selectKernels()
+{
+  Kernels k;
+  k.level = Level::Scalar;
+  k.radix2Stage = &radix2StageScalar;
+  k.normalizedDb = &normalizedDbScalarLoop;
+  k.smoothAndColorize = &smoothAndColorizeScalar;
+  k.channelLevels = &channelLevelsScalar;
+  k.biquadCascade = &biquadCascadeScalar;
+
+#if HEADROOM_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    k.level = Level::Sse2;
+    k.radix2Stage = &radix2StageSse2;
+    k.normalizedDb = &normalizedDbSse2;
+    k.smoothAndColorize = &smoothAndColorizeSse2;
+    k.channelLevels = &channelLevelsSse2;
+    k.biquadCascade = &biquadCascadeSse2;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    k.level = Level::Avx2;
+    k.radix2Stage = &radix2StageAvx2;
+    k.normalizedDb = &normalizedDbAvx2;
+    k.smoothAndColorize = &smoothAndColorizeAvx2;
+    k.channelLevels = &channelLevelsAvx2;
+    k.biquadCascade = &biquadCascadeAvx2;
+  }
+#endif
+
+  return k;
+}
+
+const Kernels& kernels()
+{
+  static const Kernels k = selectKernels();
+  return k;
+}
+
+template <std::size_t S, std::size_t C>
+BiquadCascadeFn fixedCascade()
+{
+#if HEADROOM_SIMD_X86
+  if (kernels().level == Level::Avx2) {
+    return &biquadCascadeFixedAvx2<S, C>;
+  }
+#endif
+  return &biquadCascadeFixed<S, C>;
+}
+
+// Mono and stereo ports only: from four channels up the AVX2 lanes of the generic kernel are
+// already full, and the fixed shape no longer fits in registers, so it measured slower there.
+template <std::size_t S>
+BiquadCascadeFn fixedCascadeFor(std::size_t channels)
+{
+  switch (channels) {
+    case 1:
+      return fixedCascade<S, 1>();
+    case 2:
+      return fixedCascade<S, 2>();
+    default:
+      return nullptr;
+  }
+}
+} // namespace
+
+Level activeLevel()
+{
+  return kernels().level;
+}
+
+const char* levelName(Level level)
+{
+  switch (level) {
+    case Level::Scalar:
+      return "scalar";
+    case Level::Sse2:
+      return "sse2";
+    case Level::Avx2:
+      return "avx2";
+  }
+  return "unknown";
+}
+
+void radix2Stage(std::complex<float>* data, std::size_t n, std::size_t half, const std::complex<float>* twiddles)
+{
+  kernels().radix2Stage(data, n, half, twiddles);
+}
+
+void normalizedDb(const std::complex<float>* bins, std::size_t count, float scale, float minDb, float maxDb, float* normOut)
+{
+  kernels().normalizedDb(bins, count, scale, minDb, maxDb, normOut);
+}
+
+void smoothAndColorize(const float* norm, std::size_t count, float smoothing, float* state, const uint32_t* lut256, uint32_t* colourOut)
+{
+  kernels().smoothAndColorize(norm, count, smoothing, state, lut256, colourOut);
+}
+
+void channelLevels(const float* interleaved,
+                   std::size_t frames,
+                   std::size_t channels,
+                   float clipLevel,
+                   float* peak,
+                   float* sumSq,
+                   uint32_t* clips)
+{
+  if (channels == 0 || frames == 0) {
+    return;
+  }
+  kernels().channelLevels(interleaved, frames, channels, clipLevel, peak, sumSq, clips);
+}
+
+void biquadCascade(const BiquadCascade& cascade,
+                   const float* in,
+                   float* out,
+                   std::size_t frames,
+                   std::size_t channels,
+                   double gain,
+                   double gainStep)
+{
+  if (channels == 0 || frames == 0) {
+    return;
+  }
+  kernels().biquadCascade(cascade, in, out, frames, channels, gain, gainStep);
+}
+
+BiquadCascadeFn biquadCascadeFor(std::size_t sections, std::size_t channels)
+{
+  // The default preset has 6 bands; AutoEQ exports have 10, and up to 16 with extra filters.
+  BiquadCascadeFn fn = nullptr;
+  switch (sections) {
+    case 6:
+      fn = fixedCascadeFor<6>(channels);
+      break;
+    case 10:
+      fn = fixedCascadeFor<10>(channels);
+      break;
+    case 16:
+      fn = fixedCascadeFor<16>(channels);
+      break;
+    default:
+      break;
+  }
+  return fn ? fn : &biquadCascade;
+}
+
+} // namespace dsp::simd
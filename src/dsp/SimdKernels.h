@@ -0,0 +1,80 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+namespace dsp::simd {
+
+// Instruction set picked at startup (x86: AVX2+FMA, then SSE2, else scalar).
+enum class Level {
+  Scalar,
+  Sse2,
+  Avx2,
+};
+
+Level activeLevel();
+const char* levelName(Level level);
+
+// One radix-2 DIT stage over n points: for every group of 2*half points,
+// (a, b) -> (a + w*b, a - w*b) with w = twiddles[j], j < half (contiguous per stage).
+void radix2Stage(std::complex<float>* data, std::size_t n, std::size_t half, const std::complex<float>* twiddles);
+
+// norm[i] = clamp01((10*log10(|bins[i]|^2 * scale^2) - minDb) / (maxDb - minDb)).
+void normalizedDb(const std::complex<float>* bins, std::size_t count, float scale, float minDb, float maxDb, float* normOut);
+
+// Peak-hold-ish smoothing (state = norm > state ? norm : state*s + norm*(1-s)) and palette lookup
+// (colour = lut256[round(norm*255)]) over a whole column. colourOut may be null.
+void smoothAndColorize(const float* norm,
+                       std::size_t count,
+                       float smoothing,
+                       float* state,
+                       const uint32_t* lut256,
+                       uint32_t* colourOut);
+
+// Per-channel level reduction over interleaved frames: peak[c] = max(peak[c], |x|),
+// sumSq[c] += x*x and clips[c] += (|x| >= clipLevel) for every sample of channel c. Results are
+// accumulated, so the caller clears the arrays (each `channels` long) before the first call.
+void channelLevels(const float* interleaved,
+                   std::size_t frames,
+                   std::size_t channels,
+                   float clipLevel,
+                   float* peak,
+                   float* sumSq,
+                   uint32_t* clips);
+
+// A cascade of Direct Form II transposed biquads (a0 == 1). Coefficients are one array per term,
+// `sections` long. z1/z2 of section s, channel c live at [s * stateStride + c], so the channels of
+// one section sit next to each other and run in SIMD lanes.
+struct BiquadCascade final {
+  const double* b0 = nullptr;
+  const double* b1 = nullptr;
+  const double* b2 = nullptr;
+  const double* a1 = nullptr;
+  const double* a2 = nullptr;
+  std::size_t sections = 0;
+  double* z1 = nullptr;
+  double* z2 = nullptr;
+  std::size_t stateStride = 0;
+};
+
+// out = cascade(in * gain) over interleaved frames of `channels` channels, with gain advancing by
+// gainStep every frame. Filtering runs in double precision; `in` and `out` may be the same buffer.
+void biquadCascade(const BiquadCascade& cascade,
+                   const float* in,
+                   float* out,
+                   std::size_t frames,
+                   std::size_t channels,
+                   double gain,
+                   double gainStep);
+
+using BiquadCascadeFn = void (*)(const BiquadCascade&, const float*, float*, std::size_t, std::size_t, double, double);
+
+// A biquadCascade() built for exactly this many sections and channels, with the loops unrolled
+// and the state held in registers for the whole call, or biquadCascade() itself for shapes that
+// have no such build (or would not gain from one).
+// Pick it once when the cascade is designed; called with a different shape it still works, by
+// forwarding to biquadCascade().
+BiquadCascadeFn biquadCascadeFor(std::size_t sections, std::size_t channels);
+
+} // namespace dsp::simd
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace dsp {
+
+// Wait-free single-producer/single-consumer ring buffer.
+//
+// Storage is allocated once by reset() (never from the producer or consumer side), so
+// write() is safe to call from a realtime audio callback: it never locks or allocates and
+// simply truncates when the consumer falls behind.
+template <typename T>
+class SpscRing final
+{
+public:
+  SpscRing() = default;
+  explicit SpscRing(std::size_t capacity) { reset(capacity); }
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  // Not thread-safe: only call while neither side is active.
+  void reset(std::size_t capacity)
+  {
+    std::size_t n = 2;
+    while (n < capacity) {
+      n <<= 1U;
+    }
+    m_data.assign(n, T{});
+    m_mask = n - 1U;
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+  }
+
+  std::size_t capacity() const { return m_data.size(); }
+
+  std::size_t readAvailable() const
+  {
+    return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed);
+  }
+
+  std::size_t writeAvailable() const
+  {
+    return m_data.size() - (m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire));
+  }
+
+  // Producer side. Returns the number of elements actually written.
+  std::size_t write(const T* src, std::size_t count)
+  {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    const std::size_t tail = m_tail.load(std::memory_order_acquire);
+    const std::size_t n = std::min(count, m_data.size() - (head - tail));
+    if (n == 0) {
+      return 0;
+    }
+
+    const std::size_t start = head & m_mask;
+    const std::size_t first = std::min(n, m_data.size() - start);
+    std::copy(src, src + first, m_data.begin() + static_cast<std::ptrdiff_t>(start));
+    std::copy(src + first, src + n, m_data.begin());
+
+    m_head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  // Consumer side. Returns the number of elements actually read.
+  std::size_t read(T* dst, std::size_t count)
+  {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    const std::size_t head = m_head.load(std::memory_order_acquire);
+    const std::size_t n = std::min(count, head - tail);
+    if (n == 0) {
+      return 0;
+    }
+
+    const std::size_t start = tail & m_mask;
+    const std::size_t first = std::min(n, m_data.size() - start);
+    std::copy(m_data.begin() + static_cast<std::ptrdiff_t>(start), m_data.begin() + static_cast<std::ptrdiff_t>(start + first), dst);
+    std::copy(m_data.begin(), m_data.begin() + static_cast<std::ptrdiff_t>(n - first), dst + first);
+
+    m_tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // Consumer side: drop everything currently queued.
+  void clear() { m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+  std::vector<T> m_data;
+  std::size_t m_mask = 0;
+
+  alignas(64) std::atomic<std::size_t> m_head{0};
+  alignas(64) std::atomic<std::size_t> m_tail{0};
+};
+
+// Multi-channel variant of SpscRing with planar (one plane per channel) storage and a single
+// shared head/tail, so all channels always stay frame-aligned. The producer hands over
+// interleaved audio and the ring deinterleaves it on the way in.
+class SpscPlanarRing final
+{
+public:
+  SpscPlanarRing() = default;
+
+  SpscPlanarRing(const SpscPlanarRing&) = delete;
+  SpscPlanarRing& operator=(const SpscPlanarRing&) = delete;
+
+  // Not thread-safe: only call while neither side is active.
+  void reset(std::size_t channels, std::size_t capacityFrames)
+  {
+    std::size_t n = 2;
+    while (n < capacityFrames) {
+      n <<= 1U;
+    }
+    m_channels = std::max<std::size_t>(1U, channels);
+    m_frames = n;
+    m_mask = n - 1U;
+    m_data.assign(m_channels * n, 0.0f);
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+  }
+
+  std::size_t channels() const { return m_channels; }
+  std::size_t capacity() const { return m_frames; }
+
+  std::size_t readAvailable() const
+  {
+    return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed);
+  }
+
+  // Producer side: deinterleaves up to `frames` frames of `srcChannels`-wide audio. Channels
+  // beyond channels() are ignored and planes past srcChannels are left untouched, so consumers
+  // should only read as many channels as the producer is known to deliver. Returns frames written.
+  std::size_t writeInterleaved(const float* src, std::size_t srcChannels, std::size_t frames)
+  {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    const std::size_t tail = m_tail.load(std::memory_order_acquire);
+    const std::size_t n = std::min(frames, m_frames - (head - tail));
+    if (n == 0 || srcChannels == 0) {
+      return 0;
+    }
+
+    const std::size_t used = std::min(srcChannels, m_channels);
+    for (std::size_t i = 0; i < n; ++i) {
+      const float* frame = src + i * srcChannels;
+      const std::size_t pos = (head + i) & m_mask;
+      for (std::size_t ch = 0; ch < used; ++ch) {
+        m_data[ch * m_frames + pos] = frame[ch];
+      }
+    }
+
+    m_head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  // Consumer side: copies up to `frames` frames of the first `channels` planes into dst[ch].
+  std::size_t read(float* const* dst, std::size_t channels, std::size_t frames)
+  {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    const std::size_t head = m_head.load(std::memory_order_acquire);
+    const std::size_t n = std::min(frames, head - tail);
+    if (n == 0) {
+      return 0;
+    }
+
+    const std::size_t start = tail & m_mask;
+    const std::size_t first = std::min(n, m_frames - start);
+    const std::size_t used = std::min(channels, m_channels);
+    for (std::size_t ch = 0; ch < used; ++ch) {
+      const float* plane = m_data.data() + ch * m_frames;
+      std::copy(plane + start, plane + start + first, dst[ch]);
+      std::copy(plane, plane + (n - first), dst[ch] + first);
+    }
+
+    m_tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  void clear() { m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+  std::vector<float> m_data; // m_channels planes of m_frames samples
+  std::size_t m_channels = 1;
+  std::size_t m_frames = 0;
+  std::size_t m_mask = 0;
+
+  alignas(64) std::atomic<std::size_t> m_head{0};
+  alignas(64) std::atomic<std::size_t> m_tail{0};
+};
+
+} // namespace dsp
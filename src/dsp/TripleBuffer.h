@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace dsp {
+
+// Lock-free single-writer/single-reader triple buffer.
+//
+// The writer fills back(), then publish() swaps it with the shared middle slot. The reader
+// calls update() to grab the newest published slot and then reads front() at leisure; neither
+// side ever blocks the other, and the reader always sees a complete value.
+template <typename T>
+class TripleBuffer final
+{
+public:
+  TripleBuffer() = default;
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // Writer side.
+  T& back() { return m_slots[m_back]; }
+  void publish() { m_back = m_middle.exchange(static_cast<uint8_t>(m_back | kDirty), std::memory_order_acq_rel) & kIndexMask; }
+
+  // Reader side. Returns true if a newer value was picked up.
+  bool update()
+  {
+    if ((m_middle.load(std::memory_order_relaxed) & kDirty) == 0) {
+      return false;
+    }
+    m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+  const T& front() const { return m_slots[m_front]; }
+
+private:
+  static constexpr uint8_t kDirty = 0x4;
+  static constexpr uint8_t kIndexMask = 0x3;
+
+  T m_slots[3]{};
+  uint8_t m_back = 0;
+  uint8_t m_front = 1;
+  std::atomic<uint8_t> m_middle{2};
+};
+
+} // namespace dsp
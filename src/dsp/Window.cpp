@@ -0,0 +1,88 @@
+#include "Window.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace dsp {
+
+namespace {
+
+constexpr double kTwoPi = 6.283185307179586476925;
+
+// Sum of cosines: a0 - a1 cos(x) + a2 cos(2x) - a3 cos(3x) + a4 cos(4x), x = 2*pi*i/(n-1).
+std::vector<float> cosineSum(std::size_t n, const double* a, std::size_t terms)
+{
+  std::vector<float> w(n, 1.0f);
+  if (n < 2) {
+    return w;
+  }
+  const double denom = static_cast<double>(n - 1);
+  for (std::size_t i = 0; i < n; ++i) {
+    const double x = kTwoPi * static_cast<double>(i) / denom;
+    double v = 0.0;
+    for (std::size_t k = 0; k < terms; ++k) {
+      v += ((k & 1U) ? -a[k] : a[k]) * std::cos(static_cast<double>(k) * x);
+    }
+    w[i] = static_cast<float>(v);
+  }
+  return w;
+}
+
+// Zeroth-order modified Bessel function of the first kind (power series).
+double besselI0(double x)
+{
+  double sum = 1.0;
+  double term = 1.0;
+  const double q = 0.25 * x * x;
+  for (int k = 1; k < 64; ++k) {
+    term *= q / static_cast<double>(k * k);
+    sum += term;
+    if (term < sum * 1.0e-12) {
+      break;
+    }
+  }
+  return sum;
+}
+
+} // namespace
+
+std::vector<float> makeWindow(WindowType type, std::size_t n, double kaiserBeta)
+{
+  switch (type) {
+    case WindowType::Hann: {
+      static constexpr double a[] = {0.5, 0.5};
+      return cosineSum(n, a, 2);
+    }
+    case WindowType::BlackmanHarris: {
+      static constexpr double a[] = {0.35875, 0.48829, 0.14128, 0.01168};
+      return cosineSum(n, a, 4);
+    }
+    case WindowType::FlatTop: {
+      static constexpr double a[] = {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368};
+      return cosineSum(n, a, 5);
+    }
+    case WindowType::Kaiser: {
+      std::vector<float> w(n, 1.0f);
+      if (n < 2) {
+        return w;
+      }
+      const double norm = besselI0(kaiserBeta);
+      const double half = static_cast<double>(n - 1) * 0.5;
+      for (std::size_t i = 0; i < n; ++i) {
+        const double r = (static_cast<double>(i) - half) / half;
+        w[i] = static_cast<float>(besselI0(kaiserBeta * std::sqrt(std::max(0.0, 1.0 - r * r))) / norm);
+      }
+      return w;
+    }
+  }
+  return std::vector<float>(n, 1.0f);
+}
+
+float amplitudeScale(const std::vector<float>& window)
+{
+  const double sum = std::accumulate(window.begin(), window.end(), 0.0);
+  return sum > 0.0 ? static_cast<float>(2.0 / sum) : 1.0f;
+}
+
+} // namespace dsp
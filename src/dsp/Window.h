@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace dsp {
+
+enum class WindowType {
+  Hann,
+  BlackmanHarris, // 4-term, ~-92 dB sidelobes
+  FlatTop,        // amplitude-accurate (scalloping < 0.01 dB), wide main lobe
+  Kaiser,
+};
+
+// Symmetric window of n points (same convention as Fft::hannWindow).
+std::vector<float> makeWindow(WindowType type, std::size_t n, double kaiserBeta = 9.0);
+
+// 2 / sum(w): scales |X[k]| of a windowed full-scale sine back to amplitude 1 (0 dBFS).
+float amplitudeScale(const std::vector<float>& window);
+
+} // namespace dsp
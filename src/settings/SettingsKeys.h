@@ -38,6 +38,46 @@ inline QString visualizerSpectrogramHistorySeconds()
   return QStringLiteral("visualizer/spectrogramHistorySeconds");
 }
 
+inline QString visualizerMultiChannel()
+{
+  return QStringLiteral("visualizer/multiChannel");
+}
+
+inline QString visualizerMidSide()
+{
+  return QStringLiteral("visualizer/midSide");
+}
+
+inline QString visualizerBandScale()
+{
+  return QStringLiteral("visualizer/bandScale");
+}
+
+inline QString visualizerBandCount()
+{
+  return QStringLiteral("visualizer/bandCount");
+}
+
+inline QString visualizerBandRmsPooling()
+{
+  return QStringLiteral("visualizer/bandRmsPooling");
+}
+
+inline QString visualizerWindowType()
+{
+  return QStringLiteral("visualizer/windowType");
+}
+
+inline QString visualizerOverlapPercent()
+{
+  return QStringLiteral("visualizer/overlapPercent");
+}
+
+inline QString visualizerZeroPadding()
+{
+  return QStringLiteral("visualizer/zeroPadding");
+}
+
 inline QString patchbayLayoutEditMode()
 {
   return QStringLiteral("patchbay/layoutEditMode");
@@ -13,6 +13,14 @@ struct VisualizerSettings final {
   double spectrumSmoothing = 0.92;      // 0..1, higher = more smoothing
   double waveformHistorySeconds = 0.5;  // seconds
   double spectrogramHistorySeconds = 2; // seconds
+  bool multiChannel = false;            // per-channel waveforms/spectra instead of mixdown only
+  bool midSide = false;                 // mid/side spectra + correlation/phase scope (>= 2 channels)
+  int bandScale = 1;                    // 0 linear, 1 log, 2 mel, 3 1/3 octave, 4 1/6 octave
+  int bandCount = 96;                   // display bands (linear/log/mel; octave scales derive their own)
+  bool bandRmsPooling = false;          // false = max of the bins in a band, true = RMS
+  int windowType = 0;                   // 0 Hann, 1 Blackman-Harris, 2 flat-top, 3 Kaiser
+  double overlapPercent = 75.0;         // 50..93.75
+  int zeroPadding = 1;                  // FFT length multiplier: 1, 2, 4 or 8
 };
 
 namespace VisualizerSettingsStore {
@@ -35,11 +43,31 @@ inline VisualizerSettings load(QSettings& s)
   out.spectrumSmoothing = std::clamp(out.spectrumSmoothing, 0.0, 0.999);
 
   out.waveformHistorySeconds = s.value(SettingsKeys::visualizerWaveformHistorySeconds(), out.waveformHistorySeconds).toDouble();
-  out.waveformHistorySeconds = std::clamp(out.waveformHistorySeconds, 0.05, 30.0);
+  out.waveformHistorySeconds = std::clamp(out.waveformHistorySeconds, 0.05, 300.0);
 
   out.spectrogramHistorySeconds = s.value(SettingsKeys::visualizerSpectrogramHistorySeconds(), out.spectrogramHistorySeconds).toDouble();
   out.spectrogramHistorySeconds = std::clamp(out.spectrogramHistorySeconds, 0.25, 120.0);
 
+  out.multiChannel = s.value(SettingsKeys::visualizerMultiChannel(), out.multiChannel).toBool();
+  out.midSide = s.value(SettingsKeys::visualizerMidSide(), out.midSide).toBool();
+
+  out.bandScale = s.value(SettingsKeys::visualizerBandScale(), out.bandScale).toInt();
+  out.bandScale = std::clamp(out.bandScale, 0, 4);
+
+  out.bandCount = s.value(SettingsKeys::visualizerBandCount(), out.bandCount).toInt();
+  out.bandCount = std::clamp(out.bandCount, 16, 512);
+
+  out.bandRmsPooling = s.value(SettingsKeys::visualizerBandRmsPooling(), out.bandRmsPooling).toBool();
+
+  out.windowType = s.value(SettingsKeys::visualizerWindowType(), out.windowType).toInt();
+  out.windowType = std::clamp(out.windowType, 0, 3);
+
+  out.overlapPercent = s.value(SettingsKeys::visualizerOverlapPercent(), out.overlapPercent).toDouble();
+  out.overlapPercent = std::clamp(out.overlapPercent, 50.0, 93.75);
+
+  out.zeroPadding = s.value(SettingsKeys::visualizerZeroPadding(), out.zeroPadding).toInt();
+  out.zeroPadding = std::clamp(out.zeroPadding, 1, 8);
+
   return out;
 }
 
@@ -47,7 +75,10 @@ inline bool approxEqual(const VisualizerSettings& a, const VisualizerSettings& b
 {
   auto eqD = [](double x, double y) { return std::abs(x - y) < 1.0e-6; };
   return a.refreshIntervalMs == b.refreshIntervalMs && a.fftSize == b.fftSize && eqD(a.spectrumSmoothing, b.spectrumSmoothing)
-      && eqD(a.waveformHistorySeconds, b.waveformHistorySeconds) && eqD(a.spectrogramHistorySeconds, b.spectrogramHistorySeconds);
+      && eqD(a.waveformHistorySeconds, b.waveformHistorySeconds) && eqD(a.spectrogramHistorySeconds, b.spectrogramHistorySeconds)
+      && a.multiChannel == b.multiChannel && a.midSide == b.midSide && a.bandScale == b.bandScale && a.bandCount == b.bandCount
+      && a.bandRmsPooling == b.bandRmsPooling && a.windowType == b.windowType && eqD(a.overlapPercent, b.overlapPercent)
+      && a.zeroPadding == b.zeroPadding;
 }
 
 inline void save(QSettings& s, const VisualizerSettings& v)
@@ -67,6 +98,14 @@ inline void save(QSettings& s, const VisualizerSettings& v)
   setOrRemove(SettingsKeys::visualizerSpectrumSmoothing(), v.spectrumSmoothing, d.spectrumSmoothing);
   setOrRemove(SettingsKeys::visualizerWaveformHistorySeconds(), v.waveformHistorySeconds, d.waveformHistorySeconds);
   setOrRemove(SettingsKeys::visualizerSpectrogramHistorySeconds(), v.spectrogramHistorySeconds, d.spectrogramHistorySeconds);
+  setOrRemove(SettingsKeys::visualizerMultiChannel(), v.multiChannel, d.multiChannel);
+  setOrRemove(SettingsKeys::visualizerMidSide(), v.midSide, d.midSide);
+  setOrRemove(SettingsKeys::visualizerBandScale(), v.bandScale, d.bandScale);
+  setOrRemove(SettingsKeys::visualizerBandCount(), v.bandCount, d.bandCount);
+  setOrRemove(SettingsKeys::visualizerBandRmsPooling(), v.bandRmsPooling, d.bandRmsPooling);
+  setOrRemove(SettingsKeys::visualizerWindowType(), v.windowType, d.windowType);
+  setOrRemove(SettingsKeys::visualizerOverlapPercent(), v.overlapPercent, d.overlapPercent);
+  setOrRemove(SettingsKeys::visualizerZeroPadding(), v.zeroPadding, d.zeroPadding);
 }
 } // namespace VisualizerSettingsStore
 
@@ -292,7 +292,20 @@ void handleTuiKey(int ch, PipeWireGraph& graph, EqManager& eq, AudioRecorder& re
           state.recordingStatus = QStringLiteral("Stop recording before changing format.");
           break;
         }
-        state.recordingFormat = (state.recordingFormat == AudioRecorder::Format::Wav) ? AudioRecorder::Format::Flac : AudioRecorder::Format::Wav;
+        switch (state.recordingFormat) {
+          case AudioRecorder::Format::Wav:
+            state.recordingFormat = AudioRecorder::Format::Flac;
+            break;
+          case AudioRecorder::Format::Flac:
+            state.recordingFormat = AudioRecorder::Format::Opus;
+            break;
+          case AudioRecorder::Format::Opus:
+            state.recordingFormat = AudioRecorder::Format::Vorbis;
+            break;
+          case AudioRecorder::Format::Vorbis:
+            state.recordingFormat = AudioRecorder::Format::Wav;
+            break;
+        }
         state.recordingStatus = QStringLiteral("Format set: %1").arg(AudioRecorder::formatToString(state.recordingFormat));
         break;
       }
@@ -337,7 +350,7 @@ void handleTuiKey(int ch, PipeWireGraph& graph, EqManager& eq, AudioRecorder& re
         getmaxyx(stdscr, height, width);
         const QString next = promptInputLine(
             "Recording output",
-            "Enter output path or template (.wav/.flac; supports {datetime} {target} {ext}).",
+            "Enter output path or template (.wav/.flac/.opus/.ogg; supports {datetime} {target} {ext}).",
             state.recordingPath,
             height,
             width);
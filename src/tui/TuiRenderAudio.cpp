@@ -101,7 +101,7 @@ void drawHelpOverlay(Page page, int height, int width)
   lines << QStringLiteral("  p                    Apply EQ preset (EQ)");
   lines << QStringLiteral("  r                    Start/stop recording (Recording)");
   lines << QStringLiteral("  f                    Recording file/template");
-  lines << QStringLiteral("  o                    Recording format (wav/flac)");
+  lines << QStringLiteral("  o                    Recording format (wav/flac/opus/vorbis)");
   lines << QStringLiteral("  t                    Recording timer");
   lines << QStringLiteral("  m                    Recording metadata (Recording)");
   lines << QStringLiteral("  S/T/R                Start/stop/restart (Engine)");
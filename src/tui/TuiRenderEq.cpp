@@ -171,6 +171,9 @@ static QString summarizeEqPreset(const EqPreset& preset)
 {
   QStringList parts;
   parts << QStringLiteral("pre %1dB").arg(preset.preampDb, 0, 'f', 1);
+  if (preset.linearPhase) {
+    parts << QStringLiteral("linear-phase");
+  }
 
   QStringList gains;
   gains.reserve(preset.bands.size());
@@ -96,15 +96,30 @@ void drawRecordingPage(PipeWireGraph* graph,
   ++line;
 
   const AudioRecorder::Format fmt = isRec ? recorder->format() : selectedFormat;
-  const QString fmtStr = (fmt == AudioRecorder::Format::Wav) ? QStringLiteral("WAV f32") : QStringLiteral("FLAC pcm24");
+  QString fmtStr;
+  switch (fmt) {
+    case AudioRecorder::Format::Wav:
+      fmtStr = QStringLiteral("WAV f32");
+      break;
+    case AudioRecorder::Format::Flac:
+      fmtStr = QStringLiteral("FLAC pcm24");
+      break;
+    case AudioRecorder::Format::Opus:
+      fmtStr = QStringLiteral("Opus");
+      break;
+    case AudioRecorder::Format::Vorbis:
+      fmtStr = QStringLiteral("Ogg Vorbis");
+      break;
+  }
 
   const QByteArray fmtUtf8 =
-      QStringLiteral("Format: %1  |  %2 Hz  |  %3 ch  |  %4  |  %5 bytes")
+      QStringLiteral("Format: %1  |  %2 Hz  |  %3 ch  |  %4  |  %5 bytes  |  %6 dropped")
           .arg(fmtStr)
           .arg(rate == 0 ? 48000 : static_cast<int>(rate))
           .arg(ch == 0 ? 2 : static_cast<int>(ch))
           .arg(formatDuration(seconds))
           .arg(static_cast<qulonglong>(bytes))
+          .arg(static_cast<qulonglong>(recorder ? recorder->droppedFrames() : 0u))
           .toUtf8();
   mvaddnstr(line, 0, fmtUtf8.constData(), std::max(0, width - 1));
   ++line;
@@ -129,9 +144,17 @@ void drawRecordingPage(PipeWireGraph* graph,
   const QString rmsStr = isRec ? QString::number(rmsDb, 'f', 1) : QStringLiteral("-");
   const QString timerStr = durationLimitSec > 0 ? QStringLiteral("stop after %1").arg(formatDuration(durationLimitSec)) : QStringLiteral("off");
 
-  const QByteArray lvlUtf8 = QStringLiteral("Levels: peak %1 dBFS  rms %2 dBFS  |  Timer: %3")
+  const float lufs = recorder ? recorder->integratedLufs() : -120.0f;
+  const QString tpStr = isRec ? QString::number(recorder->truePeakDb(), 'f', 1) : QStringLiteral("-");
+  const QString lufsStr = (isRec && lufs > -70.0f) ? QString::number(lufs, 'f', 1) : QStringLiteral("-");
+  const QString lraStr = isRec ? QString::number(recorder->loudnessRangeLu(), 'f', 1) : QStringLiteral("-");
+
+  const QByteArray lvlUtf8 = QStringLiteral("Levels: peak %1 dBFS  rms %2 dBFS  tp %3 dBTP  |  Loudness: %4 LUFS  lra %5 LU  |  Timer: %6")
                                  .arg(peakStr)
                                  .arg(rmsStr)
+                                 .arg(tpStr)
+                                 .arg(lufsStr)
+                                 .arg(lraStr)
                                  .arg(timerStr)
                                  .toUtf8();
   mvaddnstr(line, 0, lvlUtf8.constData(), std::max(0, width - 1));
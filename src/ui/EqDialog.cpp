@@ -177,6 +177,10 @@ EqDialog::EqDialog(const QString& deviceLabel, const EqPreset& initial, QWidget*
   m_preamp->setRange(-24.0, 24.0);
   m_preamp->setSuffix(tr(" dB"));
   form->addRow(tr("Preamp:"), m_preamp);
+
+  m_linearPhase = new QCheckBox(tr("Linear phase"), this);
+  m_linearPhase->setToolTip(tr("Apply the same response as a linear-phase FIR. No phase shift, but adds about 100 ms of latency."));
+  form->addRow(QString{}, m_linearPhase);
   root->addLayout(form);
 
   auto* responseBox = new QGroupBox(tr("Response"), this);
@@ -255,6 +259,7 @@ EqDialog::EqDialog(const QString& deviceLabel, const EqPreset& initial, QWidget*
   auto onChange = [this]() { refreshResponse(); };
   connect(m_enabled, &QCheckBox::toggled, this, onChange);
   connect(m_preamp, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, onChange);
+  connect(m_linearPhase, &QCheckBox::toggled, this, onChange);
   for (int i = 0; i < n; ++i) {
     connect(m_bandEnabled[i], &QCheckBox::toggled, this, onChange);
     connect(m_bandType[i], QOverload<int>::of(&QComboBox::currentIndexChanged), this, onChange);
@@ -284,6 +289,9 @@ void EqDialog::loadFromPreset(const EqPreset& p)
   if (m_preamp) {
     m_preamp->setValue(p.preampDb);
   }
+  if (m_linearPhase) {
+    m_linearPhase->setChecked(p.linearPhase);
+  }
 
   const int n = static_cast<int>(std::min(p.bands.size(), m_bandEnabled.size()));
   for (int i = 0; i < n; ++i) {
@@ -308,6 +316,7 @@ EqPreset EqDialog::collectPreset() const
   EqPreset p;
   p.enabled = m_enabled ? m_enabled->isChecked() : false;
   p.preampDb = m_preamp ? m_preamp->value() : 0.0;
+  p.linearPhase = m_linearPhase ? m_linearPhase->isChecked() : false;
 
   const int n = static_cast<int>(std::min({m_bandEnabled.size(), m_bandType.size(), m_bandFreq.size(), m_bandGain.size(), m_bandQ.size()}));
   p.bands.reserve(n);
@@ -441,6 +450,8 @@ void EqDialog::importPresetFromTextFile()
   }
 
   EqPreset p = parsed.value();
+  // AutoEQ files say nothing about phase; keep whatever mode the dialog is in.
+  p.linearPhase = m_linearPhase && m_linearPhase->isChecked();
   if (p.bands.size() > m_bandEnabled.size()) {
     p.bands.resize(m_bandEnabled.size());
     QMessageBox::information(this, tr("Import EQ Preset"), tr("Imported preset has more bands than this dialog supports; extra bands were dropped."));
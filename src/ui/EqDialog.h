@@ -31,6 +31,7 @@ private:
 
   QCheckBox* m_enabled = nullptr;
   QDoubleSpinBox* m_preamp = nullptr;
+  QCheckBox* m_linearPhase = nullptr;
   EqResponseWidget* m_response = nullptr;
 
   QVector<QCheckBox*> m_bandEnabled;
@@ -1,6 +1,6 @@
 #include "LevelMeterWidget.h"
 
-#include "backend/AudioLevelTap.h"
+#include "backend/MeterEngine.h"
 
 #include <QPainter>
 
@@ -9,6 +9,10 @@
 
 namespace {
 constexpr float kMinDb = -60.0f;
+constexpr qint64 kToolTipRefreshMs = 500;
+constexpr qint64 kPeakHoldMs = 330;
+// The hold line falls like a type I PPM: 20 dB in 1.5 s over the meter's 60 dB span.
+constexpr float kPeakHoldFallPerSec = (20.0f / 1.5f) / -kMinDb;
 }
 
 LevelMeterWidget::LevelMeterWidget(QWidget* parent)
@@ -19,11 +23,25 @@ LevelMeterWidget::LevelMeterWidget(QWidget* parent)
   setMinimumWidth(110);
   setMaximumWidth(140);
   setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+  m_clock.start();
 }
 
-void LevelMeterWidget::setTap(AudioLevelTap* tap)
+LevelMeterWidget::~LevelMeterWidget()
 {
-  m_tap = tap;
+  setMeter(nullptr, 0);
+}
+
+void LevelMeterWidget::setMeter(MeterEngine* engine, uint32_t nodeId, bool loudness)
+{
+  if (m_engine && m_meter >= 0) {
+    m_engine->release(m_meter);
+  }
+  m_engine = engine;
+  m_meter = engine ? engine->acquire(nodeId) : -1;
+  if (m_meter >= 0 && loudness) {
+    m_engine->setLoudness(m_meter, true);
+  }
+  setToolTip(QString());
 }
 
 float LevelMeterWidget::amplitudeToDb(float amp)
@@ -42,46 +60,79 @@ float LevelMeterWidget::dbToNormalized(float db, float minDb)
 
 void LevelMeterWidget::tick()
 {
-  if (!m_tap) {
+  // Ballistics and peak holding happen on the audio side; the widget only maps levels to pixels,
+  // so it looks the same whatever the poll rate.
+  float ppm = 0.0f;
+  float vu = 0.0f;
+  float held = 0.0f;
+  bool clipped = false;
+  const qint64 nowMs = m_clock.elapsed();
+  MeterLevels levels;
+  if (m_engine && m_meter >= 0 && m_engine->takeLevels(m_meter, levels)) {
+    ppm = levels.ppm;
+    vu = levels.rms;
+    held = levels.peak;
+    clipped = m_engine->clippedRecently(m_meter, 900);
+    m_channels = std::min(levels.channels, kMaxChannels);
+    for (int c = 0; c < m_channels; ++c) {
+      const auto i = static_cast<std::size_t>(c);
+      m_channelRmsNorm[i] = dbToNormalized(amplitudeToDb(levels.channelRms[i]), kMinDb);
+      m_channelPeakNorm[i] = dbToNormalized(amplitudeToDb(levels.channelPeak[i]), kMinDb);
+    }
+    if (levels.hasLoudness && nowMs >= m_toolTipAtMs) {
+      m_toolTipAtMs = nowMs + kToolTipRefreshMs;
+      updateLoudnessToolTip(levels);
+    }
+  } else {
+    m_channels = 0;
     m_peakNorm = 0.0f;
     m_rmsNorm = 0.0f;
     m_peakHoldNorm = 0.0f;
-    m_peakHoldTicks = 0;
+    m_peakHoldUntilMs = 0;
     m_clipped = false;
     update();
     return;
   }
 
-  const float peakDb = amplitudeToDb(m_tap->peak());
-  const float rmsDb = amplitudeToDb(m_tap->rms());
-  const float peakTarget = dbToNormalized(peakDb, kMinDb);
-  const float rmsTarget = dbToNormalized(rmsDb, kMinDb);
-
-  // Attack fast, release slow.
-  auto smooth = [](float current, float target) {
-    const float attack = 0.55f;
-    const float release = 0.08f;
-    const float k = (target > current) ? attack : release;
-    return current + (target - current) * k;
-  };
-
-  m_peakNorm = smooth(m_peakNorm, peakTarget);
-  m_rmsNorm = smooth(m_rmsNorm, rmsTarget);
-
-  // Simple peak hold.
-  if (peakTarget >= m_peakHoldNorm) {
-    m_peakHoldNorm = peakTarget;
-    m_peakHoldTicks = 10; // ~330ms at 33ms tick
-  } else if (m_peakHoldTicks > 0) {
-    --m_peakHoldTicks;
-  } else {
-    m_peakHoldNorm = std::max(m_peakNorm, m_peakHoldNorm * 0.94f);
+  m_peakNorm = dbToNormalized(amplitudeToDb(ppm), kMinDb);
+  m_rmsNorm = dbToNormalized(amplitudeToDb(vu), kMinDb);
+
+  const float heldNorm = dbToNormalized(amplitudeToDb(held), kMinDb);
+  const float elapsedSec = static_cast<float>(std::max<qint64>(0, nowMs - m_lastTickMs)) / 1000.0f;
+  m_lastTickMs = nowMs;
+  if (heldNorm >= m_peakHoldNorm) {
+    m_peakHoldNorm = heldNorm;
+    m_peakHoldUntilMs = nowMs + kPeakHoldMs;
+  } else if (nowMs >= m_peakHoldUntilMs) {
+    m_peakHoldNorm = std::max({m_peakNorm, heldNorm, m_peakHoldNorm - kPeakHoldFallPerSec * elapsedSec});
   }
 
-  m_clipped = m_tap->clippedRecently(900);
+  m_clipped = clipped;
   update();
 }
 
+void LevelMeterWidget::updateLoudnessToolTip(const MeterLevels& levels)
+{
+  const auto lufs = [](float v) {
+    return v > -70.0f ? QString::number(v, 'f', 1) : QStringLiteral("-");
+  };
+  setToolTip(tr("Momentary %1 LUFS\nShort-term %2 LUFS\nIntegrated %3 LUFS\nRange %4 LU\nTrue peak max %5 dBTP\n(double-click to reset)")
+                 .arg(lufs(levels.momentaryLufs))
+                 .arg(lufs(levels.shortTermLufs))
+                 .arg(lufs(levels.integratedLufs))
+                 .arg(levels.loudnessRangeLu, 0, 'f', 1)
+                 .arg(amplitudeToDb(levels.maxTruePeak), 0, 'f', 1));
+}
+
+void LevelMeterWidget::mouseDoubleClickEvent(QMouseEvent* event)
+{
+  if (m_engine && m_meter >= 0) {
+    m_engine->resetLoudness(m_meter);
+    m_toolTipAtMs = 0;
+  }
+  QWidget::mouseDoubleClickEvent(event);
+}
+
 void LevelMeterWidget::paintEvent(QPaintEvent* /*event*/)
 {
   QPainter p(this);
@@ -93,7 +144,7 @@ void LevelMeterWidget::paintEvent(QPaintEvent* /*event*/)
   p.drawRoundedRect(r, 6, 6);
 
   QRect bar = r.adjusted(2, 2, -2, -2);
-  const int w = std::max(0, static_cast<int>(std::lround(bar.width() * m_rmsNorm)));
+  const auto fill = [&bar](float norm) { return std::max(0, static_cast<int>(std::lround(bar.width() * norm))); };
 
   // RMS fill.
   QLinearGradient g(bar.topLeft(), bar.topRight());
@@ -102,10 +153,27 @@ void LevelMeterWidget::paintEvent(QPaintEvent* /*event*/)
   g.setColorAt(1.0, QColor(239, 68, 68));
 
   p.setBrush(g);
-  p.drawRoundedRect(QRect(bar.left(), bar.top(), w, bar.height()), 4, 4);
+  if (m_channels > 1 && m_channels <= bar.height()) {
+    // One thin lane per channel, each with its own sample-peak tick; the hold line spans them all.
+    const int gap = bar.height() / m_channels >= 3 ? 1 : 0;
+    for (int c = 0; c < m_channels; ++c) {
+      const auto i = static_cast<std::size_t>(c);
+      const int top = bar.top() + bar.height() * c / m_channels;
+      const int lane = bar.top() + bar.height() * (c + 1) / m_channels - top - gap;
+      p.setPen(Qt::NoPen);
+      p.drawRect(QRect(bar.left(), top, fill(m_channelRmsNorm[i]), lane));
+      if (m_channelPeakNorm[i] > 0.0f) {
+        const int px = bar.left() + fill(m_channelPeakNorm[i]);
+        p.setPen(QPen(QColor(148, 163, 184), 1));
+        p.drawLine(px, top, px, top + lane - 1);
+      }
+    }
+  } else {
+    p.drawRoundedRect(QRect(bar.left(), bar.top(), fill(m_rmsNorm), bar.height()), 4, 4);
+  }
 
   // Peak hold line.
-  const int px = bar.left() + static_cast<int>(std::lround(bar.width() * m_peakHoldNorm));
+  const int px = bar.left() + fill(m_peakHoldNorm);
   p.setPen(QPen(QColor(226, 232, 240), 1));
   p.drawLine(px, bar.top(), px, bar.bottom());
 
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QWidget>
 
-class AudioLevelTap;
+#include <array>
+#include <cstdint>
+
+class MeterEngine;
+struct MeterLevels;
 
 class LevelMeterWidget final : public QWidget
 {
@@ -10,22 +16,37 @@ class LevelMeterWidget final : public QWidget
 
 public:
   explicit LevelMeterWidget(QWidget* parent = nullptr);
+  ~LevelMeterWidget() override;
 
-  void setTap(AudioLevelTap* tap);
+  // Meters the node through the shared engine; the meter is released with the widget. With
+  // `loudness`, the tooltip shows its BS.1770 loudness and a double-click restarts the programme.
+  void setMeter(MeterEngine* engine, uint32_t nodeId, bool loudness = false);
+  bool hasSource() const { return m_meter >= 0; }
   void tick();
 
 protected:
   void paintEvent(QPaintEvent* event) override;
+  void mouseDoubleClickEvent(QMouseEvent* event) override;
 
 private:
   static float amplitudeToDb(float amp);
   static float dbToNormalized(float db, float minDb);
-
-  AudioLevelTap* m_tap = nullptr;
+  void updateLoudnessToolTip(const MeterLevels& levels);
+
+  QPointer<MeterEngine> m_engine;
+  int m_meter = -1;
+  // Per-channel VU fill and sample peak, stacked when the meter has more than one channel.
+  static constexpr int kMaxChannels = 16;
+  int m_channels = 0;
+  std::array<float, kMaxChannels> m_channelRmsNorm{};
+  std::array<float, kMaxChannels> m_channelPeakNorm{};
   float m_peakNorm = 0.0f;
   float m_rmsNorm = 0.0f;
   float m_peakHoldNorm = 0.0f;
-  int m_peakHoldTicks = 0;
+  QElapsedTimer m_clock;
+  qint64 m_lastTickMs = 0;
+  qint64 m_peakHoldUntilMs = 0;
+  qint64 m_toolTipAtMs = 0;
   bool m_clipped = false;
 };
 
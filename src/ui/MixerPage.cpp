@@ -1,7 +1,7 @@
 #include "MixerPage.h"
 
-#include "backend/AudioLevelTap.h"
 #include "backend/EqManager.h"
+#include "backend/MeterEngine.h"
 #include "backend/PipeWireGraph.h"
 #include "backend/PipeWireThread.h"
 #include "settings/SettingsKeys.h"
@@ -33,7 +33,7 @@ using RegisterControlsFn = std::function<void(uint32_t, QSlider*, QLabel*, QChec
 QGroupBox* makeSection(const QString& title,
                        const QList<PwNodeInfo>& nodes,
                        PipeWireGraph* graph,
-                       PipeWireThread* pw,
+                       MeterEngine* meterEngine,
                        uint32_t defaultNodeId,
                        const QString& filter,
                        std::function<void(const PwNodeInfo&)> onEqForNode,
@@ -46,7 +46,7 @@ QGroupBox* makeStreamsSection(const QString& title,
                               const QList<PwNodeInfo>& streams,
                               const QList<PwNodeInfo>& devices,
                               PipeWireGraph* graph,
-                              PipeWireThread* pw,
+                              MeterEngine* meterEngine,
                               const QString& filter,
                               std::function<void(const PwNodeInfo&)> onEqForStream,
                               std::function<void(const PwNodeInfo&)> onVisualizeForStream,
@@ -56,6 +56,9 @@ QGroupBox* makeStreamsSection(const QString& title,
 } // namespace mixer
 
 namespace {
+constexpr int kMeterIntervalMs = 33;     // ~30 Hz
+constexpr int kTrayMeterIntervalMs = 66; // ~15 Hz
+
 bool isInternalNode(const PwNodeInfo& node)
 {
   return node.name.startsWith(QStringLiteral("headroom."));
@@ -108,8 +111,10 @@ MixerPage::MixerPage(PipeWireThread* pw, PipeWireGraph* graph, EqManager* eq, QW
   m_rebuildTimer->setInterval(50);
   connect(m_rebuildTimer, &QTimer::timeout, this, &MixerPage::rebuild);
 
+  m_meterEngine = new MeterEngine(m_pw, m_graph, this);
+
   m_meterTimer = new QTimer(this);
-  m_meterTimer->setInterval(33);
+  m_meterTimer->setInterval(kMeterIntervalMs);
   connect(m_meterTimer, &QTimer::timeout, this, &MixerPage::tickMeters);
   m_meterTimer->start();
 
@@ -222,6 +227,13 @@ void MixerPage::refreshControls()
   m_mutes.swap(mutes);
 }
 
+void MixerPage::setInTray(bool inTray)
+{
+  if (m_meterTimer) {
+    m_meterTimer->setInterval(inTray ? kTrayMeterIntervalMs : kMeterIntervalMs);
+  }
+}
+
 void MixerPage::tickMeters()
 {
   QList<QPointer<LevelMeterWidget>> alive;
@@ -359,9 +371,9 @@ void MixerPage::rebuild()
   };
 
   layout->addWidget(mixer::makeStreamsSection(
-      tr("Playback (apps)"), playback, outputs, m_graph, m_pw, filter, onEq, onVisualizeStream, registerControls, meters, m_container));
+      tr("Playback (apps)"), playback, outputs, m_graph, m_meterEngine, filter, onEq, onVisualizeStream, registerControls, meters, m_container));
   layout->addWidget(mixer::makeStreamsSection(
-      tr("Recording (apps)"), recording, inputs, m_graph, m_pw, filter, onEq, onVisualizeStream, registerControls, meters, m_container));
+      tr("Recording (apps)"), recording, inputs, m_graph, m_meterEngine, filter, onEq, onVisualizeStream, registerControls, meters, m_container));
 
   const uint32_t defaultSinkId = m_graph ? m_graph->defaultAudioSinkId().value_or(0) : 0;
   const uint32_t defaultSourceId = m_graph ? m_graph->defaultAudioSourceId().value_or(0) : 0;
@@ -423,12 +435,12 @@ void MixerPage::rebuild()
   repopulateDefaultBox(m_defaultInput, m_setDefaultInput, inputs, defaultSourceId);
 
   layout->addWidget(mixer::makeSection(
-      tr("Output Devices"), outputs, m_graph, m_pw, defaultSinkId, filter, onEq, onVisualizeNode, registerControls, meters, m_container));
+      tr("Output Devices"), outputs, m_graph, m_meterEngine, defaultSinkId, filter, onEq, onVisualizeNode, registerControls, meters, m_container));
   layout->addWidget(mixer::makeSection(
-      tr("Input Devices"), inputs, m_graph, m_pw, defaultSourceId, filter, onEq, onVisualizeNode, registerControls, meters, m_container));
+      tr("Input Devices"), inputs, m_graph, m_meterEngine, defaultSourceId, filter, onEq, onVisualizeNode, registerControls, meters, m_container));
 
   layout->addWidget(
-      mixer::makeSection(tr("Other Nodes"), other, m_graph, m_pw, 0, filter, {}, onVisualizeNode, registerControls, meters, m_container));
+      mixer::makeSection(tr("Other Nodes"), other, m_graph, m_meterEngine, 0, filter, {}, onVisualizeNode, registerControls, meters, m_container));
 
   layout->addStretch(1);
 
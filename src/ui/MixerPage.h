@@ -18,6 +18,7 @@ class PipeWireGraph;
 class EqManager;
 class PipeWireThread;
 class LevelMeterWidget;
+class MeterEngine;
 
 class MixerPage final : public QWidget
 {
@@ -32,6 +33,10 @@ signals:
 public slots:
   void refresh();
 
+  // Meters poll at a lower rate while the window is hidden in the tray; the engine holds peaks
+  // between polls, so nothing is lost.
+  void setInTray(bool inTray);
+
 private:
   void scheduleRebuild();
   void refreshControls();
@@ -50,6 +55,7 @@ private:
   QWidget* m_container = nullptr;
   QTimer* m_rebuildTimer = nullptr;
   QTimer* m_meterTimer = nullptr;
+  MeterEngine* m_meterEngine = nullptr;
   QList<QPointer<LevelMeterWidget>> m_meters;
 
   QHash<uint32_t, QPointer<QSlider>> m_volumeSliders;
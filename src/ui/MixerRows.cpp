@@ -1,6 +1,5 @@
-#include "backend/AudioLevelTap.h"
+#include "backend/MeterEngine.h"
 #include "backend/PipeWireGraph.h"
-#include "backend/PipeWireThread.h"
 #include "ui/LevelMeterWidget.h"
 
 #include <QCheckBox>
@@ -36,7 +35,7 @@ bool matchesFilter(const QString& haystack, const QString& needle)
 }
 
 QWidget* makeNodeRow(PipeWireGraph* graph,
-                     PipeWireThread* pw,
+                     MeterEngine* meterEngine,
                      const PwNodeInfo& node,
                      const PwNodeControls& controls,
                      bool isDefault,
@@ -62,15 +61,12 @@ QWidget* makeNodeRow(PipeWireGraph* graph,
   }
   h->addWidget(name, 2);
 
-  AudioLevelTap* tap = nullptr;
-  if (pw && node.mediaClass.contains(QStringLiteral("Audio"))) {
-    tap = new AudioLevelTap(pw, row);
-    tap->setCaptureSink(node.mediaClass == QStringLiteral("Audio/Sink"));
-    tap->setTargetObject(node.name);
-  }
   auto* meter = new LevelMeterWidget(row);
-  meter->setTap(tap);
-  if (tap) {
+  if (meterEngine && node.mediaClass.contains(QStringLiteral("Audio"))) {
+    // Devices are few and are where programme loudness matters, so only they measure it.
+    meter->setMeter(meterEngine, node.id, true);
+  }
+  if (meter->hasSource()) {
     meters.push_back(meter);
   }
   h->addWidget(meter, 0);
@@ -226,7 +222,7 @@ StreamRoute routeForStream(PipeWireGraph* graph, const PwNodeInfo& stream)
 }
 
 QWidget* makeStreamRow(PipeWireGraph* graph,
-                       PipeWireThread* pw,
+                       MeterEngine* meterEngine,
                        const PwNodeInfo& stream,
                        const PwNodeControls& controls,
                        const QList<PwNodeInfo>& devices,
@@ -250,14 +246,11 @@ QWidget* makeStreamRow(PipeWireGraph* graph,
   name->setToolTip(route.deviceName.isEmpty() ? stream.name : QStringLiteral("%1\n%2").arg(stream.name, route.deviceName));
   h->addWidget(name, 2);
 
-  AudioLevelTap* tap = nullptr;
-  if (pw) {
-    tap = new AudioLevelTap(pw, row);
-    tap->setTargetObject(stream.name);
-  }
   auto* meter = new LevelMeterWidget(row);
-  meter->setTap(tap);
-  if (tap) {
+  if (meterEngine) {
+    meter->setMeter(meterEngine, stream.id);
+  }
+  if (meter->hasSource()) {
     meters.push_back(meter);
   }
   h->addWidget(meter, 0);
@@ -381,7 +374,7 @@ QWidget* makeStreamRow(PipeWireGraph* graph,
 QGroupBox* makeSection(const QString& title,
                        const QList<PwNodeInfo>& nodes,
                        PipeWireGraph* graph,
-                       PipeWireThread* pw,
+                       MeterEngine* meterEngine,
                        uint32_t defaultNodeId,
                        const QString& filter,
                        std::function<void(const PwNodeInfo&)> onEqForNode,
@@ -418,7 +411,7 @@ QGroupBox* makeSection(const QString& title,
     }
 
     const bool isDefault = defaultNodeId != 0 && node.id == defaultNodeId;
-    v->addWidget(makeNodeRow(graph, pw, node, controls, isDefault, std::move(onEq), std::move(onVisualize), registerControls, meters, box));
+    v->addWidget(makeNodeRow(graph, meterEngine, node, controls, isDefault, std::move(onEq), std::move(onVisualize), registerControls, meters, box));
     ++count;
   }
 
@@ -435,7 +428,7 @@ QGroupBox* makeStreamsSection(const QString& title,
                               const QList<PwNodeInfo>& streams,
                               const QList<PwNodeInfo>& devices,
                               PipeWireGraph* graph,
-                              PipeWireThread* pw,
+                              MeterEngine* meterEngine,
                               const QString& filter,
                               std::function<void(const PwNodeInfo&)> onEqForStream,
                               std::function<void(const PwNodeInfo&)> onVisualizeForStream,
@@ -472,7 +465,7 @@ QGroupBox* makeStreamsSection(const QString& title,
     }
 
     v->addWidget(makeStreamRow(graph,
-                               pw,
+                               meterEngine,
                                stream,
                                controls,
                                devices,
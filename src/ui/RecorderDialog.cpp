@@ -43,9 +43,11 @@ RecorderDialog::RecorderDialog(PipeWireGraph* graph, AudioRecorder* recorder, QW
   m_formatCombo = new QComboBox(this);
   m_formatCombo->addItem(tr("WAV (float32)"), AudioRecorder::formatToString(AudioRecorder::Format::Wav));
   m_formatCombo->addItem(tr("FLAC (24-bit)"), AudioRecorder::formatToString(AudioRecorder::Format::Flac));
+  m_formatCombo->addItem(tr("Opus"), AudioRecorder::formatToString(AudioRecorder::Format::Opus));
+  m_formatCombo->addItem(tr("Ogg Vorbis"), AudioRecorder::formatToString(AudioRecorder::Format::Vorbis));
 
   m_fileEdit = new QLineEdit(this);
-  m_fileEdit->setPlaceholderText(tr("Output path or template (.wav/.flac)"));
+  m_fileEdit->setPlaceholderText(tr("Output path or template (.wav/.flac/.opus/.ogg)"));
 
   m_durationSpin = new QSpinBox(this);
   m_durationSpin->setRange(0, 24 * 60 * 60);
@@ -130,11 +132,8 @@ RecorderDialog::RecorderDialog(PipeWireGraph* graph, AudioRecorder* recorder, QW
     AudioRecorder::Format f = AudioRecorder::Format::Wav;
     if (const auto parsed = AudioRecorder::formatFromString(rememberedFormat)) {
       f = *parsed;
-    } else {
-      const QString lp = m_fileEdit->text().trimmed().toLower();
-      if (lp.endsWith(QStringLiteral(".flac"))) {
-        f = AudioRecorder::Format::Flac;
-      }
+    } else if (const auto fromName = AudioRecorder::formatFromFileName(m_fileEdit->text())) {
+      f = *fromName;
     }
 
     for (int i = 0; i < m_formatCombo->count(); ++i) {
@@ -164,7 +164,21 @@ void RecorderDialog::syncUi()
 
   const auto uiFmt = AudioRecorder::formatFromString(m_formatCombo ? m_formatCombo->currentData().toString() : QString{}).value_or(AudioRecorder::Format::Wav);
   const auto fmt = (recording && m_recorder) ? m_recorder->format() : uiFmt;
-  const QString fmtStr = (fmt == AudioRecorder::Format::Wav) ? tr("WAV f32") : tr("FLAC pcm24");
+  QString fmtStr;
+  switch (fmt) {
+    case AudioRecorder::Format::Wav:
+      fmtStr = tr("WAV f32");
+      break;
+    case AudioRecorder::Format::Flac:
+      fmtStr = tr("FLAC pcm24");
+      break;
+    case AudioRecorder::Format::Opus:
+      fmtStr = tr("Opus");
+      break;
+    case AudioRecorder::Format::Vorbis:
+      fmtStr = tr("Ogg Vorbis");
+      break;
+  }
 
   const double secs = durationSeconds(frames, rate == 0 ? 48000u : rate);
   m_formatLabel->setText(tr("%1 • %2 Hz • %3 ch • %4")
@@ -172,8 +186,25 @@ void RecorderDialog::syncUi()
                              .arg(rate == 0 ? 48000 : static_cast<int>(rate))
                              .arg(ch == 0 ? 2 : static_cast<int>(ch))
                              .arg(formatDuration(secs)));
-  m_bytesLabel->setText(tr("%1 frames • %2 bytes (raw)").arg(static_cast<qulonglong>(frames)).arg(static_cast<qulonglong>(bytes)));
-  m_levelsLabel->setText(recording ? tr("Peak %1 dBFS • RMS %2 dBFS").arg(peakDb, 0, 'f', 1).arg(rmsDb, 0, 'f', 1) : tr("-"));
+  const uint64_t dropped = m_recorder ? m_recorder->droppedFrames() : 0u;
+  QString bytesText = tr("%1 frames • %2 bytes (raw)").arg(static_cast<qulonglong>(frames)).arg(static_cast<qulonglong>(bytes));
+  if (dropped > 0) {
+    bytesText += tr(" • %1 frames dropped (disk too slow)").arg(static_cast<qulonglong>(dropped));
+  }
+  m_bytesLabel->setText(bytesText);
+  if (recording) {
+    const float lufs = m_recorder->integratedLufs();
+    const QString lufsStr = lufs > -70.0f ? QString::number(lufs, 'f', 1) : QStringLiteral("-");
+    m_levelsLabel->setText(tr("Peak %1 dBFS • RMS %2 dBFS • TP %3 dBTP • I %4 LUFS • S %5 LUFS • LRA %6 LU")
+                               .arg(peakDb, 0, 'f', 1)
+                               .arg(rmsDb, 0, 'f', 1)
+                               .arg(m_recorder->truePeakDb(), 0, 'f', 1)
+                               .arg(lufsStr)
+                               .arg(m_recorder->shortTermLufs(), 0, 'f', 1)
+                               .arg(m_recorder->loudnessRangeLu(), 0, 'f', 1));
+  } else {
+    m_levelsLabel->setText(tr("-"));
+  }
 
   if (m_metadataLabel) {
     const QString q = quantum > 0 ? QString::number(quantum) : QStringLiteral("-");
@@ -205,7 +236,7 @@ void RecorderDialog::browseFile()
   const QString current = m_fileEdit->text().trimmed();
   const QString startDir = current.isEmpty() ? QDir::homePath() : QFileInfo(current).absolutePath();
   const QString picked =
-      QFileDialog::getSaveFileName(this, tr("Choose Output File"), startDir, tr("Audio files (*.wav *.flac);;WAV files (*.wav);;FLAC files (*.flac);;All files (*)"));
+      QFileDialog::getSaveFileName(this, tr("Choose Output File"), startDir, tr("Audio files (*.wav *.flac *.opus *.ogg);;WAV files (*.wav);;FLAC files (*.flac);;Opus files (*.opus);;Ogg Vorbis files (*.ogg);;All files (*)"));
   if (picked.trimmed().isEmpty()) {
     return;
   }
@@ -173,6 +173,9 @@ SettingsDialog::SettingsDialog(PipeWireGraph* graph, QWidget* parent)
     m_vizWaveHistory->addItem(tr("2 s"), 2.0);
     m_vizWaveHistory->addItem(tr("4 s"), 4.0);
     m_vizWaveHistory->addItem(tr("8 s"), 8.0);
+    m_vizWaveHistory->addItem(tr("30 s"), 30.0);
+    m_vizWaveHistory->addItem(tr("1 min"), 60.0);
+    m_vizWaveHistory->addItem(tr("5 min"), 300.0);
     m_vizWaveHistory->setSizeAdjustPolicy(QComboBox::AdjustToContents);
     displayForm->addRow(tr("Waveform history:"), m_vizWaveHistory);
 
@@ -190,6 +193,31 @@ SettingsDialog::SettingsDialog(PipeWireGraph* graph, QWidget* parent)
     m_vizFftSize->setSizeAdjustPolicy(QComboBox::AdjustToContents);
     analysisForm->addRow(tr("FFT size:"), m_vizFftSize);
 
+    m_vizWindow = new QComboBox(analysis);
+    m_vizWindow->addItem(tr("Hann"), 0);
+    m_vizWindow->addItem(tr("Blackman-Harris"), 1);
+    m_vizWindow->addItem(tr("Flat-top (amplitude accurate)"), 2);
+    m_vizWindow->addItem(tr("Kaiser (β = 9)"), 3);
+    m_vizWindow->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+    analysisForm->addRow(tr("Window:"), m_vizWindow);
+
+    m_vizOverlap = new QComboBox(analysis);
+    m_vizOverlap->addItem(tr("50%"), 50.0);
+    m_vizOverlap->addItem(tr("75%"), 75.0);
+    m_vizOverlap->addItem(tr("87.5%"), 87.5);
+    m_vizOverlap->addItem(tr("93.75%"), 93.75);
+    m_vizOverlap->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+    analysisForm->addRow(tr("Overlap:"), m_vizOverlap);
+
+    m_vizZeroPad = new QComboBox(analysis);
+    m_vizZeroPad->addItem(tr("None"), 1);
+    m_vizZeroPad->addItem(tr("2×"), 2);
+    m_vizZeroPad->addItem(tr("4×"), 4);
+    m_vizZeroPad->addItem(tr("8×"), 8);
+    m_vizZeroPad->setToolTip(tr("Zero-pad each frame for a finer-grained spectrum and peak frequency readout."));
+    m_vizZeroPad->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+    analysisForm->addRow(tr("Zero padding:"), m_vizZeroPad);
+
     auto* smoothingRow = new QWidget(analysis);
     auto* smoothingLayout = new QHBoxLayout(smoothingRow);
     smoothingLayout->setContentsMargins(0, 0, 0, 0);
@@ -217,6 +245,36 @@ SettingsDialog::SettingsDialog(PipeWireGraph* graph, QWidget* parent)
     m_vizSpecHistory->setSizeAdjustPolicy(QComboBox::AdjustToContents);
     analysisForm->addRow(tr("Spectrogram history:"), m_vizSpecHistory);
 
+    m_vizBandScale = new QComboBox(analysis);
+    m_vizBandScale->addItem(tr("Linear"), 0);
+    m_vizBandScale->addItem(tr("Logarithmic"), 1);
+    m_vizBandScale->addItem(tr("Mel"), 2);
+    m_vizBandScale->addItem(tr("1/3 octave"), 3);
+    m_vizBandScale->addItem(tr("1/6 octave"), 4);
+    m_vizBandScale->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+    analysisForm->addRow(tr("Spectrum scale:"), m_vizBandScale);
+
+    m_vizBandCount = new QComboBox(analysis);
+    m_vizBandCount->addItem(tr("32"), 32);
+    m_vizBandCount->addItem(tr("64"), 64);
+    m_vizBandCount->addItem(tr("96"), 96);
+    m_vizBandCount->addItem(tr("128"), 128);
+    m_vizBandCount->addItem(tr("256"), 256);
+    m_vizBandCount->setToolTip(tr("Number of bars for the linear, logarithmic and mel scales."));
+    m_vizBandCount->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+    analysisForm->addRow(tr("Spectrum bands:"), m_vizBandCount);
+
+    m_vizBandRms = new QCheckBox(tr("Average band energy (RMS) instead of peak bin"), analysis);
+    analysisForm->addRow(tr("Band pooling:"), m_vizBandRms);
+
+    m_vizMultiChannel = new QCheckBox(tr("Analyse each channel separately"), analysis);
+    m_vizMultiChannel->setToolTip(tr("Show per-channel waveforms and spectra for surround sinks and multitrack interfaces."));
+    analysisForm->addRow(tr("Channels:"), m_vizMultiChannel);
+
+    m_vizMidSide = new QCheckBox(tr("Mid/side, correlation and phase scope"), analysis);
+    m_vizMidSide->setToolTip(tr("Derive mid/side spectra and an L/R correlation meter from the first two channels."));
+    analysisForm->addRow(tr("Stereo:"), m_vizMidSide);
+
     v->addWidget(analysis);
     v->addStretch(1);
   }
@@ -280,6 +338,36 @@ void SettingsDialog::loadVisualizer()
     const int idx = findComboIndexByData<double>(m_vizSpecHistory, cfg.spectrogramHistorySeconds);
     m_vizSpecHistory->setCurrentIndex(idx >= 0 ? idx : 0);
   }
+
+  if (m_vizWindow) {
+    const int idx = findComboIndexByData<int>(m_vizWindow, cfg.windowType);
+    m_vizWindow->setCurrentIndex(idx >= 0 ? idx : 0);
+  }
+  if (m_vizOverlap) {
+    const int idx = findComboIndexByData<double>(m_vizOverlap, cfg.overlapPercent);
+    m_vizOverlap->setCurrentIndex(idx >= 0 ? idx : 1);
+  }
+  if (m_vizZeroPad) {
+    const int idx = findComboIndexByData<int>(m_vizZeroPad, cfg.zeroPadding);
+    m_vizZeroPad->setCurrentIndex(idx >= 0 ? idx : 0);
+  }
+  if (m_vizBandScale) {
+    const int idx = findComboIndexByData<int>(m_vizBandScale, cfg.bandScale);
+    m_vizBandScale->setCurrentIndex(idx >= 0 ? idx : 1);
+  }
+  if (m_vizBandCount) {
+    const int idx = findComboIndexByData<int>(m_vizBandCount, cfg.bandCount);
+    m_vizBandCount->setCurrentIndex(idx >= 0 ? idx : 2);
+  }
+  if (m_vizBandRms) {
+    m_vizBandRms->setChecked(cfg.bandRmsPooling);
+  }
+  if (m_vizMultiChannel) {
+    m_vizMultiChannel->setChecked(cfg.multiChannel);
+  }
+  if (m_vizMidSide) {
+    m_vizMidSide->setChecked(cfg.midSide);
+  }
 }
 
 void SettingsDialog::loadSinksOrder()
@@ -437,6 +525,30 @@ void SettingsDialog::accept()
   if (m_vizSpecHistory) {
     nextViz.spectrogramHistorySeconds = m_vizSpecHistory->currentData().toDouble();
   }
+  if (m_vizWindow) {
+    nextViz.windowType = m_vizWindow->currentData().toInt();
+  }
+  if (m_vizOverlap) {
+    nextViz.overlapPercent = m_vizOverlap->currentData().toDouble();
+  }
+  if (m_vizZeroPad) {
+    nextViz.zeroPadding = m_vizZeroPad->currentData().toInt();
+  }
+  if (m_vizBandScale) {
+    nextViz.bandScale = m_vizBandScale->currentData().toInt();
+  }
+  if (m_vizBandCount) {
+    nextViz.bandCount = m_vizBandCount->currentData().toInt();
+  }
+  if (m_vizBandRms) {
+    nextViz.bandRmsPooling = m_vizBandRms->isChecked();
+  }
+  if (m_vizMultiChannel) {
+    nextViz.multiChannel = m_vizMultiChannel->isChecked();
+  }
+  if (m_vizMidSide) {
+    nextViz.midSide = m_vizMidSide->isChecked();
+  }
   VisualizerSettingsStore::save(s, nextViz);
 
   if (!VisualizerSettingsStore::approxEqual(prevViz, nextViz)) {
@@ -43,5 +43,13 @@ private:
   QLabel* m_vizSmoothingLabel = nullptr;
   QComboBox* m_vizWaveHistory = nullptr;
   QComboBox* m_vizSpecHistory = nullptr;
+  QComboBox* m_vizWindow = nullptr;
+  QComboBox* m_vizOverlap = nullptr;
+  QComboBox* m_vizZeroPad = nullptr;
+  QComboBox* m_vizBandScale = nullptr;
+  QComboBox* m_vizBandCount = nullptr;
+  QCheckBox* m_vizBandRms = nullptr;
+  QCheckBox* m_vizMultiChannel = nullptr;
+  QCheckBox* m_vizMidSide = nullptr;
   bool m_resetLayoutRequested = false;
 };
@@ -1,6 +1,6 @@
 #include "VisualizerPage.h"
 
-#include "backend/AudioTap.h"
+#include "backend/AnalysisHub.h"
 #include "backend/PipeWireGraph.h"
 #include "ui/VisualizerWidget.h"
 
@@ -84,10 +84,10 @@ QString portLabel(const PwPortInfo& port)
 }
 } // namespace
 
-VisualizerPage::VisualizerPage(PipeWireGraph* graph, AudioTap* tap, QWidget* parent)
+VisualizerPage::VisualizerPage(PipeWireGraph* graph, AnalysisHub* hub, QWidget* parent)
     : QWidget(parent)
     , m_graph(graph)
-    , m_tap(tap)
+    , m_hub(hub)
 {
   auto* root = new QVBoxLayout(this);
 
@@ -102,62 +102,47 @@ VisualizerPage::VisualizerPage(PipeWireGraph* graph, AudioTap* tap, QWidget* par
 
   root->addLayout(form);
 
-  m_widget = new VisualizerWidget(m_tap, this);
+  // The widget activates the subscription while it is visible; the shared capture stream only
+  // runs while some subscriber of it is active.
+  if (m_hub) {
+    m_subscription = m_hub->subscribe(false, QString{}, this);
+  }
+  m_widget = new VisualizerWidget(m_subscription, this);
   root->addWidget(m_widget, 1);
 
   if (m_graph) {
     connect(m_graph, &PipeWireGraph::topologyChanged, this, &VisualizerPage::repopulateSources);
   }
-  if (m_tap) {
-    connect(m_tap, &AudioTap::streamStateChanged, this, [this](const QString& s) { m_state->setText(s); });
+  if (m_subscription) {
+    connect(m_subscription, &AnalysisSubscription::streamStateChanged, this, [this](const QString& s) { m_state->setText(s); });
   }
 
   connect(m_sources, QOverload<int>::of(&QComboBox::activated), this, [this](int) { m_userHasChosenTarget = true; });
 
   connect(m_sources, &QComboBox::currentIndexChanged, this, [this](int index) {
-    if (!m_tap) {
+    if (!m_subscription) {
       return;
     }
     const auto specOpt = tapSpecFromVariant(m_sources->itemData(index));
     if (!specOpt.has_value()) {
       return;
     }
-    m_tap->setTarget(specOpt->captureSink, specOpt->targetObject);
+    m_subscription->setTarget(specOpt->captureSink, specOpt->targetObject);
   });
 
-  if (m_tap) {
-    m_tap->setEnabled(false);
-  }
-
   repopulateSources();
 }
 
 void VisualizerPage::applySettings(const VisualizerSettings& settings)
 {
-  if (m_tap) {
-    m_tap->applySettings(settings);
+  if (m_hub) {
+    m_hub->applySettings(settings);
   }
   if (m_widget) {
     m_widget->applySettings(settings);
   }
 }
 
-void VisualizerPage::showEvent(QShowEvent* event)
-{
-  QWidget::showEvent(event);
-  if (m_tap) {
-    m_tap->setEnabled(true);
-  }
-}
-
-void VisualizerPage::hideEvent(QHideEvent* event)
-{
-  QWidget::hideEvent(event);
-  if (m_tap) {
-    m_tap->setEnabled(false);
-  }
-}
-
 void VisualizerPage::setTapTarget(const QString& targetObject, bool captureSink)
 {
   m_userHasChosenTarget = true;
@@ -165,8 +150,8 @@ void VisualizerPage::setTapTarget(const QString& targetObject, bool captureSink)
   m_pendingCaptureSink = captureSink;
   m_hasPendingTarget = true;
 
-  if (m_tap) {
-    m_tap->setTarget(captureSink, targetObject);
+  if (m_subscription) {
+    m_subscription->setTarget(captureSink, targetObject);
   }
 
   const int idx = findTapIndex(m_sources, targetObject, captureSink);
@@ -280,7 +265,7 @@ void VisualizerPage::repopulateSources()
   }
 
   // If we were on Auto and now have stream targets, pick the first available target.
-  if (!m_userHasChosenTarget && m_tap && !m_tap->captureSink() && m_tap->targetObject().isEmpty() && m_sources->count() > 1) {
+  if (!m_userHasChosenTarget && m_subscription && !m_subscription->captureSink() && m_subscription->targetObject().isEmpty() && m_sources->count() > 1) {
     int bestIndex = -1;
     int bestScore = -1;
     for (int i = 0; i < m_sources->count(); ++i) {
@@ -313,7 +298,7 @@ void VisualizerPage::repopulateSources()
       const auto specOpt = tapSpecFromVariant(m_sources->itemData(bestIndex));
       if (specOpt.has_value()) {
         m_sources->setCurrentIndex(bestIndex);
-        m_tap->setTarget(specOpt->captureSink, specOpt->targetObject);
+        m_subscription->setTarget(specOpt->captureSink, specOpt->targetObject);
       }
     }
   }
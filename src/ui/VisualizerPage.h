@@ -4,7 +4,8 @@
 
 class QLabel;
 class QComboBox;
-class AudioTap;
+class AnalysisHub;
+class AnalysisSubscription;
 class PipeWireGraph;
 class VisualizerWidget;
 struct VisualizerSettings;
@@ -14,21 +15,18 @@ class VisualizerPage final : public QWidget
   Q_OBJECT
 
 public:
-  explicit VisualizerPage(PipeWireGraph* graph, AudioTap* tap, QWidget* parent = nullptr);
+  explicit VisualizerPage(PipeWireGraph* graph, AnalysisHub* hub, QWidget* parent = nullptr);
 
 public slots:
   void setTapTarget(const QString& targetObject, bool captureSink);
   void applySettings(const VisualizerSettings& settings);
 
-protected:
-  void showEvent(QShowEvent* event) override;
-  void hideEvent(QHideEvent* event) override;
-
 private:
   void repopulateSources();
 
   PipeWireGraph* m_graph = nullptr;
-  AudioTap* m_tap = nullptr;
+  AnalysisHub* m_hub = nullptr;
+  AnalysisSubscription* m_subscription = nullptr;
   VisualizerWidget* m_widget = nullptr;
   QComboBox* m_sources = nullptr;
   QLabel* m_state = nullptr;
@@ -5,7 +5,6 @@
 
 #include <algorithm>
 #include <QPainter>
-#include <QTimer>
 #include <QtGlobal>
 
 #include <cmath>
@@ -14,17 +13,19 @@ namespace {
 constexpr float kPi = 3.14159265358979323846f;
 } // namespace
 
-VisualizerWidget::VisualizerWidget(AudioTap* tap, QWidget* parent)
+VisualizerWidget::VisualizerWidget(AnalysisSubscription* subscription, QWidget* parent)
     : QWidget(parent)
-    , m_tap(tap)
+    , m_subscription(subscription)
 {
   setAutoFillBackground(false);
   setAttribute(Qt::WA_OpaquePaintEvent, true);
   setAttribute(Qt::WA_NoSystemBackground, true);
   setMinimumHeight(280);
 
-  m_timer = new QTimer(this);
-  connect(m_timer, &QTimer::timeout, this, QOverload<>::of(&VisualizerWidget::update));
+  if (m_subscription) {
+    connect(m_subscription, &AnalysisSubscription::updated, this, QOverload<>::of(&VisualizerWidget::update));
+    connect(m_subscription, &AnalysisSubscription::tapChanged, this, QOverload<>::of(&VisualizerWidget::update));
+  }
 
   QSettings s;
   applySettings(VisualizerSettingsStore::load(s));
@@ -32,18 +33,11 @@ VisualizerWidget::VisualizerWidget(AudioTap* tap, QWidget* parent)
 
 void VisualizerWidget::applySettings(const VisualizerSettings& settings)
 {
-  m_refreshIntervalMs = std::clamp(settings.refreshIntervalMs, 8, 250);
-  m_waveformHistorySeconds = std::clamp(settings.waveformHistorySeconds, 0.05, 30.0);
-
-  if (m_timer) {
-    m_timer->setInterval(m_refreshIntervalMs);
-    if (isVisible()) {
-      if (!m_timer->isActive()) {
-        m_timer->start();
-      }
-    } else {
-      m_timer->stop();
-    }
+  m_waveformHistorySeconds = std::clamp(settings.waveformHistorySeconds, 0.05, 300.0);
+
+  if (m_subscription) {
+    m_subscription->setRefreshIntervalMs(std::clamp(settings.refreshIntervalMs, 8, 250));
+    m_subscription->setActive(isVisible());
   }
 
   update();
@@ -52,16 +46,16 @@ void VisualizerWidget::applySettings(const VisualizerSettings& settings)
 void VisualizerWidget::showEvent(QShowEvent* event)
 {
   QWidget::showEvent(event);
-  if (m_timer && !m_timer->isActive()) {
-    m_timer->start(m_refreshIntervalMs);
+  if (m_subscription) {
+    m_subscription->setActive(true);
   }
 }
 
 void VisualizerWidget::hideEvent(QHideEvent* event)
 {
   QWidget::hideEvent(event);
-  if (m_timer) {
-    m_timer->stop();
+  if (m_subscription) {
+    m_subscription->setActive(false);
   }
 }
 
@@ -103,7 +97,8 @@ void VisualizerWidget::paintEvent(QPaintEvent* /*event*/)
   p.drawRoundedRect(spectrumRect, 10, 10);
   p.drawRoundedRect(spectrogramRect, 10, 10);
 
-  if (!m_tap) {
+  AudioTap* tap = m_subscription ? m_subscription->tap() : nullptr;
+  if (!tap) {
     p.setPen(QColor(180, 190, 210));
     p.drawText(inner, Qt::AlignCenter, tr("No audio tap"));
     return;
@@ -111,24 +106,32 @@ void VisualizerWidget::paintEvent(QPaintEvent* /*event*/)
 
   // Header (meters).
   const bool demo = qEnvironmentVariableIsSet("HEADROOM_DEMO_VISUALIZER");
-  float peak = m_tap->peak();
-  float rms = m_tap->rms();
+  float peak = tap->peak();
+  float rms = tap->rms();
   if (demo && peak <= 0.0001f && rms <= 0.0001f) {
     peak = 0.742f;
     rms = 0.311f;
   }
+  const bool midSide = tap->hasMidSide();
+  QString header = tr("Peak: %1  RMS: %2").arg(QString::number(peak, 'f', 3), QString::number(rms, 'f', 3));
+  if (midSide) {
+    header += tr("  Corr: %1").arg(QString::number(tap->correlation(), 'f', 2));
+  }
+  float peakHz = 0.0f;
+  float peakDb = 0.0f;
+  if (tap->spectrumPeak(AudioTap::SourceMix, peakHz, peakDb) && peakDb > -90.0f) {
+    header += tr("  Max: %1 Hz @ %2 dB").arg(QString::number(peakHz, 'f', peakHz < 1000.0f ? 1 : 0), QString::number(peakDb, 'f', 1));
+  }
   p.setPen(QColor(185, 195, 215));
-  p.drawText(QRect(inner.left(), inner.top() - 4, inner.width(), 16),
-             Qt::AlignLeft | Qt::AlignVCenter,
-             tr("Peak: %1  RMS: %2").arg(QString::number(peak, 'f', 3), QString::number(rms, 'f', 3)));
+  p.drawText(QRect(inner.left(), inner.top() - 4, inner.width(), 16), Qt::AlignLeft | Qt::AlignVCenter, header);
 
   // Waveform.
   QVector<float> mins;
   QVector<float> maxs;
   const int columns = std::max(1, waveformRect.width() - 4);
-  const uint32_t sr = m_tap->sampleRate();
+  const uint32_t sr = tap->sampleRate();
   const int windowSamples = std::max(1, static_cast<int>(std::llround(m_waveformHistorySeconds * static_cast<double>(sr))));
-  m_tap->waveformMinMax(columns, windowSamples, mins, maxs);
+  tap->waveformMinMax(columns, windowSamples, mins, maxs);
   if (demo && (mins.isEmpty() || maxs.isEmpty())) {
     mins.resize(columns);
     maxs.resize(columns);
@@ -144,25 +147,46 @@ void VisualizerWidget::paintEvent(QPaintEvent* /*event*/)
     }
   }
 
-  const float midY = waveformRect.center().y();
-  const float amp = (waveformRect.height() * 0.45f);
+  auto drawWaveform = [&p](const QRect& lane, const QVector<float>& laneMins, const QVector<float>& laneMaxs, int laneColumns) {
+    const float midY = lane.center().y();
+    const float amp = (lane.height() * 0.45f);
+    for (int x = 0; x < laneColumns && x < laneMins.size() && x < laneMaxs.size(); ++x) {
+      const float minV = std::clamp(laneMins[x], -1.0f, 1.0f);
+      const float maxV = std::clamp(laneMaxs[x], -1.0f, 1.0f);
+      const int px = lane.left() + 2 + x;
+      const int y1 = static_cast<int>(midY - maxV * amp);
+      const int y2 = static_cast<int>(midY - minV * amp);
+      p.drawLine(px, y1, px, y2);
+    }
+  };
+
   p.setRenderHint(QPainter::Antialiasing, false);
   p.setPen(QPen(QColor(99, 102, 241), 1));
-  for (int x = 0; x < columns && x < mins.size() && x < maxs.size(); ++x) {
-    const float minV = std::clamp(mins[x], -1.0f, 1.0f);
-    const float maxV = std::clamp(maxs[x], -1.0f, 1.0f);
-    const int px = waveformRect.left() + 2 + x;
-    const int y1 = static_cast<int>(midY - maxV * amp);
-    const int y2 = static_cast<int>(midY - minV * amp);
-    p.drawLine(px, y1, px, y2);
+  const int channelLanes = tap->channelCount();
+  if (channelLanes > 0) {
+    // Per-channel mode: one lane per analysed channel, labelled with its position.
+    const QStringList names = tap->channelNames();
+    const int laneHeight = std::max(1, waveformRect.height() / channelLanes);
+    for (int ch = 0; ch < channelLanes; ++ch) {
+      const QRect lane(waveformRect.left(), waveformRect.top() + ch * laneHeight, waveformRect.width(), laneHeight);
+      tap->waveformMinMax(columns, windowSamples, mins, maxs, ch);
+      p.setPen(QPen(QColor(99, 102, 241), 1));
+      drawWaveform(lane, mins, maxs, columns);
+      if (ch < names.size()) {
+        p.setPen(QColor(150, 160, 185));
+        p.drawText(lane.adjusted(6, 0, 0, 0), Qt::AlignLeft | Qt::AlignTop, names[ch]);
+      }
+    }
+  } else {
+    drawWaveform(waveformRect, mins, maxs, columns);
   }
   p.setRenderHint(QPainter::Antialiasing, true);
 
-  // Spectrum.
-  QVector<float> spectrum = m_tap->spectrum();
+  // Spectrum (pre-aggregated display bands, so one bar per band rather than per FFT bin).
+  QVector<float> spectrum = tap->bands();
   if (demo) {
     if (spectrum.isEmpty()) {
-      spectrum.resize(256);
+      spectrum.resize(96);
     }
     const int bins = spectrum.size();
     for (int i = 0; i < bins; ++i) {
@@ -175,15 +199,38 @@ void VisualizerWidget::paintEvent(QPaintEvent* /*event*/)
       spectrum[i] = std::clamp(0.75f * p1 + 0.55f * p2 + 0.40f * p3 + floor, 0.0f, 1.0f);
     }
   }
+  QRect barsRect = spectrumRect;
+  if (midSide) {
+    // Phase scope (goniometer): side on x, mid on y, in a square at the right of the spectrum.
+    const int side = std::max(0, spectrumRect.height() - 8);
+    const QRect scopeRect(spectrumRect.right() - side - 4, spectrumRect.top() + 4, side, side);
+    barsRect.setRight(scopeRect.left() - 8);
+
+    QVector<float> scopeMid;
+    QVector<float> scopeSide;
+    tap->phaseScope(1024, scopeMid, scopeSide);
+    p.setPen(QPen(QColor(40, 46, 60), 1));
+    p.setBrush(Qt::NoBrush);
+    p.drawRect(scopeRect);
+    p.setPen(QPen(QColor(34, 211, 238, 140), 1));
+    const QPointF c = QRectF(scopeRect).center();
+    const float r = static_cast<float>(side) * 0.5f;
+    for (int i = 0; i < scopeMid.size(); ++i) {
+      const float x = std::clamp(scopeSide[i], -1.0f, 1.0f) * r;
+      const float y = std::clamp(scopeMid[i], -1.0f, 1.0f) * r;
+      p.drawPoint(QPointF(c.x() + x, c.y() - y));
+    }
+  }
+
   if (!spectrum.isEmpty()) {
     p.setPen(Qt::NoPen);
     const int bins = spectrum.size();
-    const float barW = static_cast<float>(spectrumRect.width()) / static_cast<float>(bins);
+    const float barW = static_cast<float>(barsRect.width()) / static_cast<float>(bins);
     for (int i = 0; i < bins; ++i) {
       const float v = std::clamp(spectrum[i], 0.0f, 1.0f);
-      const int h = static_cast<int>(v * (spectrumRect.height() - 6));
-      const QRect bar(spectrumRect.left() + static_cast<int>(i * barW),
-                      spectrumRect.bottom() - 3 - h,
+      const int h = static_cast<int>(v * (barsRect.height() - 6));
+      const QRect bar(barsRect.left() + static_cast<int>(i * barW),
+                      barsRect.bottom() - 3 - h,
                       std::max(1, static_cast<int>(barW)),
                       h);
       const QColor c = QColor::fromHsvF(0.58 - 0.58 * v, 0.85, 0.95);
@@ -193,33 +240,64 @@ void VisualizerWidget::paintEvent(QPaintEvent* /*event*/)
   }
 
   // Spectrogram.
-  auto spec = m_tap->spectrogram();
-  if (spec.columns > 0 && spec.bins > 0 && spec.pixels.size() == spec.columns * spec.bins) {
-    QImage img(spec.columns, spec.bins, QImage::Format_ARGB32);
+  updateSpectrogramImage(tap, demo);
+  if (!m_specImage.isNull()) {
+    // Oldest column is at m_specImageCol; draw [col, width) then [0, col) left to right.
+    const QRectF target = QRectF(spectrogramRect.adjusted(2, 2, -2, -2));
+    const int w = m_specImage.width();
+    const int h = m_specImage.height();
+    const qreal scale = target.width() / static_cast<qreal>(w);
+    const int olderCols = w - m_specImageCol;
+    p.setRenderHint(QPainter::SmoothPixmapTransform, false);
+    p.drawImage(QRectF(target.left(), target.top(), olderCols * scale, target.height()), m_specImage, QRectF(m_specImageCol, 0, olderCols, h));
+    if (m_specImageCol > 0) {
+      p.drawImage(QRectF(target.left() + olderCols * scale, target.top(), m_specImageCol * scale, target.height()),
+                  m_specImage,
+                  QRectF(0, 0, m_specImageCol, h));
+    }
+    p.setRenderHint(QPainter::SmoothPixmapTransform, true);
+  }
+}
+
+void VisualizerWidget::updateSpectrogramImage(AudioTap* tap, bool demo)
+{
+  tap->spectrogramSince(m_specCursor, m_specUpdate);
+  const SpectrogramUpdate& u = m_specUpdate;
+  if (u.columns <= 0 || u.bins <= 0) {
+    m_specImage = QImage();
+    return;
+  }
+
+  if (u.reset || m_specImage.width() != u.columns || m_specImage.height() != u.bins) {
+    m_specImage = QImage(u.columns, u.bins, QImage::Format_ARGB32);
+    m_specImage.fill(0U);
+    m_specImageCol = 0;
     if (demo) {
-      for (int x = 0; x < spec.columns; ++x) {
-        const float xf = static_cast<float>(x) / static_cast<float>(std::max(1, spec.columns - 1));
-        for (int y = 0; y < spec.bins; ++y) {
-          const float yf = static_cast<float>(y) / static_cast<float>(std::max(1, spec.bins - 1));
+      for (int x = 0; x < u.columns; ++x) {
+        const float xf = static_cast<float>(x) / static_cast<float>(std::max(1, u.columns - 1));
+        for (int y = 0; y < u.bins; ++y) {
+          const float yf = static_cast<float>(y) / static_cast<float>(std::max(1, u.bins - 1));
           const float ridge = std::exp(-0.5f * std::pow((yf - (0.15f + 0.55f * xf)) / 0.06f, 2.0f));
           const float ridge2 = std::exp(-0.5f * std::pow((yf - (0.55f - 0.35f * xf)) / 0.08f, 2.0f));
           const float v = std::clamp(0.12f + 0.78f * ridge + 0.52f * ridge2, 0.0f, 1.0f);
-          img.setPixel(x, y, QColor::fromHsvF(0.62 - 0.62 * v, 0.9, 0.95).rgba());
-        }
-      }
-    } else {
-      for (int x = 0; x < spec.columns; ++x) {
-        const int srcCol = (spec.writeColumn + x) % spec.columns; // oldest -> newest
-        for (int y = 0; y < spec.bins; ++y) {
-          const int srcRow = spec.bins - 1 - y; // low at bottom
-          const int srcIndex = srcCol * spec.bins + srcRow;
-          img.setPixel(x, y, spec.pixels[srcIndex]);
+          m_specImage.setPixel(x, y, QColor::fromHsvF(0.62 - 0.62 * v, 0.9, 0.95).rgba());
         }
       }
     }
+  }
+  if (demo || u.newColumns <= 0 || u.pixels.size() != u.newColumns * u.bins) {
+    return;
+  }
 
-    p.setRenderHint(QPainter::SmoothPixmapTransform, false);
-    p.drawImage(spectrogramRect.adjusted(2, 2, -2, -2), img);
-    p.setRenderHint(QPainter::SmoothPixmapTransform, true);
+  // Patch only the new columns (low frequencies at the bottom).
+  uchar* bits = m_specImage.bits();
+  const qsizetype stride = m_specImage.bytesPerLine();
+  const uint32_t* src = u.pixels.constData();
+  for (int c = 0; c < u.newColumns; ++c) {
+    for (int bin = 0; bin < u.bins; ++bin) {
+      reinterpret_cast<QRgb*>(bits + (u.bins - 1 - bin) * stride)[m_specImageCol] = src[bin];
+    }
+    src += u.bins;
+    m_specImageCol = (m_specImageCol + 1) % u.columns;
   }
 }
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "backend/AnalysisHub.h"
+#include "backend/AudioTap.h"
+
+#include <QImage>
 #include <QWidget>
 
-class AudioTap;
-class QTimer;
 struct VisualizerSettings;
 
 class VisualizerWidget final : public QWidget
@@ -11,7 +13,7 @@ class VisualizerWidget final : public QWidget
   Q_OBJECT
 
 public:
-  explicit VisualizerWidget(AudioTap* tap, QWidget* parent = nullptr);
+  explicit VisualizerWidget(AnalysisSubscription* subscription, QWidget* parent = nullptr);
 
 public slots:
   void applySettings(const VisualizerSettings& settings);
@@ -22,8 +24,15 @@ protected:
   void paintEvent(QPaintEvent* event) override;
 
 private:
-  AudioTap* m_tap = nullptr;
-  QTimer* m_timer = nullptr;
-  int m_refreshIntervalMs = 33;
+  void updateSpectrogramImage(AudioTap* tap, bool demo);
+
+  AnalysisSubscription* m_subscription = nullptr;
   double m_waveformHistorySeconds = 0.5;
+
+  // Persistent spectrogram image used as a column ring: new columns are patched in at
+  // m_specImageCol and the image is drawn in two pieces, so nothing is rebuilt per frame.
+  QImage m_specImage;
+  int m_specImageCol = 0;
+  SpectrogramCursor m_specCursor;
+  SpectrogramUpdate m_specUpdate;
 };